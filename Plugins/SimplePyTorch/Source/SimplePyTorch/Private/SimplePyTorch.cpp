@@ -13,7 +13,13 @@ void FSimplePyTorchModule::StartupModule()
 	// Init DLL from a Path
 	FString FilePath;
 	const FString szBinaries = TEXT("Binaries");
+#if PLATFORM_LINUX
+	const FString szPlatform = TEXT("Linux");
+	const FString szWrapperFile = TEXT("libtorchscript_wrapper.so");
+#else
 	const FString szPlatform = TEXT("Win64");
+	const FString szWrapperFile = TEXT("torchscript_wrapper.dll");
+#endif
 
 	WrapperDllHandle = NULL;
 	bDllLoaded = false;
@@ -33,9 +39,10 @@ void FSimplePyTorchModule::StartupModule()
 	FilePath = FPaths::ProjectDir() / TEXT("Binaries/ThirdParty/PyTorch");
 #endif
 
-#if PLATFORM_WINDOWS
+#if WITH_TORCHSCRIPT_WRAPPER
+	// Linux: libtorch shared objects are resolved through wrapper's RPATH ($ORIGIN)
 	FPlatformProcess::PushDllDirectory(*FilePath);
-	FilePath = FilePath / TEXT("torchscript_wrapper.dll");
+	FilePath = FilePath / szWrapperFile;
 
 	if (FPaths::FileExists(FilePath))
 	{
@@ -96,7 +103,7 @@ void FSimplePyTorchModule::StartupModule()
 
 void FSimplePyTorchModule::ShutdownModule()
 {
-#if PLATFORM_WINDOWS
+#if WITH_TORCHSCRIPT_WRAPPER
 	if (WrapperDllHandle != NULL)
 	{
 		FPlatformProcess::FreeDllHandle(WrapperDllHandle);
@@ -6,10 +6,11 @@
 #include "Modules/ModuleManager.h"
 #include "HAL/UnrealMemory.h"
 #include "HAL/CriticalSection.h"
+#include "Misc/ScopeRWLock.h"
 #include <vector>
 
-#if PLATFORM_WINDOWS
-	FCriticalSection USimpleTorchModule::ExecuteCritSection;
+#if WITH_TORCHSCRIPT_WRAPPER
+	FRWLock USimpleTorchModule::ModelsListLock;
 #endif
 
 USimpleTorchModule::USimpleTorchModule()
@@ -24,7 +25,7 @@ void USimpleTorchModule::BeginDestroy()
 {
 	Super::BeginDestroy();
 
-#if PLATFORM_WINDOWS
+#if WITH_TORCHSCRIPT_WRAPPER
 	FScopeLock Lock(&ExecuteCritSection);
 #endif
 
@@ -52,9 +53,10 @@ bool USimpleTorchModule::LoadTorchScriptModel(FString FileName)
 	FSimplePyTorchModule& Module = FModuleManager::GetModuleChecked<FSimplePyTorchModule>(TEXT("SimplePyTorch"));
 
 	bool bResult = false;
-#if PLATFORM_WINDOWS
+#if WITH_TORCHSCRIPT_WRAPPER
 	if (Module.bDllLoaded)
 	{
+		FWriteScopeLock ListLock(ModelsListLock);
 		FScopeLock Lock(&ExecuteCritSection);
 
 		if (Buffer != NULL)
@@ -70,6 +72,7 @@ bool USimpleTorchModule::LoadTorchScriptModel(FString FileName)
 		}
 		BufferDims = new int[16];
 
+		RawMethods.Reset();
 		ModelId = Module.FuncTSW_LoadScriptModel(TCHAR_TO_ANSI(*FileName));
 		bResult = (ModelId != INDEX_NONE);
 	}
@@ -87,7 +90,7 @@ bool USimpleTorchModule::IsTorchModelLoaded() const
 	FSimplePyTorchModule& Module = FModuleManager::GetModuleChecked<FSimplePyTorchModule>(TEXT("SimplePyTorch"));
 
 	bool bResult = false;
-#if PLATFORM_WINDOWS
+#if WITH_TORCHSCRIPT_WRAPPER
 	if (Module.bDllLoaded && Module.FuncTSW_CheckModel)
 	{
 		bResult = Module.FuncTSW_CheckModel(ModelId);
@@ -104,14 +107,15 @@ bool USimpleTorchModule::DoForwardCall(const FSimpleTorchTensor& InData, FSimple
 
 bool USimpleTorchModule::ExecuteModelMethod(const FString& MethodName, const FSimpleTorchTensor& InData, FSimpleTorchTensor& OutData)
 {
-#if PLATFORM_WINDOWS
+#if WITH_TORCHSCRIPT_WRAPPER
 	FSimplePyTorchModule& Module = FModuleManager::GetModuleChecked<FSimplePyTorchModule>(TEXT("SimplePyTorch"));
 	
 	bool bResult = false;
 	if (Module.bDllLoaded && Buffer != NULL && OutData.IsDataOwner())
 	{
+		FReadScopeLock ListLock(ModelsListLock);
 		FScopeLock Lock(&ExecuteCritSection);
-		TArray<int> InDims = InData.GetDimensions();
+		const TArray<int32>& InDims = InData.GetDimensionsRef();
 
 		float* pOutData = OutData.IsValid()
 			? OutData.GetRawData()
@@ -132,8 +136,8 @@ bool USimpleTorchModule::ExecuteModelMethod(const FString& MethodName, const FSi
 		bResult = (OutDimsCount > 0 && OutDimsCount < 8192);
 		if (bResult)
 		{
-			TArray<int32> OldOutDims = OutData.GetDimensions();
-			bool bOutTensorMatches = (OutDimsCount == OutData.GetDimensions().Num());
+			const TArray<int32>& OldOutDims = OutData.GetDimensionsRef();
+			bool bOutTensorMatches = (OutDimsCount == OldOutDims.Num());
 			TArray<int32> NewOutDims;
 
 			int32 Length = 1;
@@ -165,7 +169,8 @@ bool USimpleTorchModule::ExecuteModelMethod(const FString& MethodName, const FSi
 				{
 					OutData.Create(NewOutDims);
 				}
-				FMemory::Memcpy(OutData.GetRawData(), Buffer, Length * sizeof(float));
+				// Buffer only holds BufferSize floats; larger (sequence) outputs must be pre-allocated by caller
+				FMemory::Memcpy(OutData.GetRawData(), Buffer, FMath::Min(Length, BufferSize) * sizeof(float));
 			}
 		}
 		else
@@ -180,6 +185,104 @@ bool USimpleTorchModule::ExecuteModelMethod(const FString& MethodName, const FSi
 #endif
 }
 
+int32 USimpleTorchModule::ExecuteModelMethodRaw(const ANSICHAR* MethodName, const float* InData, const int32* InDimensions, int32 InDimensionsNum, float* OutData, int32 OutCapacity)
+{
+#if WITH_TORCHSCRIPT_WRAPPER
+	FSimplePyTorchModule& Module = FModuleManager::GetModuleChecked<FSimplePyTorchModule>(TEXT("SimplePyTorch"));
+
+	if (!Module.bDllLoaded || Buffer == NULL || BufferDims == NULL || !OutData || InDimensionsNum <= 0 || InDimensionsNum > 16)
+	{
+		return INDEX_NONE;
+	}
+
+	FReadScopeLock ListLock(ModelsListLock);
+	FScopeLock Lock(&ExecuteCritSection);
+
+	auto GetOutputLength = [this](int OutDimsCount)
+	{
+		if (OutDimsCount <= 0 || OutDimsCount >= 16)
+		{
+			return (int32)INDEX_NONE;
+		}
+		int32 Length = 1;
+		for (int i = 0; i < OutDimsCount; i++)
+		{
+			Length *= BufferDims[i];
+		}
+		return Length;
+	};
+
+	int32 InputLength = 1;
+	for (int32 i = 0; i < InDimensionsNum; i++)
+	{
+		InputLength *= InDimensions[i];
+	}
+
+	// Wrapper library doesn't take size of output buffer. Output shape is learned once per method from a single-element
+	// input written to Buffer (which is expected to hold output of a single element, see ExecuteModelMethod).
+	// If the first call of method has several elements, the first of them is evaluated separately before the call.
+	// Methods are found without creating FName: a model has a few of them.
+	FSimpleTorchRawMethod* Method = RawMethods.FindByPredicate([MethodName](const FSimpleTorchRawMethod& Item)
+	{
+		return FCStringAnsi::Strcmp(Item.Name.GetData(), MethodName) == 0;
+	});
+	if (!Method)
+	{
+		int ProbeDims[16];
+		for (int32 i = 0; i < InDimensionsNum; i++)
+		{
+			ProbeDims[i] = 1;
+		}
+		float* pOutData = Buffer;
+		int OutDimsCount = 0;
+		Module.FuncTSW_Execute_Def(ModelId, const_cast<ANSICHAR*>(MethodName), InData, ProbeDims, InDimensionsNum,
+			pOutData, BufferDims, &OutDimsCount);
+
+		const int32 Length = GetOutputLength(OutDimsCount);
+		if (Length == INDEX_NONE || Length > BufferSize)
+		{
+			return INDEX_NONE;
+		}
+		Method = &RawMethods.AddDefaulted_GetRef();
+		Method->Name.Append(MethodName, FCStringAnsi::Strlen(MethodName) + 1);
+		Method->OutputLength = Length;
+		// Output size is known for any input only if leading axis of output is the input axis: [1, ...] -> [N, ...]
+		Method->OutputPerInput = (OutDimsCount > 1 && BufferDims[0] == 1) ? Length : 0;
+
+		if (InputLength == 1)
+		{
+			if (Length > OutCapacity)
+			{
+				return INDEX_NONE;
+			}
+			FMemory::Memcpy(OutData, Buffer, Length * sizeof(float));
+			return Length;
+		}
+	}
+
+	// Only call the model if the whole output fits caller's buffer
+	const int32 ExpectedLength = InputLength == 1 ? Method->OutputLength : InputLength * Method->OutputPerInput;
+	if (ExpectedLength == 0 || ExpectedLength > OutCapacity)
+	{
+		return INDEX_NONE;
+	}
+
+	int OutDimsCount = 0;
+	Module.FuncTSW_Execute_Def(ModelId, const_cast<ANSICHAR*>(MethodName), InData, InDimensions, InDimensionsNum,
+		OutData, BufferDims, &OutDimsCount);
+
+	const int32 Length = GetOutputLength(OutDimsCount);
+	if (Length != ExpectedLength)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ExecuteModelMethodRaw: unexpected output size %d (expected %d)"), Length, ExpectedLength);
+		return INDEX_NONE;
+	}
+	return Length;
+#else
+	return INDEX_NONE;
+#endif
+}
+
 /******************************************************************************************************/
 /* FSimpleTorchTensor																					  */
 /******************************************************************************************************/
@@ -96,6 +96,9 @@ public:
 	// Get current tensor dimensions
 	TArray<int32> GetDimensions() const;
 
+	// Get current tensor dimensions without copying
+	const TArray<int32>& GetDimensionsRef() const { return Dimensions; }
+
 	// Get number of itemes in flat array
 	int32 GetDataSize() const { return DataSize; }
 
@@ -150,6 +153,17 @@ public:
 	FSimpleTorchTensor& operator-=(float Value);
 };
 
+/** Output size of model method learned by USimpleTorchModule::ExecuteModelMethodRaw */
+struct FSimpleTorchRawMethod
+{
+	/** Null-terminated method name */
+	TArray<ANSICHAR> Name;
+	/** Output floats for a single-element input */
+	int32 OutputLength = 0;
+	/** Output floats per input element (0 if output doesn't have input axis) */
+	int32 OutputPerInput = 0;
+};
+
 /**
  * 
  */
@@ -183,6 +197,16 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Simple Torch", meta = (DisplayName = "Do Forward Call"))
 	bool ExecuteModelMethod(const FString& MethodName, const FSimpleTorchTensor& InData, FSimpleTorchTensor& OutData);
 
+	/**
+	* Execute method with caller's buffers, without tensor objects and heap allocations.
+	* Output size for a single-element input is learned once per method. Inputs of several elements are only evaluated
+	* if output keeps their leading axis ([1, ...] for a single element) and the whole output fits OutCapacity,
+	* because the wrapper library can't limit size of written data.
+	* @param OutData		Buffer for at least OutCapacity floats
+	* @return Number of floats written to OutData or INDEX_NONE if request failed
+	*/
+	int32 ExecuteModelMethodRaw(const ANSICHAR* MethodName, const float* InData, const int32* InDimensions, int32 InDimensionsNum, float* OutData, int32 OutCapacity);
+
 private:
 	/** Identified of the loaded torch script model */
 	int32 ModelId;
@@ -195,8 +219,13 @@ private:
 	/** Output Buffer dimensions */
 	int* BufferDims;
 
-	// Critical session for ProcessPhonemesData
-#if PLATFORM_WINDOWS
-	static FCriticalSection ExecuteCritSection;
+	/** Methods called by ExecuteModelMethodRaw in the loaded model */
+	TArray<FSimpleTorchRawMethod> RawMethods;
+
+#if WITH_TORCHSCRIPT_WRAPPER
+	// Protects Buffer/BufferDims of this instance: different modules can be executed in parallel
+	FCriticalSection ExecuteCritSection;
+	// Loading a model modifies list of models in wrapper library, so it's exclusive to execution
+	static FRWLock ModelsListLock;
 #endif
 };
@@ -14,6 +14,10 @@ public class SimplePyTorch : ModuleRules
 	{
 		get { return Path.GetFullPath(Path.Combine(TorchPath, "Binaries/Win64")); }
 	}
+	private string TorchLinuxBinariesPath
+	{
+		get { return Path.GetFullPath(Path.Combine(TorchPath, "Binaries/Linux")); }
+	}
 
 	public SimplePyTorch(ReadOnlyTargetRules Target) : base(Target)
 	{
@@ -58,6 +62,9 @@ public class SimplePyTorch : ModuleRules
 			}
 			);
 
+		bool bWithTorchScriptWrapper = (Target.Platform == UnrealTargetPlatform.Win64 || Target.Platform == UnrealTargetPlatform.Linux);
+		PublicDefinitions.Add("WITH_TORCHSCRIPT_WRAPPER=" + (bWithTorchScriptWrapper ? "1" : "0"));
+
 		if (Target.Platform == UnrealTargetPlatform.Win64)
 		{
 			// LibTorch libraries
@@ -84,5 +91,20 @@ public class SimplePyTorch : ModuleRules
 				RuntimeDependencies.Add(Path.Combine(DllTargetDir, "NOTICE.txt"), Path.Combine(TorchPath, "NOTICE.txt"), StagedFileType.NonUFS);
 			}
 		}
+		else if (Target.Platform == UnrealTargetPlatform.Linux)
+		{
+			// libtorch (CPU) shared objects and libtorchscript_wrapper.so built from the same wrapper sources as Win64 dll;
+			// the wrapper is linked with RPATH=$ORIGIN, so all files must stay in one directory
+			if (!Target.bBuildEditor && Target.Type == TargetType.Game && Directory.Exists(TorchLinuxBinariesPath))
+			{
+				string SoTargetDir = "$(ProjectDir)/Binaries/ThirdParty/PyTorch/";
+				foreach (string SoFile in Directory.GetFiles(TorchLinuxBinariesPath, "*.so*"))
+				{
+					RuntimeDependencies.Add(Path.Combine(SoTargetDir, Path.GetFileName(SoFile)), SoFile);
+				}
+				RuntimeDependencies.Add(Path.Combine(SoTargetDir, "LICENSE.txt"), Path.Combine(TorchPath, "LICENSE.txt"), StagedFileType.NonUFS);
+				RuntimeDependencies.Add(Path.Combine(SoTargetDir, "NOTICE.txt"), Path.Combine(TorchPath, "NOTICE.txt"), StagedFileType.NonUFS);
+			}
+		}
 	}
 }
@@ -0,0 +1,144 @@
+# (c) Yuri N. K. 2022. All rights reserved.
+# ykasczc@gmail.com
+#
+# Reference output of MetaFace TorchScript models for YnnkMetaFace.Inference.TorchGoldenParity.
+# Models are evaluated by a plain Python implementation of Text2Emotion.eval_compute (2-layer GRU + ReLU + Linear)
+# with weights read directly from .tmod archive, so neither libtorch nor the plugin's torch wrapper is used.
+#
+# Usage: python make_golden_outputs.py [Resources directory]
+# Writes <model>.golden.csv: one line per eval_compute call of a freshly loaded model,
+# "input,value0,value1,...", inputs are all values of UNeuralProcessWrapper::GetModelInputRange in ascending order.
+
+import math
+import os
+import pickle
+import struct
+import sys
+import zipfile
+
+MODELS = ["ynnklipsync", "ynnkemotions_en"]
+
+# UNeuralProcessWrapper::GetModelInputRange
+INPUT_MIN = (ord("0") - ord("a")) * 2 + 1
+INPUT_MAX = (ord("z") - ord("a")) * 2 + 2
+
+
+class Tensor:
+    def __init__(self, storage, offset, size, stride):
+        self.storage, self.offset, self.size, self.stride = storage, offset, tuple(size), tuple(stride)
+
+    def rows(self):
+        """2D tensor as list of rows (1D tensor as a single row)"""
+        if len(self.size) == 1:
+            return [self.storage[self.offset:self.offset + self.size[0] * self.stride[0]:self.stride[0]]]
+        return [[self.storage[self.offset + r * self.stride[0] + c * self.stride[1]] for c in range(self.size[1])] for r in range(self.size[0])]
+
+    def flat(self):
+        count = 1
+        for dim in self.size:
+            count *= dim
+        return list(self.storage[self.offset:self.offset + count])
+
+
+class Module:
+    def __setstate__(self, state):
+        self.__dict__.update(state)
+
+
+class TorchScriptUnpickler(pickle.Unpickler):
+    def __init__(self, archive, prefix, data):
+        super().__init__(data)
+        self.archive, self.prefix, self.storages = archive, prefix, {}
+
+    def find_class(self, module, name):
+        if module == "torch._utils" and name == "_rebuild_tensor_v2":
+            return lambda storage, offset, size, stride, *args: Tensor(storage, offset, size, stride)
+        if module == "torch" and name == "FloatStorage":
+            return "float"
+        if module == "torch.jit._pickle":
+            return lambda *args: args[0] if args else None
+        if module == "collections" and name == "OrderedDict":
+            return dict
+        if module.startswith("__torch__"):
+            return type(name, (Module,), {})
+        raise pickle.UnpicklingError("Unexpected class %s.%s" % (module, name))
+
+    def persistent_load(self, pid):
+        _, storage_type, key, location, numel = pid
+        if key not in self.storages:
+            raw = self.archive.read(self.prefix + "data/" + key)
+            self.storages[key] = list(struct.unpack("<%df" % numel, raw[:numel * 4]))
+        return self.storages[key]
+
+
+def load_model(path):
+    with zipfile.ZipFile(path) as archive:
+        prefix = next(n for n in archive.namelist() if n.endswith("data.pkl"))[:-len("data.pkl")]
+        with archive.open(prefix + "data.pkl") as data:
+            return TorchScriptUnpickler(archive, prefix, data).load()
+
+
+def sigmoid(x):
+    return 1.0 / (1.0 + math.exp(-x)) if x >= 0.0 else math.exp(x) / (1.0 + math.exp(x))
+
+
+def matvec(rows, vec, bias):
+    return [sum(w * v for w, v in zip(row, vec)) + b for row, b in zip(rows, bias)]
+
+
+class Text2Emotion:
+    def __init__(self, module):
+        gru = module.gru
+        self.hidden_size = module.hidden_size
+        self.layers = []
+        for layer in range(module.num_layers):
+            self.layers.append((
+                getattr(gru, "weight_ih_l%d" % layer).rows(), getattr(gru, "weight_hh_l%d" % layer).rows(),
+                getattr(gru, "bias_ih_l%d" % layer).flat(), getattr(gru, "bias_hh_l%d" % layer).flat()))
+        self.fc_weight, self.fc_bias = module.fc0.weight.rows(), module.fc0.bias.flat()
+        self.history = module.save_hist.flat()
+        hidden = module.hidden_layer.flat()
+        self.hidden = [hidden[i * self.hidden_size:(i + 1) * self.hidden_size] for i in range(module.num_layers)]
+
+    def gru_step(self, layer, x, h):
+        w_ih, w_hh, b_ih, b_hh = self.layers[layer]
+        gi, gh = matvec(w_ih, x, b_ih), matvec(w_hh, h, b_hh)
+        n = self.hidden_size
+        out = []
+        for i in range(n):
+            r = sigmoid(gi[i] + gh[i])
+            z = sigmoid(gi[n + i] + gh[n + i])
+            c = math.tanh(gi[2 * n + i] + r * gh[2 * n + i])
+            out.append((1.0 - z) * c + z * h[i])
+        return out
+
+    def eval_compute(self, symbol):
+        # History of inputs is shifted, whole history is evaluated from the hidden state of the previous call
+        self.history = self.history[1:] + [(symbol - 15.0) * 3.0]
+        hidden = list(self.hidden)
+        out = None
+        for x in self.history:
+            out = [x]
+            for layer in range(len(self.layers)):
+                hidden[layer] = self.gru_step(layer, out, hidden[layer])
+                out = hidden[layer]
+        self.hidden = hidden
+        out = [max(v, 0.0) for v in out]
+        return [v * 0.01 + 0.15 for v in matvec(self.fc_weight, out, self.fc_bias)]
+
+
+def main():
+    resources = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    for name in MODELS:
+        model = Text2Emotion(load_model(os.path.join(resources, name + ".tmod")))
+        lines = []
+        for symbol in range(INPUT_MIN, INPUT_MAX + 1):
+            values = model.eval_compute(float(symbol))
+            lines.append(",".join([str(symbol)] + ["%.7g" % v for v in values]))
+        with open(os.path.join(resources, "Golden", name + ".golden.csv"), "w", newline="\n") as f:
+            f.write("\n".join(lines) + "\n")
+        print("%s: %d rows" % (name, len(lines)))
+
+
+if __name__ == "__main__":
+    main()
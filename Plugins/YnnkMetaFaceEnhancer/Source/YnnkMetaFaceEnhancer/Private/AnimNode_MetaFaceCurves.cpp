@@ -0,0 +1,191 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "AnimNode_MetaFaceCurves.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "Animation/AnimTrace.h"
+#include "Animation/NamedValueArray.h"
+#include "GameFramework/Actor.h"
+#include "YnnkMetaFaceController.h"
+
+/////////////////////////////////////////////////////
+// FAnimNode_MetaFaceCurves
+
+FAnimNode_MetaFaceCurves::FAnimNode_MetaFaceCurves()
+	: bApplyLipsync(true)
+	, bApplyFacialAnimation(true)
+	, Alpha(1.f)
+{
+}
+
+void FAnimNode_MetaFaceCurves::Initialize_AnyThread(const FAnimationInitializeContext& Context)
+{
+	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(Initialize_AnyThread)
+	FAnimNode_Base::Initialize_AnyThread(Context);
+	Source.Initialize(Context);
+
+	for (FAnimationSampler& Sampler : Samplers)
+	{
+		Sampler = FAnimationSampler();
+	}
+}
+
+void FAnimNode_MetaFaceCurves::CacheBones_AnyThread(const FAnimationCacheBonesContext& Context)
+{
+	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(CacheBones_AnyThread)
+	Source.CacheBones(Context);
+}
+
+void FAnimNode_MetaFaceCurves::Update_AnyThread(const FAnimationUpdateContext& Context)
+{
+	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(Update_AnyThread)
+	GetEvaluateGraphExposedInputs().Execute(Context);
+	Source.Update(Context);
+
+	TRACE_ANIM_NODE_VALUE(Context, TEXT("Alpha"), Alpha);
+}
+
+void FAnimNode_MetaFaceCurves::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	// Game thread: copy playback parameters, clips are shared and immutable
+	if (!Controller.IsValid())
+	{
+		const AActor* Owner = InAnimInstance ? InAnimInstance->GetOwningActor() : nullptr;
+		Controller = Owner ? Owner->FindComponentByClass<UYnnkMetaFaceController>() : nullptr;
+	}
+
+	if (const UYnnkMetaFaceController* MetaFaceController = Controller.Get())
+	{
+		TakeSnapshot(MetaFaceController->CurrentLipsync, Snapshots[0]);
+		TakeSnapshot(MetaFaceController->CurrentFaceAnim, Snapshots[1]);
+	}
+	else
+	{
+		Snapshots[0] = Snapshots[1] = FAnimationSnapshot();
+	}
+}
+
+void FAnimNode_MetaFaceCurves::TakeSnapshot(const FMHFacialAnimation& Animation, FAnimationSnapshot& OutSnapshot) const
+{
+	OutSnapshot.Clip = Animation.GetClip();
+	OutSnapshot.Params = Animation.GetFrameParams();
+	OutSnapshot.DroppedCurves = Animation.GetDroppedCurves();
+	OutSnapshot.bPlaying = Animation.bPlaying;
+	OutSnapshot.bFadingOut = Animation.bInterrupting;
+	if (OutSnapshot.bFadingOut)
+	{
+		OutSnapshot.FadeOutValues = Animation.GetFrameValues();
+	}
+}
+
+void FAnimNode_MetaFaceCurves::SampleAnimation(const FAnimationSnapshot& Snapshot, FAnimationSampler& Sampler, FBlendedCurve& OutCurve)
+{
+	if (!Snapshot.Clip.IsValid() || (!Snapshot.bPlaying && !Snapshot.bFadingOut))
+	{
+		return;
+	}
+
+	const FMetaFaceClip& Clip = *Snapshot.Clip;
+	if (Sampler.Clip != Snapshot.Clip)
+	{
+		// New clip: cache pause mask and order of curves
+		Sampler.Clip = Snapshot.Clip;
+		FMHFacialAnimation::MakePauseMask(Clip, Sampler.PauseMask);
+		FMHFacialAnimation::MakeCurveMask(Clip, Snapshot.DroppedCurves, Sampler.CurveMask);
+		Sampler.DroppedCurves = Snapshot.DroppedCurves;
+		Sampler.Values.SetNumZeroed(Clip.GetStride());
+		Sampler.KeyCursor = 0;
+
+		const TArray<FName>& CurveNames = Clip.GetCurveNames();
+		Sampler.SortedCurves.SetNumUninitialized(CurveNames.Num());
+		for (int32 Curve = 0; Curve < CurveNames.Num(); Curve++)
+		{
+			Sampler.SortedCurves[Curve] = Curve;
+		}
+		Sampler.SortedCurves.Sort([&CurveNames](int32 A, int32 B) { return CurveNames[A].FastLess(CurveNames[B]); });
+	}
+	else if (Sampler.DroppedCurves != Snapshot.DroppedCurves)
+	{
+		// Animation LOD of controller was changed
+		FMHFacialAnimation::MakeCurveMask(Clip, Snapshot.DroppedCurves, Sampler.CurveMask);
+		Sampler.DroppedCurves = Snapshot.DroppedCurves;
+	}
+
+	const float* FrameValues = nullptr;
+	if (Snapshot.bPlaying)
+	{
+		FMHFacialAnimation::EvaluateFrame(Clip, Snapshot.Params, Sampler.PauseMask.GetData(), Sampler.KeyCursor, Sampler.Values.GetData(),
+			Sampler.CurveMask.Num() ? Sampler.CurveMask.GetData() : nullptr);
+		FrameValues = Sampler.Values.GetData();
+	}
+	else if (Snapshot.FadeOutValues.Num() >= Clip.GetCurvesNum())
+	{
+		FrameValues = Snapshot.FadeOutValues.GetData();
+	}
+	else
+	{
+		return;
+	}
+
+	FBlendedCurve AnimationCurve;
+	AnimationCurve.Reserve(Clip.GetCurvesNum());
+	const TArray<FName>& CurveNames = Clip.GetCurveNames();
+	for (const int32 Curve : Sampler.SortedCurves)
+	{
+		AnimationCurve.Add(CurveNames[Curve], FrameValues[Curve]);
+	}
+
+	// Lip-sync and facial animation are added to each other
+	UE::Anim::FNamedValueArrayUtils::Union(OutCurve, AnimationCurve,
+		[](UE::Anim::FCurveElement& InOutResult, const UE::Anim::FCurveElement& InSource, UE::Anim::ENamedValueUnionFlags InFlags)
+		{
+			InOutResult.Value += InSource.Value;
+			InOutResult.Flags |= InSource.Flags;
+		});
+}
+
+void FAnimNode_MetaFaceCurves::Evaluate_AnyThread(FPoseContext& Output)
+{
+	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(Evaluate_AnyThread)
+	Source.Evaluate(Output);
+
+	if (!FAnimWeight::IsRelevant(Alpha))
+	{
+		return;
+	}
+
+	FBlendedCurve MetaFaceCurve;
+	if (bApplyLipsync)
+	{
+		SampleAnimation(Snapshots[0], Samplers[0], MetaFaceCurve);
+	}
+	if (bApplyFacialAnimation)
+	{
+		SampleAnimation(Snapshots[1], Samplers[1], MetaFaceCurve);
+	}
+	if (MetaFaceCurve.Num() == 0)
+	{
+		return;
+	}
+
+	const float BlendAlpha = FMath::Clamp(Alpha, 0.f, 1.f);
+	UE::Anim::FNamedValueArrayUtils::Union(Output.Curve, MetaFaceCurve,
+		[BlendAlpha](UE::Anim::FCurveElement& InOutResult, const UE::Anim::FCurveElement& InSource, UE::Anim::ENamedValueUnionFlags InFlags)
+		{
+			InOutResult.Value = FMath::Lerp(InOutResult.Value, InSource.Value, BlendAlpha);
+			InOutResult.Flags |= InSource.Flags;
+		});
+}
+
+void FAnimNode_MetaFaceCurves::GatherDebugData(FNodeDebugData& DebugData)
+{
+	DECLARE_SCOPE_HIERARCHICAL_COUNTER_ANIMNODE(GatherDebugData)
+	FString DebugLine = DebugData.GetNodeName(this);
+	DebugLine += FString::Printf(TEXT("(Alpha: %.2f, Lip-Sync: %d curves, Facial Animation: %d curves)"), Alpha,
+		Samplers[0].Clip.IsValid() ? Samplers[0].Clip->GetCurvesNum() : 0,
+		Samplers[1].Clip.IsValid() ? Samplers[1].Clip->GetCurvesNum() : 0);
+	DebugData.AddDebugItem(DebugLine);
+
+	Source.GatherDebugData(DebugData);
+}
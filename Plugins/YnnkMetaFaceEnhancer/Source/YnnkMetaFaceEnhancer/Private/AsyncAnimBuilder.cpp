@@ -14,18 +14,17 @@
 #include "MetaFaceTypes.h"
 #include "YnnkMetaFaceSettings.h"
 #include "NeuralProcessWrapper.h"
+#include "MetaFaceInferenceService.h"
+#include "MetaFaceWorkerPool.h"
 #include "HAL/CriticalSection.h"
 #include "Runtime/Launch/Resources/Version.h"
 
-FCriticalSection UAsyncAnimBuilder::StartAsyncMutex;
-
 UAsyncAnimBuilder::UAsyncAnimBuilder()
 	: LipsyncData(nullptr)
 	, bSaveGeneratedAnimationInLipsyncData(false)
 	, bGenerateLipsync(false)
 	, bGenerateFacialAnimation(false)
 	, bIsWorking(false)
-	, bExecutionInterrupted(false)
 	, bLipsyncReady(false)
 	, bFacialAnimationReady(false)
 {
@@ -108,125 +107,131 @@ void UAsyncAnimBuilder::OverrideSettings(UYnnkMetaFaceController* Controller)
 
 void UAsyncAnimBuilder::Start()
 {
-	StartAsyncMutex.Lock();
-
 	if (!LipsyncData)
 	{
 		FMHFacialAnimation AnimLS, AnimFA;
 		CallbackEvent.ExecuteIfBound(AnimLS, AnimFA);
 		return;
 	}
+	auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	if (!ModuleMFE)
+	{
+		OnAnimationFailed();
+		return;
+	}
 	if (!IsValid(NeuralProcessor))
 	{
-		auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
 		NeuralProcessor = ModuleMFE->GetNeuralProcessor();
 	}
 
 	bIsWorking = true;
-
-	// Start import thread
-	WorkingThreadFA = Async(EAsyncExecution::Thread, [this]()
+	CancellationToken = MakeShared<FMetaFaceCancellationToken, ESPMode::ThreadSafe>();
+
+	// Job works with its own copy of input data and settings: a job cancelled by Stop() may still be running after restart
+	const TArray<FPhonemeTextData> Phonemes = LipsyncData->PhonemesData;
+	const FMetaFaceGenerationSettings GenerationSettings(this);
+	const bool bLipsync = bGenerateLipsync;
+	const bool bFacialAnimation = bGenerateFacialAnimation;
+	const bool bBalanceSmileFrown = bBalanceSmileFrownCurves;
+	UPoseAsset* LipsyncPoseAsset = bLipSyncToSkeletonCurves ? ArKitCurvesPoseAsset : nullptr;
+	UPoseAsset* FacialPoseAsset = bFacialAnimationToSkeletonCurves ? ArKitCurvesPoseAsset : nullptr;
+
+	// Start import job
+	FMetaFaceWorkerPool& WorkerPool = ModuleMFE->GetWorkerPool();
+	FMetaFaceInferenceService* InferenceService = ModuleMFE->GetInferenceService();
+	WorkingThreadFA = WorkerPool.Launch([this, Token = CancellationToken, &WorkerPool, InferenceService, Phonemes, GenerationSettings,
+		bLipsync, bFacialAnimation, bBalanceSmileFrown, LipsyncPoseAsset, FacialPoseAsset]()
 	{
 		FString OutData;
 		bool bResult = false;
 		float TimeOffset = 0.f;
-		auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
 
-		if (ModuleMFE)
+		// Results are moved to OutLipsyncData/OutFacialAnimationData in game thread
+		TMap<FName, FSimpleFloatCurve> LipsyncCurves, FacialAnimationCurves;
+
+		if (InferenceService)
 		{
 			RawAnimDataMap GeneratedData;
 
-			OutLipsyncData.Empty();
-			OutFacialAnimationData.Empty();
+			// Facial Animation: independent from lip-sync, so it's built in parallel
+			TOptional<FMetaFaceSubtaskRef> FacialAnimationTask;
+			if (bFacialAnimation && !Token->IsCancelled())
+			{
+				FacialAnimationTask = WorkerPool.LaunchSubtask([&FacialAnimationCurves, &Phonemes, &GenerationSettings, Token, InferenceService, bBalanceSmileFrown, FacialPoseAsset]()
+				{
+					RawAnimDataMap FacialGeneratedData;
+					if (InferenceService->ProcessPhonemes(Phonemes, false, FacialGeneratedData, Token))
+					{
+						if (!Token->IsCancelled())
+						{
+							UMFFunctionLibrary::RawDataToFacialAnimation(Phonemes, FacialGeneratedData, FacialAnimationCurves, GenerationSettings);
+							// @TODO: an obvious problem with smile-frown!
+
+							if (bBalanceSmileFrown)
+							{
+								FacialAnimationCurves.Remove(TEXT("MouthSmileLeft"));
+								FacialAnimationCurves.Remove(TEXT("MouthSmileRight"));
+							}
+
+							if (FacialPoseAsset)
+							{
+								UMFFunctionLibrary::ConvertFacialAnimCurves(FacialAnimationCurves, FacialPoseAsset);
+							}
+						}
+					}
+				});
+			}
 
 			// Lip-sync
-			if (bGenerateLipsync && !bExecutionInterrupted)
+			if (bLipsync && !Token->IsCancelled())
 			{
-				if (NeuralProcessor->ProcessPhonemesData(LipsyncData->PhonemesData, true, GeneratedData))
+				if (InferenceService->ProcessPhonemes(Phonemes, true, GeneratedData, Token))
 				{
-					if (!bExecutionInterrupted)
+					if (!Token->IsCancelled())
 					{
-						UMFFunctionLibrary::RawDataToLipsync(LipsyncData, GeneratedData, OutLipsyncData, FMetaFaceGenerationSettings(this));
+						UMFFunctionLibrary::RawDataToLipsync(Phonemes, GeneratedData, LipsyncCurves, GenerationSettings);
 
 						const FName FrownL = TEXT("MouthFrownLeft");
 						const FName FrownR = TEXT("MouthFrownRight");
 						const FName SmileL = TEXT("MouthSmileLeft");
 						const FName SmileR = TEXT("MouthSmileRight");
 
-						if (bBalanceSmileFrownCurves
-							&& OutLipsyncData.Contains(FrownL) && OutLipsyncData.Contains(SmileL)
-							&& OutLipsyncData.Contains(FrownR) && OutLipsyncData.Contains(SmileR))
+						if (bBalanceSmileFrown
+							&& LipsyncCurves.Contains(FrownL) && LipsyncCurves.Contains(SmileL)
+							&& LipsyncCurves.Contains(FrownR) && LipsyncCurves.Contains(SmileR))
 						{
-							for (int32 i = 0; i < OutLipsyncData[FrownL].Values.Num(); i++)
+							for (int32 i = 0; i < LipsyncCurves[FrownL].Values.Num(); i++)
 							{
-								if (OutLipsyncData[FrownL].Values[i].Value < OutLipsyncData[SmileL].Values[i].Value)
+								if (LipsyncCurves[FrownL].Values[i].Value < LipsyncCurves[SmileL].Values[i].Value)
 								{
-									float Mean = (OutLipsyncData[FrownL].Values[i].Value + OutLipsyncData[SmileL].Values[i].Value) * 0.5f;
-									OutLipsyncData[FrownL].Values[i].Value = OutLipsyncData[SmileL].Values[i].Value = Mean;
+									float Mean = (LipsyncCurves[FrownL].Values[i].Value + LipsyncCurves[SmileL].Values[i].Value) * 0.5f;
+									LipsyncCurves[FrownL].Values[i].Value = LipsyncCurves[SmileL].Values[i].Value = Mean;
 								}
 
-								if (OutLipsyncData[FrownR].Values[i].Value < OutLipsyncData[SmileR].Values[i].Value)
+								if (LipsyncCurves[FrownR].Values[i].Value < LipsyncCurves[SmileR].Values[i].Value)
 								{
-									float Mean = (OutLipsyncData[FrownR].Values[i].Value + OutLipsyncData[SmileR].Values[i].Value) * 0.5f;
-									OutLipsyncData[FrownR].Values[i].Value = OutLipsyncData[SmileR].Values[i].Value = Mean;
+									float Mean = (LipsyncCurves[FrownR].Values[i].Value + LipsyncCurves[SmileR].Values[i].Value) * 0.5f;
+									LipsyncCurves[FrownR].Values[i].Value = LipsyncCurves[SmileR].Values[i].Value = Mean;
 								}
 							}
 						}
 
-						if (bLipSyncToSkeletonCurves)
+						if (LipsyncPoseAsset)
 						{
-							UMFFunctionLibrary::ConvertFacialAnimCurves(OutLipsyncData, ArKitCurvesPoseAsset);
+							UMFFunctionLibrary::ConvertFacialAnimCurves(LipsyncCurves, LipsyncPoseAsset);
 						}
 					}
 				}
 				else
 				{
-					OutLipsyncData.Empty();
 					OutData = TEXT("ERROR: can't process data");
 				}
 			}
 
-			// Facial Animation
-			if (bGenerateFacialAnimation && !bExecutionInterrupted)
+			// Join: subtask writes to FacialAnimationCurves
+			if (FacialAnimationTask.IsSet())
 			{
-				GeneratedData.Empty();
-				if (NeuralProcessor->ProcessPhonemesData2(LipsyncData->PhonemesData, false, GeneratedData))
-				{
-					if (!bExecutionInterrupted)
-					{
-						UMFFunctionLibrary::RawDataToFacialAnimation(LipsyncData, GeneratedData, OutFacialAnimationData, FMetaFaceGenerationSettings(this));
-						// @TODO: an obvious problem with smile-frown!
-
-						if (bBalanceSmileFrownCurves)
-						{
-							/*
-							for (auto& Value : OutFacialAnimationData[TEXT("MouthSmileLeft")].Values)
-							{
-								Value.Value *= 0.5f;
-							}
-							OutFacialAnimationData.Add(TEXT("MouthFrownLeft"), OutFacialAnimationData[TEXT("MouthSmileLeft")]);
-
-							for (auto& Value : OutFacialAnimationData[TEXT("MouthSmileRight")].Values)
-							{
-								Value.Value *= 0.5f;
-							}
-							OutFacialAnimationData.Add(TEXT("MouthFrownRight"), OutFacialAnimationData[TEXT("MouthSmileRight")]);
-							*/
-							OutFacialAnimationData.Remove(TEXT("MouthSmileLeft"));
-							OutFacialAnimationData.Remove(TEXT("MouthSmileRight"));
-						}
-
-						if (bFacialAnimationToSkeletonCurves)
-						{
-							UMFFunctionLibrary::ConvertFacialAnimCurves(OutFacialAnimationData, ArKitCurvesPoseAsset);
-						}
-					}
-				}
-				else
-				{
-					OutFacialAnimationData.Empty();
-					OutData = TEXT("ERROR: can't process data");
-				}
+				FacialAnimationTask.GetValue()->Join();
 			}
 		}
 		else
@@ -234,24 +239,26 @@ void UAsyncAnimBuilder::Start()
 			OutData = TEXT("ERROR: can't get pointer to module");
 		}
 
-
 		// Main job done here
-		if (!bExecutionInterrupted)
+		AsyncTask(ENamedThreads::GameThread, [this, Token, LipsyncCurves = MoveTemp(LipsyncCurves), FacialAnimationCurves = MoveTemp(FacialAnimationCurves)]() mutable
 		{
-			AsyncTask(ENamedThreads::GameThread, [this]()
+			// Builder was restarted after Stop()
+			if (Token != CancellationToken)
+			{
+				return;
+			}
+
+			if (!Token->IsCancelled())
 			{
-				StartAsyncMutex.Unlock();
+				OutLipsyncData = MoveTemp(LipsyncCurves);
+				OutFacialAnimationData = MoveTemp(FacialAnimationCurves);
 				OnAnimationReady();
-			});
-		}
-		else
-		{
-			AsyncTask(ENamedThreads::GameThread, [this]()
+			}
+			else
 			{
-				StartAsyncMutex.Unlock();
 				OnAnimationFailed();
-			});
-		}
+			}
+		});
 	});
 }
 
@@ -264,17 +271,11 @@ void UAsyncAnimBuilder::Stop()
 {
 	if (bIsWorking)
 	{
-		auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
-		if (ModuleMFE)
+		// Requests of other builders and controllers aren't affected
+		if (CancellationToken.IsValid())
 		{
-			NeuralProcessor = ModuleMFE->GetNeuralProcessor();
-			if (IsValid(NeuralProcessor))
-			{
-				NeuralProcessor->InterruptAll();
-			}
+			CancellationToken->Cancel();
 		}
-
-		bExecutionInterrupted = true;
 		bIsWorking = false;
 	}
 }
@@ -311,7 +312,7 @@ void UAsyncAnimBuilder::OnAnimationReady()
 	{
 		FMHFacialAnimation AnimLS, AnimFA;
 
-		if (!bExecutionInterrupted)
+		if (!IsRequestCancelled(CancellationToken.Get()))
 		{
 			if (bGenerateLipsync)
 			{
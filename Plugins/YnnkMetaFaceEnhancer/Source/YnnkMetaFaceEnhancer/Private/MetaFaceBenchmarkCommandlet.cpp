@@ -0,0 +1,476 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceBenchmarkCommandlet.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "NeuralProcessWrapper.h"
+#include "MetaFaceFunctionLibrary.h"
+#include "MetaFaceTypes.h"
+#include "MetaFaceStreamingBuilder.h"
+#include "MetaFaceBlendPlan.h"
+#include "MetaFaceCurveRegistry.h"
+#include "MetaFaceSmoothing.h"
+#include "Animation/PoseAsset.h"
+#include "Modules/ModuleManager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/MemoryBase.h"
+#include "Math/RandomStream.h"
+#include "Async/Async.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/EngineVersion.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace MetaFaceBenchmarkCommandlet
+{
+	struct FStageResult
+	{
+		// Phrase latency of every iteration (milliseconds)
+		TArray<double> Samples;
+		// Change of process physical memory over all iterations (memory kept by the stage)
+		int64 UsedPhysicalDelta = 0;
+		// Change of values reported by engine allocator (GMalloc->GetAllocatorStats) over all iterations
+		TMap<FString, int64> AllocatorStatsDelta;
+	};
+
+	/** Values reported by engine allocator, set of stats depends on allocator */
+	static TMap<FString, int64> GetAllocatorStats()
+	{
+		FGenericMemoryStats AllocatorStats;
+		GMalloc->GetAllocatorStats(AllocatorStats);
+
+		TMap<FString, int64> Stats;
+		for (const auto& Stat : AllocatorStats.Data)
+		{
+			Stats.Add(FString(Stat.Key), (int64)Stat.Value);
+		}
+		return Stats;
+	}
+
+	/**
+	* Run stage Iterations times after a single unmeasured run (first call creates caches and scratch buffers).
+	* Prepare isn't included in time. Memory stats are process-wide, so they also include other threads.
+	*/
+	static FStageResult MeasureStage(int32 Iterations, TFunctionRef<void()> Prepare, TFunctionRef<void()> Run)
+	{
+		FStageResult Result;
+		Prepare();
+		Run();
+
+		const int64 StartUsedPhysical = (int64)FPlatformMemory::GetStats().UsedPhysical;
+		const TMap<FString, int64> StartAllocatorStats = GetAllocatorStats();
+
+		Result.Samples.Reserve(Iterations);
+		for (int32 i = 0; i < Iterations; i++)
+		{
+			Prepare();
+			const double StartTime = FPlatformTime::Seconds();
+			Run();
+			Result.Samples.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		}
+
+		Result.UsedPhysicalDelta = (int64)FPlatformMemory::GetStats().UsedPhysical - StartUsedPhysical;
+		for (const auto& Stat : GetAllocatorStats())
+		{
+			const int64* StartValue = StartAllocatorStats.Find(Stat.Key);
+			if (StartValue && *StartValue != Stat.Value)
+			{
+				Result.AllocatorStatsDelta.Add(Stat.Key, Stat.Value - *StartValue);
+			}
+		}
+
+		return Result;
+	}
+
+	static TSharedPtr<FJsonObject> MakeStageJson(const FString& Name, FStageResult& Stage, int32 PhonemesNum)
+	{
+		Stage.Samples.Sort();
+		double Sum = 0.0;
+		for (const double Sample : Stage.Samples)
+		{
+			Sum += Sample;
+		}
+		const double Mean = Stage.Samples.Num() > 0 ? Sum / Stage.Samples.Num() : 0.0;
+
+		TSharedPtr<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("name"), Name);
+		Json->SetNumberField(TEXT("mean_ms"), Mean);
+		Json->SetNumberField(TEXT("p50_ms"), UMetaFaceBenchmarkCommandlet::GetPercentile(Stage.Samples, 50.0));
+		Json->SetNumberField(TEXT("p90_ms"), UMetaFaceBenchmarkCommandlet::GetPercentile(Stage.Samples, 90.0));
+		Json->SetNumberField(TEXT("p99_ms"), UMetaFaceBenchmarkCommandlet::GetPercentile(Stage.Samples, 99.0));
+		Json->SetNumberField(TEXT("max_ms"), Stage.Samples.Num() > 0 ? Stage.Samples.Last() : 0.0);
+		Json->SetNumberField(TEXT("per_phoneme_us"), PhonemesNum > 0 ? Mean * 1000.0 / PhonemesNum : 0.0);
+		Json->SetNumberField(TEXT("used_physical_delta_bytes"), (double)Stage.UsedPhysicalDelta);
+		TSharedPtr<FJsonObject> AllocatorJson = MakeShared<FJsonObject>();
+		for (const auto& Stat : Stage.AllocatorStatsDelta)
+		{
+			AllocatorJson->SetNumberField(Stat.Key, (double)Stat.Value);
+		}
+		Json->SetObjectField(TEXT("allocator_stats_delta"), AllocatorJson);
+
+		UE_LOG(LogMetaFace, Display, TEXT("  %-20s mean %8.3f ms | p50 %8.3f | p90 %8.3f | p99 %8.3f | %7.2f us/phoneme | %9lld bytes kept"),
+			*Name, Mean, UMetaFaceBenchmarkCommandlet::GetPercentile(Stage.Samples, 50.0), UMetaFaceBenchmarkCommandlet::GetPercentile(Stage.Samples, 90.0), UMetaFaceBenchmarkCommandlet::GetPercentile(Stage.Samples, 99.0),
+			PhonemesNum > 0 ? Mean * 1000.0 / PhonemesNum : 0.0, Stage.UsedPhysicalDelta);
+
+		return Json;
+	}
+}
+
+UMetaFaceBenchmarkCommandlet::UMetaFaceBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+double UMetaFaceBenchmarkCommandlet::GetPercentile(const TArray<double>& SortedSamples, double Percentile)
+{
+	if (SortedSamples.Num() == 0)
+	{
+		return 0.0;
+	}
+	const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * 0.01 * SortedSamples.Num()) - 1, 0, SortedSamples.Num() - 1);
+	return SortedSamples[Index];
+}
+
+void UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(float Duration, int32 Seed, TArray<FPhonemeTextData>& OutPhonemes)
+{
+	// Symbols supported by models (see UNeuralProcessWrapper::MakeModelInput)
+	static const TCHAR* Symbols = TEXT("abcdefghijklmnopqrstuvwxyz0123456789");
+	static const TCHAR* Vowels = TEXT("aeiou");
+	const int32 SymbolsNum = FCString::Strlen(Symbols);
+
+	FRandomStream Random(Seed);
+	OutPhonemes.Reset();
+
+	float Time = 0.3f;
+	int32 WordLength = 0;
+	while (Time < Duration)
+	{
+		const bool bWordStart = (WordLength == 0);
+		if (bWordStart)
+		{
+			WordLength = Random.RandRange(2, 8);
+		}
+
+		// Vowels are more frequent, digits are rare
+		const int32 SymbolIndex = Random.FRand() < 0.4f
+			? Vowels[Random.RandRange(0, 4)] - TEXT('a')
+			: (Random.FRand() < 0.97f ? Random.RandRange(0, 25) : Random.RandRange(26, SymbolsNum - 1));
+		OutPhonemes.Add(FPhonemeTextData(Time, Symbols[SymbolIndex], bWordStart));
+
+		WordLength--;
+		Time += Random.FRandRange(0.04f, 0.12f);
+
+		// Pause between words
+		if (WordLength == 0 && Random.FRand() < 0.2f)
+		{
+			Time += Random.FRandRange(0.15f, 0.6f);
+		}
+	}
+}
+
+int32 UMetaFaceBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace MetaFaceBenchmarkCommandlet;
+
+	int32 Iterations = 20;
+	float MaxDuration = 60.f;
+	FString PoseAssetPath = TEXT("/Game/MetaHumans/Common/Common/Mocap/mh_arkit_mapping_pose.mh_arkit_mapping_pose");
+	FString OutputFile = FPaths::ProjectSavedDir() / TEXT("YnnkMetaFace") / TEXT("Benchmark.json");
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("MaxDuration="), MaxDuration);
+	FParse::Value(*Params, TEXT("PoseAsset="), PoseAssetPath);
+	int32 MaxConcurrency = FPlatformMisc::NumberOfCores();
+	FParse::Value(*Params, TEXT("Output="), OutputFile);
+	FParse::Value(*Params, TEXT("MaxConcurrency="), MaxConcurrency);
+	Iterations = FMath::Max(Iterations, 1);
+
+	auto ModuleMFE = FModuleManager::LoadModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	UNeuralProcessWrapper* NeuralProcessor = ModuleMFE ? ModuleMFE->GetNeuralProcessor() : nullptr;
+	if (IsValid(NeuralProcessor))
+	{
+		NeuralProcessor->WaitForModels();
+	}
+	if (!IsValid(NeuralProcessor) || !NeuralProcessor->IsValid())
+	{
+		UE_LOG(LogMetaFace, Error, TEXT("MetaFaceBenchmark: neural models aren't loaded"));
+		return 1;
+	}
+
+	UPoseAsset* PoseAsset = LoadObject<UPoseAsset>(nullptr, *PoseAssetPath);
+	if (!PoseAsset)
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("MetaFaceBenchmark: pose asset %s isn't found, ConvertFacialAnimCurves isn't measured"), *PoseAssetPath);
+	}
+
+	// Phrases corpus
+	TArray<TPair<FString, TArray<FPhonemeTextData>>> Phrases;
+	UMFFunctionLibrary::GetWarmUpPhonemes(Phrases.AddDefaulted_GetRef().Value);
+	Phrases.Last().Key = TEXT("warmup_phrase");
+	for (const float Duration : { 1.f, 5.f, 15.f, 30.f, 60.f })
+	{
+		if (Duration <= MaxDuration)
+		{
+			auto& Phrase = Phrases.AddDefaulted_GetRef();
+			Phrase.Key = FString::Printf(TEXT("synthetic_%ds"), FMath::RoundToInt(Duration));
+			MakeSyntheticPhrase(Duration, FMath::RoundToInt(Duration * 1000.f), Phrase.Value);
+		}
+	}
+
+	const FMetaFaceGenerationSettings GenerationSettings;
+	TArray<TSharedPtr<FJsonValue>> PhrasesJson;
+
+	for (auto& Phrase : Phrases)
+	{
+		const TArray<FPhonemeTextData>& Phonemes = Phrase.Value;
+		const int32 PhonemesNum = Phonemes.Num();
+		UE_LOG(LogMetaFace, Display, TEXT("%s: %d phonemes, %.2f sec"), *Phrase.Key, PhonemesNum, PhonemesNum > 0 ? Phonemes.Last().Time : 0.f);
+
+		TArray<TSharedPtr<FJsonValue>> StagesJson;
+		RawAnimDataMap LipsyncRawData, EmotionsRawData;
+		FMetaFaceClip LipsyncClip, FacialClip, ConvertedClip;
+		auto NoPrepare = []() {};
+
+		auto AddStage = [&StagesJson, PhonemesNum](const TCHAR* Name, FStageResult&& Stage)
+		{
+			StagesJson.Add(MakeShared<FJsonValueObject>(MakeStageJson(Name, Stage, PhonemesNum)));
+		};
+
+		AddStage(TEXT("inference_lipsync"), MeasureStage(Iterations, NoPrepare, [&]()
+		{
+			ModuleMFE->ProcessPhonemesData(Phonemes, true, LipsyncRawData);
+		}));
+		AddStage(TEXT("inference_emotions"), MeasureStage(Iterations, NoPrepare, [&]()
+		{
+			ModuleMFE->ProcessPhonemesData(Phonemes, false, EmotionsRawData);
+		}));
+		AddStage(TEXT("raw_to_lipsync"), MeasureStage(Iterations, [&]() { LipsyncClip = FMetaFaceClip(); }, [&]()
+		{
+			UMFFunctionLibrary::RawDataToLipsync(Phonemes, LipsyncRawData, LipsyncClip, GenerationSettings);
+		}));
+		AddStage(TEXT("raw_to_facial"), MeasureStage(Iterations, [&]() { FacialClip = FMetaFaceClip(); }, [&]()
+		{
+			UMFFunctionLibrary::RawDataToFacialAnimation(Phonemes, EmotionsRawData, FacialClip, GenerationSettings);
+		}));
+		if (PoseAsset)
+		{
+			AddStage(TEXT("convert_curves"), MeasureStage(Iterations, [&]() { ConvertedClip = FacialClip; }, [&]()
+			{
+				UMFFunctionLibrary::ConvertFacialAnimCurves(ConvertedClip, PoseAsset);
+			}));
+		}
+
+		// Smoothing of facial animation (part of raw_to_facial): FIR of the generator and zero-phase IIR
+		FMetaFaceClip SmoothedClip;
+		AddStage(TEXT("smooth_facial_fir"), MeasureStage(Iterations, [&]() { SmoothedClip = FacialClip; }, [&]()
+		{
+			FMetaFaceSmoothing Smoothing(SmoothedClip, GenerationSettings.FacialAnimationSmoothness);
+			Smoothing.SetNarrowCurves(EMetaFaceCurveFlags::Brow);
+			Smoothing.ApplyFIR(SmoothedClip, 4, 2, true);
+		}));
+		AddStage(TEXT("smooth_facial_iir"), MeasureStage(Iterations, [&]() { SmoothedClip = FacialClip; }, [&]()
+		{
+			FMetaFaceSmoothing(SmoothedClip, GenerationSettings.FacialAnimationSmoothness).ApplyIIR(SmoothedClip, true);
+		}));
+
+		// Playback: all curves of lip-sync sampled at 60 fps, dense clip and the same curves as TMap
+		TMap<FName, FSimpleFloatCurve> LipsyncCurves;
+		LipsyncClip.ToCurves(LipsyncCurves);
+		const int32 FramesNum = FMath::CeilToInt(LipsyncClip.GetDuration() * 60.f);
+		FMetaFaceClip::FValuesArray FrameValues;
+		FrameValues.SetNumZeroed(LipsyncClip.GetStride());
+		float Checksum = 0.f;
+		AddStage(TEXT("sample_clip"), MeasureStage(Iterations, NoPrepare, [&]()
+		{
+			for (int32 Frame = 0; Frame < FramesNum; Frame++)
+			{
+				LipsyncClip.Evaluate(Frame / 60.f, FrameValues.GetData());
+				Checksum += FrameValues[0];
+			}
+		}));
+		AddStage(TEXT("sample_clip_cursor"), MeasureStage(Iterations, NoPrepare, [&]()
+		{
+			int32 KeyCursor = 0;
+			for (int32 Frame = 0; Frame < FramesNum; Frame++)
+			{
+				LipsyncClip.Evaluate(Frame / 60.f, KeyCursor, FrameValues.GetData());
+				Checksum += FrameValues[0];
+			}
+		}));
+		FMHFacialAnimation Playback;
+		Playback.Initialize(FMetaFaceClip(LipsyncClip), false);
+		AddStage(TEXT("process_frame"), MeasureStage(Iterations, [&]() { Playback.Play(); }, [&]()
+		{
+			for (int32 Frame = 0; Frame < FramesNum; Frame++)
+			{
+				Playback.ProcessFrame(Frame / 60.f, nullptr);
+			}
+		}));
+		AddStage(TEXT("sample_curves"), MeasureStage(Iterations, NoPrepare, [&]()
+		{
+			for (int32 Frame = 0; Frame < FramesNum; Frame++)
+			{
+				for (const auto& Curve : LipsyncCurves)
+				{
+					Checksum += Curve.Value.GetValueAtTime(Frame / 60.f);
+				}
+			}
+		}));
+
+		// Baked frame (bAutoBakeAnimation): Ynnk curves, lip-sync and facial animation frames mixed by compiled plan
+		FMHFacialAnimation FacialPlayback;
+		FacialPlayback.Initialize(FMetaFaceClip(FacialClip), false);
+		FacialPlayback.Play();
+		TMap<FName, float> YnnkCurves, BakedFrame;
+		for (const FName& CurveName : FMetaFaceCurveRegistry::GetCurveSet(true))
+		{
+			YnnkCurves.Add(CurveName, 0.5f);
+		}
+		for (const auto& Curve : Playback.AnimationFrame) BakedFrame.FindOrAdd(Curve.Key);
+		for (const auto& Curve : FacialPlayback.AnimationFrame) BakedFrame.FindOrAdd(Curve.Key);
+		FMetaFaceBlendPlan BlendPlan;
+		BlendPlan.Compile(BakedFrame, YnnkCurves, Playback, FacialPlayback);
+		AddStage(TEXT("bake_frame"), MeasureStage(Iterations, NoPrepare, [&]()
+		{
+			for (int32 Frame = 0; Frame < FramesNum; Frame++)
+			{
+				BlendPlan.Evaluate(BakedFrame, YnnkCurves, true, Playback, FacialPlayback, 0.25f, 1.f, 1.f);
+			}
+		}));
+
+		SIZE_T CurvesBytes = LipsyncCurves.GetAllocatedSize();
+		for (const auto& Curve : LipsyncCurves)
+		{
+			CurvesBytes += Curve.Value.Values.GetAllocatedSize();
+		}
+		UE_LOG(LogMetaFace, Display, TEXT("  lip-sync memory: clip %llu bytes, curves %llu bytes (checksum %f)"), (uint64)LipsyncClip.GetAllocatedSize(), (uint64)CurvesBytes, Checksum);
+
+		// Whole build (inference + RawDataTo*) of both models: one after another and as parallel chains (as async builders do)
+		auto PrepareBuild = [&]() { LipsyncClip = FMetaFaceClip(); FacialClip = FMetaFaceClip(); };
+		auto BuildLipsync = [&]()
+		{
+			ModuleMFE->ProcessPhonemesData(Phonemes, true, LipsyncRawData);
+			UMFFunctionLibrary::RawDataToLipsync(Phonemes, LipsyncRawData, LipsyncClip, GenerationSettings);
+		};
+		auto BuildFacialAnimation = [&]()
+		{
+			ModuleMFE->ProcessPhonemesData(Phonemes, false, EmotionsRawData);
+			UMFFunctionLibrary::RawDataToFacialAnimation(Phonemes, EmotionsRawData, FacialClip, GenerationSettings);
+		};
+		AddStage(TEXT("build_sequential"), MeasureStage(Iterations, PrepareBuild, [&]()
+		{
+			BuildLipsync();
+			BuildFacialAnimation();
+		}));
+		AddStage(TEXT("build_parallel"), MeasureStage(Iterations, PrepareBuild, [&]()
+		{
+			TFuture<void> FacialAnimationTask = Async(EAsyncExecution::ThreadPool, BuildFacialAnimation);
+			BuildLipsync();
+			FacialAnimationTask.Wait();
+		}));
+		// Phonemes received from TTS in chunks of 3
+		AddStage(TEXT("build_streaming"), MeasureStage(Iterations, NoPrepare, [&]()
+		{
+			FMetaFaceStreamingBuilder Builder(GenerationSettings, true, true);
+			auto DiscardChunk = [](FMetaFaceStreamingChunk&& Chunk) {};
+			for (int32 Index = 0; Index < PhonemesNum; Index += 3)
+			{
+				Builder.AppendPhonemes(TArray<FPhonemeTextData>(Phonemes.GetData() + Index, FMath::Min(3, PhonemesNum - Index)));
+				Builder.ProcessPending(DiscardChunk);
+			}
+			Builder.Finish();
+			Builder.ProcessPending(DiscardChunk);
+		}));
+
+		TSharedPtr<FJsonObject> PhraseJson = MakeShared<FJsonObject>();
+		PhraseJson->SetStringField(TEXT("name"), Phrase.Key);
+		PhraseJson->SetNumberField(TEXT("phonemes"), PhonemesNum);
+		PhraseJson->SetNumberField(TEXT("duration_sec"), PhonemesNum > 0 ? Phonemes.Last().Time : 0.f);
+		PhraseJson->SetNumberField(TEXT("lipsync_clip_bytes"), (double)LipsyncClip.GetAllocatedSize());
+		PhraseJson->SetNumberField(TEXT("lipsync_curves_bytes"), (double)CurvesBytes);
+		PhraseJson->SetArrayField(TEXT("stages"), StagesJson);
+		PhrasesJson.Add(MakeShared<FJsonValueObject>(PhraseJson));
+	}
+
+	// Throughput of parallel requests (controllers speaking at the same time), warm-up phrase
+	TArray<TSharedPtr<FJsonValue>> ConcurrencyJson;
+	const TArray<FPhonemeTextData>& ConcurrencyPhonemes = Phrases[0].Value;
+	for (const bool bUseLipsyncModel : { true, false })
+	{
+		double BaseThroughput = 0.0;
+		for (int32 Concurrency = 1; Concurrency <= MaxConcurrency; Concurrency *= 2)
+		{
+			TArray<TFuture<int32>> Requests;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 ThreadIndex = 0; ThreadIndex < Concurrency; ThreadIndex++)
+			{
+				Requests.Add(Async(EAsyncExecution::Thread, [ModuleMFE, &ConcurrencyPhonemes, bUseLipsyncModel, Iterations]()
+				{
+					int32 Succeeded = 0;
+					RawAnimDataMap RawData;
+					for (int32 i = 0; i < Iterations; i++)
+					{
+						Succeeded += ModuleMFE->ProcessPhonemesData(ConcurrencyPhonemes, bUseLipsyncModel, RawData) ? 1 : 0;
+					}
+					return Succeeded;
+				}));
+			}
+
+			int32 Succeeded = 0;
+			for (auto& Request : Requests)
+			{
+				Succeeded += Request.Get();
+			}
+			const double Elapsed = FPlatformTime::Seconds() - StartTime;
+			const double Throughput = Elapsed > 0.0 ? Succeeded / Elapsed : 0.0;
+			if (Concurrency == 1)
+			{
+				BaseThroughput = Throughput;
+			}
+
+			UE_LOG(LogMetaFace, Display, TEXT("%s: %2d parallel callers, %4d/%4d requests, %9.1f req/s, scaling x%.2f"),
+				bUseLipsyncModel ? TEXT("lip-sync") : TEXT("emotions"), Concurrency, Succeeded, Concurrency * Iterations, Throughput,
+				BaseThroughput > 0.0 ? Throughput / BaseThroughput : 0.0);
+
+			TSharedPtr<FJsonObject> LevelJson = MakeShared<FJsonObject>();
+			LevelJson->SetStringField(TEXT("model"), bUseLipsyncModel ? TEXT("lipsync") : TEXT("emotions"));
+			LevelJson->SetNumberField(TEXT("callers"), Concurrency);
+			LevelJson->SetNumberField(TEXT("succeeded"), Succeeded);
+			LevelJson->SetNumberField(TEXT("requests_per_sec"), Throughput);
+			ConcurrencyJson.Add(MakeShared<FJsonValueObject>(LevelJson));
+		}
+	}
+
+	// Report
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	TSharedPtr<FJsonObject> ReportJson = MakeShared<FJsonObject>();
+	ReportJson->SetStringField(TEXT("engine_version"), FEngineVersion::Current().ToString());
+	ReportJson->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+	ReportJson->SetStringField(TEXT("date"), FDateTime::UtcNow().ToIso8601());
+	ReportJson->SetNumberField(TEXT("iterations"), Iterations);
+	ReportJson->SetStringField(TEXT("lipsync_model"), NeuralProcessor->IsUsingCompiledModel(true) ? TEXT("compiled") : TEXT("torchscript"));
+	ReportJson->SetStringField(TEXT("emotions_model"), NeuralProcessor->IsUsingCompiledModel(false) ? TEXT("compiled") : TEXT("torchscript"));
+	ReportJson->SetNumberField(TEXT("process_peak_used_physical"), (double)MemoryStats.PeakUsedPhysical);
+	ReportJson->SetArrayField(TEXT("phrases"), PhrasesJson);
+	ReportJson->SetArrayField(TEXT("concurrency"), ConcurrencyJson);
+
+	FString ReportText;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ReportText);
+	FJsonSerializer::Serialize(ReportJson.ToSharedRef(), Writer);
+
+	if (!FFileHelper::SaveStringToFile(ReportText, *OutputFile))
+	{
+		UE_LOG(LogMetaFace, Error, TEXT("MetaFaceBenchmark: unable to save report to %s"), *OutputFile);
+		return 1;
+	}
+
+	UE_LOG(LogMetaFace, Display, TEXT("MetaFaceBenchmark: report saved to %s"), *OutputFile);
+	return 0;
+}
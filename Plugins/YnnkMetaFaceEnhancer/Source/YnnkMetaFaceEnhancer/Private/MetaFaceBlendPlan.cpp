@@ -0,0 +1,157 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceBlendPlan.h"
+#include "MetaFaceCurveRegistry.h"
+
+FMetaFaceBlendPlan::FMetaFaceBlendPlan()
+{
+	Reset();
+}
+
+void FMetaFaceBlendPlan::Reset()
+{
+	SlotNames.Empty();
+	YnnkCurvesNum = 0;
+	LipsyncClip = FacialAnimationClip = nullptr;
+	LipsyncCurvesNum = FacialAnimationCurvesNum = 0;
+	YnnkSources.Empty();
+	LipsyncSources.Empty();
+	FacialAnimationSources.Empty();
+	YnnkMask.Empty();
+	LipsyncCurvesMask.Empty();
+	YnnkValues.Empty();
+	LipsyncValues.Empty();
+	FacialAnimationValues.Empty();
+	OutValues.Empty();
+}
+
+void FMetaFaceBlendPlan::Compile(const TMap<FName, float>& OutFrame, const TMap<FName, float>& YnnkCurves, const FMHFacialAnimation& Lipsync, const FMHFacialAnimation& FacialAnimation)
+{
+	Reset();
+
+	const int32 SlotsNum = OutFrame.Num();
+	const int32 PaddedNum = Align(SlotsNum, 4);
+	OutFrame.GenerateKeyArray(SlotNames);
+
+	YnnkCurvesNum = YnnkCurves.Num();
+	LipsyncClip = Lipsync.GetClip().Get();
+	LipsyncCurvesNum = Lipsync.AnimationFrame.Num();
+	FacialAnimationClip = FacialAnimation.GetClip().Get();
+	FacialAnimationCurvesNum = FacialAnimation.AnimationFrame.Num();
+
+	YnnkMask.SetNumZeroed(PaddedNum);
+	LipsyncCurvesMask.SetNumZeroed(PaddedNum);
+	YnnkValues.SetNumZeroed(PaddedNum);
+	LipsyncValues.SetNumZeroed(PaddedNum);
+	FacialAnimationValues.SetNumZeroed(PaddedNum);
+	OutValues.SetNumZeroed(PaddedNum);
+	LipsyncSources.Init(INDEX_NONE, SlotsNum);
+	FacialAnimationSources.Init(INDEX_NONE, SlotsNum);
+
+	// Frame values of FMHFacialAnimation are in the order of clip curves
+	const TArray<FName>& LipsyncCurveSet = FMetaFaceCurveRegistry::GetCurveSet(true);
+	for (int32 Slot = 0; Slot < SlotsNum; Slot++)
+	{
+		const FName& CurveName = SlotNames[Slot];
+
+		const FSetElementId YnnkId = YnnkCurves.FindId(CurveName);
+		if (YnnkId.IsValidId())
+		{
+			YnnkSources.Add({ Slot, CurveName, YnnkId });
+			YnnkMask[Slot] = 1.f;
+		}
+		if (LipsyncClip)
+		{
+			LipsyncSources[Slot] = LipsyncClip->FindCurve(CurveName);
+		}
+		if (FacialAnimationClip)
+		{
+			FacialAnimationSources[Slot] = FacialAnimationClip->FindCurve(CurveName);
+		}
+		LipsyncCurvesMask[Slot] = LipsyncCurveSet.Contains(CurveName) ? 1.f : 0.f;
+	}
+}
+
+bool FMetaFaceBlendPlan::IsCompiledFor(const TMap<FName, float>& OutFrame, const TMap<FName, float>& YnnkCurves, const FMHFacialAnimation& Lipsync, const FMHFacialAnimation& FacialAnimation) const
+{
+	return OutFrame.Num() == SlotNames.Num()
+		&& YnnkCurves.Num() == YnnkCurvesNum
+		&& Lipsync.GetClip().Get() == LipsyncClip && Lipsync.AnimationFrame.Num() == LipsyncCurvesNum
+		&& FacialAnimation.GetClip().Get() == FacialAnimationClip && FacialAnimation.AnimationFrame.Num() == FacialAnimationCurvesNum;
+}
+
+bool FMetaFaceBlendPlan::Evaluate(TMap<FName, float>& OutFrame, const TMap<FName, float>& YnnkCurves, bool bUseYnnkCurves, const FMHFacialAnimation& Lipsync, const FMHFacialAnimation& FacialAnimation,
+	float YnnkRatio, float LipsyncIntensity, float FacialAnimationIntensity)
+{
+	if (!IsCompiledFor(OutFrame, YnnkCurves, Lipsync, FacialAnimation))
+	{
+		return false;
+	}
+
+	const int32 SlotsNum = SlotNames.Num();
+	const bool bUseLipsync = Lipsync.IsActive();
+	const bool bUseFacialAnimation = FacialAnimation.IsActive();
+
+	// Gather sources
+	if (bUseYnnkCurves)
+	{
+		for (const FYnnkSource& Source : YnnkSources)
+		{
+			if (!YnnkCurves.IsValidId(Source.Id) || YnnkCurves.Get(Source.Id).Key != Source.CurveName)
+			{
+				return false;
+			}
+			YnnkValues[Source.Slot] = YnnkCurves.Get(Source.Id).Value;
+		}
+	}
+	if (bUseLipsync)
+	{
+		const FMetaFaceClip::FValuesArray& FrameValues = Lipsync.GetFrameValues();
+		for (int32 Slot = 0; Slot < SlotsNum; Slot++)
+		{
+			LipsyncValues[Slot] = LipsyncSources[Slot] != INDEX_NONE ? FrameValues[LipsyncSources[Slot]] : 0.f;
+		}
+	}
+	if (bUseFacialAnimation)
+	{
+		const FMetaFaceClip::FValuesArray& FrameValues = FacialAnimation.GetFrameValues();
+		for (int32 Slot = 0; Slot < SlotsNum; Slot++)
+		{
+			FacialAnimationValues[Slot] = FacialAnimationSources[Slot] != INDEX_NONE ? FrameValues[FacialAnimationSources[Slot]] : 0.f;
+		}
+	}
+
+	// Ynnk curve takes YnnkRatio of lip-sync weight; ARKit lip-sync curves are scaled by lip-sync intensity once more
+	const float UsedYnnkRatio = bUseYnnkCurves ? YnnkRatio : 0.f;
+	const VectorRegister4Float VYnnkWeight = VectorSetFloat1(UsedYnnkRatio * LipsyncIntensity);
+	const VectorRegister4Float VYnnkRatio = VectorSetFloat1(UsedYnnkRatio);
+	const VectorRegister4Float VLipsyncWeight = VectorSetFloat1(bUseLipsync ? LipsyncIntensity : 0.f);
+	const VectorRegister4Float VFacialAnimationWeight = VectorSetFloat1(bUseFacialAnimation ? FacialAnimationIntensity : 0.f);
+	const VectorRegister4Float VLipsyncIntensityDelta = VectorSetFloat1(LipsyncIntensity - 1.f);
+	const VectorRegister4Float VMin = VectorSetFloat1(-1.f);
+	const VectorRegister4Float VMax = VectorOne();
+	for (int32 i = 0; i < OutValues.Num(); i += 4)
+	{
+		const VectorRegister4Float HasYnnk = VectorLoadAligned(&YnnkMask[i]);
+		const VectorRegister4Float LipsyncWeight = VectorMultiply(VectorNegateMultiplyAdd(HasYnnk, VYnnkRatio, VectorOne()), VLipsyncWeight);
+		const VectorRegister4Float PostScale = VectorMultiplyAdd(VectorLoadAligned(&LipsyncCurvesMask[i]), VLipsyncIntensityDelta, VectorOne());
+
+		VectorRegister4Float Sum = VectorMultiply(VectorMultiply(VectorLoadAligned(&YnnkValues[i]), HasYnnk), VYnnkWeight);
+		Sum = VectorMultiplyAdd(VectorLoadAligned(&LipsyncValues[i]), LipsyncWeight, Sum);
+		Sum = VectorMultiplyAdd(VectorLoadAligned(&FacialAnimationValues[i]), VFacialAnimationWeight, Sum);
+		VectorStoreAligned(VectorMin(VectorMax(VectorMultiply(Sum, PostScale), VMin), VMax), &OutValues[i]);
+	}
+
+	// Output frame wasn't changed since Compile, so its curves are in the same order
+	int32 Slot = 0;
+	for (auto& Curve : OutFrame)
+	{
+		if (Curve.Key != SlotNames[Slot])
+		{
+			return false;
+		}
+		Curve.Value = OutValues[Slot++];
+	}
+	return true;
+}
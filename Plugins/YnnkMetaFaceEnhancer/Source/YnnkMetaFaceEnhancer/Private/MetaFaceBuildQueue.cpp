@@ -0,0 +1,347 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceBuildQueue.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "MetaFaceFunctionLibrary.h"
+#include "MetaFaceInferenceService.h"
+#include "MetaFaceWorkerPool.h"
+#include "Async/Async.h"
+
+bool FMetaFaceBuildQueue::FJob::IsSameRequest(uint32 InHash, const TArray<FPhonemeTextData>& InPhonemesData, bool bInLipsync, bool bInFacialAnimation, const FMetaFaceGenerationSettings& InSettings) const
+{
+	if (Hash != InHash || bLipsync != bInLipsync || bFacialAnimation != bInFacialAnimation || PhonemesData.Num() != InPhonemesData.Num())
+	{
+		return false;
+	}
+	if (Settings.ArKitCurvesPoseAsset != InSettings.ArKitCurvesPoseAsset
+		|| Settings.bBalanceSmileFrownCurves != InSettings.bBalanceSmileFrownCurves
+		|| Settings.bLipSyncToSkeletonCurves != InSettings.bLipSyncToSkeletonCurves
+		|| Settings.bFacialAnimationToSkeletonCurves != InSettings.bFacialAnimationToSkeletonCurves
+		|| Settings.LipsyncNeuralIntensity != InSettings.LipsyncNeuralIntensity
+		|| Settings.VisemeApplyAlpha != InSettings.VisemeApplyAlpha
+		|| Settings.LipsyncSmoothness != InSettings.LipsyncSmoothness
+		|| Settings.FacialAnimationSmoothness != InSettings.FacialAnimationSmoothness)
+	{
+		return false;
+	}
+	for (int32 i = 0; i < PhonemesData.Num(); i++)
+	{
+		const FPhonemeTextData& A = PhonemesData[i];
+		const FPhonemeTextData& B = InPhonemesData[i];
+		if (A.Time != B.Time || A.bWordStart != B.bWordStart || !A.Symbol.Equals(B.Symbol, ESearchCase::CaseSensitive))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+FMetaFaceBuildQueue::FMetaFaceBuildQueue(FYnnkMetaFaceEnhancerModule& InOwner)
+	: Owner(InOwner)
+	, LastRequestId(0)
+	, RunningNum(0)
+{
+}
+
+uint32 FMetaFaceBuildQueue::GetRequestHash(const TArray<FPhonemeTextData>& PhonemesData, bool bLipsync, bool bFacialAnimation, const FMetaFaceGenerationSettings& Settings)
+{
+	uint32 Hash = GetTypeHash(PhonemesData.Num());
+	for (const auto& Phoneme : PhonemesData)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Phoneme.Time));
+		Hash = HashCombine(Hash, GetTypeHash(Phoneme.Symbol));
+		Hash = HashCombine(Hash, GetTypeHash(Phoneme.bWordStart));
+	}
+	Hash = HashCombine(Hash, GetTypeHash(bLipsync));
+	Hash = HashCombine(Hash, GetTypeHash(bFacialAnimation));
+	Hash = HashCombine(Hash, GetTypeHash(Settings.ArKitCurvesPoseAsset));
+	Hash = HashCombine(Hash, GetTypeHash(Settings.bBalanceSmileFrownCurves));
+	Hash = HashCombine(Hash, GetTypeHash(Settings.bLipSyncToSkeletonCurves));
+	Hash = HashCombine(Hash, GetTypeHash(Settings.bFacialAnimationToSkeletonCurves));
+	Hash = HashCombine(Hash, GetTypeHash(Settings.LipsyncNeuralIntensity));
+	Hash = HashCombine(Hash, GetTypeHash(Settings.VisemeApplyAlpha));
+	Hash = HashCombine(Hash, GetTypeHash(Settings.LipsyncSmoothness));
+	Hash = HashCombine(Hash, GetTypeHash(Settings.FacialAnimationSmoothness));
+	return Hash;
+}
+
+bool FMetaFaceBuildQueue::FindResult(const TArray<FPhonemeTextData>& PhonemesData, bool bLipsync, bool bFacialAnimation, const FMetaFaceGenerationSettings& Settings,
+	FMetaFaceBuildResult& OutResult)
+{
+	const uint32 Hash = GetRequestHash(PhonemesData, bLipsync, bFacialAnimation, Settings);
+	for (int32 i = RecentResults.Num() - 1; i >= 0; i--)
+	{
+		if (RecentResults[i].Job->IsSameRequest(Hash, PhonemesData, bLipsync, bFacialAnimation, Settings))
+		{
+			// Move to the end, so frequently used results stay in cache
+			FCachedResult Item = MoveTemp(RecentResults[i]);
+			RecentResults.RemoveAt(i);
+			OutResult = Item.Result;
+			RecentResults.Add(MoveTemp(Item));
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 FMetaFaceBuildQueue::Submit(const TArray<FPhonemeTextData>& PhonemesData, bool bLipsync, bool bFacialAnimation, const FMetaFaceGenerationSettings& Settings,
+	EMetaFaceBuildPriority Priority, FMetaFaceBuildCallback&& Callback)
+{
+	const int32 RequestId = ++LastRequestId;
+	const uint32 Hash = GetRequestHash(PhonemesData, bLipsync, bFacialAnimation, Settings);
+
+	// Wait for the same job if it's queued or running
+	for (const auto& Job : Jobs)
+	{
+		if (!Job->Token->IsCancelled() && Job->IsSameRequest(Hash, PhonemesData, bLipsync, bFacialAnimation, Settings))
+		{
+			Job->Waiters.Add(RequestId, MoveTemp(Callback));
+			Requests.Add(RequestId, Job);
+			if (Priority == EMetaFaceBuildPriority::SpeakNow)
+			{
+				Job->Priority = Priority;
+				StartJobs();
+			}
+			return RequestId;
+		}
+	}
+
+	FJobPtr Job = MakeShared<FJob, ESPMode::ThreadSafe>();
+	Job->Hash = Hash;
+	Job->PhonemesData = PhonemesData;
+	Job->bLipsync = bLipsync;
+	Job->bFacialAnimation = bFacialAnimation;
+	Job->Settings = Settings;
+	Job->Priority = Priority;
+	Job->Token = MakeShared<FMetaFaceCancellationToken, ESPMode::ThreadSafe>();
+	Job->Waiters.Add(RequestId, MoveTemp(Callback));
+
+	Jobs.Add(Job);
+	Requests.Add(RequestId, Job);
+	StartJobs();
+
+	return RequestId;
+}
+
+void FMetaFaceBuildQueue::Cancel(int32 RequestId)
+{
+	FJobPtr Job;
+	if (!Requests.RemoveAndCopyValue(RequestId, Job))
+	{
+		return;
+	}
+
+	Job->Waiters.Remove(RequestId);
+	if (Job->Waiters.Num() == 0)
+	{
+		Job->Token->Cancel();
+		// Running job is removed when worker returns
+		if (!Job->bRunning)
+		{
+			Jobs.Remove(Job);
+		}
+	}
+}
+
+void FMetaFaceBuildQueue::SetPriority(int32 RequestId, EMetaFaceBuildPriority Priority)
+{
+	if (const FJobPtr* Job = Requests.Find(RequestId))
+	{
+		// Job shared with other requests keeps the highest priority
+		if (Priority == EMetaFaceBuildPriority::SpeakNow || (*Job)->Waiters.Num() == 1)
+		{
+			(*Job)->Priority = Priority;
+		}
+		StartJobs();
+	}
+}
+
+bool FMetaFaceBuildQueue::IsPending(int32 RequestId) const
+{
+	return Requests.Contains(RequestId);
+}
+
+void FMetaFaceBuildQueue::Reset()
+{
+	for (const auto& Job : Jobs)
+	{
+		Job->Token->Cancel();
+		Job->Waiters.Empty();
+	}
+	Jobs.RemoveAll([](const FJobPtr& Job) { return !Job->bRunning; });
+	Requests.Empty();
+	RecentResults.Empty();
+}
+
+int32 FMetaFaceBuildQueue::GetMaxRunningNum() const
+{
+	const int32 ThreadsNum = Owner.GetWorkerPool().GetThreadsNum();
+	return ThreadsNum > 0 ? ThreadsNum : FMetaFaceWorkerPool::GetDefaultThreadsNum();
+}
+
+void FMetaFaceBuildQueue::StartJobs()
+{
+	const int32 MaxRunningNum = GetMaxRunningNum();
+	// Keep one worker for speak-now requests
+	const int32 MaxPrefetchNum = FMath::Max(MaxRunningNum - 1, 1);
+
+	while (RunningNum < MaxRunningNum)
+	{
+		FJobPtr NextJob;
+		for (const auto& Job : Jobs)
+		{
+			if (Job->bRunning)
+			{
+				continue;
+			}
+			if (Job->Priority == EMetaFaceBuildPriority::SpeakNow)
+			{
+				NextJob = Job;
+				break;
+			}
+			if (!NextJob.IsValid() && RunningNum < MaxPrefetchNum)
+			{
+				NextJob = Job;
+			}
+		}
+
+		if (!NextJob.IsValid())
+		{
+			break;
+		}
+		RunJob(NextJob);
+	}
+}
+
+void FMetaFaceBuildQueue::RunJob(const FJobPtr& Job)
+{
+	Job->bRunning = true;
+	RunningNum++;
+
+	FMetaFaceWorkerPool& WorkerPool = Owner.GetWorkerPool();
+	FMetaFaceInferenceService* InferenceService = Owner.GetInferenceService();
+	TWeakPtr<FMetaFaceBuildQueue, ESPMode::ThreadSafe> WeakThis = AsShared();
+
+	// Job data isn't modified while it's running, except waiters and priority which are only used in game thread
+	WorkerPool.Launch([WeakThis, Job, &WorkerPool, InferenceService]()
+	{
+		const FMetaFaceCancellationTokenPtr& Token = Job->Token;
+		FCompletedJob Completed;
+		Completed.Job = Job;
+		FMetaFaceBuildResult& Result = Completed.Result;
+		bool bFacialAnimationSuccess = true, bLipsyncSuccess = true;
+
+		// Facial Animation: independent from lip-sync, so it's built in parallel
+		TOptional<FMetaFaceSubtaskRef> FacialAnimationTask;
+		if (Job->bFacialAnimation && !Token->IsCancelled())
+		{
+			FacialAnimationTask = WorkerPool.LaunchSubtask([&Result, &bFacialAnimationSuccess, Job, InferenceService]()
+			{
+				RawAnimDataMap GeneratedData;
+				bFacialAnimationSuccess = InferenceService && InferenceService->ProcessPhonemes(Job->PhonemesData, false, GeneratedData, Job->Token);
+				if (bFacialAnimationSuccess && !Job->Token->IsCancelled())
+				{
+					FMetaFaceClip AnimationData;
+					UMFFunctionLibrary::RawDataToFacialAnimation(Job->PhonemesData, GeneratedData, AnimationData, Job->Settings);
+					if (Job->Settings.bBalanceSmileFrownCurves)
+					{
+						AnimationData.RemoveCurve(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::MouthSmileLeft));
+						AnimationData.RemoveCurve(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::MouthSmileRight));
+					}
+					Result.FacialAnimation.Initialize(MoveTemp(AnimationData), true, 1.f, 0.49f);
+				}
+			});
+		}
+
+		// Lip-sync
+		if (Job->bLipsync && !Token->IsCancelled())
+		{
+			RawAnimDataMap GeneratedData;
+			bLipsyncSuccess = InferenceService && InferenceService->ProcessPhonemes(Job->PhonemesData, true, GeneratedData, Token);
+			if (bLipsyncSuccess && !Token->IsCancelled())
+			{
+				FMetaFaceClip AnimationData;
+				UMFFunctionLibrary::RawDataToLipsync(Job->PhonemesData, GeneratedData, AnimationData, Job->Settings);
+				if (Job->Settings.bBalanceSmileFrownCurves)
+				{
+					UMFFunctionLibrary::BalanceSmileFrownCurves(AnimationData);
+				}
+				Result.LipSync.Initialize(MoveTemp(AnimationData), false);
+			}
+		}
+
+		// Join
+		if (FacialAnimationTask.IsSet())
+		{
+			FacialAnimationTask.GetValue()->Join();
+		}
+
+		Completed.bSuccess = bLipsyncSuccess && bFacialAnimationSuccess && !Token->IsCancelled();
+
+		// Queue is destroyed when module is unloaded
+		if (auto This = WeakThis.Pin())
+		{
+			This->CompletedJobs.Enqueue(MoveTemp(Completed));
+			AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+			{
+				if (auto Queue = WeakThis.Pin())
+				{
+					Queue->ProcessCompletedJobs();
+				}
+			});
+		}
+	});
+}
+
+void FMetaFaceBuildQueue::ProcessCompletedJobs()
+{
+	FCompletedJob Completed;
+	while (CompletedJobs.Dequeue(Completed))
+	{
+		OnJobComplete(Completed);
+	}
+}
+
+void FMetaFaceBuildQueue::OnJobComplete(FCompletedJob& CompletedJob)
+{
+	const FJobPtr Job = CompletedJob.Job;
+	Job->bRunning = false;
+	RunningNum--;
+	Jobs.Remove(Job);
+
+	// Copy shares clips with the result, modified animations copy their clips (see FMHFacialAnimation::GetMutableClip)
+	if (CompletedJob.bSuccess)
+	{
+		RecentResults.Add({ Job, CompletedJob.Result });
+		if (RecentResults.Num() > ResultsCacheSize)
+		{
+			RecentResults.RemoveAt(0);
+		}
+	}
+
+	// Release worker before executing callbacks
+	StartJobs();
+
+	TMap<int32, FMetaFaceBuildCallback> Waiters = MoveTemp(Job->Waiters);
+	Job->Waiters.Reset();
+	for (const auto& Waiter : Waiters)
+	{
+		Requests.Remove(Waiter.Key);
+	}
+
+	// Duplicated requests get copies sharing the same clips, the last one takes the result
+	int32 WaiterIndex = 0;
+	for (const auto& Waiter : Waiters)
+	{
+		if (++WaiterIndex < Waiters.Num())
+		{
+			FMetaFaceBuildResult ResultCopy = CompletedJob.Result;
+			Waiter.Value(Waiter.Key, CompletedJob.bSuccess, MoveTemp(ResultCopy));
+		}
+		else
+		{
+			Waiter.Value(Waiter.Key, CompletedJob.bSuccess, MoveTemp(CompletedJob.Result));
+		}
+	}
+}
@@ -0,0 +1,420 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceClip.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Unique.h"
+
+FMetaFaceClip::FMetaFaceClip()
+	: Stride(0)
+{
+}
+
+FMetaFaceClip::FMetaFaceClip(const TArray<FName>& InCurveNames, int32 KeysNumToReserve)
+	: Stride(0)
+{
+	Reset(InCurveNames, KeysNumToReserve);
+}
+
+FMetaFaceClip::FMetaFaceClip(const TMap<FName, FSimpleFloatCurve>& InCurves)
+	: Stride(0)
+{
+	FromCurves(InCurves);
+}
+
+void FMetaFaceClip::Reset(const TArray<FName>& InCurveNames, int32 KeysNumToReserve)
+{
+	CurveNames = InCurveNames;
+	UpdateCurveIds();
+	Stride = Align(CurveNames.Num(), 4);
+	Times.Reset(KeysNumToReserve);
+	Values.Reset(KeysNumToReserve * Stride);
+}
+
+float* FMetaFaceClip::AddKey(float Time)
+{
+	Times.Add(Time);
+	return Values.GetData() + Values.AddZeroed(Stride);
+}
+
+void FMetaFaceClip::FindKeys(float Time, int32& OutKey, float& OutAlpha) const
+{
+	const int32 KeysNum = Times.Num();
+	const int32 NextKey = Algo::UpperBound(Times, Time);
+
+	OutAlpha = 0.f;
+	if (NextKey == 0)
+	{
+		OutKey = 0;
+	}
+	else if (NextKey == KeysNum)
+	{
+		OutKey = KeysNum - 1;
+	}
+	else
+	{
+		OutKey = NextKey - 1;
+		OutAlpha = (Time - Times[OutKey]) / (Times[NextKey] - Times[OutKey]);
+	}
+}
+
+void FMetaFaceClip::FindKeys(float Time, int32& InOutCursor, float& OutAlpha) const
+{
+	const int32 KeysNum = Times.Num();
+	OutAlpha = 0.f;
+	if (KeysNum == 0)
+	{
+		InOutCursor = 0;
+		return;
+	}
+
+	if (!Times.IsValidIndex(InOutCursor) || (InOutCursor > 0 && Times[InOutCursor] > Time))
+	{
+		// Time moved back or keys were replaced
+		InOutCursor = FMath::Max(Algo::UpperBound(Times, Time) - 1, 0);
+	}
+	else
+	{
+		while (InOutCursor + 1 < KeysNum && Times[InOutCursor + 1] <= Time)
+		{
+			InOutCursor++;
+		}
+	}
+
+	if (InOutCursor + 1 < KeysNum && Time > Times[InOutCursor])
+	{
+		OutAlpha = (Time - Times[InOutCursor]) / (Times[InOutCursor + 1] - Times[InOutCursor]);
+	}
+}
+
+void FMetaFaceClip::Evaluate(float Time, float* OutValues) const
+{
+	if (Times.Num() == 0)
+	{
+		FMemory::Memzero(OutValues, Stride * sizeof(float));
+		return;
+	}
+
+	int32 Key;
+	float Alpha;
+	FindKeys(Time, Key, Alpha);
+	EvaluateKeys(Key, Alpha, OutValues);
+}
+
+void FMetaFaceClip::Evaluate(float Time, int32& InOutCursor, float* OutValues) const
+{
+	if (Times.Num() == 0)
+	{
+		FMemory::Memzero(OutValues, Stride * sizeof(float));
+		return;
+	}
+
+	float Alpha;
+	FindKeys(Time, InOutCursor, Alpha);
+	EvaluateKeys(InOutCursor, Alpha, OutValues);
+}
+
+void FMetaFaceClip::EvaluateKeys(int32 Key, float Alpha, float* OutValues) const
+{
+	const float* KeyA = GetKey(Key);
+	if (Alpha == 0.f)
+	{
+		FMemory::Memcpy(OutValues, KeyA, Stride * sizeof(float));
+		return;
+	}
+
+	// Rows are 16-byte aligned
+	const float* KeyB = KeyA + Stride;
+	const VectorRegister4Float VAlpha = VectorSetFloat1(Alpha);
+	for (int32 i = 0; i < Stride; i += 4)
+	{
+		const VectorRegister4Float A = VectorLoadAligned(KeyA + i);
+		const VectorRegister4Float B = VectorLoadAligned(KeyB + i);
+		VectorStore(VectorMultiplyAdd(VectorSubtract(B, A), VAlpha, A), OutValues + i);
+	}
+}
+
+float FMetaFaceClip::EvaluateCurve(int32 Curve, float Time) const
+{
+	if (Times.Num() == 0)
+	{
+		return 0.f;
+	}
+
+	int32 Key;
+	float Alpha;
+	FindKeys(Time, Key, Alpha);
+	return Alpha == 0.f
+		? GetValue(Key, Curve)
+		: FMath::Lerp(GetValue(Key, Curve), GetValue(Key + 1, Curve), Alpha);
+}
+
+void FMetaFaceClip::GetIntervalsToKeys(float Time, float& OutFromPrevious, float& OutToNext) const
+{
+	const int32 NextKey = Algo::UpperBound(Times, Time);
+	OutFromPrevious = NextKey > 0 ? Time - Times[NextKey - 1] : 0.f;
+	OutToNext = NextKey < Times.Num() ? Times[NextKey] - Time : 0.f;
+}
+
+void FMetaFaceClip::GetIntervalsToKeys(float Time, int32 Cursor, float& OutFromPrevious, float& OutToNext) const
+{
+	OutFromPrevious = OutToNext = 0.f;
+	if (!Times.IsValidIndex(Cursor))
+	{
+		return;
+	}
+
+	if (Time < Times[Cursor])
+	{
+		// Before the first key
+		OutToNext = Times[Cursor] - Time;
+	}
+	else
+	{
+		OutFromPrevious = Time - Times[Cursor];
+		OutToNext = Cursor + 1 < Times.Num() ? Times[Cursor + 1] - Time : 0.f;
+	}
+}
+
+void FMetaFaceClip::SetCurveNames(const TArray<FName>& NewCurveNames)
+{
+	const int32 NewStride = Align(NewCurveNames.Num(), 4);
+	const int32 KeysNum = Times.Num();
+
+	FValuesArray NewValues;
+	NewValues.SetNumZeroed(KeysNum * NewStride);
+	for (int32 Curve = 0; Curve < NewCurveNames.Num(); Curve++)
+	{
+		const int32 SourceCurve = CurveNames.IndexOfByKey(NewCurveNames[Curve]);
+		if (SourceCurve != INDEX_NONE)
+		{
+			for (int32 Key = 0; Key < KeysNum; Key++)
+			{
+				NewValues[Key * NewStride + Curve] = Values[Key * Stride + SourceCurve];
+			}
+		}
+	}
+
+	CurveNames = NewCurveNames;
+	UpdateCurveIds();
+	Stride = NewStride;
+	Values = MoveTemp(NewValues);
+}
+
+void FMetaFaceClip::UpdateCurveIds()
+{
+	FMetaFaceCurveRegistry& Registry = FMetaFaceCurveRegistry::Get();
+	CurveIds.SetNumUninitialized(CurveNames.Num());
+	for (int32 Curve = 0; Curve < CurveNames.Num(); Curve++)
+	{
+		CurveIds[Curve] = Registry.FindOrAdd(CurveNames[Curve]);
+	}
+}
+
+bool FMetaFaceClip::HasSameKeys(const FMetaFaceClip& Other) const
+{
+	return Times.Num() == Other.Times.Num()
+		&& FMemory::Memcmp(Times.GetData(), Other.Times.GetData(), Times.Num() * sizeof(float)) == 0;
+}
+
+void FMetaFaceClip::AddCurves(const FMetaFaceClip& Other)
+{
+	if (Other.CurveNames.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<FName> NewCurveNames = CurveNames;
+	TArray<int32> TargetCurves;
+	TargetCurves.SetNumUninitialized(Other.CurveNames.Num());
+	for (int32 Curve = 0; Curve < Other.CurveNames.Num(); Curve++)
+	{
+		TargetCurves[Curve] = NewCurveNames.AddUnique(Other.CurveNames[Curve]);
+	}
+	if (NewCurveNames.Num() != CurveNames.Num())
+	{
+		SetCurveNames(NewCurveNames);
+	}
+
+	if (Times.Num() == 0)
+	{
+		Times = Other.Times;
+		Values.SetNumZeroed(Times.Num() * Stride);
+	}
+
+	const bool bSameKeys = HasSameKeys(Other);
+	for (int32 Key = 0; Key < Times.Num(); Key++)
+	{
+		float* Row = GetKey(Key);
+		for (int32 Curve = 0; Curve < Other.CurveNames.Num(); Curve++)
+		{
+			Row[TargetCurves[Curve]] = bSameKeys ? Other.GetValue(Key, Curve) : Other.EvaluateCurve(Curve, Times[Key]);
+		}
+	}
+}
+
+void FMetaFaceClip::RemoveCurve(FName CurveName)
+{
+	const int32 Curve = FindCurve(CurveName);
+	if (Curve != INDEX_NONE)
+	{
+		TArray<FName> NewCurveNames = CurveNames;
+		NewCurveNames.RemoveAt(Curve);
+		SetCurveNames(NewCurveNames);
+	}
+}
+
+void FMetaFaceClip::AppendKeys(const FMetaFaceClip& Other)
+{
+	if (Other.Times.Num() == 0)
+	{
+		return;
+	}
+
+	const int32 KeysNum = Times.Num();
+	TArray<FName> NewCurveNames = CurveNames;
+	TArray<int32> TargetCurves;
+	TargetCurves.SetNumUninitialized(Other.CurveNames.Num());
+	for (int32 Curve = 0; Curve < Other.CurveNames.Num(); Curve++)
+	{
+		TargetCurves[Curve] = NewCurveNames.AddUnique(Other.CurveNames[Curve]);
+	}
+	if (NewCurveNames.Num() != CurveNames.Num())
+	{
+		const int32 OldCurvesNum = CurveNames.Num();
+		SetCurveNames(NewCurveNames);
+
+		// New curves start with their first value
+		for (int32 Curve = 0; Curve < Other.CurveNames.Num(); Curve++)
+		{
+			if (TargetCurves[Curve] >= OldCurvesNum)
+			{
+				for (int32 Key = 0; Key < KeysNum; Key++)
+				{
+					GetValue(Key, TargetCurves[Curve]) = Other.GetValue(0, Curve);
+				}
+			}
+		}
+	}
+
+	Times.Reserve(KeysNum + Other.Times.Num());
+	Values.Reserve((KeysNum + Other.Times.Num()) * Stride);
+	for (int32 Key = 0; Key < Other.Times.Num(); Key++)
+	{
+		float* Row = AddKey(Other.Times[Key]);
+		// Curves missing in other clip keep their last value
+		if (Times.Num() > 1)
+		{
+			FMemory::Memcpy(Row, Row - Stride, Stride * sizeof(float));
+		}
+		const float* OtherRow = Other.GetKey(Key);
+		for (int32 Curve = 0; Curve < Other.CurveNames.Num(); Curve++)
+		{
+			Row[TargetCurves[Curve]] = OtherRow[Curve];
+		}
+	}
+}
+
+void FMetaFaceClip::FromCurves(const TMap<FName, FSimpleFloatCurve>& InCurves)
+{
+	TArray<FName> InCurveNames;
+	InCurves.GenerateKeyArray(InCurveNames);
+
+	// Generated curves are keyed at the same times: use the longest curve as time axis
+	const FSimpleFloatCurve* Reference = nullptr;
+	for (const auto& Curve : InCurves)
+	{
+		if (!Reference || Curve.Value.Values.Num() > Reference->Values.Num())
+		{
+			Reference = &Curve.Value;
+		}
+	}
+
+	bool bSharedKeys = true;
+	for (const auto& Curve : InCurves)
+	{
+		const auto& Keys = Curve.Value.Values;
+		if (Keys.Num() == 0)
+		{
+			continue;
+		}
+		if (Keys.Num() != Reference->Values.Num())
+		{
+			bSharedKeys = false;
+			break;
+		}
+		for (int32 i = 0; i < Keys.Num() && bSharedKeys; i++)
+		{
+			bSharedKeys = Keys[i].Time == Reference->Values[i].Time;
+		}
+		if (!bSharedKeys)
+		{
+			break;
+		}
+	}
+
+	TArray<float> KeyTimes;
+	if (Reference)
+	{
+		if (bSharedKeys)
+		{
+			KeyTimes.Reserve(Reference->Values.Num());
+			for (const auto& Key : Reference->Values)
+			{
+				KeyTimes.Add(Key.Time);
+			}
+		}
+		else
+		{
+			// Union of keys of all curves
+			for (const auto& Curve : InCurves)
+			{
+				for (const auto& Key : Curve.Value.Values)
+				{
+					KeyTimes.Add(Key.Time);
+				}
+			}
+			KeyTimes.Sort();
+			KeyTimes.SetNum(Algo::Unique(KeyTimes));
+		}
+	}
+
+	Reset(InCurveNames, KeyTimes.Num());
+	for (const float Time : KeyTimes)
+	{
+		AddKey(Time);
+	}
+
+	int32 CurveIndex = 0;
+	for (const auto& Curve : InCurves)
+	{
+		const auto& Keys = Curve.Value.Values;
+		if (Keys.Num() > 0)
+		{
+			for (int32 Key = 0; Key < KeyTimes.Num(); Key++)
+			{
+				GetValue(Key, CurveIndex) = bSharedKeys ? Keys[Key].Value : Curve.Value.GetValueAtTime(KeyTimes[Key]);
+			}
+		}
+		CurveIndex++;
+	}
+}
+
+void FMetaFaceClip::ToCurves(TMap<FName, FSimpleFloatCurve>& OutCurves) const
+{
+	OutCurves.Empty(CurveNames.Num());
+	for (int32 Curve = 0; Curve < CurveNames.Num(); Curve++)
+	{
+		FSimpleFloatCurve& OutCurve = OutCurves.Add(CurveNames[Curve]);
+		OutCurve.Values.Reserve(Times.Num());
+		for (int32 Key = 0; Key < Times.Num(); Key++)
+		{
+			OutCurve.Values.Add(FSimpleFloatValue(Times[Key], GetValue(Key, Curve)));
+		}
+	}
+}
+
+SIZE_T FMetaFaceClip::GetAllocatedSize() const
+{
+	return CurveNames.GetAllocatedSize() + CurveIds.GetAllocatedSize() + Times.GetAllocatedSize() + Values.GetAllocatedSize();
+}
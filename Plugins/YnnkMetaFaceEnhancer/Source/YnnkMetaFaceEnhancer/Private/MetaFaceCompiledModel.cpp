@@ -0,0 +1,229 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceCompiledModel.h"
+#include "MetaFaceTypes.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Crc.h"
+#include "Math/VectorRegister.h"
+
+namespace MetaFaceKernels
+{
+	/** Fetch rows for inputs and clamp them. CurvesNum is known at compile time, so inner loop is fully unrolled. */
+	template<int32 CurvesNum>
+	struct TCompiledModelKernel
+	{
+		static_assert(CurvesNum % 4 == 0, "Curves count should be a multiple of SIMD width");
+
+		static void Run(const float* Rows, int32 InputMin, int32 InputsNum, const float* Symbols, int32 SymbolsNum, float* OutValues)
+		{
+			const VectorRegister4Float MinValue = VectorSetFloat1(-1.f);
+			const VectorRegister4Float MaxValue = VectorSetFloat1(1.f);
+
+			for (int32 i = 0; i < SymbolsNum; i++)
+			{
+				const int32 RowIndex = FMath::Clamp(FMath::RoundToInt(Symbols[i]) - InputMin, 0, InputsNum - 1);
+				const float* Src = Rows + RowIndex * CurvesNum;
+				float* Dst = OutValues + i * CurvesNum;
+
+				for (int32 n = 0; n < CurvesNum; n += 4)
+				{
+					VectorStore(VectorMin(VectorMax(VectorLoad(Src + n), MinValue), MaxValue), Dst + n);
+				}
+			}
+		}
+	};
+
+	/** Fallback for unknown curves count */
+	static void RunGeneric(const float* Rows, int32 InputMin, int32 InputsNum, int32 CurvesNum, const float* Symbols, int32 SymbolsNum, float* OutValues)
+	{
+		for (int32 i = 0; i < SymbolsNum; i++)
+		{
+			const int32 RowIndex = FMath::Clamp(FMath::RoundToInt(Symbols[i]) - InputMin, 0, InputsNum - 1);
+			const float* Src = Rows + RowIndex * CurvesNum;
+			float* Dst = OutValues + i * CurvesNum;
+
+			for (int32 n = 0; n < CurvesNum; n++)
+			{
+				Dst[n] = FMath::Clamp(Src[n], -1.f, 1.f);
+			}
+		}
+	}
+}
+
+FMetaFaceModelSignature FMetaFaceModelSignature::FromFile(const FString& FileName)
+{
+	FMetaFaceModelSignature Signature;
+	TArray<uint8> Data;
+	if (FFileHelper::LoadFileToArray(Data, *FileName, FILEREAD_Silent) && Data.Num() > 0)
+	{
+		Signature.Size = (uint32)Data.Num();
+		Signature.Crc = FCrc::MemCrc32(Data.GetData(), Data.Num());
+	}
+	return Signature;
+}
+
+FMetaFaceCompiledModel::FMetaFaceCompiledModel()
+	: Rows(nullptr)
+	, InputMin(0)
+	, InputsNum(0)
+	, CurvesNum(0)
+{
+}
+
+FMetaFaceCompiledModel::~FMetaFaceCompiledModel()
+{
+	Reset();
+}
+
+void FMetaFaceCompiledModel::Reset()
+{
+	Rows = nullptr;
+	InputMin = InputsNum = CurvesNum = 0;
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	FileData.Empty();
+}
+
+bool FMetaFaceCompiledModel::LoadFromFile(const FString& FileName, int32 ExpectedCurvesNum, const FMetaFaceModelSignature& ExpectedSource)
+{
+	Reset();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.FileExists(*FileName))
+	{
+		return false;
+	}
+
+	// Try to map file
+	MappedFile.Reset(PlatformFile.OpenMapped(*FileName));
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (MappedRegion.IsValid() && InitFromMemory(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize(), ExpectedCurvesNum, ExpectedSource))
+		{
+			return true;
+		}
+		MappedRegion.Reset();
+		MappedFile.Reset();
+	}
+
+	// Load to memory
+	if (FFileHelper::LoadFileToArray(FileData, *FileName) && InitFromMemory(FileData.GetData(), FileData.Num(), ExpectedCurvesNum, ExpectedSource))
+	{
+		return true;
+	}
+
+	UE_LOG(LogMetaFace, Warning, TEXT("Unable to load compiled model from file (%s)"), *FileName);
+	Reset();
+	return false;
+}
+
+bool FMetaFaceCompiledModel::InitFromMemory(const uint8* Data, int64 Size, int32 ExpectedCurvesNum, const FMetaFaceModelSignature& ExpectedSource)
+{
+	if (!Data || Size < (int64)sizeof(FMetaFaceCompiledModelHeader))
+	{
+		return false;
+	}
+
+	FMetaFaceCompiledModelHeader Header;
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+
+	if (Header.Magic != FMetaFaceCompiledModelHeader::FileMagic || Header.Version != FMetaFaceCompiledModelHeader::FileVersion)
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("Compiled model: unsupported file format"));
+		return false;
+	}
+	if (Header.CurvesNum != ExpectedCurvesNum || Header.InputsNum <= 0)
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("Compiled model: invalid size (%d x %d), expected %d curves"), Header.InputsNum, Header.CurvesNum, ExpectedCurvesNum);
+		return false;
+	}
+	if (ExpectedSource.IsValid() && (Header.SourceSize != ExpectedSource.Size || Header.SourceCrc != ExpectedSource.Crc))
+	{
+		UE_LOG(LogMetaFace, Log, TEXT("Compiled model is made for another version of TorchScript model"));
+		return false;
+	}
+	if (Size < (int64)sizeof(Header) + (int64)Header.InputsNum * Header.CurvesNum * sizeof(float))
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("Compiled model: file is truncated"));
+		return false;
+	}
+
+	Rows = reinterpret_cast<const float*>(Data + sizeof(Header));
+	InputMin = Header.InputMin;
+	InputsNum = Header.InputsNum;
+	CurvesNum = Header.CurvesNum;
+
+	return true;
+}
+
+bool FMetaFaceCompiledModel::Serialize(int32 InputMin, int32 InputsNum, int32 CurvesNum, const TArray<float>& Rows, const FMetaFaceModelSignature& Source, TArray<uint8>& OutData)
+{
+	if (InputsNum <= 0 || CurvesNum <= 0 || Rows.Num() != InputsNum * CurvesNum)
+	{
+		return false;
+	}
+
+	FMetaFaceCompiledModelHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = FMetaFaceCompiledModelHeader::FileMagic;
+	Header.Version = FMetaFaceCompiledModelHeader::FileVersion;
+	Header.InputMin = InputMin;
+	Header.InputsNum = InputsNum;
+	Header.CurvesNum = CurvesNum;
+	Header.SourceSize = Source.Size;
+	Header.SourceCrc = Source.Crc;
+
+	OutData.SetNumUninitialized(sizeof(Header) + Rows.Num() * sizeof(float));
+	FMemory::Memcpy(OutData.GetData(), &Header, sizeof(Header));
+	FMemory::Memcpy(OutData.GetData() + sizeof(Header), Rows.GetData(), Rows.Num() * sizeof(float));
+
+	return true;
+}
+
+bool FMetaFaceCompiledModel::SaveToFile(const FString& FileName, int32 InputMin, int32 InputsNum, int32 CurvesNum, const TArray<float>& Rows, const FMetaFaceModelSignature& Source)
+{
+	TArray<uint8> FileData;
+	return Serialize(InputMin, InputsNum, CurvesNum, Rows, Source, FileData)
+		&& FFileHelper::SaveArrayToFile(FileData, *FileName);
+}
+
+bool FMetaFaceCompiledModel::InitFromRows(int32 InInputMin, int32 InInputsNum, int32 InCurvesNum, const TArray<float>& InRows)
+{
+	Reset();
+
+	if (Serialize(InInputMin, InInputsNum, InCurvesNum, InRows, FMetaFaceModelSignature(), FileData)
+		&& InitFromMemory(FileData.GetData(), FileData.Num(), InCurvesNum, FMetaFaceModelSignature()))
+	{
+		return true;
+	}
+
+	Reset();
+	return false;
+}
+
+bool FMetaFaceCompiledModel::Evaluate(const float* Symbols, int32 SymbolsNum, float* OutValues) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	switch (CurvesNum)
+	{
+		case 24: // lip-sync
+			MetaFaceKernels::TCompiledModelKernel<24>::Run(Rows, InputMin, InputsNum, Symbols, SymbolsNum, OutValues);
+			break;
+		case 20: // emotions
+			MetaFaceKernels::TCompiledModelKernel<20>::Run(Rows, InputMin, InputsNum, Symbols, SymbolsNum, OutValues);
+			break;
+		default:
+			MetaFaceKernels::RunGeneric(Rows, InputMin, InputsNum, CurvesNum, Symbols, SymbolsNum, OutValues);
+			break;
+	}
+
+	return true;
+}
@@ -0,0 +1,217 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceCurveRegistry.h"
+#include "Misc/ScopeRWLock.h"
+
+namespace
+{
+	// In the order of EMetaFaceCurve
+	const TCHAR* BuiltinCurveNames[] =
+	{
+		TEXT("EyeBlinkLeft"), TEXT("EyeLookDownLeft"), TEXT("EyeLookInLeft"), TEXT("EyeLookOutLeft"), TEXT("EyeLookUpLeft"), TEXT("EyeSquintLeft"), TEXT("EyeWideLeft"),
+		TEXT("EyeBlinkRight"), TEXT("EyeLookDownRight"), TEXT("EyeLookInRight"), TEXT("EyeLookOutRight"), TEXT("EyeLookUpRight"), TEXT("EyeSquintRight"), TEXT("EyeWideRight"),
+		TEXT("JawForward"), TEXT("JawLeft"), TEXT("JawRight"), TEXT("JawOpen"),
+		TEXT("MouthClose"), TEXT("MouthFunnel"), TEXT("MouthPucker"), TEXT("MouthLeft"), TEXT("MouthRight"), TEXT("MouthSmileLeft"), TEXT("MouthSmileRight"), TEXT("MouthFrownLeft"), TEXT("MouthFrownRight"),
+		TEXT("MouthDimpleLeft"), TEXT("MouthDimpleRight"), TEXT("MouthStretchLeft"), TEXT("MouthStretchRight"), TEXT("MouthRollLower"), TEXT("MouthRollUpper"), TEXT("MouthShrugLower"), TEXT("MouthShrugUpper"),
+		TEXT("MouthPressLeft"), TEXT("MouthPressRight"), TEXT("MouthLowerDownLeft"), TEXT("MouthLowerDownRight"), TEXT("MouthUpperUpLeft"), TEXT("MouthUpperUpRight"),
+		TEXT("BrowDownLeft"), TEXT("BrowDownRight"), TEXT("BrowInnerUp"), TEXT("BrowOuterUpLeft"), TEXT("BrowOuterUpRight"),
+		TEXT("CheekPuff"), TEXT("CheekSquintLeft"), TEXT("CheekSquintRight"), TEXT("NoseSneerLeft"), TEXT("NoseSneerRight"), TEXT("TongueOut"),
+		TEXT("HeadYaw"), TEXT("HeadPitch"), TEXT("HeadRoll")
+	};
+	static_assert(UE_ARRAY_COUNT(BuiltinCurveNames) == (int32)EMetaFaceCurve::Num, "Names of built-in curves don't match EMetaFaceCurve");
+
+	/** Name of curve of the opposite side or empty string */
+	FString MakeMirroredName(const FString& CurveName, EMetaFaceCurveFlags Flags)
+	{
+		const bool bLeft = EnumHasAnyFlags(Flags, EMetaFaceCurveFlags::Left);
+		if (!bLeft && !EnumHasAnyFlags(Flags, EMetaFaceCurveFlags::Right))
+		{
+			return FString();
+		}
+
+		// ARKit: ...Left/...Right, MetaHuman CTRL_: ...L/...R
+		if (CurveName.EndsWith(bLeft ? TEXT("Left") : TEXT("Right")))
+		{
+			return CurveName.LeftChop(bLeft ? 4 : 5) + (bLeft ? TEXT("Right") : TEXT("Left"));
+		}
+		return CurveName.LeftChop(1) + (bLeft ? TEXT("R") : TEXT("L"));
+	}
+}
+
+FMetaFaceCurveRegistry& FMetaFaceCurveRegistry::Get()
+{
+	static FMetaFaceCurveRegistry Registry;
+	return Registry;
+}
+
+FMetaFaceCurveRegistry::FMetaFaceCurveRegistry()
+{
+	Curves.Reserve(256);
+	CurveIds.Reserve(256);
+	for (const TCHAR* CurveName : BuiltinCurveNames)
+	{
+		AddCurve(CurveName);
+	}
+}
+
+int32 FMetaFaceCurveRegistry::FindOrAdd(FName CurveName)
+{
+	{
+		FReadScopeLock ReadLock(Lock);
+		if (const int32* CurveId = CurveIds.Find(CurveName))
+		{
+			return *CurveId;
+		}
+	}
+
+	FWriteScopeLock WriteLock(Lock);
+	if (const int32* CurveId = CurveIds.Find(CurveName))
+	{
+		return *CurveId;
+	}
+	return AddCurve(CurveName);
+}
+
+int32 FMetaFaceCurveRegistry::Find(FName CurveName) const
+{
+	FReadScopeLock ReadLock(Lock);
+	const int32* CurveId = CurveIds.Find(CurveName);
+	return CurveId ? *CurveId : INDEX_NONE;
+}
+
+FName FMetaFaceCurveRegistry::GetName(int32 CurveId) const
+{
+	FReadScopeLock ReadLock(Lock);
+	return Curves.IsValidIndex(CurveId) ? Curves[CurveId].Name : NAME_None;
+}
+
+EMetaFaceCurveFlags FMetaFaceCurveRegistry::GetFlags(int32 CurveId) const
+{
+	FReadScopeLock ReadLock(Lock);
+	return Curves.IsValidIndex(CurveId) ? Curves[CurveId].Flags : EMetaFaceCurveFlags::None;
+}
+
+int32 FMetaFaceCurveRegistry::GetMirroredCurve(int32 CurveId) const
+{
+	FReadScopeLock ReadLock(Lock);
+	return Curves.IsValidIndex(CurveId) ? Curves[CurveId].MirroredCurve : INDEX_NONE;
+}
+
+FName FMetaFaceCurveRegistry::GetName(EMetaFaceCurve Curve)
+{
+	static const TArray<FName> BuiltinNames = []()
+	{
+		TArray<FName> Names;
+		for (const TCHAR* CurveName : BuiltinCurveNames)
+		{
+			Names.Add(CurveName);
+		}
+		return Names;
+	}();
+	return BuiltinNames[(int32)Curve];
+}
+
+const TArray<FName>& FMetaFaceCurveRegistry::GetCurveSet(bool bLipsyncCurves)
+{
+	auto MakeCurveSet = [](TArrayView<const EMetaFaceCurve> CurveSet)
+	{
+		TArray<FName> Names;
+		Names.Reserve(CurveSet.Num());
+		for (const EMetaFaceCurve Curve : CurveSet)
+		{
+			Names.Add(GetName(Curve));
+		}
+		return Names;
+	};
+
+	static const TArray<FName> LipsyncSet = MakeCurveSet(MetaFaceCurveSets::Lipsync);
+	static const TArray<FName> EmotionsSet = MakeCurveSet(MetaFaceCurveSets::Emotions);
+	return bLipsyncCurves ? LipsyncSet : EmotionsSet;
+}
+
+int32 FMetaFaceCurveRegistry::AddCurve(FName CurveName)
+{
+	const FString CurveString = CurveName.ToString();
+	const int32 CurveId = Curves.Num();
+
+	FCurveInfo& Info = Curves.AddDefaulted_GetRef();
+	Info.Name = CurveName;
+	Info.Flags = MakeCurveFlags(CurveString);
+	Info.MirroredCurve = INDEX_NONE;
+	if (CurveId >= (int32)EMetaFaceCurve::Num)
+	{
+		Info.Flags |= EMetaFaceCurveFlags::Custom;
+	}
+	CurveIds.Add(CurveName, CurveId);
+
+	// Link with the opposite side if it's already registered
+	const FString MirroredName = MakeMirroredName(CurveString, Info.Flags);
+	if (!MirroredName.IsEmpty())
+	{
+		if (const int32* MirroredCurve = CurveIds.Find(FName(*MirroredName)))
+		{
+			Curves[CurveId].MirroredCurve = *MirroredCurve;
+			Curves[*MirroredCurve].MirroredCurve = CurveId;
+		}
+	}
+
+	return CurveId;
+}
+
+EMetaFaceCurveFlags FMetaFaceCurveRegistry::MakeCurveFlags(const FString& CurveName)
+{
+	EMetaFaceCurveFlags Flags = EMetaFaceCurveFlags::None;
+	if (CurveName.StartsWith(TEXT("Head")))
+	{
+		Flags |= EMetaFaceCurveFlags::Head;
+	}
+	if (CurveName.Contains(TEXT("Brow")))
+	{
+		Flags |= EMetaFaceCurveFlags::Brow;
+	}
+	if (CurveName.Contains(TEXT("Eye")))
+	{
+		Flags |= EMetaFaceCurveFlags::Eye;
+	}
+	if (CurveName.Contains(TEXT("Mouth")) || CurveName.Contains(TEXT("Jaw")) || CurveName.Contains(TEXT("Tongue")) || CurveName.Contains(TEXT("Lip")))
+	{
+		Flags |= EMetaFaceCurveFlags::Mouth;
+	}
+	if (!EnumHasAnyFlags(Flags, EMetaFaceCurveFlags::Head))
+	{
+		static const TCHAR* DetailKeywords[] = { TEXT("Cheek"), TEXT("Nose"), TEXT("Dimple"), TEXT("Shrug"), TEXT("Stretch") };
+		for (const TCHAR* Keyword : DetailKeywords)
+		{
+			if (CurveName.Contains(Keyword))
+			{
+				Flags |= EMetaFaceCurveFlags::Detail;
+				break;
+			}
+		}
+	}
+
+	// ARKit: ...Left/...Right, MetaHuman CTRL_: ...L/...R after lower case letter
+	const int32 Len = CurveName.Len();
+	if (CurveName.EndsWith(TEXT("Left")))
+	{
+		Flags |= EMetaFaceCurveFlags::Left;
+	}
+	else if (CurveName.EndsWith(TEXT("Right")))
+	{
+		Flags |= EMetaFaceCurveFlags::Right;
+	}
+	else if (Len > 1 && FChar::IsLower(CurveName[Len - 2]))
+	{
+		if (CurveName[Len - 1] == TEXT('L'))
+		{
+			Flags |= EMetaFaceCurveFlags::Left;
+		}
+		else if (CurveName[Len - 1] == TEXT('R'))
+		{
+			Flags |= EMetaFaceCurveFlags::Right;
+		}
+	}
+
+	return Flags;
+}
@@ -10,9 +10,12 @@
 #include "Misc/CString.h"
 #include "HAL/PlatformApplicationMisc.h"
 #include "YnnkMetaFaceEnhancer.h"
+#include "MetaFaceWorkerPool.h"
 #include "YnnkMetaFaceController.h"
 #include "AsyncAnimBuilder.h"
 #include "YnnkMetaFaceSettings.h"
+#include "MetaFaceVisemeTable.h"
+#include "MetaFaceSmoothing.h"
 #include "NeuralProcessWrapper.h"
 #include "Async/Async.h"
 
@@ -60,39 +63,18 @@ void UMFFunctionLibrary::CreateMetaFaceAnimationCurves(UYnnkVoiceLipsyncData* Li
 		{
 			if (RawData.Num() > 0)
 			{
-				TMap<FName, FSimpleFloatCurve> AnimationData;
+				FMetaFaceClip AnimationData;
 				UMFFunctionLibrary::RawDataToLipsync(LipsyncData, RawData, AnimationData, MetaFaceSettings);
-
-				const FName FrownL = TEXT("MouthFrownLeft");
-				const FName FrownR = TEXT("MouthFrownRight");
-				const FName SmileL = TEXT("MouthSmileLeft");
-				const FName SmileR = TEXT("MouthSmileRight");
-
-				if (MetaFaceSettings.bBalanceSmileFrownCurves
-					&& AnimationData.Contains(FrownL) && AnimationData.Contains(SmileL)
-					&& AnimationData.Contains(FrownR) && AnimationData.Contains(SmileR))
+				if (MetaFaceSettings.bBalanceSmileFrownCurves)
 				{
-					for (int32 i = 0; i < AnimationData[FrownL].Values.Num(); i++)
-					{
-						if (AnimationData[FrownL].Values[i].Value < AnimationData[SmileL].Values[i].Value)
-						{
-							float Mean = (AnimationData[FrownL].Values[i].Value + AnimationData[SmileL].Values[i].Value) * 0.5f;
-							AnimationData[FrownL].Values[i].Value = AnimationData[SmileL].Values[i].Value = Mean;
-						}
-
-						if (AnimationData[FrownR].Values[i].Value < AnimationData[SmileR].Values[i].Value)
-						{
-							float Mean = (AnimationData[FrownR].Values[i].Value + AnimationData[SmileR].Values[i].Value) * 0.5f;
-							AnimationData[FrownR].Values[i].Value = AnimationData[SmileR].Values[i].Value = Mean;
-						}
-					}
+					UMFFunctionLibrary::BalanceSmileFrownCurves(AnimationData);
 				}
 
 				if (MetaFaceSettings.bLipSyncToSkeletonCurves)
 				{
 					UMFFunctionLibrary::ConvertFacialAnimCurves(AnimationData, MetaFaceSettings.ArKitCurvesPoseAsset);
 				}
-				LipsyncAnimation.Initialize(AnimationData, false);
+				LipsyncAnimation.Initialize(MoveTemp(AnimationData), false);
 			}
 		}
 	}
@@ -102,12 +84,12 @@ void UMFFunctionLibrary::CreateMetaFaceAnimationCurves(UYnnkVoiceLipsyncData* Li
 		{
 			if (RawData.Num() > 0)
 			{
-				TMap<FName, FSimpleFloatCurve> AnimationData;
+				FMetaFaceClip AnimationData;
 				UMFFunctionLibrary::RawDataToFacialAnimation(LipsyncData, RawData, AnimationData, MetaFaceSettings);
 				if (MetaFaceSettings.bBalanceSmileFrownCurves)
 				{
-					AnimationData.Remove(TEXT("MouthSmileLeft"));
-					AnimationData.Remove(TEXT("MouthSmileRight"));
+					AnimationData.RemoveCurve(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::MouthSmileLeft));
+					AnimationData.RemoveCurve(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::MouthSmileRight));
 				}
 				if (MetaFaceSettings.bFacialAnimationToSkeletonCurves)
 				{
@@ -115,7 +97,7 @@ void UMFFunctionLibrary::CreateMetaFaceAnimationCurves(UYnnkVoiceLipsyncData* Li
 				}
 
 				const float FacialAnimationPauseDuration = 1.;
-				FacialAnimation.Initialize(AnimationData, true, FacialAnimationPauseDuration, FacialAnimationPauseDuration * 0.5f - 0.01f);
+				FacialAnimation.Initialize(MoveTemp(AnimationData), true, FacialAnimationPauseDuration, FacialAnimationPauseDuration * 0.5f - 0.01f);
 			}
 		}
 	}
@@ -127,27 +109,27 @@ void UMFFunctionLibrary::CreateMetaFaceAnimationCurves(UYnnkVoiceLipsyncData* Li
 
 	//LipsyncData->
 
-	if (MetaFaceSettings.bLipSyncToSkeletonCurves && !__is_anim_converted(LipsyncAnimation))
+	if (MetaFaceSettings.bLipSyncToSkeletonCurves && LipsyncAnimation.GetClip().IsValid() && !__is_anim_converted(LipsyncAnimation))
 	{
-		auto AnimCopy = LipsyncAnimation.AnimationData;
+		FMetaFaceClip AnimCopy = *LipsyncAnimation.GetClip();
 		UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, MetaFaceSettings.ArKitCurvesPoseAsset);
-		NewItem.LipSync.AnimationData.Append(AnimCopy);
+		NewItem.LipSync.AddCurves(AnimCopy);
 		__set_anim_converted(LipsyncAnimation);
 	}
 
-	if (MetaFaceSettings.bFacialAnimationToSkeletonCurves && !__is_anim_converted(FacialAnimation))
+	if (MetaFaceSettings.bFacialAnimationToSkeletonCurves && FacialAnimation.GetClip().IsValid() && !__is_anim_converted(FacialAnimation))
 	{
-		auto AnimCopy = FacialAnimation.AnimationData;
+		FMetaFaceClip AnimCopy = *FacialAnimation.GetClip();
 		UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, MetaFaceSettings.ArKitCurvesPoseAsset);
-		NewItem.FacialAnimation.AnimationData.Append(AnimCopy);
+		NewItem.FacialAnimation.AddCurves(AnimCopy);
 		__set_anim_converted(FacialAnimation);
 	}
 	
 #if WITH_EDITOR
 	LipsyncData->Modify();
 #endif
-	LipsyncData->ExtraAnimData1 = NewItem.LipSync.AnimationData;
-	LipsyncData->ExtraAnimData2 = NewItem.FacialAnimation.AnimationData;
+	LipsyncData->ExtraAnimData1 = NewItem.LipSync.GetAnimationData();
+	LipsyncData->ExtraAnimData2 = NewItem.FacialAnimation.GetAnimationData();
 
 }
 
@@ -190,9 +172,10 @@ bool UMFFunctionLibrary::BuildFacialAnimationData(UYnnkVoiceLipsyncData* Lipsync
 
 float UMFFunctionLibrary::FacialAnimation_CurveValueAtTime(FMHFacialAnimation& Animation, FName Curve, float PlayTime)
 {
-	if (const auto CurveData = Animation.AnimationData.Find(Curve))
+	const int32 CurveIndex = Animation.GetClip().IsValid() ? Animation.GetClip()->FindCurve(Curve) : INDEX_NONE;
+	if (CurveIndex != INDEX_NONE)
 	{
-		return CurveData->GetValueAtTime(PlayTime);
+		return Animation.GetClip()->EvaluateCurve(CurveIndex, PlayTime);
 	}
 	else
 	{
@@ -200,6 +183,11 @@ float UMFFunctionLibrary::FacialAnimation_CurveValueAtTime(FMHFacialAnimation& A
 	}
 }
 
+TMap<FName, FSimpleFloatCurve> UMFFunctionLibrary::FacialAnimation_GetAnimationData(FMHFacialAnimation& Animation)
+{
+	return Animation.GetAnimationData();
+}
+
 FString UMFFunctionLibrary::FacialAnimation_GetDescription(FMHFacialAnimation& Animation)
 {
 	return Animation.GetDescription();
@@ -219,110 +207,123 @@ UNeuralProcessWrapper* UMFFunctionLibrary::InitializeYnnkMetaFace(UObject* Paren
 	return p;
 }
 
+void UMFFunctionLibrary::GetWarmUpPhonemes(TArray<FPhonemeTextData>& OutPhonemes)
+{
+	OutPhonemes.Empty();
+	OutPhonemes.Add(FPhonemeTextData(0.330000f, TEXT('d'), true));
+	OutPhonemes.Add(FPhonemeTextData(0.360000f, TEXT('a'), false));
+	OutPhonemes.Add(FPhonemeTextData(0.517500f, TEXT('l'), true));
+	OutPhonemes.Add(FPhonemeTextData(0.615000f, TEXT('e'), false));
+	OutPhonemes.Add(FPhonemeTextData(0.680000f, TEXT('s'), false));
+	OutPhonemes.Add(FPhonemeTextData(0.745000f, TEXT('t'), false));
+	OutPhonemes.Add(FPhonemeTextData(0.866667f, TEXT('p'), true));
+	OutPhonemes.Add(FPhonemeTextData(0.923333f, TEXT('r'), false));
+	OutPhonemes.Add(FPhonemeTextData(0.980000f, TEXT('a'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.036667f, TEXT('b'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.093333f, TEXT('l'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.150000f, TEXT('a'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.235000f, TEXT('m'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.391250f, TEXT('h'), true));
+	OutPhonemes.Add(FPhonemeTextData(1.462500f, TEXT('o'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.510000f, TEXT('p'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.557500f, TEXT('f'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.605000f, TEXT('a'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.676250f, TEXT('l'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.747500f, TEXT('i'), false));
+	OutPhonemes.Add(FPhonemeTextData(1.980000f, TEXT('i'), true));
+	OutPhonemes.Add(FPhonemeTextData(2.025000f, TEXT('z'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.150000f, TEXT('u'), true));
+	OutPhonemes.Add(FPhonemeTextData(2.230000f, TEXT('e'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.270000f, TEXT('n'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.355000f, TEXT('a'), true));
+	OutPhonemes.Add(FPhonemeTextData(2.377500f, TEXT('i'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.454250f, TEXT('b'), true));
+	OutPhonemes.Add(FPhonemeTextData(2.508500f, TEXT('i'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.562749f, TEXT('g'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.616999f, TEXT('i'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.671249f, TEXT('n'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.749124f, TEXT('d'), true));
+	OutPhonemes.Add(FPhonemeTextData(2.772749f, TEXT('a'), false));
+	OutPhonemes.Add(FPhonemeTextData(2.905000f, TEXT('p'), true));
+	OutPhonemes.Add(FPhonemeTextData(2.990000f, TEXT('e'), false));
+	OutPhonemes.Add(FPhonemeTextData(3.075000f, TEXT('k'), false));
+	OutPhonemes.Add(FPhonemeTextData(3.160000f, TEXT('a'), false));
+	OutPhonemes.Add(FPhonemeTextData(3.245000f, TEXT('j'), false));
+	OutPhonemes.Add(FPhonemeTextData(3.406667f, TEXT('p'), true));
+	OutPhonemes.Add(FPhonemeTextData(3.483333f, TEXT('r'), false));
+	OutPhonemes.Add(FPhonemeTextData(3.560000f, TEXT('a'), false));
+	OutPhonemes.Add(FPhonemeTextData(3.675000f, TEXT('s'), false));
+	OutPhonemes.Add(FPhonemeTextData(3.790000f, TEXT('e'), false));
+	OutPhonemes.Add(FPhonemeTextData(3.905000f, TEXT('s'), false));
+	OutPhonemes.Add(FPhonemeTextData(4.180000f, TEXT('e'), true));
+	OutPhonemes.Add(FPhonemeTextData(4.223334f, TEXT('f'), false));
+	OutPhonemes.Add(FPhonemeTextData(4.266667f, TEXT('t'), false));
+	OutPhonemes.Add(FPhonemeTextData(4.310001f, TEXT('o'), false));
+	OutPhonemes.Add(FPhonemeTextData(4.470000f, TEXT('e'), true));
+	OutPhonemes.Add(FPhonemeTextData(4.545000f, TEXT('f'), true));
+	OutPhonemes.Add(FPhonemeTextData(4.590000f, TEXT('i'), false));
+	OutPhonemes.Add(FPhonemeTextData(4.680000f, TEXT('u'), false));
+	OutPhonemes.Add(FPhonemeTextData(4.860000f, TEXT('s'), true));
+	OutPhonemes.Add(FPhonemeTextData(4.950000f, TEXT('e'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.040000f, TEXT('k'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.130001f, TEXT('a'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.175001f, TEXT('n'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.220001f, TEXT('d'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.265001f, TEXT('z'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.385000f, TEXT('i'), true));
+	OutPhonemes.Add(FPhonemeTextData(5.422500f, TEXT('t'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.550000f, TEXT('1'), true));
+	OutPhonemes.Add(FPhonemeTextData(5.640000f, TEXT('o'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.730000f, TEXT('z'), false));
+	OutPhonemes.Add(FPhonemeTextData(5.865000f, TEXT('m'), true));
+	OutPhonemes.Add(FPhonemeTextData(5.910000f, TEXT('i'), false));
+	OutPhonemes.Add(FPhonemeTextData(6.075000f, TEXT('e'), true));
+	OutPhonemes.Add(FPhonemeTextData(6.112500f, TEXT('n'), false));
+	OutPhonemes.Add(FPhonemeTextData(6.330000f, TEXT('e'), true));
+	OutPhonemes.Add(FPhonemeTextData(6.420000f, TEXT('r'), false));
+	OutPhonemes.Add(FPhonemeTextData(6.510000f, TEXT('o'), false));
+}
+
 void UMFFunctionLibrary::PrepareYnnkMetaFaceModel()
 {
-	// Start import thread
-	Async(EAsyncExecution::Thread, []()
-	{
-		FString OutData;
-		bool bResult = false;
-
-		auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
-
-		if (ModuleMFE)
-		{
-			TArray<FPhonemeTextData> PhonemesData;
-			PhonemesData.Add(FPhonemeTextData(0.330000f, TEXT('d'), true));
-			PhonemesData.Add(FPhonemeTextData(0.360000f, TEXT('a'), false));
-			PhonemesData.Add(FPhonemeTextData(0.517500f, TEXT('l'), true));
-			PhonemesData.Add(FPhonemeTextData(0.615000f, TEXT('e'), false));
-			PhonemesData.Add(FPhonemeTextData(0.680000f, TEXT('s'), false));
-			PhonemesData.Add(FPhonemeTextData(0.745000f, TEXT('t'), false));
-			PhonemesData.Add(FPhonemeTextData(0.866667f, TEXT('p'), true));
-			PhonemesData.Add(FPhonemeTextData(0.923333f, TEXT('r'), false));
-			PhonemesData.Add(FPhonemeTextData(0.980000f, TEXT('a'), false));
-			PhonemesData.Add(FPhonemeTextData(1.036667f, TEXT('b'), false));
-			PhonemesData.Add(FPhonemeTextData(1.093333f, TEXT('l'), false));
-			PhonemesData.Add(FPhonemeTextData(1.150000f, TEXT('a'), false));
-			PhonemesData.Add(FPhonemeTextData(1.235000f, TEXT('m'), false));
-			PhonemesData.Add(FPhonemeTextData(1.391250f, TEXT('h'), true));
-			PhonemesData.Add(FPhonemeTextData(1.462500f, TEXT('o'), false));
-			PhonemesData.Add(FPhonemeTextData(1.510000f, TEXT('p'), false));
-			PhonemesData.Add(FPhonemeTextData(1.557500f, TEXT('f'), false));
-			PhonemesData.Add(FPhonemeTextData(1.605000f, TEXT('a'), false));
-			PhonemesData.Add(FPhonemeTextData(1.676250f, TEXT('l'), false));
-			PhonemesData.Add(FPhonemeTextData(1.747500f, TEXT('i'), false));
-			PhonemesData.Add(FPhonemeTextData(1.980000f, TEXT('i'), true));
-			PhonemesData.Add(FPhonemeTextData(2.025000f, TEXT('z'), false));
-			PhonemesData.Add(FPhonemeTextData(2.150000f, TEXT('u'), true));
-			PhonemesData.Add(FPhonemeTextData(2.230000f, TEXT('e'), false));
-			PhonemesData.Add(FPhonemeTextData(2.270000f, TEXT('n'), false));
-			PhonemesData.Add(FPhonemeTextData(2.355000f, TEXT('a'), true));
-			PhonemesData.Add(FPhonemeTextData(2.377500f, TEXT('i'), false));
-			PhonemesData.Add(FPhonemeTextData(2.454250f, TEXT('b'), true));
-			PhonemesData.Add(FPhonemeTextData(2.508500f, TEXT('i'), false));
-			PhonemesData.Add(FPhonemeTextData(2.562749f, TEXT('g'), false));
-			PhonemesData.Add(FPhonemeTextData(2.616999f, TEXT('i'), false));
-			PhonemesData.Add(FPhonemeTextData(2.671249f, TEXT('n'), false));
-			PhonemesData.Add(FPhonemeTextData(2.749124f, TEXT('d'), true));
-			PhonemesData.Add(FPhonemeTextData(2.772749f, TEXT('a'), false));
-			PhonemesData.Add(FPhonemeTextData(2.905000f, TEXT('p'), true));
-			PhonemesData.Add(FPhonemeTextData(2.990000f, TEXT('e'), false));
-			PhonemesData.Add(FPhonemeTextData(3.075000f, TEXT('k'), false));
-			PhonemesData.Add(FPhonemeTextData(3.160000f, TEXT('a'), false));
-			PhonemesData.Add(FPhonemeTextData(3.245000f, TEXT('j'), false));
-			PhonemesData.Add(FPhonemeTextData(3.406667f, TEXT('p'), true));
-			PhonemesData.Add(FPhonemeTextData(3.483333f, TEXT('r'), false));
-			PhonemesData.Add(FPhonemeTextData(3.560000f, TEXT('a'), false));
-			PhonemesData.Add(FPhonemeTextData(3.675000f, TEXT('s'), false));
-			PhonemesData.Add(FPhonemeTextData(3.790000f, TEXT('e'), false));
-			PhonemesData.Add(FPhonemeTextData(3.905000f, TEXT('s'), false));
-			PhonemesData.Add(FPhonemeTextData(4.180000f, TEXT('e'), true));
-			PhonemesData.Add(FPhonemeTextData(4.223334f, TEXT('f'), false));
-			PhonemesData.Add(FPhonemeTextData(4.266667f, TEXT('t'), false));
-			PhonemesData.Add(FPhonemeTextData(4.310001f, TEXT('o'), false));
-			PhonemesData.Add(FPhonemeTextData(4.470000f, TEXT('e'), true));
-			PhonemesData.Add(FPhonemeTextData(4.545000f, TEXT('f'), true));
-			PhonemesData.Add(FPhonemeTextData(4.590000f, TEXT('i'), false));
-			PhonemesData.Add(FPhonemeTextData(4.680000f, TEXT('u'), false));
-			PhonemesData.Add(FPhonemeTextData(4.860000f, TEXT('s'), true));
-			PhonemesData.Add(FPhonemeTextData(4.950000f, TEXT('e'), false));
-			PhonemesData.Add(FPhonemeTextData(5.040000f, TEXT('k'), false));
-			PhonemesData.Add(FPhonemeTextData(5.130001f, TEXT('a'), false));
-			PhonemesData.Add(FPhonemeTextData(5.175001f, TEXT('n'), false));
-			PhonemesData.Add(FPhonemeTextData(5.220001f, TEXT('d'), false));
-			PhonemesData.Add(FPhonemeTextData(5.265001f, TEXT('z'), false));
-			PhonemesData.Add(FPhonemeTextData(5.385000f, TEXT('i'), true));
-			PhonemesData.Add(FPhonemeTextData(5.422500f, TEXT('t'), false));
-			PhonemesData.Add(FPhonemeTextData(5.550000f, TEXT('1'), true));
-			PhonemesData.Add(FPhonemeTextData(5.640000f, TEXT('o'), false));
-			PhonemesData.Add(FPhonemeTextData(5.730000f, TEXT('z'), false));
-			PhonemesData.Add(FPhonemeTextData(5.865000f, TEXT('m'), true));
-			PhonemesData.Add(FPhonemeTextData(5.910000f, TEXT('i'), false));
-			PhonemesData.Add(FPhonemeTextData(6.075000f, TEXT('e'), true));
-			PhonemesData.Add(FPhonemeTextData(6.112500f, TEXT('n'), false));
-			PhonemesData.Add(FPhonemeTextData(6.330000f, TEXT('e'), true));
-			PhonemesData.Add(FPhonemeTextData(6.420000f, TEXT('r'), false));
-			PhonemesData.Add(FPhonemeTextData(6.510000f, TEXT('o'), false));
-
-			UNeuralProcessWrapper* NeuralProcessor = ModuleMFE->GetNeuralProcessor();
-
-			if (IsValid(NeuralProcessor))
-			{
-				RawAnimDataMap GeneratedData;
+	auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	if (!ModuleMFE)
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("PrepareYnnkMetaFaceModel: can't get pointer to module"));
+		return;
+	}
 
-				// Lip-sync
-				NeuralProcessor->ProcessPhonemesData(PhonemesData, true, GeneratedData);
-				GeneratedData.Empty();
+	// Can start loading models
+	UNeuralProcessWrapper* NeuralProcessor = ModuleMFE->GetNeuralProcessor();
+	if (!IsValid(NeuralProcessor))
+	{
+		return;
+	}
 
-				// Facial animation
-				NeuralProcessor->ProcessPhonemesData2(PhonemesData, false, GeneratedData);
-			}
-		}
-		else
+	if (ModuleMFE->IsLoadingModels())
+	{
+		// Models loaded in background are warmed up automatically
+		if (GetDefault<UYnnkMetaFaceSettings>()->bWarmUpModels)
 		{
-			OutData = TEXT("ERROR: can't get pointer to module");
+			return;
 		}
+
+		// Worker of the pool shouldn't be blocked until models are loaded: warm up when they are ready
+		TSharedRef<FDelegateHandle> Handle = MakeShared<FDelegateHandle>();
+		*Handle = ModuleMFE->OnModelsReady().AddLambda([Handle]()
+		{
+			if (auto Module = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer")))
+			{
+				Module->OnModelsReady().Remove(*Handle);
+			}
+			PrepareYnnkMetaFaceModel();
+		});
+		return;
+	}
+
+	ModuleMFE->GetWorkerPool().Launch([NeuralProcessor]()
+	{
+		NeuralProcessor->WarmUp();
 	});
 }
 
@@ -337,162 +338,286 @@ FRotator UMFFunctionLibrary::MakeHeadRotatorFromAnimFrame(const TMap<FName, floa
 		: FRotator::ZeroRotator;
 }
 
-void UMFFunctionLibrary::RawDataToLipsync(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves, const FMetaFaceGenerationSettings& MetaFaceSettings)
+namespace MetaFaceGeneration
 {
-	const int32 PhonemesNum = PhonemesSource->PhonemesData.Num();
-	float PlayTime = PhonemesSource->PhonemesData.Last().Time + 0.05f;
-	float PreviousPhonemeTime = 0.f;
-
-	// Debug output
-	/*
-	for (const auto& Curve : InData)
+	/**
+	* Value of a key for a phoneme without model output (curve is shorter than phonemes array): the previous key
+	* of the curve is kept (0 at the beginning of the phrase). Used by both batch and streaming key generation.
+	*/
+	static float KeepPreviousValue(const float* PreviousValue)
 	{
-		UE_LOG(LogTemp, Log, TEXT("Curve: %s has %d points"), *Curve.Key.ToString(), Curve.Value.Num());
+		return PreviousValue ? *PreviousValue : 0.f;
+	}
 
-		FString Values;
-		for (const auto& Val : Curve.Value)
+	/**
+	* Fade keys added before a phoneme which starts a new word after pause.
+	* Returns number of keys: 1 (zero key at the beginning of the phrase), 2 (fade out and fade in) or 0.
+	*/
+	static int32 GetLipsyncFadeKeys(const FPhonemeTextData& Phoneme, float PreviousPhonemeTime, float& OutTimeFadeIn, float& OutTimeFadeOut)
+	{
+		OutTimeFadeIn = OutTimeFadeOut = 0.f;
+		if (!Phoneme.bWordStart || Phoneme.Time - PreviousPhonemeTime < 0.2f)
 		{
-			Values.Append(FString::SanitizeFloat(Val));
-			Values.Append(TEXT(" "));
+			return 0;
+		}
+		if (PreviousPhonemeTime == 0.f)
+		{
+			return 1;
 		}
-		Values.TrimEndInline();
-		UE_LOG(LogTemp, Log, TEXT("%s"), *Values);
-	}
-	*/
 
-	auto Settings = GetDefault<UYnnkMetaFaceSettings>();
-	// Due to complifications with CC4 characters it's better not to convert lip-sync here and do it later in YnnkMetaFaceController
-	// (to keep original curves controlling bones)
-	float VisemeApplyAlpha = MetaFaceSettings.VisemeApplyAlpha;
-	float LipsyncNeuralIntensity = MetaFaceSettings.LipsyncNeuralIntensity;
-	float LipsyncSmoothness = MetaFaceSettings.LipsyncSmoothness;
-	UPoseAsset* ArKitCurvesPoseAsset = MetaFaceSettings.ArKitCurvesPoseAsset;
-	bool bConvertLipSync = false;// MetaFaceSettings.bLipSyncToSkeletonCurves;
+		float OffsetBetweenWords = FMath::Min(0.2f, (Phoneme.Time - PreviousPhonemeTime) * 0.5f - 0.05f);
+		OutTimeFadeIn = PreviousPhonemeTime + OffsetBetweenWords;
+		OutTimeFadeOut = Phoneme.Time - OffsetBetweenWords;
+		return 2;
+	}
 
-	// initialize out data
-	OutAnimationCurves.Empty();
-	for (const auto& Curve : InData)
+	static bool IsClosedViseme(EYnnkViseme Viseme)
 	{
-		OutAnimationCurves.Add(Curve.Key);
+		return Viseme == EYnnkViseme::YV_BMP || Viseme == EYnnkViseme::YV_FV || Viseme == EYnnkViseme::YV_Oh || Viseme == EYnnkViseme::YV_WU;
 	}
 
-	// fill out data
-	for (int32 Index = 0; Index < PhonemesNum; ++Index)
+	/** Viseme poses of settings in the order of curves of clip */
+	struct FLipsyncPoses
+	{
+		FMetaFaceVisemeTablePtr Table;
+		FMetaFaceClip::FValuesArray Values;
+		FMetaFaceClip::FValuesArray Mask;
+		int32 Stride;
+
+		FLipsyncPoses(const TArray<int32>& CurveIds, int32 InStride)
+			: Table(GetDefault<UYnnkMetaFaceSettings>()->GetVisemeTable())
+			, Stride(InStride)
+		{
+			Table->MakeRows(CurveIds, Stride, Values, Mask);
+		}
+
+		bool HasViseme(EYnnkViseme Viseme) const { return Table->HasViseme(Viseme); }
+		// Viseme can be YV_Max (empty row)
+		const float* GetValues(EYnnkViseme Viseme) const { return Values.GetData() + (int32)Viseme * Stride; }
+		const float* GetMask(EYnnkViseme Viseme) const { return Mask.GetData() + (int32)Viseme * Stride; }
+	};
+
+	/**
+	* Lip-sync values of all curves at phoneme. RawValues and OutRow have clip stride and are 16-byte aligned.
+	* PrevViseme/NextViseme are YV_Max at the ends of phrase.
+	*/
+	static void MakeLipsyncRow(const FLipsyncPoses& Poses, const FPhonemeTextData& Phoneme, bool bNextWordStart, EYnnkViseme PrevViseme, EYnnkViseme Viseme, EYnnkViseme NextViseme,
+		float PlayTime, const FMetaFaceGenerationSettings& MetaFaceSettings, const float* RawValues, float* OutRow, uint8* OutFlags, int32 CurvesNum)
 	{
-		const auto& Phoneme = PhonemesSource->PhonemesData[Index];
+		const float WordPlaceMultiplier = (Phoneme.bWordStart || bNextWordStart) ? 0.5f : 1.f;
 
-		EYnnkViseme v = YnnkHelpers::SymbolToViseme(Phoneme.Symbol[0]);
+		// manual smooth: average with poses of closed neighbour visemes
+		const bool bSmoothPrev = IsClosedViseme(PrevViseme) && Poses.HasViseme(PrevViseme);
+		const bool bSmoothNext = IsClosedViseme(NextViseme) && Poses.HasViseme(NextViseme);
 
-		float TimeFadeIn = 0.f, TimeFadeOut = 0.f;
-		bool bNewWordStarted = Phoneme.bWordStart;
-		if (bNewWordStarted)
+		// pose of the viseme
+		const bool bApplyViseme = Poses.HasViseme(Viseme);
+		const bool bReplaceByViseme = Viseme == EYnnkViseme::YV_BMP;
+		float LerpAlpha = MetaFaceSettings.LipsyncNeuralIntensity;
+		if (Viseme == EYnnkViseme::YV_WU || Viseme == EYnnkViseme::YV_Oh)
 		{
-			if (Phoneme.Time - PreviousPhonemeTime < 0.2f)
-			{
-				bNewWordStarted = false;
-			}
-			else
-			{
-				float OffsetBetweenWords = FMath::Min(0.2f, (Phoneme.Time - PreviousPhonemeTime) * 0.5f - 0.05f);
-				TimeFadeIn = PreviousPhonemeTime + OffsetBetweenWords;
-				TimeFadeOut = Phoneme.Time - OffsetBetweenWords;
-			}
+			LerpAlpha = MetaFaceSettings.LipsyncNeuralIntensity * 0.4f;
 		}
 
-		for (const auto& Curve : InData)
+		// fade out
+		const bool bFadeOut = PlayTime - Phoneme.Time < 0.25f;
+		const float FadeOutMultiplier = (PlayTime - Phoneme.Time) / 0.25f;
+
+		const float* PrevPose = Poses.GetValues(PrevViseme);
+		const float* NextPose = Poses.GetValues(NextViseme);
+		const float* Pose = Poses.GetValues(Viseme);
+		const float* PoseMask = Poses.GetMask(Viseme);
+
+		const VectorRegister4Float VWordPlaceMultiplier = VectorSetFloat1(WordPlaceMultiplier);
+		const VectorRegister4Float VApplyAlpha = VectorSetFloat1(MetaFaceSettings.VisemeApplyAlpha);
+		const VectorRegister4Float VLerpAlpha = VectorSetFloat1(LerpAlpha);
+		const VectorRegister4Float VFadeOut = VectorSetFloat1(FadeOutMultiplier);
+		const VectorRegister4Float VTwo = VectorSetFloat1(2.f);
+		const VectorRegister4Float VThree = VectorSetFloat1(3.f);
+		for (int32 i = 0; i < Poses.Stride; i += 4)
 		{
-			const FName& CurveName = Curve.Key;
+			VectorRegister4Float Value = VectorMultiply(VectorLoadAligned(RawValues + i), VWordPlaceMultiplier);
 
-			// add fade in-out
-			if (bNewWordStarted)
+			if (bSmoothPrev && bSmoothNext)
 			{
-				if (PreviousPhonemeTime == 0.f)
-				{
-					OutAnimationCurves[CurveName].Values.Add(FSimpleFloatValue(0.f, 0.f, 1));
-				}
-				else
-				{
-					OutAnimationCurves[CurveName].Values.Add(FSimpleFloatValue(TimeFadeIn, 0.f));
-					OutAnimationCurves[CurveName].Values.Add(FSimpleFloatValue(TimeFadeOut, 0.f));
-				}
+				Value = VectorDivide(VectorAdd(VectorAdd(VectorLoadAligned(PrevPose + i), Value), VectorLoadAligned(NextPose + i)), VThree);
 			}
-
-			float WordPlaceMultiplier = 1.f;
-			if (Phoneme.bWordStart)
+			else if (bSmoothPrev)
 			{
-				WordPlaceMultiplier = 0.5f;
+				Value = VectorDivide(VectorAdd(VectorLoadAligned(PrevPose + i), Value), VTwo);
 			}
-			else if (Index + 1 < PhonemesSource->PhonemesData.Num() && PhonemesSource->PhonemesData[Index + 1].bWordStart)
+			else if (bSmoothNext)
 			{
-				WordPlaceMultiplier = 0.5f;
+				Value = VectorDivide(VectorAdd(Value, VectorLoadAligned(NextPose + i)), VTwo);
 			}
 
-			// get NN value
-			if (!InData[CurveName].IsValidIndex(Index))
+			if (bApplyViseme)
 			{
-				continue;
+				// Lerp(Pose * VisemeApplyAlpha, Value, LerpAlpha) for curves of pose
+				const VectorRegister4Float ApplyValue = VectorMultiply(VectorLoadAligned(Pose + i), VApplyAlpha);
+				const VectorRegister4Float VisemeValue = bReplaceByViseme
+					? ApplyValue
+					: VectorAdd(ApplyValue, VectorMultiply(VLerpAlpha, VectorSubtract(Value, ApplyValue)));
+				Value = VectorSelect(VectorCompareGT(VectorLoadAligned(PoseMask + i), VectorZero()), VisemeValue, Value);
 			}
 
-			float val = InData[CurveName][Index];
-			val *= WordPlaceMultiplier;
-
-			// manual smooth
-			const EYnnkViseme PrevViseme = (Index > 0)
-				? YnnkHelpers::SymbolToViseme(PhonemesSource->PhonemesData[Index - 1].Symbol[0])
-				: EYnnkViseme::YV_Max;
-			const EYnnkViseme NextViseme = (Index + 1 < PhonemesSource->PhonemesData.Num())
-				? YnnkHelpers::SymbolToViseme(PhonemesSource->PhonemesData[Index + 1].Symbol[0])
-				: EYnnkViseme::YV_Max;
-			if ((PrevViseme == EYnnkViseme::YV_BMP || PrevViseme == EYnnkViseme::YV_FV || PrevViseme == EYnnkViseme::YV_Oh || PrevViseme == EYnnkViseme::YV_WU)
-				&& (NextViseme == EYnnkViseme::YV_BMP || NextViseme == EYnnkViseme::YV_FV || NextViseme == EYnnkViseme::YV_Oh || NextViseme == EYnnkViseme::YV_WU)
-				&& Settings->LipsyncVisemesPreset.Contains(PrevViseme) && Settings->LipsyncVisemesPreset.Contains(NextViseme))
-			{
-				const float AlphaPrev = Settings->LipsyncVisemesPreset[PrevViseme].Curves[CurveName];
-				const float AlphaNext = Settings->LipsyncVisemesPreset[NextViseme].Curves[CurveName];
-
-				val = (AlphaPrev + val + AlphaNext) / 3.f;
-			}
-			else if ((PrevViseme == EYnnkViseme::YV_BMP || PrevViseme == EYnnkViseme::YV_FV || PrevViseme == EYnnkViseme::YV_Oh || PrevViseme == EYnnkViseme::YV_WU) && Settings->LipsyncVisemesPreset.Contains(PrevViseme))
+			if (bFadeOut)
 			{
-				const float AlphaPrev = Settings->LipsyncVisemesPreset[PrevViseme].Curves[CurveName];
-				val = (AlphaPrev + val) / 2.f;
-			}
-			else if ((NextViseme == EYnnkViseme::YV_BMP || NextViseme == EYnnkViseme::YV_FV || NextViseme == EYnnkViseme::YV_Oh || NextViseme == EYnnkViseme::YV_WU) && Settings->LipsyncVisemesPreset.Contains(NextViseme))
-			{
-				const float AlphaNext = Settings->LipsyncVisemesPreset[NextViseme].Curves[CurveName];
-				val = (val + AlphaNext) / 2.f;
+				Value = VectorMultiply(Value, VFadeOut);
 			}
+			VectorStoreAligned(Value, OutRow + i);
+		}
+
+		// closed visemes keep their keys while smoothing
+		const bool bRichViseme = bApplyViseme && (Viseme == EYnnkViseme::YV_BMP || Viseme == EYnnkViseme::YV_WU);
+		for (int32 Curve = 0; Curve < CurvesNum; Curve++)
+		{
+			OutFlags[Curve] = (bRichViseme && PoseMask[Curve] > 0.f) ? 1 : 0;
+		}
+	}
+
+	/** Intensity of facial animation curve */
+	static float GetFacialAnimationScale(int32 CurveId)
+	{
+		if (EnumHasAnyFlags(FMetaFaceCurveRegistry::Get().GetFlags(CurveId), EMetaFaceCurveFlags::Brow))
+		{
+			return 0.6f;
+		}
+		else if (CurveId == (int32)EMetaFaceCurve::EyeSquintLeft || CurveId == (int32)EMetaFaceCurve::EyeSquintRight)
+		{
+			return 0.75f;
+		}
+		return 1.f;
+	}
+
+	/** Facial animation value of curve at phoneme */
+	static float GetFacialAnimationValue(float CurveScale, float RawValue, float PlayTime, float PhonemeTime)
+	{
+		float val = RawValue * CurveScale;
+
+		// fade out
+		if (PlayTime - PhonemeTime < 0.25f)
+		{
+			float mul = (PlayTime - PhonemeTime) / 0.25f;
+			val *= mul;
+		}
+
+		return val;
+	}
+
+	/** Curves of raw data in the order of clip */
+	static void GetRawCurves(const RawAnimDataMap& InData, TArray<FName>& OutCurveNames, TArray<const TArray<float>*>& OutRawCurves)
+	{
+		OutCurveNames.Reset(InData.Num());
+		OutRawCurves.Reset(InData.Num());
+		for (const auto& Curve : InData)
+		{
+			OutCurveNames.Add(Curve.Key);
+			OutRawCurves.Add(&Curve.Value);
+		}
+	}
+}
+
+void UMFFunctionLibrary::RawDataToLipsync(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, FMetaFaceClip& OutClip, const FMetaFaceGenerationSettings& MetaFaceSettings)
+{
+	RawDataToLipsync(PhonemesSource->PhonemesData, InData, OutClip, MetaFaceSettings);
+}
+
+void UMFFunctionLibrary::RawDataToLipsync(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves, const FMetaFaceGenerationSettings& MetaFaceSettings)
+{
+	RawDataToLipsync(PhonemesSource->PhonemesData, InData, OutAnimationCurves, MetaFaceSettings);
+}
+
+void UMFFunctionLibrary::RawDataToLipsync(const TArray<FPhonemeTextData>& Phonemes, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves, const FMetaFaceGenerationSettings& MetaFaceSettings)
+{
+	FMetaFaceClip Clip;
+	RawDataToLipsync(Phonemes, InData, Clip, MetaFaceSettings);
+	Clip.ToCurves(OutAnimationCurves);
+}
+
+void UMFFunctionLibrary::RawDataToLipsync(const TArray<FPhonemeTextData>& Phonemes, const RawAnimDataMap& InData, FMetaFaceClip& OutClip, const FMetaFaceGenerationSettings& MetaFaceSettings)
+{
+	const int32 PhonemesNum = Phonemes.Num();
+	float PlayTime = Phonemes.Last().Time + 0.05f;
+	float PreviousPhonemeTime = 0.f;
+
+	// Due to complifications with CC4 characters it's better not to convert lip-sync here and do it later in YnnkMetaFaceController
+	// (to keep original curves controlling bones)
+	float LipsyncSmoothness = MetaFaceSettings.LipsyncSmoothness;
+
+	// initialize out data: phoneme key, up to two fade keys per phoneme and the last key
+	TArray<FName> CurveNames;
+	TArray<const TArray<float>*> RawCurves;
+	MetaFaceGeneration::GetRawCurves(InData, CurveNames, RawCurves);
+	const int32 CurvesNum = CurveNames.Num();
+	const int32 Stride = Align(CurvesNum, 4);
+	OutClip.Reset(CurveNames, PhonemesNum * 3 + 1);
+
+	// Flags of all values (used for smoothing only)
+	TArray<uint8> Flags;
+	Flags.Reserve((PhonemesNum * 3 + 1) * CurvesNum);
+
+	// Visemes of phonemes and poses for curves of clip
+	TArray<EYnnkViseme> Visemes;
+	Visemes.SetNumUninitialized(PhonemesNum);
+	for (int32 Index = 0; Index < PhonemesNum; ++Index)
+	{
+		Visemes[Index] = YnnkHelpers::SymbolToViseme(Phonemes[Index].Symbol[0]);
+	}
+	const MetaFaceGeneration::FLipsyncPoses Poses(OutClip.GetCurveIds(), Stride);
+	FMetaFaceClip::FValuesArray RawValues;
+	RawValues.SetNumZeroed(Stride);
+
+	// fill out data
+	for (int32 Index = 0; Index < PhonemesNum; ++Index)
+	{
+		const auto& Phoneme = Phonemes[Index];
 
-			int32 Flag = 0;
-			if (const FMetaFacePose* Src = Settings->LipsyncVisemesPreset.Find(v))
+		// add fade in-out
+		float TimeFadeIn, TimeFadeOut;
+		const int32 FadeKeysNum = MetaFaceGeneration::GetLipsyncFadeKeys(Phoneme, PreviousPhonemeTime, TimeFadeIn, TimeFadeOut);
+		if (FadeKeysNum == 1)
+		{
+			OutClip.AddKey(0.f);
+			Flags.AddUninitialized(CurvesNum);
+			FMemory::Memset(Flags.GetData() + Flags.Num() - CurvesNum, 1, CurvesNum);
+		}
+		else if (FadeKeysNum == 2)
+		{
+			OutClip.AddKey(TimeFadeIn);
+			OutClip.AddKey(TimeFadeOut);
+			Flags.AddZeroed(CurvesNum * 2);
+		}
+
+		// NN values of phoneme
+		bool bAllCurvesValid = true;
+		for (int32 Curve = 0; Curve < CurvesNum; Curve++)
+		{
+			const TArray<float>& RawCurve = *RawCurves[Curve];
+			const bool bValid = RawCurve.IsValidIndex(Index);
+			RawValues[Curve] = bValid ? RawCurve[Index] : 0.f;
+			bAllCurvesValid &= bValid;
+		}
+
+		float* Row = OutClip.AddKey(Phoneme.Time);
+		const float* PreviousRow = OutClip.GetKeysNum() > 1 ? Row - Stride : nullptr;
+		const int32 RowFlagsIndex = Flags.AddUninitialized(CurvesNum);
+		uint8* RowFlags = Flags.GetData() + RowFlagsIndex;
+		MetaFaceGeneration::MakeLipsyncRow(Poses, Phoneme, Index + 1 < PhonemesNum && Phonemes[Index + 1].bWordStart,
+			Index > 0 ? Visemes[Index - 1] : EYnnkViseme::YV_Max, Visemes[Index], Index + 1 < PhonemesNum ? Visemes[Index + 1] : EYnnkViseme::YV_Max,
+			PlayTime, MetaFaceSettings, RawValues.GetData(), Row, RowFlags, CurvesNum);
+
+		if (!bAllCurvesValid)
+		{
+			for (int32 Curve = 0; Curve < CurvesNum; Curve++)
 			{
-				if (const float* VisemeValue = Src->Curves.Find(CurveName))
+				if (!RawCurves[Curve]->IsValidIndex(Index))
 				{
-					float ApplyVisemeValue = *VisemeValue * VisemeApplyAlpha;
-					switch (v)
-					{
-					case EYnnkViseme::YV_BMP:
-						val = ApplyVisemeValue; Flag = 1; break;
-					case EYnnkViseme::YV_WU:
-						Flag = 1;
-						//case EYnnkViseme::YV_FV:
-					case EYnnkViseme::YV_Oh:
-						val = FMath::Lerp(ApplyVisemeValue, val, LipsyncNeuralIntensity * 0.4f); break;
-					default:
-						val = FMath::Lerp(ApplyVisemeValue, val, LipsyncNeuralIntensity); break;
-					}
+					// no NN value: keep previous one
+					Row[Curve] = MetaFaceGeneration::KeepPreviousValue(PreviousRow ? PreviousRow + Curve : nullptr);
+					RowFlags[Curve] = 0;
 				}
 			}
-
-			// fade out
-			if (PlayTime - Phoneme.Time < 0.25f)
-			{
-				float mul = (PlayTime - Phoneme.Time) / 0.25f;
-				val *= mul;
-			}
-
-			// save
-			OutAnimationCurves[CurveName].Values.Add(FSimpleFloatValue(Phoneme.Time, val, Flag));
 		}
 
 		PreviousPhonemeTime = Phoneme.Time;
@@ -500,44 +625,93 @@ void UMFFunctionLibrary::RawDataToLipsync(const UYnnkVoiceLipsyncData* PhonemesS
 
 	// reset all curves at the end
 	PreviousPhonemeTime += 0.2f;
-	for (auto& Curve : OutAnimationCurves)
-	{
-		Curve.Value.Values.Add(FSimpleFloatValue(PreviousPhonemeTime, 0.f, 1));
-	}
+	OutClip.AddKey(PreviousPhonemeTime);
+	Flags.AddUninitialized(CurvesNum);
+	FMemory::Memset(Flags.GetData() + Flags.Num() - CurvesNum, 1, CurvesNum);
 
 	// apply smoothness
 	if (LipsyncSmoothness > 0.f)
 	{
-		// minimal smooth
-		for (auto& Curve : OutAnimationCurves)
+		// minimal smooth, keys with CURVEFLAG_RICH are almost kept
+		FMetaFaceSmoothing Smoothing(OutClip, LipsyncSmoothness);
+		Smoothing.SetRichKeysScale(0.15f);
+		Smoothing.ApplyFIR(OutClip, 2, 1, false, Flags.GetData());
+	}
+}
+
+void UMFFunctionLibrary::MakeLipsyncKeys(const TArray<FPhonemeTextData>& Phonemes, int32 Index, float PlayTime, float& InOutPreviousPhonemeTime,
+	const RawAnimDataMap& InData, const FMetaFaceGenerationSettings& MetaFaceSettings, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves)
+{
+	const auto& Phoneme = Phonemes[Index];
+
+	float TimeFadeIn, TimeFadeOut;
+	const int32 FadeKeysNum = MetaFaceGeneration::GetLipsyncFadeKeys(Phoneme, InOutPreviousPhonemeTime, TimeFadeIn, TimeFadeOut);
+
+	// values of all curves for the phoneme
+	FMetaFaceCurveRegistry& Registry = FMetaFaceCurveRegistry::Get();
+	const int32 CurvesNum = InData.Num();
+	const int32 Stride = Align(CurvesNum, 4);
+	TArray<int32> CurveIds;
+	CurveIds.Reserve(CurvesNum);
+	FMetaFaceClip::FValuesArray RawValues, Row;
+	RawValues.SetNumZeroed(Stride);
+	Row.SetNumZeroed(Stride);
+	for (const auto& Curve : InData)
+	{
+		RawValues[CurveIds.Num()] = Curve.Value.IsValidIndex(Index) ? Curve.Value[Index] : 0.f;
+		CurveIds.Add(Registry.FindOrAdd(Curve.Key));
+	}
+	TArray<uint8, TInlineAllocator<64>> RowFlags;
+	RowFlags.SetNumUninitialized(CurvesNum);
+
+	const MetaFaceGeneration::FLipsyncPoses Poses(CurveIds, Stride);
+	MetaFaceGeneration::MakeLipsyncRow(Poses, Phoneme, Index + 1 < Phonemes.Num() && Phonemes[Index + 1].bWordStart,
+		Index > 0 ? YnnkHelpers::SymbolToViseme(Phonemes[Index - 1].Symbol[0]) : EYnnkViseme::YV_Max,
+		YnnkHelpers::SymbolToViseme(Phoneme.Symbol[0]),
+		Index + 1 < Phonemes.Num() ? YnnkHelpers::SymbolToViseme(Phonemes[Index + 1].Symbol[0]) : EYnnkViseme::YV_Max,
+		PlayTime, MetaFaceSettings, RawValues.GetData(), Row.GetData(), RowFlags.GetData(), CurvesNum);
+
+	int32 CurveIndex = 0;
+	for (const auto& Curve : InData)
+	{
+		const int32 Column = CurveIndex++;
+		FSimpleFloatCurve& OutCurve = OutAnimationCurves[Curve.Key];
+
+		// add fade in-out
+		if (FadeKeysNum == 1)
 		{
-			auto& Points = Curve.Value.Values;
-			int32 Num = Points.Num();
-			for (int32 n = 0; n < 2; n++)
-			{
-				for (int32 i = 2; i < Num - 2; i++)
-				{
-					float NewVal = (Points[i - 1].Value + Points[i].Value + Points[i + 1].Value) / 3.f;
-					if (Points[i].Flag & CURVEFLAG_RICH)
-					{
-						Points[i].Value = FMath::Lerp(Points[i].Value, NewVal, LipsyncSmoothness * 0.15f);
-					}
-					else
-					{
-						Points[i].Value = FMath::Lerp(Points[i].Value, NewVal, LipsyncSmoothness);
-					}
-				}
-			}
+			OutCurve.Values.Add(FSimpleFloatValue(0.f, 0.f, 1));
 		}
+		else if (FadeKeysNum == 2)
+		{
+			OutCurve.Values.Add(FSimpleFloatValue(TimeFadeIn, 0.f));
+			OutCurve.Values.Add(FSimpleFloatValue(TimeFadeOut, 0.f));
+		}
+
+		// no NN value: keep previous one
+		if (!Curve.Value.IsValidIndex(Index))
+		{
+			const float* PreviousValue = OutCurve.Values.Num() > 0 ? &OutCurve.Values.Last().Value : nullptr;
+			OutCurve.Values.Add(FSimpleFloatValue(Phoneme.Time, MetaFaceGeneration::KeepPreviousValue(PreviousValue), 0));
+			continue;
+		}
+
+		// save
+		OutCurve.Values.Add(FSimpleFloatValue(Phoneme.Time, Row[Column], RowFlags[Column]));
 	}
 
-	// convert to skeleton curves
-	if (bConvertLipSync && IsValid(ArKitCurvesPoseAsset))
+	InOutPreviousPhonemeTime = Phoneme.Time;
+}
+
+void UMFFunctionLibrary::RawDataToFacialAnimation(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, FMetaFaceClip& OutClip,
+	const FMetaFaceGenerationSettings& MetaFaceSettings)
+{
+	if (!IsValid(PhonemesSource))
 	{
-		TMap<FName, FSimpleFloatCurve> SwapData;
-		UYnnkLipSyncFunctionLibrary::ExpandPoseAnimationToCurves(OutAnimationCurves, ArKitCurvesPoseAsset, SwapData);
-		OutAnimationCurves = SwapData;
+		return;
 	}
+
+	RawDataToFacialAnimation(PhonemesSource->PhonemesData, InData, OutClip, MetaFaceSettings);
 }
 
 void UMFFunctionLibrary::RawDataToFacialAnimation(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves,
@@ -548,184 +722,250 @@ void UMFFunctionLibrary::RawDataToFacialAnimation(const UYnnkVoiceLipsyncData* P
 		return;
 	}
 
-	const int32 PhonemesNum = PhonemesSource->PhonemesData.Num();
-	float PlayTime = PhonemesSource->PhonemesData.Last().Time + 0.05f;
+	RawDataToFacialAnimation(PhonemesSource->PhonemesData, InData, OutAnimationCurves, MetaFaceSettings);
+}
+
+void UMFFunctionLibrary::RawDataToFacialAnimation(const TArray<FPhonemeTextData>& Phonemes, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves,
+	const FMetaFaceGenerationSettings& MetaFaceSettings)
+{
+	FMetaFaceClip Clip;
+	RawDataToFacialAnimation(Phonemes, InData, Clip, MetaFaceSettings);
+	Clip.ToCurves(OutAnimationCurves);
+}
+
+void UMFFunctionLibrary::RawDataToFacialAnimation(const TArray<FPhonemeTextData>& Phonemes, const RawAnimDataMap& InData, FMetaFaceClip& OutClip,
+	const FMetaFaceGenerationSettings& MetaFaceSettings)
+{
+	const int32 PhonemesNum = Phonemes.Num();
+	float PlayTime = Phonemes.Last().Time + 0.05f;
 	float PreviousPhonemeTime = 0.f;
 
-	auto Settings = GetDefault<UYnnkMetaFaceSettings>();
 	float FacialAnimationSmoothness = MetaFaceSettings.FacialAnimationSmoothness;
 	bool bFacialAnimationToSkeletonCurves = MetaFaceSettings.bFacialAnimationToSkeletonCurves;
 
-	bool bMirrorRightBlink = false;
-	if (InData.Contains(TEXT("EyeBlinkLeft")) && !InData.Contains(TEXT("EyeBlinkRight")))
+	// initialize out data: a key per phoneme and the last key
+	TArray<FName> CurveNames;
+	TArray<const TArray<float>*> RawCurves;
+	MetaFaceGeneration::GetRawCurves(InData, CurveNames, RawCurves);
+	const int32 RawCurvesNum = CurveNames.Num();
+	int32 BlinkLeft = INDEX_NONE, BlinkRight = INDEX_NONE;
+	if (NeedsMirroredRightBlink(InData))
 	{
-		bMirrorRightBlink = true;
+		BlinkLeft = CurveNames.IndexOfByKey(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::EyeBlinkLeft));
+		BlinkRight = CurveNames.Add(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::EyeBlinkRight));
 	}
+	const int32 CurvesNum = CurveNames.Num();
+	const int32 Stride = Align(CurvesNum, 4);
+	OutClip.Reset(CurveNames, PhonemesNum + 1);
 
-	// initialize out data
-	OutAnimationCurves.Empty();
-	for (const auto& Curve : InData)
+	TArray<float> CurveScales;
+	CurveScales.SetNumUninitialized(CurvesNum);
+	for (int32 Curve = 0; Curve < CurvesNum; Curve++)
 	{
-		OutAnimationCurves.Add(Curve.Key);
-	}
-	if (bMirrorRightBlink)
-	{
-		OutAnimationCurves.Add(TEXT("EyeBlinkRight"));
+		CurveScales[Curve] = MetaFaceGeneration::GetFacialAnimationScale(OutClip.GetCurveIds()[Curve]);
 	}
 
 	// fill out data
 	for (int32 Index = 0; Index < PhonemesNum; ++Index)
 	{
-		const auto& Phoneme = PhonemesSource->PhonemesData[Index];
-		EYnnkViseme v = PhonemesSource->SymbolToViseme(Phoneme.Symbol[0]);
-
-		for (const auto& Curve : InData)
+		const auto& Phoneme = Phonemes[Index];
+		float* Row = OutClip.AddKey(Phoneme.Time);
+		const float* PreviousRow = Index > 0 ? Row - Stride : nullptr;
+		for (int32 Curve = 0; Curve < RawCurvesNum; Curve++)
 		{
-			const FName& CurveName = Curve.Key;
-
-			// get NN value
-			if (!InData[CurveName].IsValidIndex(Index))
-			{
-				continue;
-			}
-			float val = InData[CurveName][Index];
-
-			if (CurveName.ToString().Left(4) == TEXT("Brow"))
-			{
-				val *= 0.6f;
-			}
-			else if (CurveName.ToString().Left(9) == TEXT("EyeSquint"))
-			{
-				val *= 0.75f;
-			}
-
-			// fade out
-			if (PlayTime - Phoneme.Time < 0.25f)
+			if (RawCurves[Curve]->IsValidIndex(Index))
 			{
-				float mul = (PlayTime - Phoneme.Time) / 0.25f;
-				val *= mul;
+				Row[Curve] = MetaFaceGeneration::GetFacialAnimationValue(CurveScales[Curve], (*RawCurves[Curve])[Index], PlayTime, Phoneme.Time);
 			}
-
-			// save
-			OutAnimationCurves[CurveName].Values.Add(FSimpleFloatValue(Phoneme.Time, val));
-
-			FString szCurveName = CurveName.ToString();
-			if (bMirrorRightBlink && szCurveName == TEXT("EyeBlinkLeft"))
+			else
 			{
-				OutAnimationCurves[TEXT("EyeBlinkRight")].Values.Add(FSimpleFloatValue(Phoneme.Time, val));
+				// no NN value: keep previous one
+				Row[Curve] = MetaFaceGeneration::KeepPreviousValue(PreviousRow ? PreviousRow + Curve : nullptr);
 			}
 		}
-
+		if (BlinkRight != INDEX_NONE)
+		{
+			Row[BlinkRight] = Row[BlinkLeft];
+		}
 		PreviousPhonemeTime = Phoneme.Time;
 	}
 
 	// reset all curves at the end
 	PreviousPhonemeTime += 0.8f;
-	for (auto& Curve : OutAnimationCurves)
-	{
-		Curve.Value.Values.Add(FSimpleFloatValue(PreviousPhonemeTime, 0.f, 1));
-	}
+	OutClip.AddKey(PreviousPhonemeTime);
 
 	// @TODO: create eye blink animation
 
 	// apply smoothness
 	if (FacialAnimationSmoothness > 0.f)
 	{
-		// smooth
-		int SmoothIterations = 4;
+		// brows are smoothed by 3 keys, other curves by 5 keys; the first and the last keys are smoothed too
+		FMetaFaceSmoothing Smoothing(OutClip, FacialAnimationSmoothness);
+		Smoothing.SetNarrowCurves(EMetaFaceCurveFlags::Brow);
+		Smoothing.ApplyFIR(OutClip, 4, 2, true);
+	} // end apply smoothness
 
-		for (int32 cnt = 0; cnt < SmoothIterations; ++cnt)
-		{
-			for (auto& Curve : OutAnimationCurves)
-			{
-				bool bBrow = Curve.Key.ToString().Contains(TEXT("Brow"));
-				bool bHead = false;//  Curve.Key.ToString().Contains(TEXT("Head"));
+	// convert to skeleton curves
+	if (bFacialAnimationToSkeletonCurves && IsValid(MetaFaceSettings.ArKitCurvesPoseAsset))
+	{
+		ConvertFacialAnimCurves(OutClip, MetaFaceSettings.ArKitCurvesPoseAsset);
+	}
+}
 
-				if (cnt >= SmoothIterations && !bBrow)
-				{
-					continue;
-				}
+void UMFFunctionLibrary::BalanceSmileFrownCurves(FMetaFaceClip& InOutClip)
+{
+	const int32 FrownL = InOutClip.FindCurve(EMetaFaceCurve::MouthFrownLeft);
+	const int32 FrownR = InOutClip.FindCurve(EMetaFaceCurve::MouthFrownRight);
+	const int32 SmileL = InOutClip.FindCurve(EMetaFaceCurve::MouthSmileLeft);
+	const int32 SmileR = InOutClip.FindCurve(EMetaFaceCurve::MouthSmileRight);
 
-				auto& Points = Curve.Value.Values;
-				int32 Num = Points.Num();
-				for (int32 i = 2; i < Num - 2; i++)
-				{
-					float NewVal = 0.f;
-					if (bBrow || bHead)
-					{
-						NewVal = (Points[i - 1].Value + Points[i].Value + Points[i + 1].Value) / 3.f;
-					}
-					if (!bBrow)
-					{
-						NewVal = (Points[i - 2].Value + Points[i - 1].Value + Points[i].Value + Points[i + 1].Value + Points[i + 2].Value) * 0.2f;
-					}
-					Points[i].Value = FMath::Lerp(Points[i].Value, NewVal, FacialAnimationSmoothness);
-				}
-				if (Num > 1)
-				{
-					float NewVal = (Points[0].Value + Points[1].Value) * 0.5f;
-					Points[0].Value = FMath::Lerp(Points[0].Value, NewVal, FacialAnimationSmoothness);
-					if (Num > 2)
-					{
-						NewVal = (Points[Num - 2].Value + Points[Num - 1].Value) * 0.5f;
-						Points[Num - 1].Value = FMath::Lerp(Points[Num - 1].Value, NewVal, FacialAnimationSmoothness);
-					}
-				}
+	if (FrownL != INDEX_NONE && SmileL != INDEX_NONE && FrownR != INDEX_NONE && SmileR != INDEX_NONE)
+	{
+		for (int32 i = 0; i < InOutClip.GetKeysNum(); i++)
+		{
+			float* Row = InOutClip.GetKey(i);
+			if (Row[FrownL] < Row[SmileL])
+			{
+				Row[FrownL] = Row[SmileL] = (Row[FrownL] + Row[SmileL]) * 0.5f;
 			}
-		} // end for
-	} // end apply smoothness
+			if (Row[FrownR] < Row[SmileR])
+			{
+				Row[FrownR] = Row[SmileR] = (Row[FrownR] + Row[SmileR]) * 0.5f;
+			}
+		}
+	}
+}
 
-	// convert to skeleton curves
-	if (bFacialAnimationToSkeletonCurves && IsValid(MetaFaceSettings.ArKitCurvesPoseAsset))
+void UMFFunctionLibrary::MakeFacialAnimationKeys(const TArray<FPhonemeTextData>& Phonemes, int32 Index, float PlayTime, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves)
+{
+	const auto& Phoneme = Phonemes[Index];
+	const bool bMirrorRightBlink = NeedsMirroredRightBlink(InData);
+	FMetaFaceCurveRegistry& Registry = FMetaFaceCurveRegistry::Get();
+
+	for (const auto& Curve : InData)
 	{
-		ConvertFacialAnimCurves(OutAnimationCurves, MetaFaceSettings.ArKitCurvesPoseAsset);
+		const FName& CurveName = Curve.Key;
+
+		// get NN value
+		TArray<FSimpleFloatValue>& OutValues = OutAnimationCurves[CurveName].Values;
+		float val;
+		if (Curve.Value.IsValidIndex(Index))
+		{
+			const float CurveScale = MetaFaceGeneration::GetFacialAnimationScale(Registry.FindOrAdd(CurveName));
+			val = MetaFaceGeneration::GetFacialAnimationValue(CurveScale, Curve.Value[Index], PlayTime, Phoneme.Time);
+		}
+		else
+		{
+			// no NN value: keep previous one
+			val = MetaFaceGeneration::KeepPreviousValue(OutValues.Num() > 0 ? &OutValues.Last().Value : nullptr);
+		}
+
+		// save
+		OutValues.Add(FSimpleFloatValue(Phoneme.Time, val));
+
+		if (bMirrorRightBlink && CurveName == FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::EyeBlinkLeft))
+		{
+			OutAnimationCurves[FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::EyeBlinkRight)].Values.Add(FSimpleFloatValue(Phoneme.Time, val));
+		}
 	}
 }
 
-void UMFFunctionLibrary::ConvertFacialAnimCurves(TMap<FName, FSimpleFloatCurve>& InOutAnimationCurves, UPoseAsset* CurvesPoseAsset, FString Filter)
+bool UMFFunctionLibrary::NeedsMirroredRightBlink(const RawAnimDataMap& InData)
 {
-	const FName Head_Roll = TEXT("HeadRoll");
-	const FName Head_Pitch = TEXT("HeadPitch");
-	const FName Head_Yaw = TEXT("HeadYaw");
-
-	TMap<FName, FSimpleFloatCurve> HeadData;
-	HeadData.Add(Head_Roll);
-	HeadData.Add(Head_Pitch);
-	HeadData.Add(Head_Yaw);
-	InOutAnimationCurves.RemoveAndCopyValue(Head_Roll, HeadData[Head_Roll]);
-	InOutAnimationCurves.RemoveAndCopyValue(Head_Pitch, HeadData[Head_Pitch]);
-	InOutAnimationCurves.RemoveAndCopyValue(Head_Yaw, HeadData[Head_Yaw]);
-
-	TMap<FName, FSimpleFloatCurve> SwapData;
-	UYnnkLipSyncFunctionLibrary::ExpandPoseAnimationToCurves(InOutAnimationCurves, CurvesPoseAsset, SwapData, Filter);
-	InOutAnimationCurves = SwapData;
-
-	InOutAnimationCurves.Append(HeadData);
+	return InData.Contains(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::EyeBlinkLeft)) && !InData.Contains(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::EyeBlinkRight));
 }
 
-void UMFFunctionLibrary::GetMetaFaceCurvesSet(TArray<FName>& CurvesSet, bool bLipSyncCurves)
+void UMFFunctionLibrary::ConvertFacialAnimCurves(FMetaFaceClip& InOutClip, UPoseAsset* CurvesPoseAsset, FString Filter)
 {
-	if (bLipSyncCurves)
+	if (!IsValid(CurvesPoseAsset))
 	{
-		CurvesSet =
+		return;
+	}
+
+	struct FCurveWeight
+	{
+		int32 Source;
+		int32 Target;
+		float Weight;
+	};
+
+	// Head rotation isn't converted
+	const EMetaFaceCurve HeadCurves[] = { EMetaFaceCurve::HeadRoll, EMetaFaceCurve::HeadPitch, EMetaFaceCurve::HeadYaw };
+
+	// Every source curve is a pose, which sets skeleton curves with some weights
+	const TArray<FName>& SourceCurves = InOutClip.GetCurveNames();
+	const TArray<FName> PoseCurves = CurvesPoseAsset->GetCurveFNames();
+	TArray<int32> PoseCurveTargets;
+	PoseCurveTargets.Init(INDEX_NONE, PoseCurves.Num());
+
+	TArray<FName> TargetCurves;
+	TArray<FCurveWeight> Weights;
+	TArray<float> PoseCurveValues;
+	for (int32 Source = 0; Source < SourceCurves.Num(); Source++)
+	{
+		const int32 PoseIndex = CurvesPoseAsset->GetPoseIndexByName(SourceCurves[Source]);
+		if (PoseIndex == INDEX_NONE || !CurvesPoseAsset->GetCurveValues(PoseIndex, PoseCurveValues))
+		{
+			continue;
+		}
+
+		for (int32 PoseCurve = 0; PoseCurve < PoseCurveValues.Num() && PoseCurve < PoseCurves.Num(); PoseCurve++)
+		{
+			if (PoseCurveValues[PoseCurve] == 0.f)
+			{
+				continue;
+			}
+			if (PoseCurveTargets[PoseCurve] == INDEX_NONE)
+			{
+				const bool bPassFilter = Filter.IsEmpty() || PoseCurves[PoseCurve].ToString().StartsWith(Filter);
+				PoseCurveTargets[PoseCurve] = bPassFilter ? TargetCurves.Add(PoseCurves[PoseCurve]) : -2;
+			}
+			if (PoseCurveTargets[PoseCurve] >= 0)
+			{
+				Weights.Add({ Source, PoseCurveTargets[PoseCurve], PoseCurveValues[PoseCurve] });
+			}
+		}
+	}
+
+	TArray<TPair<int32, int32>> KeptCurves;
+	for (const EMetaFaceCurve HeadCurve : HeadCurves)
+	{
+		const int32 Source = InOutClip.FindCurve(HeadCurve);
+		if (Source != INDEX_NONE)
 		{
-			TEXT("JawOpen"), TEXT("MouthClose"), TEXT("MouthFunnel"), TEXT("MouthPucker"), TEXT("MouthLeft"), TEXT("MouthRight"),
-			TEXT("MouthSmileLeft"), TEXT("MouthSmileRight"), TEXT("MouthFrownLeft"), TEXT("MouthFrownRight"), TEXT("MouthDimpleLeft"),
-			TEXT("MouthDimpleRight"), TEXT("MouthStretchLeft"), TEXT("MouthStretchRight"), TEXT("MouthRollLower"), TEXT("MouthRollUpper"),
-			TEXT("MouthShrugLower"), TEXT("MouthShrugUpper"), TEXT("MouthPressLeft"), TEXT("MouthPressRight"), TEXT("MouthLowerDownLeft"),
-			TEXT("MouthLowerDownRight"), TEXT("MouthUpperUpLeft"), TEXT("MouthUpperUpRight")
-		}; // 24
+			KeptCurves.Add(TPair<int32, int32>(Source, TargetCurves.AddUnique(FMetaFaceCurveRegistry::GetName(HeadCurve))));
+		}
 	}
-	else /* facial animation curves set */
+
+	const int32 KeysNum = InOutClip.GetKeysNum();
+	FMetaFaceClip Converted(TargetCurves, KeysNum);
+	for (int32 Key = 0; Key < KeysNum; Key++)
 	{
-		CurvesSet =
+		const float* SourceRow = InOutClip.GetKey(Key);
+		float* TargetRow = Converted.AddKey(InOutClip.GetTime(Key));
+		for (const FCurveWeight& CurveWeight : Weights)
 		{
-			TEXT("BrowDownLeft"), TEXT("BrowDownRight"), TEXT("BrowInnerUp"), TEXT("BrowOuterUpLeft"), TEXT("BrowOuterUpRight"),
-			TEXT("CheekPuff"), TEXT("CheekSquintLeft"), TEXT("CheekSquintRight"), TEXT("NoseSneerLeft"), TEXT("NoseSneerRight"),
-			TEXT("HeadYaw"), TEXT("HeadPitch"), TEXT("HeadRoll"), TEXT("EyeBlinkLeft"), TEXT("EyeSquintLeft"), TEXT("EyeWideLeft"),
-			TEXT("EyeSquintRight"), TEXT("EyeWideRight"), TEXT("MouthSmileLeft"), TEXT("MouthSmileRight")
-		}; // 20
+			TargetRow[CurveWeight.Target] += SourceRow[CurveWeight.Source] * CurveWeight.Weight;
+		}
+		for (const auto& KeptCurve : KeptCurves)
+		{
+			TargetRow[KeptCurve.Value] = SourceRow[KeptCurve.Key];
+		}
 	}
+
+	InOutClip = MoveTemp(Converted);
+}
+
+void UMFFunctionLibrary::ConvertFacialAnimCurves(TMap<FName, FSimpleFloatCurve>& InOutAnimationCurves, UPoseAsset* CurvesPoseAsset, FString Filter)
+{
+	FMetaFaceClip Clip(InOutAnimationCurves);
+	ConvertFacialAnimCurves(Clip, CurvesPoseAsset, Filter);
+	Clip.ToCurves(InOutAnimationCurves);
+}
+
+void UMFFunctionLibrary::GetMetaFaceCurvesSet(TArray<FName>& CurvesSet, bool bLipSyncCurves)
+{
+	CurvesSet = FMetaFaceCurveRegistry::GetCurveSet(bLipSyncCurves);
 }
 
 #undef __is_anim_converted
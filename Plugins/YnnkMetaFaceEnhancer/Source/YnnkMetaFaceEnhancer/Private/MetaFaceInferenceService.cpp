@@ -0,0 +1,380 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceInferenceService.h"
+#include "NeuralProcessWrapper.h"
+#include "YnnkMetaFaceSettings.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/ScopeExit.h"
+
+FMetaFaceInferenceService::FPendingRequest::FPendingRequest()
+	: RequestDone(FPlatformProcess::GetSynchEventFromPool(true))
+{
+}
+
+FMetaFaceInferenceService::FPendingRequest::~FPendingRequest()
+{
+	FPlatformProcess::ReturnSynchEventToPool(RequestDone);
+}
+
+void FMetaFaceInferenceService::FPendingRequest::Complete(bool bInSuccess)
+{
+	bSuccess = bInSuccess;
+	RequestDone->Trigger();
+}
+
+FMetaFaceInferenceService::FMetaFaceInferenceService(UNeuralProcessWrapper* InProcessor)
+	: Processor(InProcessor)
+	, bWaitingForModels(false)
+	, bStopping(false)
+{
+	for (auto& Queue : Queues)
+	{
+		Queue.BatchFullEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	}
+	ModelsReadyEvent = FPlatformProcess::GetSynchEventFromPool(true);
+	ModelsReadyEvent->Trigger();
+}
+
+FMetaFaceInferenceService::~FMetaFaceInferenceService()
+{
+	Shutdown();
+
+	for (auto& Queue : Queues)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(Queue.BatchFullEvent);
+	}
+	FPlatformProcess::ReturnSynchEventToPool(ModelsReadyEvent);
+}
+
+void FMetaFaceInferenceService::SetProcessor(UNeuralProcessWrapper* InProcessor)
+{
+	FScopeLock Lock(&QueueLock);
+	Processor = InProcessor;
+}
+
+void FMetaFaceInferenceService::SetWaitingForModels(bool bWaiting)
+{
+	TArray<FDeferredRequest> Requests;
+	{
+		FScopeLock Lock(&QueueLock);
+		bWaitingForModels = bWaiting && !bStopping;
+		if (bWaitingForModels)
+		{
+			ModelsReadyEvent->Reset();
+		}
+		else
+		{
+			ModelsReadyEvent->Trigger();
+			Requests = MoveTemp(DeferredRequests);
+			DeferredRequests.Reset();
+		}
+	}
+
+	for (auto& Request : Requests)
+	{
+		Submit(Request.PhonemesData, Request.bUseLipsyncModel, MoveTemp(Request.Callback), Request.CancellationToken);
+	}
+}
+
+bool FMetaFaceInferenceService::ShouldBatch(const UNeuralProcessWrapper* InProcessor, bool bUseLipsyncModel)
+{
+	const bool bModelReady = bUseLipsyncModel ? InProcessor->IsLipsyncModelReady() : InProcessor->IsEmotionsModelReady();
+
+	// Concatenated sequences give the same output as separate requests only for lookup tables and models verified at load time
+	if (!bModelReady)
+	{
+		return false;
+	}
+	return InProcessor->IsUsingCompiledModel(bUseLipsyncModel)
+		|| (InProcessor->IsSequenceInputEnabled(bUseLipsyncModel) && GetDefault<UYnnkMetaFaceSettings>()->BatchingWindowMs > 0.f);
+}
+
+void FMetaFaceInferenceService::Submit(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, FMetaFaceInferenceCallback&& Callback, const FMetaFaceCancellationTokenPtr& CancellationToken)
+{
+	if (IsRequestCancelled(CancellationToken.Get()))
+	{
+		Callback(false, RawAnimDataMap());
+		return;
+	}
+
+	{
+		FScopeLock Lock(&QueueLock);
+		if (bWaitingForModels)
+		{
+			DeferredRequests.Add({ PhonemesData, bUseLipsyncModel, MoveTemp(Callback), CancellationToken });
+			return;
+		}
+	}
+
+	RawAnimDataMap Data;
+	const bool bResult = ProcessPhonemes(PhonemesData, bUseLipsyncModel, Data, CancellationToken);
+	Callback(bResult, MoveTemp(Data));
+}
+
+bool FMetaFaceInferenceService::ProcessPhonemes(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, RawAnimDataMap& OutData, const FMetaFaceCancellationTokenPtr& CancellationToken)
+{
+	ActiveCallers.Increment();
+	ON_SCOPE_EXIT
+	{
+		ActiveCallers.Decrement();
+	};
+
+	// Wait in short slices to release the caller soon after cancellation
+	while (!ModelsReadyEvent->Wait(CancellationPollMs))
+	{
+		if (IsRequestCancelled(CancellationToken.Get()))
+		{
+			return false;
+		}
+	}
+
+	UNeuralProcessWrapper* CurrentProcessor;
+	{
+		FScopeLock Lock(&QueueLock);
+		if (bStopping || !Processor)
+		{
+			return false;
+		}
+		CurrentProcessor = Processor;
+	}
+
+	if (!ShouldBatch(CurrentProcessor, bUseLipsyncModel))
+	{
+		return CurrentProcessor->ProcessPhonemesSequence(PhonemesData, bUseLipsyncModel, OutData, CancellationToken.Get());
+	}
+
+	FPendingRequestRef Request = MakeShared<FPendingRequest, ESPMode::ThreadSafe>();
+	if (PhonemesData.Num() == 0 || !CurrentProcessor->MakeModelInput(PhonemesData, Request->Symbols, TEXT("FMetaFaceInferenceService")) || Request->Symbols.Num() == 0)
+	{
+		return false;
+	}
+	Request->InterruptState = CurrentProcessor->GetInterruptState();
+	Request->CancellationToken = CancellationToken;
+
+	// The first caller in empty queue collects and evaluates the batch
+	FBatchQueue& Queue = Queues[bUseLipsyncModel ? 1 : 0];
+	bool bLeader;
+	{
+		FScopeLock Lock(&QueueLock);
+		if (bStopping)
+		{
+			return false;
+		}
+		Queue.Requests.Add(Request);
+		bLeader = !Queue.bHasLeader;
+		Queue.bHasLeader = true;
+		if (Queue.Requests.Num() >= GetDefault<UYnnkMetaFaceSettings>()->MaxBatchSize)
+		{
+			Queue.BatchFullEvent->Trigger();
+		}
+	}
+
+	while (true)
+	{
+		if (bLeader)
+		{
+			ProcessBatch(bUseLipsyncModel, Request);
+			bLeader = false;
+		}
+
+		if (Request->RequestDone->Wait(CancellationPollMs))
+		{
+			break;
+		}
+
+		FScopeLock Lock(&QueueLock);
+		if (Queue.Requests.Contains(Request))
+		{
+			if (IsRequestCancelled(CancellationToken.Get()))
+			{
+				Queue.Requests.RemoveSingle(Request);
+				return false;
+			}
+			// Previous leader has taken its batch, this caller collects the next one
+			if (!Queue.bHasLeader)
+			{
+				Queue.bHasLeader = true;
+				bLeader = true;
+			}
+		}
+		else if (IsRequestCancelled(CancellationToken.Get()))
+		{
+			// Request is evaluated in batch of other caller, its result is discarded
+			return false;
+		}
+	}
+
+	OutData = MoveTemp(Request->Data);
+	return Request->bSuccess;
+}
+
+void FMetaFaceInferenceService::Shutdown()
+{
+	TArray<FPendingRequestRef> Rejected;
+	TArray<FDeferredRequest> RejectedDeferred;
+	UNeuralProcessWrapper* CurrentProcessor;
+	{
+		FScopeLock Lock(&QueueLock);
+		bStopping = true;
+		bWaitingForModels = false;
+		for (auto& Queue : Queues)
+		{
+			Rejected.Append(MoveTemp(Queue.Requests));
+			Queue.Requests.Reset();
+			Queue.BatchFullEvent->Trigger();
+		}
+		RejectedDeferred = MoveTemp(DeferredRequests);
+		DeferredRequests.Reset();
+		CurrentProcessor = Processor;
+	}
+
+	// Release waiting callers
+	ModelsReadyEvent->Trigger();
+	for (auto& Request : Rejected)
+	{
+		Request->Complete(false);
+	}
+	for (auto& Request : RejectedDeferred)
+	{
+		Request.Callback(false, RawAnimDataMap());
+	}
+
+	// Callers evaluating requests leave after the current model call
+	if (ActiveCallers.GetValue() > 0 && CurrentProcessor)
+	{
+		CurrentProcessor->InterruptAll();
+	}
+	while (ActiveCallers.GetValue() > 0)
+	{
+		FPlatformProcess::SleepNoStats(CancellationPollMs * 0.001f);
+	}
+}
+
+void FMetaFaceInferenceService::ProcessBatch(bool bUseLipsyncModel, const FPendingRequestRef& Leader)
+{
+	FBatchQueue& Queue = Queues[bUseLipsyncModel ? 1 : 0];
+	const UYnnkMetaFaceSettings* Settings = GetDefault<UYnnkMetaFaceSettings>();
+
+	// Let other callers join the batch (lookup table is evaluated at once, it takes requests already queued)
+	bool bCompiledModel;
+	{
+		FScopeLock Lock(&QueueLock);
+		bCompiledModel = Processor && Processor->IsUsingCompiledModel(bUseLipsyncModel);
+	}
+	const double WindowEndTime = FPlatformTime::Seconds() + (bCompiledModel ? 0.0 : Settings->BatchingWindowMs * 0.001);
+	while (FPlatformTime::Seconds() < WindowEndTime && !Queue.BatchFullEvent->Wait(CancellationPollMs))
+	{
+		if (IsRequestCancelled(Leader->CancellationToken.Get()))
+		{
+			// Another waiting caller collects the batch
+			FScopeLock Lock(&QueueLock);
+			Queue.bHasLeader = false;
+			return;
+		}
+	}
+
+	TArray<FPendingRequestRef> Batch;
+	UNeuralProcessWrapper* BatchProcessor;
+	{
+		FScopeLock Lock(&QueueLock);
+		Queue.bHasLeader = false;
+
+		const int32 TakenNum = FMath::Min(Queue.Requests.Num(), FMath::Max(Settings->MaxBatchSize, 1));
+		Batch.Append(Queue.Requests.GetData(), TakenNum);
+		Queue.Requests.RemoveAt(0, TakenNum, false);
+		BatchProcessor = Processor;
+	}
+
+	if (!BatchProcessor)
+	{
+		for (auto& Request : Batch)
+		{
+			Request->Complete(false);
+		}
+		return;
+	}
+
+	BatchesNum.Increment();
+	BatchedRequestsNum.Add(Batch.Num());
+
+	const int32 InterruptState = BatchProcessor->GetInterruptState();
+	const int32 CurvesNum = BatchProcessor->GetCurvesNum(bUseLipsyncModel);
+	TArray<float> Symbols;
+	TArray<float> Values;
+
+	while (true)
+	{
+		// Cancelled and interrupted requests leave the batch between chunks
+		for (int32 i = 0; i < Batch.Num(); i++)
+		{
+			if (Batch[i]->InterruptState != InterruptState || IsRequestCancelled(Batch[i]->CancellationToken.Get()))
+			{
+				Batch[i]->Complete(false);
+				Batch.RemoveAt(i--);
+			}
+		}
+		if (Batch.Num() == 0)
+		{
+			return;
+		}
+
+		// Leader's request is cancelled: its caller leaves, the rest of the batch is evaluated by another caller
+		if (IsRequestCancelled(Leader->CancellationToken.Get()))
+		{
+			FScopeLock Lock(&QueueLock);
+			if (bStopping)
+			{
+				break;
+			}
+			Queue.Requests.Insert(Batch, 0);
+			return;
+		}
+
+		// Next chunk: concatenated inputs of requests which aren't evaluated yet
+		Symbols.Reset();
+		for (const auto& Request : Batch)
+		{
+			const int32 Num = FMath::Min(Request->Symbols.Num() - Request->EvaluatedNum, UNeuralProcessWrapper::MaxSymbolsPerCall - Symbols.Num());
+			Symbols.Append(Request->Symbols.GetData() + Request->EvaluatedNum, Num);
+			if (Symbols.Num() == UNeuralProcessWrapper::MaxSymbolsPerCall)
+			{
+				break;
+			}
+		}
+
+		// Model replica is acquired by EvaluateSymbols, so batches of different leaders are evaluated in parallel
+		if (!BatchProcessor->EvaluateSymbols(bUseLipsyncModel, Symbols, Values, TEXT("FMetaFaceInferenceService")))
+		{
+			break;
+		}
+
+		// Scatter results
+		int32 Offset = 0;
+		for (int32 i = 0; i < Batch.Num() && Offset < Symbols.Num(); i++)
+		{
+			FPendingRequest& Request = *Batch[i];
+			const int32 Num = FMath::Min(Request.Symbols.Num() - Request.EvaluatedNum, Symbols.Num() - Offset);
+			Request.Values.SetNumUninitialized(Request.Symbols.Num() * CurvesNum, false);
+			FMemory::Memcpy(Request.Values.GetData() + Request.EvaluatedNum * CurvesNum, Values.GetData() + Offset * CurvesNum, Num * CurvesNum * sizeof(float));
+			Request.EvaluatedNum += Num;
+			Offset += Num;
+
+			if (Request.EvaluatedNum == Request.Symbols.Num())
+			{
+				BatchProcessor->ScatterValues(bUseLipsyncModel, Request.Values.GetData(), Request.Symbols.Num(), Request.Data);
+				Request.Complete(true);
+				Batch.RemoveAt(i--);
+			}
+		}
+	}
+
+	// Evaluation failed or service is stopping
+	for (auto& Request : Batch)
+	{
+		Request->Complete(false);
+	}
+}
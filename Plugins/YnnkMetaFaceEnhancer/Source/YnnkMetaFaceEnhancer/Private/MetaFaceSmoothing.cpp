@@ -0,0 +1,261 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceSmoothing.h"
+#include "MetaFaceCurveRegistry.h"
+#include "YnnkVoiceLipsyncData.h"
+
+namespace MetaFaceSmoothingKernels
+{
+	/** Lerp(Value, Average, Strength) in the same order of operations as scalar FMath::Lerp */
+	FORCEINLINE VectorRegister4Float LerpTo(const VectorRegister4Float& Value, const VectorRegister4Float& Target, const VectorRegister4Float& Strength)
+	{
+		return VectorAdd(Value, VectorMultiply(Strength, VectorSubtract(Target, Value)));
+	}
+
+	/** Smooth key with average of 3 keys */
+	FORCEINLINE void SmoothKey3(float* Row, const float* Prev, const float* Next, const float* KeyStrengths, int32 Stride)
+	{
+		const VectorRegister4Float Third = VectorSetFloat1(3.f);
+		for (int32 i = 0; i < Stride; i += 4)
+		{
+			const VectorRegister4Float Value = VectorLoadAligned(Row + i);
+			const VectorRegister4Float Average = VectorDivide(VectorAdd(VectorAdd(VectorLoadAligned(Prev + i), Value), VectorLoadAligned(Next + i)), Third);
+			VectorStoreAligned(LerpTo(Value, Average, VectorLoadAligned(KeyStrengths + i)), Row + i);
+		}
+	}
+
+	/** Smooth key with average of 5 keys (or 3 keys for curves in NarrowMask) */
+	FORCEINLINE void SmoothKey5(float* Row, const float* const* Rows, const float* KeyStrengths, const float* NarrowMask, int32 Stride)
+	{
+		const VectorRegister4Float Third = VectorSetFloat1(3.f);
+		const VectorRegister4Float Fifth = VectorSetFloat1(0.2f);
+		for (int32 i = 0; i < Stride; i += 4)
+		{
+			const VectorRegister4Float Value = VectorLoadAligned(Row + i);
+			const VectorRegister4Float Prev = VectorLoadAligned(Rows[1] + i);
+			const VectorRegister4Float Next = VectorLoadAligned(Rows[3] + i);
+			const VectorRegister4Float Average3 = VectorDivide(VectorAdd(VectorAdd(Prev, Value), Next), Third);
+			const VectorRegister4Float Sum5 = VectorAdd(VectorAdd(VectorAdd(VectorAdd(VectorLoadAligned(Rows[0] + i), Prev), Value), Next), VectorLoadAligned(Rows[4] + i));
+			const VectorRegister4Float Average = VectorSelect(VectorCompareGT(VectorLoadAligned(NarrowMask + i), VectorZero()), Average3, VectorMultiply(Sum5, Fifth));
+			VectorStoreAligned(LerpTo(Value, Average, VectorLoadAligned(KeyStrengths + i)), Row + i);
+		}
+	}
+
+	/** Lerp Row to average of Row and Other */
+	FORCEINLINE void SmoothEnd(float* Row, const float* Other, bool bRowIsFirst, const float* InStrengths, int32 Stride)
+	{
+		const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+		for (int32 i = 0; i < Stride; i += 4)
+		{
+			const VectorRegister4Float Value = VectorLoadAligned(Row + i);
+			const VectorRegister4Float OtherValue = VectorLoadAligned(Other + i);
+			const VectorRegister4Float Sum = bRowIsFirst ? VectorAdd(Value, OtherValue) : VectorAdd(OtherValue, Value);
+			VectorStoreAligned(LerpTo(Value, VectorMultiply(Sum, Half), VectorLoadAligned(InStrengths + i)), Row + i);
+		}
+	}
+}
+
+FMetaFaceSmoothing::FMetaFaceSmoothing(const FMetaFaceClip& Clip, float Strength)
+	: CurveIds(Clip.GetCurveIds())
+	, RichScale(1.f)
+{
+	const int32 Stride = Clip.GetStride();
+	Strengths.SetNumZeroed(Stride);
+	RichStrengths.SetNumZeroed(Stride);
+	NarrowMask.SetNumZeroed(Stride);
+	for (int32 Curve = 0; Curve < CurveIds.Num(); Curve++)
+	{
+		Strengths[Curve] = RichStrengths[Curve] = Strength;
+	}
+}
+
+void FMetaFaceSmoothing::SetCategoryStrength(EMetaFaceCurveFlags Category, float Strength)
+{
+	const FMetaFaceCurveRegistry& Registry = FMetaFaceCurveRegistry::Get();
+	for (int32 Curve = 0; Curve < CurveIds.Num(); Curve++)
+	{
+		if (EnumHasAnyFlags(Registry.GetFlags(CurveIds[Curve]), Category))
+		{
+			Strengths[Curve] = Strength;
+			RichStrengths[Curve] = Strength * RichScale;
+		}
+	}
+}
+
+void FMetaFaceSmoothing::SetRichKeysScale(float Scale)
+{
+	RichScale = Scale;
+	for (int32 Curve = 0; Curve < CurveIds.Num(); Curve++)
+	{
+		RichStrengths[Curve] = Strengths[Curve] * RichScale;
+	}
+}
+
+void FMetaFaceSmoothing::SetNarrowCurves(EMetaFaceCurveFlags Category)
+{
+	const FMetaFaceCurveRegistry& Registry = FMetaFaceCurveRegistry::Get();
+	for (int32 Curve = 0; Curve < CurveIds.Num(); Curve++)
+	{
+		NarrowMask[Curve] = EnumHasAnyFlags(Registry.GetFlags(CurveIds[Curve]), Category) ? 1.f : 0.f;
+	}
+}
+
+void FMetaFaceSmoothing::MakeKeyStrengths(int32 KeysNum, const uint8* KeyFlags, FMetaFaceClip::FValuesArray& OutStrengths) const
+{
+	const int32 Stride = Strengths.Num();
+	const int32 CurvesNum = CurveIds.Num();
+	OutStrengths.SetNumUninitialized(KeysNum * Stride);
+	for (int32 Key = 0; Key < KeysNum; Key++)
+	{
+		float* Row = OutStrengths.GetData() + Key * Stride;
+		const uint8* RowFlags = KeyFlags + Key * CurvesNum;
+		for (int32 Curve = 0; Curve < CurvesNum; Curve++)
+		{
+			Row[Curve] = (RowFlags[Curve] & CURVEFLAG_RICH) ? RichStrengths[Curve] : Strengths[Curve];
+		}
+		for (int32 Curve = CurvesNum; Curve < Stride; Curve++)
+		{
+			Row[Curve] = 0.f;
+		}
+	}
+}
+
+void FMetaFaceSmoothing::ApplyFIR(FMetaFaceClip& Clip, int32 PassesNum, int32 Radius, bool bSmoothEnds, const uint8* KeyFlags) const
+{
+	using namespace MetaFaceSmoothingKernels;
+
+	const int32 Num = Clip.GetKeysNum();
+	const int32 Stride = Clip.GetStride();
+	if (PassesNum <= 0 || Num == 0 || Stride != Strengths.Num())
+	{
+		return;
+	}
+	Radius = FMath::Clamp(Radius, 1, 2);
+
+	FMetaFaceClip::FValuesArray KeyStrengths;
+	if (KeyFlags)
+	{
+		MakeKeyStrengths(Num, KeyFlags, KeyStrengths);
+	}
+	auto GetKeyStrengths = [this, &KeyStrengths, KeyFlags, Stride](int32 Key)
+	{
+		return KeyFlags ? KeyStrengths.GetData() + Key * Stride : Strengths.GetData();
+	};
+
+	auto SmoothFirst = [&]()
+	{
+		if (Num > 1)
+		{
+			SmoothEnd(Clip.GetKey(0), Clip.GetKey(1), true, Strengths.GetData(), Stride);
+		}
+	};
+	auto SmoothLast = [&]()
+	{
+		if (Num > 2)
+		{
+			SmoothEnd(Clip.GetKey(Num - 1), Clip.GetKey(Num - 2), false, Strengths.GetData(), Stride);
+		}
+	};
+
+	// Smoothed keys
+	const int32 First = 2;
+	const int32 End = Num - 2;
+	if (End <= First)
+	{
+		if (bSmoothEnds)
+		{
+			for (int32 Pass = 0; Pass < PassesNum; Pass++)
+			{
+				SmoothFirst();
+				SmoothLast();
+			}
+		}
+		return;
+	}
+
+	// Pass follows the previous one with a lag of Radius keys: it reads the next keys already smoothed by the previous pass
+	// and previous keys smoothed by itself, but not yet changed by the next pass. The first key is read by a pass only
+	// at the first smoothed key and the last key only at the last one, so ends are smoothed right after that.
+	const int32 StepsNum = End - First + (PassesNum - 1) * Radius;
+	for (int32 Step = 0; Step < StepsNum; Step++)
+	{
+		for (int32 Pass = 0; Pass < PassesNum; Pass++)
+		{
+			const int32 Key = First + Step - Pass * Radius;
+			if (Key < First)
+			{
+				break;
+			}
+			if (Key >= End)
+			{
+				continue;
+			}
+
+			if (Radius == 1)
+			{
+				SmoothKey3(Clip.GetKey(Key), Clip.GetKey(Key - 1), Clip.GetKey(Key + 1), GetKeyStrengths(Key), Stride);
+			}
+			else
+			{
+				const float* Rows[5] = { Clip.GetKey(Key - 2), Clip.GetKey(Key - 1), Clip.GetKey(Key), Clip.GetKey(Key + 1), Clip.GetKey(Key + 2) };
+				SmoothKey5(Clip.GetKey(Key), Rows, GetKeyStrengths(Key), NarrowMask.GetData(), Stride);
+			}
+
+			if (bSmoothEnds)
+			{
+				if (Key == First)
+				{
+					SmoothFirst();
+				}
+				if (Key == End - 1)
+				{
+					SmoothLast();
+				}
+			}
+		}
+	}
+}
+
+void FMetaFaceSmoothing::ApplyIIR(FMetaFaceClip& Clip, bool bZeroPhase, const uint8* KeyFlags) const
+{
+	using namespace MetaFaceSmoothingKernels;
+
+	const int32 Num = Clip.GetKeysNum();
+	const int32 Stride = Clip.GetStride();
+	if (Num < 2 || Stride != Strengths.Num())
+	{
+		return;
+	}
+
+	FMetaFaceClip::FValuesArray KeyStrengths;
+	if (KeyFlags)
+	{
+		MakeKeyStrengths(Num, KeyFlags, KeyStrengths);
+	}
+
+	// Each row is lerped to already filtered neighbour row
+	for (int32 Key = 1; Key < Num; Key++)
+	{
+		float* Row = Clip.GetKey(Key);
+		const float* Prev = Clip.GetKey(Key - 1);
+		const float* RowStrengths = KeyFlags ? KeyStrengths.GetData() + Key * Stride : Strengths.GetData();
+		for (int32 i = 0; i < Stride; i += 4)
+		{
+			VectorStoreAligned(LerpTo(VectorLoadAligned(Row + i), VectorLoadAligned(Prev + i), VectorLoadAligned(RowStrengths + i)), Row + i);
+		}
+	}
+	if (bZeroPhase)
+	{
+		for (int32 Key = Num - 2; Key >= 0; Key--)
+		{
+			float* Row = Clip.GetKey(Key);
+			const float* Next = Clip.GetKey(Key + 1);
+			const float* RowStrengths = KeyFlags ? KeyStrengths.GetData() + Key * Stride : Strengths.GetData();
+			for (int32 i = 0; i < Stride; i += 4)
+			{
+				VectorStoreAligned(LerpTo(VectorLoadAligned(Row + i), VectorLoadAligned(Next + i), VectorLoadAligned(RowStrengths + i)), Row + i);
+			}
+		}
+	}
+}
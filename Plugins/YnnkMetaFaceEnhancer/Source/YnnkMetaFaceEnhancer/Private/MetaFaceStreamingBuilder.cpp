@@ -0,0 +1,394 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceStreamingBuilder.h"
+#include "MetaFaceFunctionLibrary.h"
+#include "MetaFaceInferenceService.h"
+#include "NeuralProcessWrapper.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "Modules/ModuleManager.h"
+#include "Misc/ScopeLock.h"
+
+/* --------------------------------------------------------------- */
+/* -						FStreamingCurve						 - */
+/* --------------------------------------------------------------- */
+
+void FMetaFaceStreamingBuilder::FStreamingCurve::Initialize(int32 PassesNum, int32 InRadius, float InAlpha, float InRichAlpha, bool bInSmoothEnds)
+{
+	Keys.Empty();
+	Passes.Empty();
+	Passes.SetNum(PassesNum);
+	EmittedNum = 0;
+	Radius = InRadius;
+	Alpha = InAlpha;
+	RichAlpha = InRichAlpha;
+	bSmoothEnds = bInSmoothEnds;
+}
+
+bool FMetaFaceStreamingBuilder::FStreamingCurve::ComputeKey(int32 Pass, bool bFinished)
+{
+	// Batch smoothing is done in place: for (i = 2; i < Num - 2; i++) P[i] = Lerp(P[i], Average(P[i - Radius] .. P[i + Radius]), Alpha)
+	// so the key depends on already smoothed previous keys of this pass and next keys of the previous pass.
+	TArray<float>& Output = Passes[Pass - 1];
+	const int32 Index = Output.Num();
+	const int32 SourceNum = GetPassNum(Pass - 1);
+	const int32 KeysNum = Keys.Num();
+
+	if (Index >= SourceNum)
+	{
+		return false;
+	}
+
+	const float Value = GetPassValue(Pass - 1, Index);
+
+	if (Index < 2)
+	{
+		if (Index == 0 && bSmoothEnds)
+		{
+			if (SourceNum > 1)
+			{
+				Output.Add(FMath::Lerp(Value, (Value + GetPassValue(Pass - 1, 1)) * 0.5f, Alpha));
+			}
+			else if (bFinished)
+			{
+				Output.Add(Value);
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else
+		{
+			Output.Add(Value);
+		}
+	}
+	else if (Index < KeysNum - 2)
+	{
+		if (SourceNum <= Index + Radius)
+		{
+			return false;
+		}
+
+		float Sum = 0.f;
+		for (int32 i = Index - Radius; i <= Index + Radius; i++)
+		{
+			// first two keys are only changed after the pass
+			Sum += (i >= 2 && i < Index) ? Output[i] : GetPassValue(Pass - 1, i);
+		}
+		const float NewValue = (Radius == 2) ? Sum * 0.2f : Sum / (float)(Radius * 2 + 1);
+		Output.Add(FMath::Lerp(Value, NewValue, (Keys[Index].Flag & CURVEFLAG_RICH) ? RichAlpha : Alpha));
+	}
+	else
+	{
+		// Last two keys: wait until the phrase is finished (otherwise new keys would be added after them)
+		if (!bFinished)
+		{
+			return false;
+		}
+
+		if (bSmoothEnds && Index == KeysNum - 1 && KeysNum > 2)
+		{
+			Output.Add(FMath::Lerp(Value, (GetPassValue(Pass - 1, Index - 1) + Value) * 0.5f, Alpha));
+		}
+		else
+		{
+			Output.Add(Value);
+		}
+	}
+
+	return true;
+}
+
+void FMetaFaceStreamingBuilder::FStreamingCurve::Advance(bool bFinished, FSimpleFloatCurve& OutCurve)
+{
+	const int32 PassesNum = Passes.Num();
+	for (int32 Pass = 1; Pass <= PassesNum; Pass++)
+	{
+		while (ComputeKey(Pass, bFinished));
+	}
+
+	const int32 FinalNum = GetPassNum(PassesNum);
+	for (int32 i = EmittedNum; i < FinalNum; i++)
+	{
+		OutCurve.Values.Add(FSimpleFloatValue(Keys[i].Time, GetPassValue(PassesNum, i), Keys[i].Flag));
+	}
+	EmittedNum = FinalNum;
+}
+
+/* --------------------------------------------------------------- */
+/* -					FMetaFaceStreamingBuilder				 - */
+/* --------------------------------------------------------------- */
+
+FMetaFaceStreamingBuilder::FMetaFaceStreamingBuilder(const FMetaFaceGenerationSettings& InSettings, bool bInCreateLipSync, bool bInCreateFacialAnimation)
+	: Settings(InSettings)
+	, CancellationToken(MakeShared<FMetaFaceCancellationToken, ESPMode::ThreadSafe>())
+	, bFinishRequested(false)
+	, bOutputFinished(false)
+{
+	LipSync.bEnabled = bInCreateLipSync;
+	FacialAnimation.bEnabled = bInCreateFacialAnimation;
+}
+
+void FMetaFaceStreamingBuilder::AppendPhonemes(const TArray<FPhonemeTextData>& NewPhonemes)
+{
+	FScopeLock Lock(&QueueLock);
+	QueuedPhonemes.Append(NewPhonemes);
+}
+
+void FMetaFaceStreamingBuilder::Finish()
+{
+	FScopeLock Lock(&QueueLock);
+	bFinishRequested = true;
+}
+
+bool FMetaFaceStreamingBuilder::ProcessPending(TFunctionRef<void(FMetaFaceStreamingChunk&&)> OnChunkReady)
+{
+	FScopeLock Lock(&ProcessLock);
+	if (bOutputFinished || CancellationToken->IsCancelled())
+	{
+		return false;
+	}
+
+	TArray<FPhonemeTextData> NewPhonemes;
+	bool bFinished;
+	{
+		FScopeLock QueueScopeLock(&QueueLock);
+		NewPhonemes = MoveTemp(QueuedPhonemes);
+		QueuedPhonemes.Reset();
+		bFinished = bFinishRequested;
+	}
+
+	// Keys are only added to the end of curves
+	float LastTime = Phonemes.Num() > 0 ? Phonemes.Last().Time : 0.f;
+	for (int32 i = 0; i < NewPhonemes.Num(); i++)
+	{
+		if (NewPhonemes[i].Time < LastTime)
+		{
+			UE_LOG(LogMetaFace, Warning, TEXT("Streaming animation: phoneme \"%s\" at %.3f is older then previous phoneme (%.3f), skipped"), *NewPhonemes[i].Symbol, NewPhonemes[i].Time, LastTime);
+			NewPhonemes.RemoveAt(i--);
+			continue;
+		}
+		LastTime = NewPhonemes[i].Time;
+	}
+
+	if (NewPhonemes.Num() == 0 && !bFinished)
+	{
+		return false;
+	}
+
+	FMetaFaceStreamingChunk Chunk;
+	const int32 FirstNewPhoneme = Phonemes.Num();
+	Phonemes.Append(NewPhonemes);
+	if ((LipSync.bEnabled && !UpdateModelOutput(LipSync, FirstNewPhoneme, bFinished, true))
+		|| (FacialAnimation.bEnabled && !UpdateModelOutput(FacialAnimation, FirstNewPhoneme, bFinished, false)))
+	{
+		// Owner doesn't wait for output of the cancelled builder
+		if (CancellationToken->IsCancelled())
+		{
+			bOutputFinished = true;
+			return false;
+		}
+
+		Chunk.bFailed = Chunk.bFinished = true;
+		bOutputFinished = true;
+		OnChunkReady(MoveTemp(Chunk));
+		return true;
+	}
+
+	AdvanceStream(LipSync, true, bFinished, Chunk.LipSync);
+	AdvanceStream(FacialAnimation, false, bFinished, Chunk.FacialAnimation);
+
+	Chunk.bFinished = bOutputFinished = bFinished;
+	OnChunkReady(MoveTemp(Chunk));
+
+	return true;
+}
+
+void FMetaFaceStreamingBuilder::CheckModelMode(FModelStream& Stream, bool bUseLipsyncModel)
+{
+	auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	UNeuralProcessWrapper* Processor = ModuleMFE ? ModuleMFE->GetNeuralProcessor() : nullptr;
+	if (!Processor || Processor->IsLoading())
+	{
+		return;
+	}
+
+	Stream.bModeChecked = true;
+	Stream.bWholePhrase = !Processor->IsModelStateless(bUseLipsyncModel);
+	if (Stream.bWholePhrase)
+	{
+		UE_LOG(LogMetaFace, Log, TEXT("Streaming animation: %s model isn't verified to be stateless, the phrase is evaluated when it's finished"),
+			bUseLipsyncModel ? TEXT("lip-sync") : TEXT("emotions"));
+	}
+}
+
+bool FMetaFaceStreamingBuilder::UpdateModelOutput(FModelStream& Stream, int32 FirstNewPhoneme, bool bFinished, bool bUseLipsyncModel)
+{
+	if (!Stream.bModeChecked)
+	{
+		CheckModelMode(Stream, bUseLipsyncModel);
+	}
+
+	if (!Stream.bWholePhrase && FirstNewPhoneme < Phonemes.Num())
+	{
+		const TArray<FPhonemeTextData> NewPhonemes(Phonemes.GetData() + FirstNewPhoneme, Phonemes.Num() - FirstNewPhoneme);
+		if (!EvaluateModel(Stream, NewPhonemes, bUseLipsyncModel))
+		{
+			return false;
+		}
+
+		// Models were loaded during the call: output of the first chunk is only kept for stateless model
+		if (!Stream.bModeChecked)
+		{
+			CheckModelMode(Stream, bUseLipsyncModel);
+			if (Stream.bWholePhrase)
+			{
+				Stream.RawData.Reset();
+			}
+		}
+	}
+
+	// Stateful model: output for a phoneme depends on all previous phonemes
+	if (Stream.bWholePhrase && bFinished && Phonemes.Num() > 0)
+	{
+		Stream.RawData.Reset();
+		return EvaluateModel(Stream, Phonemes, bUseLipsyncModel);
+	}
+
+	return true;
+}
+
+bool FMetaFaceStreamingBuilder::EvaluateModel(FModelStream& Stream, const TArray<FPhonemeTextData>& NewPhonemes, bool bUseLipsyncModel)
+{
+	auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	FMetaFaceInferenceService* InferenceService = ModuleMFE ? ModuleMFE->GetInferenceService() : nullptr;
+
+	RawAnimDataMap ChunkData;
+	if (!InferenceService || !InferenceService->ProcessPhonemes(NewPhonemes, bUseLipsyncModel, ChunkData, CancellationToken))
+	{
+		if (CancellationToken->IsCancelled())
+		{
+			return false;
+		}
+		UE_LOG(LogMetaFace, Log, TEXT("Streaming animation: unable to evaluate %s model"), bUseLipsyncModel ? TEXT("lip-sync") : TEXT("emotions"));
+		return false;
+	}
+
+	// Stateless models: output for concatenated sequence is the same as for the whole phrase
+	for (auto& Curve : ChunkData)
+	{
+		Stream.RawData.FindOrAdd(Curve.Key).Append(Curve.Value);
+	}
+
+	return true;
+}
+
+void FMetaFaceStreamingBuilder::InitializeCurves(FModelStream& Stream, bool bUseLipsyncModel)
+{
+	TArray<FName> CurveNames;
+	Stream.RawData.GetKeys(CurveNames);
+	if (!bUseLipsyncModel && UMFFunctionLibrary::NeedsMirroredRightBlink(Stream.RawData))
+	{
+		CurveNames.Add(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::EyeBlinkRight));
+	}
+
+	// Smoothing parameters of RawDataToLipsync and RawDataToFacialAnimation
+	for (const FName& CurveName : CurveNames)
+	{
+		FStreamingCurve& Curve = Stream.Curves.Add(CurveName);
+		if (bUseLipsyncModel)
+		{
+			const float Smoothness = Settings.LipsyncSmoothness;
+			Curve.Initialize(Smoothness > 0.f ? 2 : 0, 1, Smoothness, Smoothness * 0.15f, false);
+		}
+		else
+		{
+			const float Smoothness = Settings.FacialAnimationSmoothness;
+			const int32 CurveId = FMetaFaceCurveRegistry::Get().FindOrAdd(CurveName);
+			const bool bBrow = EnumHasAnyFlags(FMetaFaceCurveRegistry::Get().GetFlags(CurveId), EMetaFaceCurveFlags::Brow);
+			Curve.Initialize(Smoothness > 0.f ? 4 : 0, bBrow ? 1 : 2, Smoothness, Smoothness, true);
+		}
+		Stream.PhonemeKeys.Add(CurveName);
+	}
+}
+
+void FMetaFaceStreamingBuilder::AdvanceStream(FModelStream& Stream, bool bUseLipsyncModel, bool bFinished, TMap<FName, FSimpleFloatCurve>& OutKeys)
+{
+	// Output of stateful model isn't known until the phrase is finished
+	if (!Stream.bEnabled || Phonemes.Num() == 0 || (Stream.bWholePhrase && !bFinished))
+	{
+		return;
+	}
+	if (Stream.Curves.Num() == 0)
+	{
+		InitializeCurves(Stream, bUseLipsyncModel);
+	}
+
+	// End of phrase used for fade out. While phrase isn't finished, phonemes which can't be faded are converted.
+	const float PlayTime = Phonemes.Last().Time + 0.05f;
+
+	for (; Stream.NextPhoneme < Phonemes.Num(); Stream.NextPhoneme++)
+	{
+		const int32 Index = Stream.NextPhoneme;
+		if (!bFinished)
+		{
+			// lip-sync key depends on the next phoneme
+			if (bUseLipsyncModel && Index + 1 >= Phonemes.Num())
+			{
+				break;
+			}
+			if (PlayTime - Phonemes[Index].Time < 0.25f)
+			{
+				break;
+			}
+		}
+
+		// The last key of the previous phoneme is kept for curves without model output
+		for (auto& Curve : Stream.PhonemeKeys)
+		{
+			TArray<FSimpleFloatValue>& Values = Curve.Value.Values;
+			if (Values.Num() > 1)
+			{
+				Values.RemoveAt(0, Values.Num() - 1, false);
+			}
+		}
+
+		if (bUseLipsyncModel)
+		{
+			UMFFunctionLibrary::MakeLipsyncKeys(Phonemes, Index, PlayTime, Stream.PreviousPhonemeTime, Stream.RawData, Settings, Stream.PhonemeKeys);
+		}
+		else
+		{
+			UMFFunctionLibrary::MakeFacialAnimationKeys(Phonemes, Index, PlayTime, Stream.RawData, Stream.PhonemeKeys);
+			Stream.PreviousPhonemeTime = Phonemes[Index].Time;
+		}
+
+		for (const auto& Curve : Stream.PhonemeKeys)
+		{
+			const TArray<FSimpleFloatValue>& Values = Curve.Value.Values;
+			const int32 FirstNewKey = Index > 0 ? 1 : 0;
+			Stream.Curves[Curve.Key].Keys.Append(Values.GetData() + FirstNewKey, Values.Num() - FirstNewKey);
+		}
+	}
+
+	// reset all curves at the end
+	if (bFinished)
+	{
+		const float ResetTime = Stream.PreviousPhonemeTime + (bUseLipsyncModel ? 0.2f : 0.8f);
+		for (auto& Curve : Stream.Curves)
+		{
+			Curve.Value.Keys.Add(FSimpleFloatValue(ResetTime, 0.f, 1));
+		}
+	}
+
+	for (auto& Curve : Stream.Curves)
+	{
+		FSimpleFloatCurve NewKeys;
+		Curve.Value.Advance(bFinished, NewKeys);
+		if (NewKeys.Values.Num() > 0)
+		{
+			OutKeys.Add(Curve.Key, MoveTemp(NewKeys));
+		}
+	}
+}
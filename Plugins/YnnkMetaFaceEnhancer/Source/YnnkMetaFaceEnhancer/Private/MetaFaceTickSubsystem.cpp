@@ -0,0 +1,139 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceTickSubsystem.h"
+#include "YnnkMetaFaceController.h"
+#include "YnnkMetaFaceSettings.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "GameFramework/Actor.h"
+#include "Async/ParallelFor.h"
+
+/* --------------------------------------------------------------- */
+/* -					FMetaFaceTickFunction					 - */
+/* --------------------------------------------------------------- */
+
+void FMetaFaceTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Subsystem->TickControllers(DeltaTime);
+	}
+}
+
+FString FMetaFaceTickFunction::DiagnosticMessage()
+{
+	return TEXT("FMetaFaceTickFunction");
+}
+
+/* --------------------------------------------------------------- */
+/* -					UMetaFaceTickSubsystem					 - */
+/* --------------------------------------------------------------- */
+
+bool UMetaFaceTickSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return GetDefault<UYnnkMetaFaceSettings>()->bTickControllersInSubsystem && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UMetaFaceTickSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UMetaFaceTickSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Same tick group as component ticks of controllers, before animation of meshes is updated
+	TickFunction.bCanEverTick = true;
+	TickFunction.bStartWithTickEnabled = true;
+	TickFunction.bRunOnAnyThread = false;
+	TickFunction.TickGroup = TG_PrePhysics;
+	TickFunction.Subsystem = this;
+	TickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UMetaFaceTickSubsystem::Deinitialize()
+{
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+	TickFunction.Subsystem = nullptr;
+
+	for (UYnnkMetaFaceController* Controller : Controllers)
+	{
+		if (IsValid(Controller))
+		{
+			Controller->TickSubsystem.Reset();
+		}
+	}
+	Controllers.Empty();
+
+	Super::Deinitialize();
+}
+
+void UMetaFaceTickSubsystem::RegisterController(UYnnkMetaFaceController* Controller)
+{
+	if (IsValid(Controller))
+	{
+		Controllers.AddUnique(Controller);
+		Controller->TickSubsystem = this;
+	}
+}
+
+void UMetaFaceTickSubsystem::UnregisterController(UYnnkMetaFaceController* Controller)
+{
+	Controllers.RemoveSingleSwap(Controller);
+	if (Controller)
+	{
+		Controller->TickSubsystem.Reset();
+	}
+}
+
+void UMetaFaceTickSubsystem::TickControllers(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UMetaFaceTickSubsystem::TickControllers);
+
+	// Component tick is still used as a flag of active controller
+	TickedControllers.Reset();
+	TickedDeltaTimes.Reset();
+	for (int32 Index = Controllers.Num() - 1; Index >= 0; Index--)
+	{
+		UYnnkMetaFaceController* Controller = Controllers[Index];
+		if (!IsValid(Controller))
+		{
+			Controllers.RemoveAtSwap(Index);
+			continue;
+		}
+		if (Controller->IsComponentTickEnabled())
+		{
+			const AActor* Owner = Controller->GetOwner();
+			TickedControllers.Add(Controller);
+			TickedDeltaTimes.Add(Owner ? DeltaTime * Owner->CustomTimeDilation : DeltaTime);
+		}
+	}
+
+	const int32 Num = TickedControllers.Num();
+	if (Num == 0)
+	{
+		return;
+	}
+
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		TickedControllers[Index]->TickGameThread(TickedDeltaTimes[Index]);
+	}
+
+	// Game thread is busy in ParallelFor, so nothing else modifies controllers or their clips here
+	ParallelFor(Num, [this](int32 Index)
+	{
+		TickedControllers[Index]->TickAnimation();
+	}, Num < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	for (UYnnkMetaFaceController* Controller : TickedControllers)
+	{
+		Controller->FinishTick();
+	}
+}
@@ -15,22 +15,157 @@
 
 void FMHFacialAnimation::Initialize(const TMap<FName, FSimpleFloatCurve>& InAnimationData, bool bInFadeOnPause, float InFadePauseDuration, float InFadeTime)
 {
-	AnimationData = InAnimationData;
+	Clip = MakeShared<FMetaFaceClip, ESPMode::ThreadSafe>(InAnimationData);
+	InitializeFrame(bInFadeOnPause, InFadePauseDuration, InFadeTime);
+}
+
+void FMHFacialAnimation::Initialize(FMetaFaceClip&& InClip, bool bInFadeOnPause, float InFadePauseDuration, float InFadeTime)
+{
+	Clip = MakeShared<FMetaFaceClip, ESPMode::ThreadSafe>(MoveTemp(InClip));
+	InitializeFrame(bInFadeOnPause, InFadePauseDuration, InFadeTime);
+}
+
+void FMHFacialAnimation::Initialize(const FMetaFaceClipPtr& InClip, bool bInFadeOnPause, float InFadePauseDuration, float InFadeTime)
+{
+	Clip = InClip;
+	InitializeFrame(bInFadeOnPause, InFadePauseDuration, InFadeTime);
+}
+
+void FMHFacialAnimation::InitializeFrame(bool bInFadeOnPause, float InFadePauseDuration, float InFadeTime)
+{
 	bFadeOnPause = bInFadeOnPause;
 	Fade_PauseDuration = InFadePauseDuration;
 	FadeTime = InFadeTime;
 	bPlaying = bInterrupting = false;
+	bStreaming = false;
 
 	AnimationFrame.Empty();
 	AnimationDuration = 0.f;
-	for (const auto& Pair : AnimationData)
+	FrameValues.Empty();
+	PauseMask.Empty();
+	CurveMask.Empty();
+	KeyCursor = 0;
+	FrameParams = FMetaFaceFrameParams();
+	bFrameEvaluated = false;
+	if (Clip.IsValid())
+	{
+		AnimationDuration = Clip->GetDuration();
+		AnimationFrame.Reserve(Clip->GetCurvesNum());
+		UpdateFrameCurves();
+	}
+}
+
+void FMHFacialAnimation::UpdateFrameCurves()
+{
+	// Frame contains curves in the same order as clip
+	const TArray<FName>& CurveNames = Clip->GetCurveNames();
+	for (int32 Curve = AnimationFrame.Num(); Curve < CurveNames.Num(); Curve++)
+	{
+		AnimationFrame.Add(CurveNames[Curve], 0.f);
+	}
+	FrameValues.SetNumZeroed(Clip->GetStride());
+	MakePauseMask(*Clip, PauseMask);
+	MakeCurveMask(*Clip, DroppedCurves, CurveMask);
+}
+
+void FMHFacialAnimation::SetDroppedCurves(EMetaFaceCurveFlags InDroppedCurves)
+{
+	if (DroppedCurves != InDroppedCurves)
+	{
+		DroppedCurves = InDroppedCurves;
+		CurveMask.Empty();
+		if (Clip.IsValid())
+		{
+			MakeCurveMask(*Clip, DroppedCurves, CurveMask);
+		}
+	}
+}
+
+void FMHFacialAnimation::MakePauseMask(const FMetaFaceClip& InClip, FMetaFaceClip::FValuesArray& OutPauseMask)
+{
+	const FMetaFaceCurveRegistry& Registry = FMetaFaceCurveRegistry::Get();
+	OutPauseMask.SetNumZeroed(InClip.GetStride());
+	for (int32 Curve = 0; Curve < InClip.GetCurvesNum(); Curve++)
+	{
+		OutPauseMask[Curve] = EnumHasAnyFlags(Registry.GetFlags(InClip.GetCurveIds()[Curve]), EMetaFaceCurveFlags::Head) ? 0.f : 1.f;
+	}
+}
+
+void FMHFacialAnimation::MakeCurveMask(const FMetaFaceClip& InClip, EMetaFaceCurveFlags DroppedCurves, FMetaFaceClip::FValuesArray& OutCurveMask)
+{
+	OutCurveMask.Empty();
+	if (DroppedCurves == EMetaFaceCurveFlags::None)
+	{
+		return;
+	}
+
+	const FMetaFaceCurveRegistry& Registry = FMetaFaceCurveRegistry::Get();
+	OutCurveMask.SetNumZeroed(InClip.GetStride());
+	for (int32 Curve = 0; Curve < InClip.GetCurvesNum(); Curve++)
+	{
+		OutCurveMask[Curve] = EnumHasAnyFlags(Registry.GetFlags(InClip.GetCurveIds()[Curve]), DroppedCurves) ? 0.f : 1.f;
+	}
+}
+
+void FMHFacialAnimation::EvaluateFrame(const FMetaFaceClip& InClip, const FMetaFaceFrameParams& Params, const float* PauseMask, int32& InOutKeyCursor, float* OutValues, const float* CurveMask)
+{
+	InClip.Evaluate(Params.PlayTime, InOutKeyCursor, OutValues);
+
+	// Value * Alpha * (Head ? 1 : PauseAlpha) [* Kept]
+	const VectorRegister4Float VAlpha = VectorSetFloat1(Params.Alpha);
+	const VectorRegister4Float VPauseDelta = VectorSetFloat1(Params.PauseAlpha - 1.f);
+	for (int32 i = 0; i < InClip.GetStride(); i += 4)
+	{
+		VectorRegister4Float Scale = VectorMultiply(VectorMultiplyAdd(VectorLoadAligned(PauseMask + i), VPauseDelta, VectorOne()), VAlpha);
+		if (CurveMask)
+		{
+			Scale = VectorMultiply(Scale, VectorLoadAligned(CurveMask + i));
+		}
+		VectorStoreAligned(VectorMultiply(VectorLoadAligned(OutValues + i), Scale), OutValues + i);
+	}
+}
+
+TMap<FName, FSimpleFloatCurve> FMHFacialAnimation::GetAnimationData() const
+{
+	TMap<FName, FSimpleFloatCurve> AnimationData;
+	if (Clip.IsValid())
 	{
-		AnimationDuration = FMath::Max(AnimationDuration, Pair.Value.GetDuration());
-		AnimationFrame.Add(Pair.Key, 0.f);
+		Clip->ToCurves(AnimationData);
 	}
+	return AnimationData;
 }
 
-void FMHFacialAnimation::ProcessFrame(float PlayTime, UYnnkLipsyncController* LipsyncController)
+FMetaFaceClip& FMHFacialAnimation::GetMutableClip()
+{
+	if (!Clip.IsValid())
+	{
+		Clip = MakeShared<FMetaFaceClip, ESPMode::ThreadSafe>();
+	}
+	else if (!Clip.IsUnique())
+	{
+		// Other objects keep playing the original clip
+		Clip = MakeShared<FMetaFaceClip, ESPMode::ThreadSafe>(*Clip);
+	}
+	return const_cast<FMetaFaceClip&>(*Clip);
+}
+
+void FMHFacialAnimation::AppendKeys(const FMetaFaceClip& InClip)
+{
+	FMetaFaceClip& MutableClip = GetMutableClip();
+	MutableClip.AppendKeys(InClip);
+	AnimationDuration = MutableClip.GetDuration();
+	UpdateFrameCurves();
+}
+
+void FMHFacialAnimation::AddCurves(const FMetaFaceClip& InClip)
+{
+	FMetaFaceClip& MutableClip = GetMutableClip();
+	MutableClip.AddCurves(InClip);
+	AnimationDuration = MutableClip.GetDuration();
+	UpdateFrameCurves();
+}
+
+void FMHFacialAnimation::ProcessFrame(float PlayTime, UYnnkLipsyncController* LipsyncController, bool bEvaluateFrame)
 {
 	if (bPlaying)
 	{
@@ -41,45 +176,63 @@ void FMHFacialAnimation::ProcessFrame(float PlayTime, UYnnkLipsyncController* Li
 			Alpha *= (PlayTime / 0.3f);
 		}
 
-		if (PlayTime > AnimationDuration)
+		if (PlayTime > AnimationDuration && !bStreaming)
 		{
 			bPlaying = false;
 			bInterrupting = true;
 		}
 
-		// get current viseme values
-		for (auto& Curve : AnimationData)
+		if (!Clip.IsValid())
+		{
+			return;
+		}
+
+		// All curves are keyed at the same times, so pause is the same for all of them
+		float t0, t1;
+		if (bFadeOnPause && LipsyncController)
+		{
+			LipsyncController->GetSpeakingKeyIntervals(t0, t1);
+		}
+		else
 		{
-			const FName CurveName = Curve.Key;
-			float PauseAlpha = 1.f;
+			float KeyAlpha;
+			Clip->FindKeys(PlayTime, KeyCursor, KeyAlpha);
+			Clip->GetIntervalsToKeys(PlayTime, KeyCursor, t0, t1);
+		}
 
-			float t0, t1;
-			if (bFadeOnPause && LipsyncController)
+		float PauseAlpha = 1.f;
+		if (t1 + t0 > Fade_PauseDuration)
+		{
+			if (t0 < FadeTime)
 			{
-				LipsyncController->GetSpeakingKeyIntervals(t0, t1);
+				PauseAlpha = 1.f - t0 / FadeTime;
 			}
-			else
+			else if (t1 < FadeTime)
 			{
-				Curve.Value.GetIntervalsToKeys(PlayTime, t0, t1);
+				PauseAlpha = 1.f - t1 / FadeTime;
 			}
-
-			if (t1 + t0 > Fade_PauseDuration && CurveName.ToString().Left(4) != TEXT("Head"))
+			else
 			{
-				if (t0 < FadeTime)
-				{
-					PauseAlpha = 1.f - t0 / FadeTime;
-				}
-				else if (t1 < FadeTime)
-				{
-					PauseAlpha = 1.f - t1 / FadeTime;
-				}
-				else
-				{
-					PauseAlpha = 0.f;
-				}
+				PauseAlpha = 0.f;
 			}
+		}
 
-			AnimationFrame[CurveName] = Curve.Value.GetValueAtTime(PlayTime) * Alpha * PauseAlpha;
+		FrameParams.PlayTime = PlayTime;
+		FrameParams.Alpha = Alpha;
+		FrameParams.PauseAlpha = PauseAlpha;
+		bFrameEvaluated = bEvaluateFrame;
+		if (!bEvaluateFrame)
+		{
+			return;
+		}
+
+		// get current viseme values
+		EvaluateFrame(*Clip, FrameParams, PauseMask.GetData(), KeyCursor, FrameValues.GetData(), CurveMask.Num() ? CurveMask.GetData() : nullptr);
+
+		int32 Curve = 0;
+		for (auto& FrameCurve : AnimationFrame)
+		{
+			FrameCurve.Value = FrameValues[Curve++];
 		}
 	}
 	else if (bInterrupting)
@@ -87,18 +240,28 @@ void FMHFacialAnimation::ProcessFrame(float PlayTime, UYnnkLipsyncController* Li
 		float dValue = LipsyncController->GetWorld()->GetDeltaSeconds() * 2.f;
 		bool bCanFinish = true;
 
-		for (auto& Curve : AnimationFrame)
+		if (!bFrameEvaluated && Clip.IsValid())
+		{
+			// Fade out from the last frame played without evaluation
+			EvaluateFrame(*Clip, FrameParams, PauseMask.GetData(), KeyCursor, FrameValues.GetData(), CurveMask.Num() ? CurveMask.GetData() : nullptr);
+			bFrameEvaluated = true;
+		}
+
+		int32 Curve = 0;
+		for (auto& FrameCurve : AnimationFrame)
 		{
-			if (Curve.Value > 0.f)
+			float& Value = FrameValues[Curve++];
+			if (Value > 0.f)
 			{
-				Curve.Value -= dValue;
+				Value -= dValue;
 
-				if (Curve.Value < 0.f)
-					Curve.Value = 0.f;
+				if (Value < 0.f)
+					Value = 0.f;
 
-				if (Curve.Value > 0.f)
+				if (Value > 0.f)
 					bCanFinish = false;
 			}
+			FrameCurve.Value = Value;
 		}
 
 		if (bCanFinish)
@@ -126,23 +289,29 @@ void FMHFacialAnimation::Stop()
 FString FMHFacialAnimation::GetDescription() const
 {
 	FString ret = TEXT("IsValid: ") + FString::FromInt((int)IsValid()) + TEXT("\n");
-	for (auto& Curve : AnimationData)
+	if (!Clip.IsValid())
+	{
+		return ret;
+	}
+
+	const int32 KeysNum = Clip->GetKeysNum();
+	for (int32 Curve = 0; Curve < Clip->GetCurvesNum(); Curve++)
 	{
 		float TimeFrom = -1.f, TimeTo = -1.f;
-		if (Curve.Value.Values.Num() > 0)
+		if (KeysNum > 0)
 		{
-			TimeFrom = Curve.Value.Values[0].Time;
-			TimeTo = Curve.Value.Values.Last().Time;
+			TimeFrom = Clip->GetTime(0);
+			TimeTo = Clip->GetTime(KeysNum - 1);
 		}
 
 		float Val = 0.f;
-		for (const auto& v : Curve.Value.Values)
+		for (int32 Key = 0; Key < KeysNum; Key++)
 		{
-			Val += v.Value;
+			Val += Clip->GetValue(Key, Curve);
 		}
-		Val /= Curve.Value.Values.Num();
+		Val /= KeysNum;
 
-		FString crv = Curve.Key.ToString() + TEXT(": [time ") + FString::SanitizeFloat(TimeFrom) + TEXT("/") + FString::SanitizeFloat(TimeTo) + TEXT("] average: ") + FString::SanitizeFloat(Val);
+		FString crv = Clip->GetCurveNames()[Curve].ToString() + TEXT(": [time ") + FString::SanitizeFloat(TimeFrom) + TEXT("/") + FString::SanitizeFloat(TimeTo) + TEXT("] average: ") + FString::SanitizeFloat(Val);
 
 		ret += (crv + TEXT("\n"));
 	}
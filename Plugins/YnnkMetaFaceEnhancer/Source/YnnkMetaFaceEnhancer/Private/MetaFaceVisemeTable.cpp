@@ -0,0 +1,58 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceVisemeTable.h"
+#include "MetaFaceCurveRegistry.h"
+
+FMetaFaceVisemeTable::FMetaFaceVisemeTable(const TMap<EYnnkViseme, FMetaFacePose>& VisemesPreset)
+{
+	FMetaFaceCurveRegistry& Registry = FMetaFaceCurveRegistry::Get();
+
+	for (const auto& Pose : VisemesPreset)
+	{
+		for (const auto& Curve : Pose.Value.Curves)
+		{
+			CurveIds.AddUnique(Registry.FindOrAdd(Curve.Key));
+		}
+	}
+
+	const int32 CurvesNum = CurveIds.Num();
+	Values.SetNumZeroed(VisemesNum * CurvesNum);
+	Mask.SetNumZeroed(VisemesNum * CurvesNum);
+	for (const auto& Pose : VisemesPreset)
+	{
+		const int32 Viseme = (int32)Pose.Key;
+		if (Viseme >= VisemesNum)
+		{
+			continue;
+		}
+		bHasViseme[Viseme] = true;
+		for (const auto& Curve : Pose.Value.Curves)
+		{
+			const int32 Column = CurveIds.IndexOfByKey(Registry.FindOrAdd(Curve.Key));
+			Values[Viseme * CurvesNum + Column] = Curve.Value;
+			Mask[Viseme * CurvesNum + Column] = true;
+		}
+	}
+}
+
+void FMetaFaceVisemeTable::MakeRows(const TArray<int32>& InCurveIds, int32 Stride, FMetaFaceClip::FValuesArray& OutValues, FMetaFaceClip::FValuesArray& OutMask) const
+{
+	OutValues.SetNumZeroed((VisemesNum + 1) * Stride);
+	OutMask.SetNumZeroed((VisemesNum + 1) * Stride);
+
+	const int32 CurvesNum = CurveIds.Num();
+	for (int32 Curve = 0; Curve < InCurveIds.Num(); Curve++)
+	{
+		const int32 Column = CurveIds.IndexOfByKey(InCurveIds[Curve]);
+		if (Column == INDEX_NONE)
+		{
+			continue;
+		}
+		for (int32 Viseme = 0; Viseme < VisemesNum; Viseme++)
+		{
+			OutValues[Viseme * Stride + Curve] = Values[Viseme * CurvesNum + Column];
+			OutMask[Viseme * Stride + Curve] = Mask[Viseme * CurvesNum + Column] ? 1.f : 0.f;
+		}
+	}
+}
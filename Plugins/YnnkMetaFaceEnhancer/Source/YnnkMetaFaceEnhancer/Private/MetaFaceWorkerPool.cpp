@@ -0,0 +1,139 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceWorkerPool.h"
+#include "MetaFaceTypes.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/ThreadSafeCounter.h"
+
+/* -					FMetaFaceSubtask					 - */
+/* --------------------------------------------------------------- */
+
+FMetaFaceSubtask::FMetaFaceSubtask(TUniqueFunction<void()>&& InJob)
+	: Job(MoveTemp(InJob))
+	, bClaimed(false)
+	, DoneEvent(FPlatformProcess::GetSynchEventFromPool(true))
+{
+}
+
+FMetaFaceSubtask::~FMetaFaceSubtask()
+{
+	FPlatformProcess::ReturnSynchEventToPool(DoneEvent);
+}
+
+bool FMetaFaceSubtask::TryRun()
+{
+	if (bClaimed.exchange(true))
+	{
+		return false;
+	}
+
+	Job();
+	Job.Reset();
+	DoneEvent->Trigger();
+	return true;
+}
+
+void FMetaFaceSubtask::Join()
+{
+	if (!TryRun())
+	{
+		DoneEvent->Wait();
+	}
+}
+
+/* -					FMetaFaceWorkerPool					 - */
+/* --------------------------------------------------------------- */
+
+FMetaFaceWorkerPool::FMetaFaceWorkerPool()
+	: Pool(nullptr)
+	, ThreadsNum(0)
+{
+}
+
+FMetaFaceWorkerPool::~FMetaFaceWorkerPool()
+{
+	Destroy();
+}
+
+int32 FMetaFaceWorkerPool::GetDefaultThreadsNum()
+{
+	// Leave cores for game, render and RHI threads
+	return FMath::Clamp(FPlatformMisc::NumberOfCores() - 2, 1, 4);
+}
+
+bool FMetaFaceWorkerPool::Create(int32 InThreadsNum, EThreadPriority Priority, uint64 AffinityMask)
+{
+	Destroy();
+
+	if (!FPlatformProcess::SupportsMultithreading())
+	{
+		return false;
+	}
+
+	ThreadsNum = InThreadsNum > 0 ? InThreadsNum : GetDefaultThreadsNum();
+	Pool = FQueuedThreadPool::Allocate();
+	// Default stack size: workers run TorchScript library calls, their stack usage isn't known
+	if (!Pool->Create(ThreadsNum, 0, Priority, TEXT("MetaFaceWorkerPool")))
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("Unable to create MetaFace worker pool, global thread pool will be used"));
+		delete Pool;
+		Pool = nullptr;
+		ThreadsNum = 0;
+		return false;
+	}
+
+	if (AffinityMask != 0)
+	{
+		// Every job waits for the others, so each thread of the pool receives exactly one job
+		FThreadSafeCounter ArrivedNum;
+		FEvent* AllArrived = FPlatformProcess::GetSynchEventFromPool(true);
+		TArray<TFuture<void>> Jobs;
+		for (int32 i = 0; i < ThreadsNum; i++)
+		{
+			Jobs.Add(AsyncPool(*Pool, [this, AffinityMask, &ArrivedNum, AllArrived]()
+			{
+				FPlatformProcess::SetThreadAffinityMask(AffinityMask);
+				if (ArrivedNum.Increment() == ThreadsNum)
+				{
+					AllArrived->Trigger();
+				}
+				else
+				{
+					AllArrived->Wait();
+				}
+			}));
+		}
+		for (auto& Job : Jobs)
+		{
+			Job.Wait();
+		}
+		FPlatformProcess::ReturnSynchEventToPool(AllArrived);
+	}
+
+	UE_LOG(LogMetaFace, Log, TEXT("MetaFace worker pool: %d threads, priority %d, affinity 0x%llx"), ThreadsNum, (int32)Priority, AffinityMask);
+	return true;
+}
+
+void FMetaFaceWorkerPool::Destroy()
+{
+	if (Pool)
+	{
+		Pool->Destroy();
+		delete Pool;
+		Pool = nullptr;
+	}
+	ThreadsNum = 0;
+}
+
+FMetaFaceSubtaskRef FMetaFaceWorkerPool::LaunchSubtask(TUniqueFunction<void()>&& Job)
+{
+	FMetaFaceSubtaskRef Subtask = MakeShared<FMetaFaceSubtask, ESPMode::ThreadSafe>(MoveTemp(Job));
+	// If the pool abandons this job, subtask is executed by Join()
+	Launch([Subtask]()
+	{
+		Subtask->TryRun();
+	});
+	return Subtask;
+}
@@ -4,357 +4,762 @@
 #include "NeuralProcessWrapper.h"
 #include "MetaFaceFunctionLibrary.h"
 #include "MetaFaceTypes.h"
+#include "YnnkMetaFaceSettings.h"
 #include "YnnkVoiceLipsyncData.h"
 #include "Interfaces/IPluginManager.h"
 #include "HAL/CriticalSection.h"
 #include "Containers/StringConv.h"
 #include "Misc/Paths.h"
-
-// Critical session for ProcessPhonemesData
-FCriticalSection UNeuralProcessWrapper::NeuralWrapMutex1;
-FCriticalSection UNeuralProcessWrapper::NeuralWrapMutex2;
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeExit.h"
+#include "Async/Async.h"
+#include "UObject/GarbageCollection.h"
 
 UNeuralProcessWrapper::UNeuralProcessWrapper()
 	: EmotionsNeuralModel(nullptr)
 	, bEmotionsModelReady(false)
 	, LipsyncNeuralModel(nullptr)
 	, bLipsyncModelReady(false)
+	, bLoading(false)
 {
 	UMFFunctionLibrary::GetMetaFaceCurvesSet(NN_EmotionsOutCurves, false);
 	UMFFunctionLibrary::GetMetaFaceCurvesSet(NN_LipsyncOutCurves, true);
+	EmotionsReplicaReleased = FPlatformProcess::GetSynchEventFromPool(false);
+	LipsyncReplicaReleased = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+UNeuralProcessWrapper::~UNeuralProcessWrapper()
+{
+	FPlatformProcess::ReturnSynchEventToPool(EmotionsReplicaReleased);
+	FPlatformProcess::ReturnSynchEventToPool(LipsyncReplicaReleased);
 }
 
 void UNeuralProcessWrapper::Initialize()
 {
 	bEmotionsModelReady = false;
 	bLipsyncModelReady = false;
+	bEmotionsSequenceInput = false;
+	bLipsyncSequenceInput = false;
+	EmotionsCompiledModel.Reset();
+	LipsyncCompiledModel.Reset();
+
+	// Lookup tables don't need torch runtime
+	auto Settings = GetDefault<UYnnkMetaFaceSettings>();
+	if (Settings->bUseLookupTables)
+	{
+		bEmotionsModelReady = LoadLookupTable(false);
+		bLipsyncModelReady = LoadLookupTable(true);
+	}
 
-	FString ResourcesPath = GetResourcesPath();
+	InitializeTorchModels(!bEmotionsModelReady, !bLipsyncModelReady);
 
-	FString FileName = ResourcesPath / TEXT("ynnkemotions_en.tmod");
-	if (!FPaths::FileExists(FileName))
+	// Stateless models are replaced by lookup tables
+	if (Settings->bUseLookupTables)
+	{
+		if (bEmotionsModelReady && !EmotionsCompiledModel.IsValid())
+		{
+			BuildLookupTable(false);
+		}
+		if (bLipsyncModelReady && !LipsyncCompiledModel.IsValid())
+		{
+			BuildLookupTable(true);
+		}
+	}
+
+	// Models still evaluated by torch get replicas for parallel requests
+	if (bEmotionsModelReady && !EmotionsCompiledModel.IsValid())
+	{
+		// With lookup tables enabled, model left here has failed the statelessness probe
+		bEmotionsSequenceInput = !Settings->bUseLookupTables && ProbeSequenceInput(false);
+		CreateModelReplicas(false);
+	}
+	if (bLipsyncModelReady && !LipsyncCompiledModel.IsValid())
+	{
+		bLipsyncSequenceInput = !Settings->bUseLookupTables && ProbeSequenceInput(true);
+		CreateModelReplicas(true);
+	}
+}
+
+void UNeuralProcessWrapper::InitializeAsync(bool bWarmUp, TFunction<void()>&& OnLoaded)
+{
+	check(IsInGameThread());
+	if (bLoading)
 	{
-		FileName = ResourcesPath / TEXT("ynnkemotions_en_editor.tmod");
+		return;
 	}
+	bLoading = true;
 
-	EmotionsNeuralModel = USimpleTorchModule::CreateSimpleTorchModule(this);
-	if (EmotionsNeuralModel)
+	// Main model and replicas for both models
+	const int32 ModulesNum = FMath::Max(GetDefault<UYnnkMetaFaceSettings>()->NeuralModelReplicas, 1) * 2;
+	PreallocatedTorchModules.Reset();
+	PreallocatedModulesUsed = 0;
+	for (int32 i = 0; i < ModulesNum; i++)
 	{
-		if (FPaths::FileExists(FileName) && EmotionsNeuralModel->LoadTorchScriptModel(FileName))
+		PreallocatedTorchModules.Add(USimpleTorchModule::CreateSimpleTorchModule(this));
+	}
+
+	LoadingTask = Async(EAsyncExecution::Thread, [this, bWarmUp, OnLoaded = MoveTemp(OnLoaded)]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		Initialize();
+		if (bWarmUp)
 		{
-			EmotionsInData.Create({ 1 });
-			EmotionsOutData.Create({ 1, NN_EmotionsOutCurves.Num() });
-			bEmotionsModelReady = true;
+			WarmUp();
 		}
-		else
+		UE_LOG(LogMetaFace, Log, TEXT("Neural models loaded in background (%.2f sec), lip-sync: %s, emotions: %s"),
+			FPlatformTime::Seconds() - StartTime, bLipsyncModelReady ? TEXT("ready") : TEXT("failed"), bEmotionsModelReady ? TEXT("ready") : TEXT("failed"));
+
+		bLoading = false;
+		if (OnLoaded)
 		{
-			UE_LOG(LogMetaFace, Warning, TEXT("Unable to load torch jit model from file (%s)"), *FileName);
+			OnLoaded();
 		}
-	}
-	else
+
+		// Unused modules can be collected
+		TWeakObjectPtr<UNeuralProcessWrapper> WeakThis(this);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+		{
+			if (WeakThis.IsValid() && !WeakThis->bLoading)
+			{
+				WeakThis->PreallocatedTorchModules.Empty();
+				WeakThis->PreallocatedModulesUsed = 0;
+			}
+		});
+	});
+}
+
+void UNeuralProcessWrapper::WaitForModels() const
+{
+	if (LoadingTask.IsValid())
 	{
-		UE_LOG(LogMetaFace, Warning, TEXT("Unable to create torch jit model wrapper"));
+		LoadingTask.Wait();
 	}
+}
 
-	// new: lip-sync model
+void UNeuralProcessWrapper::WarmUp()
+{
+	TArray<FPhonemeTextData> PhonemesData;
+	UMFFunctionLibrary::GetWarmUpPhonemes(PhonemesData);
+	RawAnimDataMap GeneratedData;
 
-	FileName = ResourcesPath / TEXT("ynnklipsync.tmod");
-	if (!FPaths::FileExists(FileName))
+	for (const bool bUseLipsyncModel : { true, false })
+	{
+		if (!(bUseLipsyncModel ? bLipsyncModelReady : bEmotionsModelReady))
+		{
+			continue;
+		}
+
+		// Free replicas are taken in turn, so sequential calls reach every TorchScript instance
+		const int32 CallsNum = IsUsingCompiledModel(bUseLipsyncModel)
+			? 1
+			: FMath::Max((bUseLipsyncModel ? LipsyncReplicas : EmotionsReplicas).Num(), 1);
+		for (int32 i = 0; i < CallsNum; i++)
+		{
+			ProcessPhonemesInternal(PhonemesData, bUseLipsyncModel, GeneratedData, TEXT("WarmUp"));
+		}
+	}
+}
+
+USimpleTorchModule* UNeuralProcessWrapper::CreateTorchModule()
+{
+	// Modules stay referenced by the pool until loading is complete
+	if (PreallocatedModulesUsed < PreallocatedTorchModules.Num())
 	{
-		FileName = ResourcesPath / TEXT("ynnklipsync_editor.tmod");
+		return PreallocatedTorchModules[PreallocatedModulesUsed++];
 	}
-	LipsyncNeuralModel = USimpleTorchModule::CreateSimpleTorchModule(this);
-	if (LipsyncNeuralModel)
+	if (IsInGameThread())
+	{
+		return USimpleTorchModule::CreateSimpleTorchModule(this);
+	}
+
+	UE_LOG(LogMetaFace, Warning, TEXT("Unable to create torch jit model wrapper outside of game thread"));
+	return nullptr;
+}
+
+void UNeuralProcessWrapper::InitializeTorchModels(bool bLoadEmotionsModel, bool bLoadLipsyncModel)
+{
+	FString FileName;
+
+	if (bLoadEmotionsModel)
 	{
-		if (FPaths::FileExists(FileName) && LipsyncNeuralModel->LoadTorchScriptModel(FileName))
+		FileName = GetModelFile(false);
+
+		EmotionsNeuralModel = CreateTorchModule();
+		if (EmotionsNeuralModel)
 		{
-			LipsyncInData.Create({ 1 });
-			LipsyncOutData.Create({ 1, NN_LipsyncOutCurves.Num() });
-			bLipsyncModelReady = true;
+			if (FPaths::FileExists(FileName) && EmotionsNeuralModel->LoadTorchScriptModel(FileName))
+			{
+				FGCScopeGuard GCGuard;
+				EmotionsModelFile = FileName;
+				EmotionsReplicas = { EmotionsNeuralModel };
+				EmotionsReplicaLocks = { MakeShared<FCriticalSection>() };
+				bEmotionsModelReady = true;
+			}
+			else
+			{
+				UE_LOG(LogMetaFace, Warning, TEXT("Unable to load torch jit model from file (%s)"), *FileName);
+			}
 		}
 		else
 		{
-			UE_LOG(LogMetaFace, Warning, TEXT("Unable to load torch jit model from file (%s)"), *FileName);
+			UE_LOG(LogMetaFace, Warning, TEXT("Unable to create torch jit model wrapper"));
 		}
 	}
-	else
+
+	// new: lip-sync model
+
+	if (bLoadLipsyncModel)
 	{
-		UE_LOG(LogMetaFace, Warning, TEXT("Unable to create torch jit model wrapper"));
+		FileName = GetModelFile(true);
+		LipsyncNeuralModel = CreateTorchModule();
+		if (LipsyncNeuralModel)
+		{
+			if (FPaths::FileExists(FileName) && LipsyncNeuralModel->LoadTorchScriptModel(FileName))
+			{
+				FGCScopeGuard GCGuard;
+				LipsyncModelFile = FileName;
+				LipsyncReplicas = { LipsyncNeuralModel };
+				LipsyncReplicaLocks = { MakeShared<FCriticalSection>() };
+				bLipsyncModelReady = true;
+			}
+			else
+			{
+				UE_LOG(LogMetaFace, Warning, TEXT("Unable to load torch jit model from file (%s)"), *FileName);
+			}
+		}
+		else
+		{
+			UE_LOG(LogMetaFace, Warning, TEXT("Unable to create torch jit model wrapper"));
+		}
 	}
 }
 
 bool UNeuralProcessWrapper::IsValid() const
 {
-	return bEmotionsModelReady && bLipsyncModelReady;
+	return !bLoading && bEmotionsModelReady && bLipsyncModelReady;
 }
 
 bool UNeuralProcessWrapper::IsLipsyncModelReady() const
 {
-	return bLipsyncModelReady;
+	return !bLoading && bLipsyncModelReady;
 }
 
 bool UNeuralProcessWrapper::IsEmotionsModelReady() const
 {
-	return bEmotionsModelReady;
+	return !bLoading && bEmotionsModelReady;
 }
 
 void UNeuralProcessWrapper::InterruptAll()
 {
-	bProcessingModel1 = false;
-	bProcessingModel2 = false;
+	InterruptCounter.Increment();
 }
 
 bool UNeuralProcessWrapper::ProcessPhonemesData(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData)
 {
-	OutData.Empty();
+	return ProcessPhonemesInternal(PhonemesData, bUseLipsyncModel, OutData, TEXT("ProcessPhonemesData"));
+}
 
-	// Check NN model
-	if ((bUseLipsyncModel && !bLipsyncModelReady) || (!bUseLipsyncModel && !bEmotionsModelReady))
+bool UNeuralProcessWrapper::ProcessPhonemesData2(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel /* false */, TMap<FName, TArray<float>>& OutData)
+{
+	// this version is only used for emotions
+	return ProcessPhonemesInternal(PhonemesData, false, OutData, TEXT("ProcessPhonemesData2"));
+}
+
+bool UNeuralProcessWrapper::ProcessPhonemesSequence(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData, const FMetaFaceCancellationToken* CancellationToken)
+{
+	return bUseLipsyncModel
+		? ProcessPhonemesInternal(PhonemesData, true, OutData, TEXT("ProcessPhonemesSequence"), CancellationToken)
+		: ProcessPhonemesInternal(PhonemesData, false, OutData, TEXT("ProcessPhonemesSequence"), CancellationToken);
+}
+
+bool UNeuralProcessWrapper::IsUsingCompiledModel(bool bUseLipsyncModel) const
+{
+	return bUseLipsyncModel ? LipsyncCompiledModel.IsValid() : EmotionsCompiledModel.IsValid();
+}
+
+void UNeuralProcessWrapper::GetModelInputRange(int32& OutInputMin, int32& OutInputMax)
+{
+	// see MakeModelInput
+	OutInputMin = ('0' - 'a') * 2 + 1;
+	OutInputMax = ('z' - 'a') * 2 + 2;
+}
+
+bool UNeuralProcessWrapper::CompileTorchModel(bool bUseLipsyncModel, int32& OutInputMin, int32& OutInputsNum, TArray<float>& OutRows)
+{
+	USimpleTorchModule* nnModel = bUseLipsyncModel ? LipsyncNeuralModel : EmotionsNeuralModel;
+	const int32 CurvesNum = bUseLipsyncModel ? NN_LipsyncOutCurves.Num() : NN_EmotionsOutCurves.Num();
+
+	if (!nnModel || !nnModel->IsTorchModelLoaded())
 	{
-		UE_LOG(LogMetaFace, Warning, TEXT("ProcessPhonemesData: model isn't ready"));
+		UE_LOG(LogMetaFace, Warning, TEXT("CompileTorchModel: TorchScript model isn't loaded"));
 		return false;
 	}
-	if (PhonemesData.Num() == 0)
+
+	int32 InputMax;
+	GetModelInputRange(OutInputMin, InputMax);
+	OutInputsNum = InputMax - OutInputMin + 1;
+	OutRows.SetNumZeroed(OutInputsNum * CurvesNum);
+
+	FScopeLock Lock(bUseLipsyncModel ? LipsyncReplicaLocks[0].Get() : EmotionsReplicaLocks[0].Get());
+
+	TArray<float> RowValues;
+	RowValues.SetNumUninitialized(CurvesNum);
+	const int32 InDims[1] = { 1 };
+
+	// Evaluate inputs in direct order, then verify them in reverse order:
+	// output of a stateless model doesn't depend on previous inputs
+	for (int32 Pass = 0; Pass < 2; Pass++)
 	{
-		UE_LOG(LogMetaFace, Warning, TEXT("PhonemesData is empty. Enable it in Project Settings > [Plugins] Ynnk Lip-sync > Generate Phonemes Data"));
-		return false;
-	}
+		for (int32 Index = 0; Index < OutInputsNum; Index++)
+		{
+			const int32 Row = (Pass == 0) ? Index : OutInputsNum - 1 - Index;
+			const float Symbol = (float)(OutInputMin + Row);
 
-	bProcessingModel1 = true;
+			if (nnModel->ExecuteModelMethodRaw("eval_compute", &Symbol, InDims, 1, RowValues.GetData(), RowValues.Num()) != CurvesNum)
+			{
+				UE_LOG(LogMetaFace, Warning, TEXT("CompileTorchModel: unable to evaluate model for input %d"), OutInputMin + Row);
+				return false;
+			}
 
-	const auto& CurvesSet = bUseLipsyncModel
-		? NN_LipsyncOutCurves
-		: NN_EmotionsOutCurves;
-	auto& nnModel = bUseLipsyncModel
-		? LipsyncNeuralModel
-		: EmotionsNeuralModel;
-	/*
-	auto& InTensor = bUseLipsyncModel
-		? LipsyncInData
-		: EmotionsInData;
-	auto& OutTensor = bUseLipsyncModel
-		? LipsyncOutData
-		: EmotionsOutData;
-	*/
-	FSimpleTorchTensor InTensor, OutTensor;
-	InTensor.Create({ 1 });
-	OutTensor.Create({ 1, CurvesSet.Num() });
-
-	FScopeLock Lock(&NeuralWrapMutex1);
+			const float* RawData = RowValues.GetData();
+			float* RowData = OutRows.GetData() + Row * CurvesNum;
+			for (int32 n = 0; n < CurvesNum; n++)
+			{
+				if (Pass == 0)
+				{
+					RowData[n] = RawData[n];
+				}
+				else if (!FMath::IsNearlyEqual(RowData[n], RawData[n], KINDA_SMALL_NUMBER))
+				{
+					UE_LOG(LogMetaFace, Warning, TEXT("CompileTorchModel: model output isn't repeatable for input %d, it can't be compiled"), OutInputMin + Row);
+					return false;
+				}
+			}
+		}
+	}
 
-	const ANSICHAR cFirst = 'a', cLast = 'z';
-	const ANSICHAR c0 = '0', c9 = '9';
+	return true;
+}
 
-	// don't mirror curves
-	bool bMirrorLeftToRight = false;
+void UNeuralProcessWrapper::CreateModelReplicas(bool bUseLipsyncModel)
+{
+	auto& Replicas = bUseLipsyncModel ? LipsyncReplicas : EmotionsReplicas;
+	auto& Locks = bUseLipsyncModel ? LipsyncReplicaLocks : EmotionsReplicaLocks;
+	const FString& ModelFile = bUseLipsyncModel ? LipsyncModelFile : EmotionsModelFile;
+	const int32 ReplicasNum = FMath::Max(GetDefault<UYnnkMetaFaceSettings>()->NeuralModelReplicas, 1);
 
-	// create curves
-	for (const auto& ColumnName : CurvesSet)
+	while (Replicas.Num() < ReplicasNum)
 	{
-		FString szCurveName = ColumnName.ToString();
-		OutData.Add(ColumnName);
-
-		// mirror right curves
-		if (bMirrorLeftToRight && szCurveName.Left(5) == TEXT("Mouth") && szCurveName.Right(4) == TEXT("Left"))
+		USimpleTorchModule* Replica = CreateTorchModule();
+		if (!Replica || !Replica->LoadTorchScriptModel(ModelFile))
 		{
-			szCurveName = szCurveName.LeftChop(4) + TEXT("Right");
-			OutData.Add(*szCurveName);
+			UE_LOG(LogMetaFace, Warning, TEXT("Unable to create replica of torch jit model (%s)"), *ModelFile);
+			break;
 		}
+		// Replicas can be loaded in background thread (InitializeAsync)
+		FGCScopeGuard GCGuard;
+		Replicas.Add(Replica);
+		Locks.Add(MakeShared<FCriticalSection>());
 	}
+}
 
-	// Compute floats
-	int32 DebugCounter = 0;
-	for (const auto& Phoneme : PhonemesData)
+int32 UNeuralProcessWrapper::AcquireModelReplica(bool bUseLipsyncModel, const FMetaFaceCancellationToken* CancellationToken)
+{
+	auto& Locks = bUseLipsyncModel ? LipsyncReplicaLocks : EmotionsReplicaLocks;
+	if (Locks.Num() == 0)
 	{
-		DebugCounter++;
+		return INDEX_NONE;
+	}
 
-		if (Phoneme.Symbol.Len() != 1)
+	// Start from different replicas to spread requests
+	const int32 FirstIndex = (uint32)ReplicaCounter.Increment() % (uint32)Locks.Num();
+	for (int32 i = 0; i < Locks.Num(); i++)
+	{
+		const int32 Index = (FirstIndex + i) % Locks.Num();
+		if (Locks[Index]->TryLock())
 		{
-			UE_LOG(LogMetaFace, Log, TEXT("ProcessPhonemesData: invalid symbol \"%s\""), *Phoneme.Symbol);
-			bProcessingModel1 = false;
-			return false;
+			return Index;
 		}
+	}
 
-		ANSICHAR ansi[16];
-		ansi[0] = StringCast<ANSICHAR>(*Phoneme.Symbol).Get()[0];
-		if (!(ansi[0] >= cFirst && ansi[0] <= cLast) && !(ansi[0] >= c0 && ansi[0] <= c9))
+	// All replicas are busy: wait until one is released. Cancellable request wakes up to check its token.
+	FEvent* ReplicaReleased = bUseLipsyncModel ? LipsyncReplicaReleased : EmotionsReplicaReleased;
+	while (!IsRequestCancelled(CancellationToken))
+	{
+		if (CancellationToken)
 		{
-			UE_LOG(LogMetaFace, Log, TEXT("ProcessPhonemesData can't read phoneme data: \"%s\""), *Phoneme.Symbol);
-			//bProcessingModel1 = false;
-			//return false;
-			continue;
+			ReplicaReleased->Wait(ReplicaCancellationPollMs);
 		}
-
-		int32 SymbolNum = (ansi[0] - cFirst) * 2 + 1;
-		bool bNewWordStarted = Phoneme.bWordStart;
-		if (bNewWordStarted) { SymbolNum++; }
-		InTensor[0] = (float)SymbolNum;
-
-		// single-symbol evaluation
-		if (!nnModel)
+		else
 		{
-			UE_LOG(LogMetaFace, Log, TEXT("Invalid nnModel"));
-			bProcessingModel1 = false;
-			return false;
+			ReplicaReleased->Wait();
 		}
-
-		//FScopeLock Lock(&CritSectionObject);
-
-		bool bResult = nnModel->ExecuteModelMethod(TEXT("eval_compute"), InTensor, OutTensor);
-		if (!bResult || !bProcessingModel1)
+		for (int32 i = 0; i < Locks.Num(); i++)
 		{
-			bProcessingModel1 = false;
-			return false;
+			const int32 Index = (FirstIndex + i) % Locks.Num();
+			if (Locks[Index]->TryLock())
+			{
+				// Pass wake-up to the next waiting request: two releases may be merged into a single trigger
+				ReplicaReleased->Trigger();
+				return Index;
+			}
 		}
+	}
+	return INDEX_NONE;
+}
 
-		check(OutTensor.GetDataSize() == CurvesSet.Num());
+void UNeuralProcessWrapper::ReleaseModelReplica(bool bUseLipsyncModel, int32 ReplicaIndex)
+{
+	auto& Locks = bUseLipsyncModel ? LipsyncReplicaLocks : EmotionsReplicaLocks;
+	Locks[ReplicaIndex]->Unlock();
+	// Auto-reset event wakes one waiting request (or the next one to wait, if nobody waits now)
+	(bUseLipsyncModel ? LipsyncReplicaReleased : EmotionsReplicaReleased)->Trigger();
+}
 
-		for (int32 n = 0; n < CurvesSet.Num(); n++)
-		{
-			const FName& CurveName = CurvesSet[n];
+FString UNeuralProcessWrapper::GetModelFile(bool bUseLipsyncModel) const
+{
+	const FString ResourcesPath = GetResourcesPath();
+	const TCHAR* ModelName = bUseLipsyncModel ? TEXT("ynnklipsync") : TEXT("ynnkemotions_en");
 
-			TArray<int32> Dims = OutTensor.GetDimensions();
-			if (Dims.Num() < 2) Dims.SetNum(2);
+	FString FileName = ResourcesPath / ModelName + TEXT(".tmod");
+	if (!FPaths::FileExists(FileName))
+	{
+		FileName = ResourcesPath / ModelName + TEXT("_editor.tmod");
+	}
+	return FileName;
+}
 
-			FSimpleTorchTensor t;
-			t.CreateAsChild(&OutTensor, { 0, n });
-			// get NN value
-			float val = FMath::Clamp(t.Item(), -1.f, 1.f);
-			OutData[CurveName].Add(val);
+FString UNeuralProcessWrapper::GetLookupTableCacheFile(const FString& ModelFile)
+{
+	return FPaths::ProjectSavedDir() / TEXT("YnnkMetaFace") / FPaths::GetBaseFilename(ModelFile) + TEXT(".mfcm");
+}
 
-			// mirror right curves
-			FString szCurveName = CurveName.ToString();
-			if (bMirrorLeftToRight && szCurveName.Left(5) == TEXT("Mouth") && szCurveName.Right(4) == TEXT("Left"))
-			{
-				szCurveName = szCurveName.LeftChop(4) + TEXT("Right");
-				OutData[*szCurveName].Add(val);
-			}
+bool UNeuralProcessWrapper::LoadLookupTable(bool bUseLipsyncModel)
+{
+	FMetaFaceCompiledModel& CompiledModel = bUseLipsyncModel ? LipsyncCompiledModel : EmotionsCompiledModel;
+	const int32 CurvesNum = GetCurvesNum(bUseLipsyncModel);
+	const FString ModelFile = GetModelFile(bUseLipsyncModel);
+	// Without model file there is nothing to be outdated against
+	const FMetaFaceModelSignature ModelSignature = FMetaFaceModelSignature::FromFile(ModelFile);
+
+	// Table exported with the plugin, then table cached by BuildLookupTable. Table is outdated if it's made for another model file.
+	const FString TableFiles[2] =
+	{
+		GetResourcesPath() / (bUseLipsyncModel ? TEXT("ynnklipsync.mfcm") : TEXT("ynnkemotions_en.mfcm")),
+		GetLookupTableCacheFile(ModelFile)
+	};
+	for (const FString& TableFile : TableFiles)
+	{
+		if (FPaths::FileExists(TableFile)
+			&& CompiledModel.LoadFromFile(TableFile, CurvesNum, ModelSignature))
+		{
+			UE_LOG(LogMetaFace, Log, TEXT("Using lookup table %s"), *TableFile);
+			return true;
 		}
 	}
 
-	bProcessingModel1 = false;
-	return true;
+	return false;
 }
 
-bool UNeuralProcessWrapper::ProcessPhonemesData2(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel /* false */, TMap<FName, TArray<float>>& OutData)
+bool UNeuralProcessWrapper::BuildLookupTable(bool bUseLipsyncModel)
 {
-	OutData.Empty();
-
-	// Check NN model
-	if ((bUseLipsyncModel && !bLipsyncModelReady) || (!bUseLipsyncModel && !bEmotionsModelReady))
+	FMetaFaceCompiledModel& CompiledModel = bUseLipsyncModel ? LipsyncCompiledModel : EmotionsCompiledModel;
+	const FString& ModelFile = bUseLipsyncModel ? LipsyncModelFile : EmotionsModelFile;
+	const int32 CurvesNum = GetCurvesNum(bUseLipsyncModel);
+	const FString CacheFile = GetLookupTableCacheFile(ModelFile);
+
+	int32 InputMin, InputsNum;
+	TArray<float> Rows;
+	if (!CompileTorchModel(bUseLipsyncModel, InputMin, InputsNum, Rows))
 	{
-		UE_LOG(LogMetaFace, Warning, TEXT("ProcessPhonemesData: model isn't ready"));
+		// Probing may have changed state of the model
+		UE_LOG(LogMetaFace, Log, TEXT("Model %s can't be replaced by lookup table, TorchScript is used"), *FPaths::GetCleanFilename(ModelFile));
+		ReloadTorchModel(bUseLipsyncModel);
 		return false;
 	}
-	if (PhonemesData.Num() == 0)
+
+	if (!CompiledModel.InitFromRows(InputMin, InputsNum, CurvesNum, Rows))
 	{
-		UE_LOG(LogMetaFace, Warning, TEXT("PhonemesData is empty. Enable it in Project Settings > [Plugins] Ynnk Lip-sync > Generate Phonemes Data"));
 		return false;
 	}
 
-	bProcessingModel2 = true;
+	if (!FMetaFaceCompiledModel::SaveToFile(CacheFile, InputMin, InputsNum, CurvesNum, Rows, FMetaFaceModelSignature::FromFile(ModelFile)))
+	{
+		UE_LOG(LogMetaFace, Log, TEXT("Unable to save lookup table cache (%s)"), *CacheFile);
+	}
 
-	const auto& CurvesSet = NN_EmotionsOutCurves;
-	auto& nnModel = EmotionsNeuralModel;
-	/*
-	auto& InTensor = EmotionsInData;
-	auto& OutTensor = EmotionsOutData;
-	*/
-	FSimpleTorchTensor InTensor, OutTensor;
-	InTensor.Create({ 1 });
-	OutTensor.Create({ 1, CurvesSet.Num() });
-	
-	FScopeLock Lock(&NeuralWrapMutex2);
+	UE_LOG(LogMetaFace, Log, TEXT("Model %s is replaced by lookup table"), *FPaths::GetCleanFilename(ModelFile));
+	return true;
+}
 
-	const ANSICHAR cFirst = 'a', cLast = 'z';
-	const ANSICHAR c0 = '0', c9 = '9';
+bool UNeuralProcessWrapper::InitializeLookupTable(bool bUseLipsyncModel, int32 InputMin, int32 InputsNum, const TArray<float>& Rows)
+{
+	FMetaFaceCompiledModel& CompiledModel = bUseLipsyncModel ? LipsyncCompiledModel : EmotionsCompiledModel;
+	if (!CompiledModel.InitFromRows(InputMin, InputsNum, GetCurvesNum(bUseLipsyncModel), Rows))
+	{
+		return false;
+	}
+	(bUseLipsyncModel ? bLipsyncModelReady : bEmotionsModelReady) = true;
+	return true;
+}
 
-	// don't mirror curves
-	bool bMirrorLeftToRight = false;
+bool UNeuralProcessWrapper::ProbeSequenceInput(bool bUseLipsyncModel)
+{
+	USimpleTorchModule* nnModel = bUseLipsyncModel ? LipsyncNeuralModel : EmotionsNeuralModel;
+	const FString& ModelFile = bUseLipsyncModel ? LipsyncModelFile : EmotionsModelFile;
+	const int32 CurvesNum = GetCurvesNum(bUseLipsyncModel);
+
+	// Output for a sequence can only match per-phoneme output if model is stateless
+	int32 InputMin, InputsNum;
+	TArray<float> Rows;
+	if (!CompileTorchModel(bUseLipsyncModel, InputMin, InputsNum, Rows))
+	{
+		UE_LOG(LogMetaFace, Log, TEXT("Model %s isn't stateless, phonemes are evaluated one by one"), *FPaths::GetCleanFilename(ModelFile));
+		ReloadTorchModel(bUseLipsyncModel);
+		return false;
+	}
 
-	// create curves
-	for (const auto& ColumnName : CurvesSet)
+	// All inputs in a single call (in reverse order) should give the same rows as calls per input
+	TArray<float> Symbols, Values;
+	Symbols.SetNumUninitialized(InputsNum);
+	for (int32 i = 0; i < InputsNum; i++)
 	{
-		FString szCurveName = ColumnName.ToString();
-		OutData.Add(ColumnName);
+		Symbols[i] = (float)(InputMin + InputsNum - 1 - i);
+	}
+	Values.SetNumUninitialized(InputsNum * CurvesNum);
 
-		// mirror right curves
-		if (bMirrorLeftToRight && szCurveName.Left(5) == TEXT("Mouth") && szCurveName.Right(4) == TEXT("Left"))
+	bool bResult;
+	{
+		FScopeLock Lock(bUseLipsyncModel ? LipsyncReplicaLocks[0].Get() : EmotionsReplicaLocks[0].Get());
+		const int32 InDims[1] = { InputsNum };
+		bResult = (nnModel->ExecuteModelMethodRaw("eval_compute", Symbols.GetData(), InDims, 1, Values.GetData(), Values.Num()) == Values.Num());
+	}
+	for (int32 i = 0; i < InputsNum && bResult; i++)
+	{
+		const float* SequenceRow = Values.GetData() + i * CurvesNum;
+		const float* Row = Rows.GetData() + (InputsNum - 1 - i) * CurvesNum;
+		for (int32 n = 0; n < CurvesNum; n++)
 		{
-			szCurveName = szCurveName.LeftChop(4) + TEXT("Right");
-			OutData.Add(*szCurveName);
+			if (!FMath::IsNearlyEqual(SequenceRow[n], Row[n], KINDA_SMALL_NUMBER))
+			{
+				bResult = false;
+				break;
+			}
 		}
 	}
 
-	// Compute floats
-	int32 DebugCounter = 0.f;
-	for (const auto& Phoneme : PhonemesData)
+	if (!bResult)
 	{
-		DebugCounter++;
+		UE_LOG(LogMetaFace, Log, TEXT("Model %s: sequence output doesn't match per-phoneme output, phonemes are evaluated one by one"), *FPaths::GetCleanFilename(ModelFile));
+		ReloadTorchModel(bUseLipsyncModel);
+		return false;
+	}
 
+	UE_LOG(LogMetaFace, Log, TEXT("Model %s: phrase is evaluated in a single call"), *FPaths::GetCleanFilename(ModelFile));
+	return true;
+}
+
+bool UNeuralProcessWrapper::ReloadTorchModel(bool bUseLipsyncModel)
+{
+	USimpleTorchModule* nnModel = bUseLipsyncModel ? LipsyncNeuralModel : EmotionsNeuralModel;
+	const FString& ModelFile = bUseLipsyncModel ? LipsyncModelFile : EmotionsModelFile;
+
+	// Wrapper library can't unload models, previous instance stays in memory until exit
+	FScopeLock Lock(bUseLipsyncModel ? LipsyncReplicaLocks[0].Get() : EmotionsReplicaLocks[0].Get());
+	if (!nnModel->LoadTorchScriptModel(ModelFile))
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("Unable to reload torch jit model from file (%s)"), *ModelFile);
+		(bUseLipsyncModel ? bLipsyncModelReady : bEmotionsModelReady) = false;
+		return false;
+	}
+	return true;
+}
+
+bool UNeuralProcessWrapper::MakeModelInput(const TArray<FPhonemeTextData>& PhonemesData, TArray<float>& OutSymbols, const TCHAR* CallerName) const
+{
+	const ANSICHAR cFirst = 'a', cLast = 'z';
+	const ANSICHAR c0 = '0', c9 = '9';
+
+	OutSymbols.Reset(PhonemesData.Num());
+	for (const auto& Phoneme : PhonemesData)
+	{
 		if (Phoneme.Symbol.Len() != 1)
 		{
-			UE_LOG(LogMetaFace, Log, TEXT("ProcessPhonemesData2: invalid symbol \"%s\""), *Phoneme.Symbol);
-			bProcessingModel2 = false;
+			UE_LOG(LogMetaFace, Log, TEXT("%s: invalid symbol \"%s\""), CallerName, *Phoneme.Symbol);
 			return false;
 		}
+
 		ANSICHAR ansi[16];
 		ansi[0] = StringCast<ANSICHAR>(*Phoneme.Symbol).Get()[0];
 		if (!(ansi[0] >= cFirst && ansi[0] <= cLast) && !(ansi[0] >= c0 && ansi[0] <= c9))
 		{
 			UE_LOG(LogMetaFace, Log, TEXT("ProcessPhonemesData can't read phoneme data: \"%s\""), *Phoneme.Symbol);
-			//bProcessingModel2 = false;
-			//return false;
 			continue;
 		}
 
 		int32 SymbolNum = (ansi[0] - cFirst) * 2 + 1;
-		bool bNewWordStarted = Phoneme.bWordStart;
-		if (bNewWordStarted) { SymbolNum++; }
-		InTensor[0] = (float)SymbolNum;
+		if (Phoneme.bWordStart) { SymbolNum++; }
+		OutSymbols.Add((float)SymbolNum);
+	}
+
+	return true;
+}
+
+bool UNeuralProcessWrapper::ProcessPhonemesInternal(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData, const TCHAR* CallerName, const FMetaFaceCancellationToken* CancellationToken)
+{
+	// Check NN model
+	if ((bUseLipsyncModel && !bLipsyncModelReady) || (!bUseLipsyncModel && !bEmotionsModelReady))
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("%s: model isn't ready"), CallerName);
+		OutData.Empty();
+		return false;
+	}
+	if (PhonemesData.Num() == 0)
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("PhonemesData is empty. Enable it in Project Settings > [Plugins] Ynnk Lip-sync > Generate Phonemes Data"));
+		OutData.Empty();
+		return false;
+	}
+
+	// Scratch buffers are reused by the calling thread: a phrase doesn't allocate memory after the first call
+	static thread_local TArray<float> Symbols;
+	static thread_local TArray<float> Values;
+
+	if (!MakeModelInput(PhonemesData, Symbols, CallerName)
+		|| !EvaluateSymbols(bUseLipsyncModel, Symbols, Values, CallerName, CancellationToken))
+	{
+		OutData.Empty();
+		return false;
+	}
 
-		// single-symbol evaluation
-		if (!nnModel)
+	ScatterValues(bUseLipsyncModel, Values.GetData(), Symbols.Num(), OutData);
+	return true;
+}
+
+bool UNeuralProcessWrapper::EvaluateSymbols(bool bUseLipsyncModel, const TArray<float>& Symbols, TArray<float>& OutValues, const TCHAR* CallerName, const FMetaFaceCancellationToken* CancellationToken)
+{
+	const bool bSequenceInput = bUseLipsyncModel
+		? bLipsyncSequenceInput
+		: bEmotionsSequenceInput;
+	const FMetaFaceCompiledModel& CompiledModel = bUseLipsyncModel
+		? LipsyncCompiledModel
+		: EmotionsCompiledModel;
+	const int32 CurvesNum = GetCurvesNum(bUseLipsyncModel);
+	const int32 SymbolsNum = Symbols.Num();
+
+	if (IsRequestCancelled(CancellationToken))
+	{
+		return false;
+	}
+
+	OutValues.Reset(SymbolsNum * CurvesNum);
+	OutValues.AddUninitialized(SymbolsNum * CurvesNum);
+
+	// Compiled model: no torch calls, no lock
+	if (CompiledModel.IsValid())
+	{
+		return CompiledModel.Evaluate(Symbols.GetData(), SymbolsNum, OutValues.GetData());
+	}
+
+	// Checked after every model call
+	const int32 InterruptState = InterruptCounter.GetValue();
+	auto IsInterrupted = [this, InterruptState, CancellationToken]()
+	{
+		return InterruptCounter.GetValue() != InterruptState || IsRequestCancelled(CancellationToken);
+	};
+
+	// single-symbol evaluation
+	const int32 ReplicaIndex = AcquireModelReplica(bUseLipsyncModel, CancellationToken);
+	if (ReplicaIndex == INDEX_NONE)
+	{
+		if (!IsRequestCancelled(CancellationToken))
 		{
 			UE_LOG(LogMetaFace, Log, TEXT("Invalid nnModel"));
-			bProcessingModel2 = false;
-			return false;
 		}
+		return false;
+	}
+	ON_SCOPE_EXIT
+	{
+		ReleaseModelReplica(bUseLipsyncModel, ReplicaIndex);
+	};
+	USimpleTorchModule* nnModel = bUseLipsyncModel
+		? LipsyncReplicas[ReplicaIndex]
+		: EmotionsReplicas[ReplicaIndex];
+	if (IsInterrupted())
+	{
+		return false;
+	}
 
-		bool bResult = nnModel->ExecuteModelMethod(TEXT("eval_compute"), InTensor, OutTensor);
-		if (!bResult || !bProcessingModel2)
+	// Compute floats: phrase in calls of up to MaxSymbolsPerCall inputs, model writes directly to OutValues
+	int32 EvaluatedNum = 0;
+	if (bSequenceInput && SymbolsNum > 1)
+	{
+		while (EvaluatedNum < SymbolsNum)
 		{
-			bProcessingModel2 = false;
-			return false;
+			const int32 ChunkNum = FMath::Min(SymbolsNum - EvaluatedNum, MaxSymbolsPerCall);
+			const int32 InDims[1] = { ChunkNum };
+			const int32 Written = nnModel->ExecuteModelMethodRaw("eval_compute", Symbols.GetData() + EvaluatedNum, InDims, 1,
+				OutValues.GetData() + EvaluatedNum * CurvesNum, ChunkNum * CurvesNum);
+			if (IsInterrupted())
+			{
+				return false;
+			}
+			if (Written != ChunkNum * CurvesNum)
+			{
+				// Shared flag isn't changed by requests: only this request falls back
+				UE_LOG(LogMetaFace, Log, TEXT("%s: sequence call failed, evaluating phonemes one by one"), CallerName);
+				break;
+			}
+			EvaluatedNum += ChunkNum;
 		}
+	}
 
-		check(OutTensor.GetDataSize() == CurvesSet.Num());
-
-		for (int32 n = 0; n < CurvesSet.Num(); n++)
+	// Compute floats: one call per phoneme
+	const int32 InDims[1] = { 1 };
+	for (int32 i = EvaluatedNum; i < SymbolsNum; i++)
+	{
+		float* RowData = OutValues.GetData() + i * CurvesNum;
+		const int32 Written = nnModel->ExecuteModelMethodRaw("eval_compute", Symbols.GetData() + i, InDims, 1, RowData, CurvesNum);
+		if (Written != CurvesNum || IsInterrupted())
 		{
-			const FName& CurveName = CurvesSet[n];
+			return false;
+		}
+	}
+	ClampValues(OutValues.GetData(), OutValues.Num());
 
-			TArray<int32> Dims = OutTensor.GetDimensions();
-			if (Dims.Num() < 2) Dims.SetNum(2);
+	return true;
+}
 
-			FSimpleTorchTensor t;
-			t.CreateAsChild(&OutTensor, { 0, n });
-			// get NN value
-			float val = FMath::Clamp(t.Item(), -1.f, 1.f);
-			OutData[CurveName].Add(val);
+void UNeuralProcessWrapper::ClampValues(float* Values, int32 Num)
+{
+	for (int32 i = 0; i < Num; i++)
+	{
+		Values[i] = FMath::Clamp(Values[i], -1.f, 1.f);
+	}
+}
 
-			// mirror right curves
-			FString szCurveName = CurveName.ToString();
-			if (bMirrorLeftToRight && szCurveName.Left(5) == TEXT("Mouth") && szCurveName.Right(4) == TEXT("Left"))
-			{
-				szCurveName = szCurveName.LeftChop(4) + TEXT("Right");
-				OutData[*szCurveName].Add(val);
-			}
+void UNeuralProcessWrapper::ScatterValues(bool bUseLipsyncModel, const float* Values, int32 SymbolsNum, TMap<FName, TArray<float>>& OutData) const
+{
+	const auto& CurvesSet = bUseLipsyncModel
+		? NN_LipsyncOutCurves
+		: NN_EmotionsOutCurves;
+	const int32 CurvesNum = CurvesSet.Num();
+
+	// Keep arrays of the previous request to avoid allocations
+	if (OutData.Num() != CurvesNum)
+	{
+		OutData.Empty(CurvesNum);
+	}
+	for (int32 n = 0; n < CurvesNum; n++)
+	{
+		TArray<float>& Curve = OutData.FindOrAdd(CurvesSet[n]);
+		Curve.Reset(SymbolsNum);
+		Curve.AddUninitialized(SymbolsNum);
+		for (int32 i = 0; i < SymbolsNum; i++)
+		{
+			Curve[i] = Values[i * CurvesNum + n];
 		}
 	}
-
-	bProcessingModel2 = false;
-	return true;
 }
 
 FString UNeuralProcessWrapper::GetResourcesPath() const
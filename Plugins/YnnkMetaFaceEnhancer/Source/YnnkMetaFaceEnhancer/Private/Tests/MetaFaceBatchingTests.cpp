@@ -0,0 +1,97 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Async/Async.h"
+#include "Math/RandomStream.h"
+#include "UObject/Package.h"
+#include "NeuralProcessWrapper.h"
+#include "MetaFaceInferenceService.h"
+#include "MetaFaceBenchmarkCommandlet.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceBatchedLookupTablesTest, "YnnkMetaFace.Inference.BatchedLookupTables",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+/**
+* Parallel callers send requests to inference service for models evaluated by lookup tables, settings aren't changed.
+* Every request should be evaluated by the batched path and get the same output as a request to the wrapper.
+*/
+bool FMetaFaceBatchedLookupTablesTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 CallersNum = 8;
+	constexpr int32 RequestsPerCaller = 16;
+	constexpr int32 PhrasesNum = 4;
+	FRandomStream Random(1);
+
+	// Separate wrapper with random lookup tables: doesn't depend on models of the module
+	UNeuralProcessWrapper* Wrapper = NewObject<UNeuralProcessWrapper>(GetTransientPackage());
+	int32 InputMin, InputMax;
+	UNeuralProcessWrapper::GetModelInputRange(InputMin, InputMax);
+	for (const bool bUseLipsyncModel : { true, false })
+	{
+		TArray<float> Rows;
+		Rows.SetNumUninitialized((InputMax - InputMin + 1) * Wrapper->GetCurvesNum(bUseLipsyncModel));
+		for (float& Value : Rows)
+		{
+			Value = Random.FRandRange(-1.f, 1.f);
+		}
+		if (!TestTrue(TEXT("Lookup table is initialized"), Wrapper->InitializeLookupTable(bUseLipsyncModel, InputMin, InputMax - InputMin + 1, Rows)))
+		{
+			Wrapper->MarkAsGarbage();
+			return false;
+		}
+	}
+
+	// Phrases of different length and output of the wrapper for them
+	TArray<TArray<FPhonemeTextData>> Phrases;
+	TArray<RawAnimDataMap> Expected[2];
+	for (int32 Phrase = 0; Phrase < PhrasesNum; Phrase++)
+	{
+		UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(1.f + Phrase * 3.f, 100 + Phrase, Phrases.AddDefaulted_GetRef());
+		for (const bool bUseLipsyncModel : { true, false })
+		{
+			Wrapper->ProcessPhonemesData(Phrases.Last(), bUseLipsyncModel, Expected[bUseLipsyncModel ? 1 : 0].AddDefaulted_GetRef());
+		}
+	}
+
+	int32 Mismatches = 0;
+	{
+		FMetaFaceInferenceService Service(Wrapper);
+		FThreadSafeCounter MismatchesCounter;
+		TArray<TFuture<void>> Callers;
+		for (int32 Caller = 0; Caller < CallersNum; Caller++)
+		{
+			Callers.Add(Async(EAsyncExecution::Thread, [&Service, &Phrases, &Expected, &MismatchesCounter, Caller]()
+			{
+				for (int32 i = 0; i < RequestsPerCaller; i++)
+				{
+					const int32 Phrase = (Caller + i) % PhrasesNum;
+					const bool bUseLipsyncModel = (i % 2) == 0;
+					RawAnimDataMap Data;
+					if (!Service.ProcessPhonemes(Phrases[Phrase], bUseLipsyncModel, Data)
+						|| !Data.OrderIndependentCompareEqual(Expected[bUseLipsyncModel ? 1 : 0][Phrase]))
+					{
+						MismatchesCounter.Increment();
+					}
+				}
+			}));
+		}
+		for (auto& Caller : Callers)
+		{
+			Caller.Wait();
+		}
+		Mismatches = MismatchesCounter.GetValue();
+
+		AddInfo(FString::Printf(TEXT("%d requests in %d batches"), Service.GetBatchedRequestsNum(), Service.GetBatchesNum()));
+		TestEqual(TEXT("Every request is evaluated in batch"), Service.GetBatchedRequestsNum(), CallersNum * RequestsPerCaller);
+	}
+	TestEqual(TEXT("Batched requests failed or differ from requests to wrapper"), Mismatches, 0);
+
+	Wrapper->MarkAsGarbage();
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,171 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "NeuralProcessWrapper.h"
+#include "MetaFaceInferenceService.h"
+#include "MetaFaceCancellationToken.h"
+#include "MetaFaceBenchmarkCommandlet.h"
+#include "MetaFaceTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceBenchmarkPercentileTest, "YnnkMetaFace.Benchmark.Percentile",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FMetaFaceBenchmarkPercentileTest::RunTest(const FString& Parameters)
+{
+	TArray<double> Samples;
+	TestEqual(TEXT("No samples"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 50.0), 0.0);
+
+	Samples = { 7.0 };
+	TestEqual(TEXT("Single sample, p0"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 0.0), 7.0);
+	TestEqual(TEXT("Single sample, p99"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 99.0), 7.0);
+
+	// Nearest rank: ceil(P / 100 * N)-th sample
+	Samples.Reset();
+	for (int32 i = 1; i <= 10; i++)
+	{
+		Samples.Add((double)i);
+	}
+	TestEqual(TEXT("p0"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 0.0), 1.0);
+	TestEqual(TEXT("p50"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 50.0), 5.0);
+	TestEqual(TEXT("p55"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 55.0), 6.0);
+	TestEqual(TEXT("p90"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 90.0), 9.0);
+	TestEqual(TEXT("p99"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 99.0), 10.0);
+	TestEqual(TEXT("p100"), UMetaFaceBenchmarkCommandlet::GetPercentile(Samples, 100.0), 10.0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceBenchmarkDeterminismTest, "YnnkMetaFace.Benchmark.Determinism",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMetaFaceBenchmarkDeterminismTest::RunTest(const FString& Parameters)
+{
+	// The same seed gives the same phrase
+	TArray<FPhonemeTextData> Phrase, PhraseCopy;
+	UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(5.f, 5000, Phrase);
+	UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(5.f, 5000, PhraseCopy);
+	if (!TestTrue(TEXT("Synthetic phrase isn't empty"), Phrase.Num() > 0)
+		|| !TestEqual(TEXT("Synthetic phrase length"), PhraseCopy.Num(), Phrase.Num()))
+	{
+		return false;
+	}
+	for (int32 i = 0; i < Phrase.Num(); i++)
+	{
+		if (Phrase[i].Time != PhraseCopy[i].Time || Phrase[i].Symbol != PhraseCopy[i].Symbol || Phrase[i].bWordStart != PhraseCopy[i].bWordStart)
+		{
+			AddError(FString::Printf(TEXT("Synthetic phrase differs at phoneme %d"), i));
+			return false;
+		}
+	}
+
+	FYnnkMetaFaceEnhancerModule* ModuleMFE = MetaFaceTestHelpers::GetModuleWithModels(*this);
+	if (!ModuleMFE)
+	{
+		return false;
+	}
+
+	for (const bool bUseLipsyncModel : { true, false })
+	{
+		const TCHAR* ModelName = bUseLipsyncModel ? TEXT("lip-sync") : TEXT("emotions");
+		if (!ModuleMFE->GetNeuralProcessor()->IsModelStateless(bUseLipsyncModel))
+		{
+			AddInfo(FString::Printf(TEXT("%s model isn't verified to be stateless, its output depends on previous requests"), ModelName));
+			continue;
+		}
+
+		RawAnimDataMap Output, RepeatedOutput;
+		if (!TestTrue(FString::Printf(TEXT("%s: phrase evaluated"), ModelName), ModuleMFE->ProcessPhonemesData(Phrase, bUseLipsyncModel, Output))
+			|| !TestTrue(FString::Printf(TEXT("%s: phrase evaluated again"), ModelName), ModuleMFE->ProcessPhonemesData(Phrase, bUseLipsyncModel, RepeatedOutput)))
+		{
+			continue;
+		}
+
+		// Golden rows: output for a phoneme in phrase is the output for the same model input evaluated alone
+		TMap<FString, RawAnimDataMap> GoldenRows;
+		for (int32 i = 0; i < Phrase.Num(); i++)
+		{
+			const FString RowKey = Phrase[i].Symbol + (Phrase[i].bWordStart ? TEXT("+") : TEXT(""));
+			RawAnimDataMap* Row = GoldenRows.Find(RowKey);
+			if (!Row)
+			{
+				Row = &GoldenRows.Add(RowKey);
+				if (!ModuleMFE->ProcessPhonemesData({ Phrase[i] }, bUseLipsyncModel, *Row))
+				{
+					AddError(FString::Printf(TEXT("%s: unable to evaluate phoneme \"%s\""), ModelName, *RowKey));
+					return false;
+				}
+			}
+
+			for (const auto& Curve : Output)
+			{
+				const TArray<float>* RepeatedCurve = RepeatedOutput.Find(Curve.Key);
+				const TArray<float>* GoldenCurve = Row->Find(Curve.Key);
+				if (!RepeatedCurve || !GoldenCurve || !Curve.Value.IsValidIndex(i) || !RepeatedCurve->IsValidIndex(i) || GoldenCurve->Num() != 1)
+				{
+					AddError(FString::Printf(TEXT("%s: output of curve %s is incomplete"), ModelName, *Curve.Key.ToString()));
+					return false;
+				}
+				if (Curve.Value[i] != (*RepeatedCurve)[i])
+				{
+					AddError(FString::Printf(TEXT("%s: repeated request differs at phoneme %d, curve %s"), ModelName, i, *Curve.Key.ToString()));
+					return false;
+				}
+				if (!FMath::IsNearlyEqual(Curve.Value[i], (*GoldenCurve)[0], KINDA_SMALL_NUMBER))
+				{
+					AddError(FString::Printf(TEXT("%s: phoneme %d differs from golden row, curve %s: %f vs %f"), ModelName, i, *Curve.Key.ToString(), Curve.Value[i], (*GoldenCurve)[0]));
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceBenchmarkCancelledRequestTest, "YnnkMetaFace.Benchmark.CancelledRequest",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMetaFaceBenchmarkCancelledRequestTest::RunTest(const FString& Parameters)
+{
+	FYnnkMetaFaceEnhancerModule* ModuleMFE = MetaFaceTestHelpers::GetModuleWithModels(*this);
+	if (!ModuleMFE)
+	{
+		return false;
+	}
+	FMetaFaceInferenceService* InferenceService = ModuleMFE->GetInferenceService();
+
+	TArray<FPhonemeTextData> Phrase;
+	UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(5.f, 5000, Phrase);
+
+	// Request cancelled before it's sent fails without output
+	FMetaFaceCancellationTokenPtr Token = MakeShared<FMetaFaceCancellationToken, ESPMode::ThreadSafe>();
+	Token->Cancel();
+	for (const bool bUseLipsyncModel : { true, false })
+	{
+		RawAnimDataMap Output;
+		TestFalse(TEXT("Cancelled request fails"), InferenceService->ProcessPhonemes(Phrase, bUseLipsyncModel, Output, Token));
+		TestEqual(TEXT("Cancelled request has no output"), Output.Num(), 0);
+
+		bool bCallbackCalled = false, bCallbackSuccess = true;
+		InferenceService->Submit(Phrase, bUseLipsyncModel, [&bCallbackCalled, &bCallbackSuccess](bool bSuccess, RawAnimDataMap&& Data)
+		{
+			bCallbackCalled = true;
+			bCallbackSuccess = bSuccess;
+		}, Token);
+		TestTrue(TEXT("Callback of cancelled request is called immediately"), bCallbackCalled);
+		TestFalse(TEXT("Callback of cancelled request reports failure"), bCallbackSuccess);
+	}
+
+	// Other requests aren't affected
+	RawAnimDataMap Output;
+	TestTrue(TEXT("Request without token succeeds after cancelled ones"), InferenceService->ProcessPhonemes(Phrase, true, Output));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
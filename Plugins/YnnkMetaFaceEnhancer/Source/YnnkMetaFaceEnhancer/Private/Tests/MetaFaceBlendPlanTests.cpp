@@ -0,0 +1,127 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+#include "MetaFaceBlendPlan.h"
+#include "MetaFaceCurveRegistry.h"
+#include "MetaFaceTypes.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MetaFaceBlendPlanTests
+{
+	/** Playing animation of two random keys sampled between them */
+	static FMHFacialAnimation MakeAnimation(const TArray<FName>& CurveNames, FRandomStream& Random)
+	{
+		FMetaFaceClip Clip(CurveNames, 2);
+		for (int32 Key = 0; Key < 2; Key++)
+		{
+			float* Row = Clip.AddKey((float)Key);
+			for (int32 Curve = 0; Curve < CurveNames.Num(); Curve++)
+			{
+				Row[Curve] = Random.FRandRange(-1.f, 1.f);
+			}
+		}
+		FMHFacialAnimation Animation;
+		Animation.Initialize(MoveTemp(Clip), false);
+		Animation.Play();
+		Animation.ProcessFrame(0.5f, nullptr);
+		return Animation;
+	}
+
+	/** Mixing of baked frame with map lookups per curve (UYnnkMetaFaceController before FMetaFaceBlendPlan) */
+	static void MixWithLookups(TMap<FName, float>& OutFrame, const TMap<FName, float>& YnnkCurves, const FMHFacialAnimation& Lipsync, const FMHFacialAnimation& FacialAnimation,
+		float YnnkRatio, float LipsyncIntensity, float FacialAnimationIntensity)
+	{
+		const TArray<FName>& LipSyncARCurvesSet = FMetaFaceCurveRegistry::GetCurveSet(true);
+		for (auto& Curve : OutFrame)
+		{
+			Curve.Value = 0.f;
+			float SummAlpha = 0.f;
+			if (const float* Value = YnnkCurves.Find(Curve.Key))
+			{
+				Curve.Value = *Value * YnnkRatio * LipsyncIntensity;
+				SummAlpha = YnnkRatio;
+			}
+			if (const float* Value = Lipsync.AnimationFrame.Find(Curve.Key))
+			{
+				Curve.Value += *Value * (1.f - SummAlpha) * LipsyncIntensity;
+			}
+			if (const float* Value = FacialAnimation.AnimationFrame.Find(Curve.Key))
+			{
+				Curve.Value += *Value * FacialAnimationIntensity;
+			}
+			if (LipSyncARCurvesSet.Contains(Curve.Key))
+			{
+				Curve.Value *= LipsyncIntensity;
+			}
+			Curve.Value = FMath::Clamp(Curve.Value, -1.f, 1.f);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceBlendPlanMatchesLookupsTest, "YnnkMetaFace.BlendPlan.MatchesLookups",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+/**
+* Mix Ynnk, lip-sync and facial animation frames (ARKit and skeleton curves) with FMetaFaceBlendPlan
+* and with map lookups. Plan should be reported as outdated when a source gets another clip.
+*/
+bool FMetaFaceBlendPlanMatchesLookupsTest::RunTest(const FString& Parameters)
+{
+	using namespace MetaFaceBlendPlanTests;
+
+	const float YnnkRatio = 0.25f, LipsyncIntensity = 0.8f, FacialAnimationIntensity = 1.2f;
+	FRandomStream Random(1);
+
+	// ARKit curves and curves converted to skeleton
+	TArray<FName> LipsyncCurves = FMetaFaceCurveRegistry::GetCurveSet(true);
+	TArray<FName> FacialCurves = FMetaFaceCurveRegistry::GetCurveSet(false);
+	for (int32 i = 0; i < 150; i++)
+	{
+		LipsyncCurves.Add(*FString::Printf(TEXT("CTRL_expressions_mouth%d"), i));
+	}
+	for (int32 i = 0; i < 100; i++)
+	{
+		FacialCurves.Add(*FString::Printf(TEXT("CTRL_expressions_brow%d"), i));
+	}
+	FMHFacialAnimation Lipsync = MakeAnimation(LipsyncCurves, Random);
+	const FMHFacialAnimation FacialAnimation = MakeAnimation(FacialCurves, Random);
+
+	TMap<FName, float> YnnkCurves;
+	for (const FName& CurveName : FMetaFaceCurveRegistry::GetCurveSet(true))
+	{
+		YnnkCurves.Add(CurveName, Random.FRandRange(0.f, 1.f));
+	}
+
+	TMap<FName, float> LookupsFrame, PlanFrame;
+	for (const FName& CurveName : LipsyncCurves) LookupsFrame.FindOrAdd(CurveName);
+	for (const FName& CurveName : FacialCurves) LookupsFrame.FindOrAdd(CurveName);
+	PlanFrame = LookupsFrame;
+
+	MixWithLookups(LookupsFrame, YnnkCurves, Lipsync, FacialAnimation, YnnkRatio, LipsyncIntensity, FacialAnimationIntensity);
+
+	FMetaFaceBlendPlan Plan;
+	Plan.Compile(PlanFrame, YnnkCurves, Lipsync, FacialAnimation);
+	if (!TestTrue(TEXT("Compiled plan is evaluated"), Plan.Evaluate(PlanFrame, YnnkCurves, true, Lipsync, FacialAnimation, YnnkRatio, LipsyncIntensity, FacialAnimationIntensity)))
+	{
+		return false;
+	}
+
+	float MaxDifference = 0.f;
+	for (const auto& Curve : LookupsFrame)
+	{
+		MaxDifference = FMath::Max(MaxDifference, FMath::Abs(Curve.Value - PlanFrame[Curve.Key]));
+	}
+	TestTrue(FString::Printf(TEXT("Plan gives the same frame as lookups (max difference %g)"), MaxDifference), MaxDifference <= KINDA_SMALL_NUMBER);
+
+	// New phrase
+	Lipsync = MakeAnimation(LipsyncCurves, Random);
+	TestFalse(TEXT("Plan is outdated after clip is changed"), Plan.Evaluate(PlanFrame, YnnkCurves, true, Lipsync, FacialAnimation, YnnkRatio, LipsyncIntensity, FacialAnimationIntensity));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
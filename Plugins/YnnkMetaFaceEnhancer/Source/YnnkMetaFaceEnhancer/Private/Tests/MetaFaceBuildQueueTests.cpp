@@ -0,0 +1,212 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/Event.h"
+#include "Misc/Timespan.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "MetaFaceBuildQueue.h"
+#include "MetaFaceWorkerPool.h"
+#include "MetaFaceBenchmarkCommandlet.h"
+#include "MetaFaceTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MetaFaceBuildQueueTests
+{
+	/** Holds all threads of worker pool, so the test controls when jobs started by build queue are executed */
+	class FWorkerGate
+	{
+	public:
+		~FWorkerGate() { Open(); }
+
+		/** Queue blocking job for every thread and wait until all threads are blocked (i.e. jobs queued before are finished) */
+		bool Close(FMetaFaceWorkerPool& WorkerPool, double Timeout)
+		{
+			Open();
+			State = MakeShared<FState, ESPMode::ThreadSafe>();
+			const int32 ThreadsNum = WorkerPool.GetThreadsNum();
+			for (int32 i = 0; i < ThreadsNum; i++)
+			{
+				WorkerPool.Launch([State = State, ThreadsNum]()
+				{
+					if (State->ArrivedNum.Increment() == ThreadsNum)
+					{
+						State->AllArrived->Trigger();
+					}
+					State->Released->Wait();
+				});
+			}
+			return State->AllArrived->Wait(FTimespan::FromSeconds(Timeout));
+		}
+
+		void Open()
+		{
+			if (State.IsValid())
+			{
+				State->Released->Trigger();
+				State.Reset();
+			}
+		}
+
+	private:
+		// Shared with blocking jobs, which can outlive the gate
+		struct FState
+		{
+			FThreadSafeCounter ArrivedNum;
+			FEvent* AllArrived = FPlatformProcess::GetSynchEventFromPool(true);
+			FEvent* Released = FPlatformProcess::GetSynchEventFromPool(true);
+			~FState()
+			{
+				FPlatformProcess::ReturnSynchEventToPool(AllArrived);
+				FPlatformProcess::ReturnSynchEventToPool(Released);
+			}
+		};
+		TSharedPtr<FState, ESPMode::ThreadSafe> State;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceBuildQueuePriorityTest, "YnnkMetaFace.BuildQueue.SpeakNowBehindPrefetch",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+/**
+* Queue prefetch phrases (each requested twice) while workers are held by a gate, then request one more phrase to speak now.
+* Jobs are executed in waves: the gate is opened until the started jobs are finished, then results are delivered
+* and the queue starts next jobs. Speak-now request should be built in the first wave after prefetch jobs already
+* given to workers and before other queued prefetch requests. Duplicated requests should share a single build
+* and completed requests should be found in recent results.
+*/
+bool FMetaFaceBuildQueuePriorityTest::RunTest(const FString& Parameters)
+{
+	using namespace MetaFaceBuildQueueTests;
+
+	constexpr int32 DuplicatesNum = 2;
+	constexpr float PhraseDuration = 5.f;
+	constexpr double Timeout = 120.0;
+
+	FYnnkMetaFaceEnhancerModule* ModuleMFE = MetaFaceTestHelpers::GetModuleWithModels(*this);
+	if (!ModuleMFE)
+	{
+		return false;
+	}
+	FMetaFaceWorkerPool& WorkerPool = ModuleMFE->GetWorkerPool();
+	if (WorkerPool.GetThreadsNum() == 0)
+	{
+		AddInfo(TEXT("MetaFace worker pool isn't created, skipped: threads of global pool can't be held"));
+		return true;
+	}
+	FMetaFaceBuildQueue& BuildQueue = ModuleMFE->GetBuildQueue();
+	BuildQueue.Reset();
+	const FMetaFaceGenerationSettings Settings;
+
+	// Prefetch jobs given to workers at once (one worker is kept for speak-now requests, see FMetaFaceBuildQueue::StartJobs)
+	const int32 StartedPrefetchNum = FMath::Max(WorkerPool.GetThreadsNum() - 1, 1);
+	// Some prefetch jobs stay in queue
+	const int32 PrefetchNum = StartedPrefetchNum + 2;
+
+	FWorkerGate Gate;
+	if (!Gate.Close(WorkerPool, Timeout))
+	{
+		AddError(TEXT("Worker pool is busy"));
+		return false;
+	}
+
+	// Results of duplicated requests: [phrase][duplicate]
+	TArray<TArray<FMetaFaceClipPtr>> PrefetchClips;
+	PrefetchClips.SetNum(PrefetchNum);
+	TArray<TArray<FPhonemeTextData>> PrefetchPhrases;
+	PrefetchPhrases.SetNum(PrefetchNum);
+	int32 Wave = 0, PrefetchCompleted = 0, PrefetchSucceeded = 0, LastPrefetchPhrase = INDEX_NONE;
+	// Wave of every completed prefetch request
+	TArray<int32> PrefetchWaves;
+	for (int32 i = 0; i < PrefetchNum; i++)
+	{
+		UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(PhraseDuration, 1000 + i, PrefetchPhrases[i]);
+		for (int32 j = 0; j < DuplicatesNum; j++)
+		{
+			BuildQueue.Submit(PrefetchPhrases[i], true, true, Settings, EMetaFaceBuildPriority::Prefetch,
+				[&PrefetchClips, &PrefetchCompleted, &PrefetchSucceeded, &PrefetchWaves, &Wave, &LastPrefetchPhrase, i](int32, bool bSuccess, FMetaFaceBuildResult&& Result)
+			{
+				PrefetchCompleted++;
+				PrefetchSucceeded += bSuccess ? 1 : 0;
+				PrefetchWaves.Add(Wave);
+				LastPrefetchPhrase = i;
+				PrefetchClips[i].Add(Result.LipSync.GetClip());
+			});
+		}
+	}
+
+	TArray<FPhonemeTextData> PhonemesData;
+	UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(PhraseDuration, 1, PhonemesData);
+	bool bSpeakNowDone = false, bSpeakNowSuccess = false;
+	int32 SpeakNowWave = INDEX_NONE;
+	BuildQueue.Submit(PhonemesData, true, true, Settings, EMetaFaceBuildPriority::SpeakNow,
+		[&bSpeakNowDone, &bSpeakNowSuccess, &SpeakNowWave, &Wave](int32, bool bSuccess, FMetaFaceBuildResult&& Result)
+	{
+		bSpeakNowDone = true;
+		bSpeakNowSuccess = bSuccess;
+		SpeakNowWave = Wave;
+	});
+
+	while (!bSpeakNowDone || PrefetchCompleted < PrefetchNum * DuplicatesNum)
+	{
+		// Every wave completes at least one job
+		if (++Wave > PrefetchNum + 1)
+		{
+			AddError(TEXT("Requests aren't completed"));
+			BuildQueue.Reset();
+			return false;
+		}
+
+		// Started jobs are finished when all workers are at the gate again
+		Gate.Open();
+		if (!Gate.Close(WorkerPool, Timeout))
+		{
+			AddError(TEXT("Requests aren't completed in time"));
+			BuildQueue.Reset();
+			return false;
+		}
+
+		// Results are delivered in game thread, the queue starts next jobs (they wait for the next wave)
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+	}
+	Gate.Open();
+
+	const int32 PrefetchBeforeSpeakNow = PrefetchWaves.FilterByPredicate([SpeakNowWave](int32 PrefetchWave) { return PrefetchWave <= SpeakNowWave; }).Num();
+	AddInfo(FString::Printf(TEXT("%d requests built in %d waves, speak-now request in wave %d"), PrefetchCompleted + 1, Wave, SpeakNowWave));
+	TestTrue(TEXT("Speak-now request succeeds"), bSpeakNowSuccess);
+	TestEqual(TEXT("Prefetch requests succeed"), PrefetchSucceeded, PrefetchNum * DuplicatesNum);
+	TestEqual(TEXT("Speak-now request is built before queued prefetch requests"), PrefetchBeforeSpeakNow, StartedPrefetchNum * DuplicatesNum);
+
+	for (int32 i = 0; i < PrefetchNum; i++)
+	{
+		// Duplicates get copies of a single result
+		if (TestEqual(TEXT("Every duplicated request gets result"), PrefetchClips[i].Num(), DuplicatesNum))
+		{
+			for (int32 j = 1; j < DuplicatesNum; j++)
+			{
+				TestTrue(TEXT("Duplicated requests share the same clip"), PrefetchClips[i][j].IsValid() && PrefetchClips[i][j] == PrefetchClips[i][0]);
+			}
+		}
+	}
+
+	// The last completed phrase is kept in recent results (only for the same settings)
+	FMetaFaceBuildResult RecentResult;
+	if (TestTrue(TEXT("Recently built phrase is found"), BuildQueue.FindResult(PrefetchPhrases[LastPrefetchPhrase], true, true, Settings, RecentResult))
+		&& PrefetchClips[LastPrefetchPhrase].Num() > 0)
+	{
+		TestTrue(TEXT("Recent result shares clip with delivered result"), RecentResult.LipSync.GetClip() == PrefetchClips[LastPrefetchPhrase][0]);
+	}
+	FMetaFaceGenerationSettings OtherSettings;
+	OtherSettings.LipsyncSmoothness = Settings.LipsyncSmoothness + 0.1f;
+	TestFalse(TEXT("Request with other settings isn't found"), BuildQueue.FindResult(PrefetchPhrases[LastPrefetchPhrase], true, true, OtherSettings, RecentResult));
+
+	BuildQueue.Reset();
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,105 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Async/Async.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformProcess.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "YnnkMetaFaceSettings.h"
+#include "NeuralProcessWrapper.h"
+#include "MetaFaceInferenceService.h"
+#include "MetaFaceCancellationToken.h"
+#include "MetaFaceBenchmarkCommandlet.h"
+#include "MetaFaceTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceCancellationBoundTest, "YnnkMetaFace.Inference.CancellationBound",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+/**
+* Parallel requests for a 60 sec phrase, all but the first one are cancelled while they are evaluated (or wait in batch).
+* Cancelled callers must be released within the bound of MetaFaceCancellationToken.h, the first request must succeed.
+* Checked with batching disabled and enabled (a cancelled caller may be the leader of the batch).
+*/
+bool FMetaFaceCancellationBoundTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 RequestsNum = 4;
+	// Thread scheduling isn't part of the bound
+	constexpr double SchedulingSlackMs = 20.0;
+
+	FYnnkMetaFaceEnhancerModule* ModuleMFE = MetaFaceTestHelpers::GetModuleWithModels(*this);
+	if (!ModuleMFE)
+	{
+		return false;
+	}
+	FMetaFaceInferenceService* InferenceService = ModuleMFE->GetInferenceService();
+
+	TArray<FPhonemeTextData> PhonemesData;
+	UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(60.f, 60000, PhonemesData);
+	TArray<FPhonemeTextData> ChunkPhonemes(PhonemesData.GetData(), FMath::Min(PhonemesData.Num(), UNeuralProcessWrapper::MaxSymbolsPerCall));
+
+	UYnnkMetaFaceSettings* Settings = GetMutableDefault<UYnnkMetaFaceSettings>();
+	const float SavedBatchingWindowMs = Settings->BatchingWindowMs;
+
+	for (const float BatchingWindowMs : { 0.f, 5.f })
+	{
+		Settings->BatchingWindowMs = BatchingWindowMs;
+
+		for (const bool bUseLipsyncModel : { true, false })
+		{
+			const FString Context = FString::Printf(TEXT("%s model, batching window %.0f ms"), bUseLipsyncModel ? TEXT("lip-sync") : TEXT("emotions"), BatchingWindowMs);
+
+			// Time of a single model call of MaxSymbolsPerCall phonemes (without other requests)
+			RawAnimDataMap ChunkData;
+			InferenceService->ProcessPhonemes(ChunkPhonemes, bUseLipsyncModel, ChunkData);
+			const double ChunkStartTime = FPlatformTime::Seconds();
+			InferenceService->ProcessPhonemes(ChunkPhonemes, bUseLipsyncModel, ChunkData);
+			const double ChunkCallMs = (FPlatformTime::Seconds() - ChunkStartTime) * 1000.0;
+
+			// Replicas are shared by parallel requests, so the running chunk may be longer than a chunk evaluated alone
+			const double BoundMs = ChunkCallMs * 2.0 + UNeuralProcessWrapper::ReplicaCancellationPollMs + FMetaFaceInferenceService::CancellationPollMs + SchedulingSlackMs;
+
+			TArray<FMetaFaceCancellationTokenPtr> Tokens;
+			TArray<TFuture<double>> Requests;
+			TArray<bool> Results;
+			Results.Init(false, RequestsNum);
+			for (int32 i = 0; i < RequestsNum; i++)
+			{
+				FMetaFaceCancellationTokenPtr Token = MakeShared<FMetaFaceCancellationToken, ESPMode::ThreadSafe>();
+				Tokens.Add(Token);
+				Requests.Add(Async(EAsyncExecution::Thread, [InferenceService, &PhonemesData, &Results, i, Token, bUseLipsyncModel]()
+				{
+					RawAnimDataMap GeneratedData;
+					Results[i] = InferenceService->ProcessPhonemes(PhonemesData, bUseLipsyncModel, GeneratedData, Token);
+					return FPlatformTime::Seconds();
+				}));
+			}
+
+			FPlatformProcess::Sleep(0.02f);
+			const double CancelTime = FPlatformTime::Seconds();
+			for (int32 i = 1; i < RequestsNum; i++)
+			{
+				Tokens[i]->Cancel();
+			}
+
+			for (int32 i = 1; i < RequestsNum; i++)
+			{
+				const double ReleaseMs = FMath::Max(Requests[i].Get() - CancelTime, 0.0) * 1000.0;
+				if (ReleaseMs > BoundMs)
+				{
+					AddError(FString::Printf(TEXT("%s: cancelled caller released in %.3f ms, bound is %.3f ms"), *Context, ReleaseMs, BoundMs));
+				}
+			}
+			Requests[0].Wait();
+			TestTrue(FString::Printf(TEXT("%s: not cancelled request succeeds"), *Context), Results[0]);
+		}
+	}
+
+	Settings->BatchingWindowMs = SavedBatchingWindowMs;
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,72 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "Misc/FileHelper.h"
+#include "HAL/FileManager.h"
+#include "Math/RandomStream.h"
+#include "MetaFaceCompiledModel.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceLookupTableSignatureTest, "YnnkMetaFace.Inference.LookupTableSignature",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+/**
+* Lookup table saved for a model file should be loaded for the same file content whatever file times are,
+* and rejected after the model file is changed (even if its size is the same and the table is newer).
+*/
+bool FMetaFaceLookupTableSignatureTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 InputMin = -3, InputsNum = 8, CurvesNum = 24;
+	const FString Directory = FPaths::AutomationTransientDir() / TEXT("MetaFace");
+	const FString ModelFile = Directory / TEXT("model.tmod");
+	const FString TableFile = Directory / TEXT("model.mfcm");
+	FRandomStream Random(1);
+
+	TArray<uint8> ModelData;
+	ModelData.SetNumUninitialized(4096);
+	for (uint8& Byte : ModelData)
+	{
+		Byte = (uint8)Random.RandRange(0, 255);
+	}
+	TArray<float> Rows;
+	Rows.SetNumUninitialized(InputsNum * CurvesNum);
+	for (float& Value : Rows)
+	{
+		Value = Random.FRandRange(-1.f, 1.f);
+	}
+
+	if (!FFileHelper::SaveArrayToFile(ModelData, *ModelFile)
+		|| !FMetaFaceCompiledModel::SaveToFile(TableFile, InputMin, InputsNum, CurvesNum, Rows, FMetaFaceModelSignature::FromFile(ModelFile)))
+	{
+		AddError(FString::Printf(TEXT("Unable to write test files to %s"), *Directory));
+		return false;
+	}
+
+	// Table is older than model (as after checkout): content is the same, so table is valid
+	IFileManager::Get().SetTimeStamp(*TableFile, FDateTime(2000, 1, 1));
+	FMetaFaceCompiledModel Table;
+	if (TestTrue(TEXT("Table is loaded for the same model file"), Table.LoadFromFile(TableFile, CurvesNum, FMetaFaceModelSignature::FromFile(ModelFile))))
+	{
+		const float Symbol = (float)(InputMin + 5);
+		float Values[CurvesNum];
+		Table.Evaluate(&Symbol, 1, Values);
+		TestTrue(TEXT("Table gives saved rows"), FMemory::Memcmp(Values, Rows.GetData() + 5 * CurvesNum, sizeof(Values)) == 0);
+	}
+
+	// Model is changed, size is the same, table is newer
+	ModelData[ModelData.Num() / 2] ^= 0xFF;
+	FFileHelper::SaveArrayToFile(ModelData, *ModelFile);
+	IFileManager::Get().SetTimeStamp(*TableFile, FDateTime::UtcNow() + FTimespan::FromDays(1.0));
+	TestFalse(TEXT("Table is rejected for changed model file"), Table.LoadFromFile(TableFile, CurvesNum, FMetaFaceModelSignature::FromFile(ModelFile)));
+
+	Table.Reset();
+	IFileManager::Get().Delete(*TableFile);
+	IFileManager::Get().Delete(*ModelFile);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
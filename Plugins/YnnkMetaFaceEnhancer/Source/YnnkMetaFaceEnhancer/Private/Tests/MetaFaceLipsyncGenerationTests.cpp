@@ -0,0 +1,159 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+#include "MetaFaceFunctionLibrary.h"
+#include "MetaFaceCurveRegistry.h"
+#include "MetaFaceTypes.h"
+#include "YnnkMetaFaceSettings.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MetaFaceLipsyncGenerationTests
+{
+	/** Lip-sync value of curve at phoneme with lookups in LipsyncVisemesPreset (generator before FMetaFaceVisemeTable) */
+	static float GetLegacyLipsyncValue(const UYnnkMetaFaceSettings* Settings, const TArray<FPhonemeTextData>& Phonemes, int32 Index, float PlayTime,
+		const FName& CurveName, float RawValue, const FMetaFaceGenerationSettings& MetaFaceSettings)
+	{
+		auto IsClosedViseme = [](EYnnkViseme Viseme)
+		{
+			return Viseme == EYnnkViseme::YV_BMP || Viseme == EYnnkViseme::YV_FV || Viseme == EYnnkViseme::YV_Oh || Viseme == EYnnkViseme::YV_WU;
+		};
+
+		const auto& Phoneme = Phonemes[Index];
+		const EYnnkViseme v = YnnkHelpers::SymbolToViseme(Phoneme.Symbol[0]);
+
+		float val = RawValue;
+		if (Phoneme.bWordStart || (Index + 1 < Phonemes.Num() && Phonemes[Index + 1].bWordStart))
+		{
+			val *= 0.5f;
+		}
+
+		const EYnnkViseme PrevViseme = (Index > 0) ? YnnkHelpers::SymbolToViseme(Phonemes[Index - 1].Symbol[0]) : EYnnkViseme::YV_Max;
+		const EYnnkViseme NextViseme = (Index + 1 < Phonemes.Num()) ? YnnkHelpers::SymbolToViseme(Phonemes[Index + 1].Symbol[0]) : EYnnkViseme::YV_Max;
+		if (IsClosedViseme(PrevViseme) && IsClosedViseme(NextViseme) && Settings->LipsyncVisemesPreset.Contains(PrevViseme) && Settings->LipsyncVisemesPreset.Contains(NextViseme))
+		{
+			val = (Settings->LipsyncVisemesPreset[PrevViseme].Curves[CurveName] + val + Settings->LipsyncVisemesPreset[NextViseme].Curves[CurveName]) / 3.f;
+		}
+		else if (IsClosedViseme(PrevViseme) && Settings->LipsyncVisemesPreset.Contains(PrevViseme))
+		{
+			val = (Settings->LipsyncVisemesPreset[PrevViseme].Curves[CurveName] + val) / 2.f;
+		}
+		else if (IsClosedViseme(NextViseme) && Settings->LipsyncVisemesPreset.Contains(NextViseme))
+		{
+			val = (val + Settings->LipsyncVisemesPreset[NextViseme].Curves[CurveName]) / 2.f;
+		}
+
+		if (const FMetaFacePose* Src = Settings->LipsyncVisemesPreset.Find(v))
+		{
+			if (const float* VisemeValue = Src->Curves.Find(CurveName))
+			{
+				const float ApplyVisemeValue = *VisemeValue * MetaFaceSettings.VisemeApplyAlpha;
+				switch (v)
+				{
+				case EYnnkViseme::YV_BMP:
+					val = ApplyVisemeValue; break;
+				case EYnnkViseme::YV_WU:
+				case EYnnkViseme::YV_Oh:
+					val = FMath::Lerp(ApplyVisemeValue, val, MetaFaceSettings.LipsyncNeuralIntensity * 0.4f); break;
+				default:
+					val = FMath::Lerp(ApplyVisemeValue, val, MetaFaceSettings.LipsyncNeuralIntensity); break;
+				}
+			}
+		}
+
+		if (PlayTime - Phoneme.Time < 0.25f)
+		{
+			val *= (PlayTime - Phoneme.Time) / 0.25f;
+		}
+		return val;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceLipsyncGenerationGoldenTest, "YnnkMetaFace.Generation.LipsyncMatchesPresetLookups",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+/**
+* Generate lip-sync for repeated warm-up phrase from random model output. With smoothing disabled, phoneme keys
+* of the clip built by RawDataToLipsync (dense viseme table) should be bit-identical to per-curve lookups in viseme presets.
+*/
+bool FMetaFaceLipsyncGenerationGoldenTest::RunTest(const FString& Parameters)
+{
+	using namespace MetaFaceLipsyncGenerationTests;
+
+	constexpr int32 Repeats = 3;
+	const UYnnkMetaFaceSettings* Settings = GetDefault<UYnnkMetaFaceSettings>();
+	FRandomStream Random(1);
+
+	TArray<FPhonemeTextData> Phrase, Phonemes;
+	UMFFunctionLibrary::GetWarmUpPhonemes(Phrase);
+	const float PhraseDuration = Phrase.Last().Time + 0.5f;
+	for (int32 Repeat = 0; Repeat < Repeats; Repeat++)
+	{
+		for (const FPhonemeTextData& Phoneme : Phrase)
+		{
+			FPhonemeTextData& NewPhoneme = Phonemes.Add_GetRef(Phoneme);
+			NewPhoneme.Time += Repeat * PhraseDuration;
+		}
+	}
+	const int32 PhonemesNum = Phonemes.Num();
+
+	RawAnimDataMap RawData;
+	for (const FName& CurveName : FMetaFaceCurveRegistry::GetCurveSet(true))
+	{
+		TArray<float>& Values = RawData.Add(CurveName);
+		Values.SetNumUninitialized(PhonemesNum);
+		for (float& Value : Values)
+		{
+			Value = Random.FRandRange(0.f, 1.f);
+		}
+	}
+
+	FMetaFaceGenerationSettings GenerationSettings;
+	GenerationSettings.VisemeApplyAlpha = 0.6f;
+	GenerationSettings.LipsyncNeuralIntensity = 0.7f;
+	GenerationSettings.LipsyncSmoothness = 0.f;
+	const float PlayTime = Phonemes.Last().Time + 0.05f;
+
+	FMetaFaceClip Clip;
+	UMFFunctionLibrary::RawDataToLipsync(Phonemes, RawData, Clip, GenerationSettings);
+	if (!TestEqual(TEXT("Clip has all curves"), Clip.GetCurvesNum(), RawData.Num()))
+	{
+		return false;
+	}
+
+	// Phoneme keys of clip (curves of clip are in the order of RawData)
+	int32 Mismatches = 0;
+	float MaxDifference = 0.f;
+	int32 Key = 0;
+	for (int32 Index = 0; Index < PhonemesNum; Index++)
+	{
+		while (Key < Clip.GetKeysNum() && Clip.GetTime(Key) != Phonemes[Index].Time)
+		{
+			Key++;
+		}
+		if (Key == Clip.GetKeysNum())
+		{
+			AddError(FString::Printf(TEXT("Key of phoneme %d isn't found"), Index));
+			return false;
+		}
+		int32 Curve = 0;
+		for (const auto& RawCurve : RawData)
+		{
+			const float Reference = GetLegacyLipsyncValue(Settings, Phonemes, Index, PlayTime, RawCurve.Key, RawCurve.Value[Index], GenerationSettings);
+			const float Value = Clip.GetValue(Key, Curve++);
+			if (FMemory::Memcmp(&Reference, &Value, sizeof(float)) != 0)
+			{
+				Mismatches++;
+				MaxDifference = FMath::Max(MaxDifference, FMath::Abs(Reference - Value));
+			}
+		}
+	}
+
+	TestEqual(FString::Printf(TEXT("Mismatched values (max difference %g)"), MaxDifference), Mismatches, 0);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
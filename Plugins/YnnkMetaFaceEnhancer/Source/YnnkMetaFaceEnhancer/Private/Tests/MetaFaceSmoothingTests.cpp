@@ -0,0 +1,155 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+#include "MetaFaceSmoothing.h"
+#include "MetaFaceCurveRegistry.h"
+#include "MetaFaceTypes.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MetaFaceSmoothingTests
+{
+	/** Smoothing loops of RawDataToLipsync (Flags != nullptr) and RawDataToFacialAnimation before FMetaFaceSmoothing */
+	static void LegacySmooth(FMetaFaceClip& Clip, float Smoothness, const uint8* Flags)
+	{
+		const int32 Num = Clip.GetKeysNum();
+		const int32 CurvesNum = Clip.GetCurvesNum();
+		if (Flags)
+		{
+			const float RichSmoothness = Smoothness * 0.15f;
+			for (int32 n = 0; n < 2; n++)
+			{
+				for (int32 i = 2; i < Num - 2; i++)
+				{
+					const float* PrevRow = Clip.GetKey(i - 1);
+					float* Row = Clip.GetKey(i);
+					const float* NextRow = Clip.GetKey(i + 1);
+					const uint8* RowFlags = Flags + i * CurvesNum;
+					for (int32 Curve = 0; Curve < CurvesNum; Curve++)
+					{
+						float NewVal = (PrevRow[Curve] + Row[Curve] + NextRow[Curve]) / 3.f;
+						Row[Curve] = FMath::Lerp(Row[Curve], NewVal, (RowFlags[Curve] & CURVEFLAG_RICH) ? RichSmoothness : Smoothness);
+					}
+				}
+			}
+			return;
+		}
+
+		TArray<bool> BrowCurves;
+		BrowCurves.SetNumUninitialized(CurvesNum);
+		for (int32 Curve = 0; Curve < CurvesNum; Curve++)
+		{
+			BrowCurves[Curve] = EnumHasAnyFlags(FMetaFaceCurveRegistry::Get().GetFlags(Clip.GetCurveIds()[Curve]), EMetaFaceCurveFlags::Brow);
+		}
+		for (int32 cnt = 0; cnt < 4; ++cnt)
+		{
+			for (int32 i = 2; i < Num - 2; i++)
+			{
+				const float* Rows[5] = { Clip.GetKey(i - 2), Clip.GetKey(i - 1), Clip.GetKey(i), Clip.GetKey(i + 1), Clip.GetKey(i + 2) };
+				float* Row = Clip.GetKey(i);
+				for (int32 Curve = 0; Curve < CurvesNum; Curve++)
+				{
+					float NewVal = BrowCurves[Curve]
+						? (Rows[1][Curve] + Rows[2][Curve] + Rows[3][Curve]) / 3.f
+						: (Rows[0][Curve] + Rows[1][Curve] + Rows[2][Curve] + Rows[3][Curve] + Rows[4][Curve]) * 0.2f;
+					Row[Curve] = FMath::Lerp(Row[Curve], NewVal, Smoothness);
+				}
+			}
+			if (Num > 1)
+			{
+				float* First = Clip.GetKey(0);
+				const float* Second = Clip.GetKey(1);
+				for (int32 Curve = 0; Curve < CurvesNum; Curve++)
+				{
+					First[Curve] = FMath::Lerp(First[Curve], (First[Curve] + Second[Curve]) * 0.5f, Smoothness);
+				}
+				if (Num > 2)
+				{
+					const float* BeforeLast = Clip.GetKey(Num - 2);
+					float* Last = Clip.GetKey(Num - 1);
+					for (int32 Curve = 0; Curve < CurvesNum; Curve++)
+					{
+						Last[Curve] = FMath::Lerp(Last[Curve], (BeforeLast[Curve] + Last[Curve]) * 0.5f, Smoothness);
+					}
+				}
+			}
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceSmoothingGoldenTest, "YnnkMetaFace.Generation.SmoothingMatchesScalarLoops",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+/**
+* Smooth random lip-sync and facial animation clips with the scalar loops of generators and with FMetaFaceSmoothing kernels
+* configured as RawDataToLipsync/RawDataToFacialAnimation do. Results should be bit-identical.
+* Clips of 3..16 keys and a few longer ones are checked to cover ends of curves.
+*/
+bool FMetaFaceSmoothingGoldenTest::RunTest(const FString& Parameters)
+{
+	using namespace MetaFaceSmoothingTests;
+
+	constexpr int32 MaxKeysNum = 400;
+	const float Smoothness = 0.7f;
+	FRandomStream Random(1);
+
+	for (const bool bLipsync : { true, false })
+	{
+		FMetaFaceClip Reference, Clip;
+		TArray<uint8> Flags;
+		int32 Mismatches = 0;
+		float MaxDifference = 0.f;
+
+		for (int32 Num = 3; Num <= MaxKeysNum; Num += (Num < 16 ? 1 : MaxKeysNum / 4))
+		{
+			Clip.Reset(FMetaFaceCurveRegistry::GetCurveSet(bLipsync), Num);
+			Flags.SetNumUninitialized(Num * Clip.GetCurvesNum());
+			for (int32 Key = 0; Key < Num; Key++)
+			{
+				float* Row = Clip.AddKey(Key * 0.05f);
+				for (int32 Curve = 0; Curve < Clip.GetCurvesNum(); Curve++)
+				{
+					Row[Curve] = Random.FRandRange(-0.2f, 1.f);
+					Flags[Key * Clip.GetCurvesNum() + Curve] = Random.RandRange(0, 3) == 0 ? CURVEFLAG_RICH : 0;
+				}
+			}
+			Reference = Clip;
+
+			LegacySmooth(Reference, Smoothness, bLipsync ? Flags.GetData() : nullptr);
+			FMetaFaceSmoothing Smoothing(Clip, Smoothness);
+			if (bLipsync)
+			{
+				Smoothing.SetRichKeysScale(0.15f);
+				Smoothing.ApplyFIR(Clip, 2, 1, false, Flags.GetData());
+			}
+			else
+			{
+				Smoothing.SetNarrowCurves(EMetaFaceCurveFlags::Brow);
+				Smoothing.ApplyFIR(Clip, 4, 2, true);
+			}
+
+			for (int32 Key = 0; Key < Num; Key++)
+			{
+				for (int32 Curve = 0; Curve < Clip.GetCurvesNum(); Curve++)
+				{
+					const float ReferenceValue = Reference.GetValue(Key, Curve);
+					const float Value = Clip.GetValue(Key, Curve);
+					if (FMemory::Memcmp(&ReferenceValue, &Value, sizeof(float)) != 0)
+					{
+						Mismatches++;
+						MaxDifference = FMath::Max(MaxDifference, FMath::Abs(ReferenceValue - Value));
+					}
+				}
+			}
+		}
+
+		TestEqual(FString::Printf(TEXT("%s: mismatched values (max difference %g)"), bLipsync ? TEXT("Lip-sync") : TEXT("Facial animation"), MaxDifference), Mismatches, 0);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,152 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "NeuralProcessWrapper.h"
+#include "MetaFaceStreamingBuilder.h"
+#include "MetaFaceFunctionLibrary.h"
+#include "MetaFaceBenchmarkCommandlet.h"
+#include "MetaFaceTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MetaFaceStreamingTests
+{
+	/** Compare streamed keys with keys of the whole phrase, returns max difference of values (or -1 if keys don't match) */
+	static float CompareCurves(const TMap<FName, FSimpleFloatCurve>& Batch, const TMap<FName, FSimpleFloatCurve>& Streamed)
+	{
+		float MaxDifference = 0.f;
+		for (const auto& Curve : Batch)
+		{
+			const FSimpleFloatCurve* StreamedCurve = Streamed.Find(Curve.Key);
+			if (!StreamedCurve || StreamedCurve->Values.Num() != Curve.Value.Values.Num())
+			{
+				return -1.f;
+			}
+			for (int32 i = 0; i < Curve.Value.Values.Num(); i++)
+			{
+				if (StreamedCurve->Values[i].Time != Curve.Value.Values[i].Time)
+				{
+					return -1.f;
+				}
+				MaxDifference = FMath::Max(MaxDifference, FMath::Abs(StreamedCurve->Values[i].Value - Curve.Value.Values[i].Value));
+			}
+		}
+		return MaxDifference;
+	}
+
+	/** Time of the last key which can be played */
+	static float GetLastKeyTime(const TMap<FName, FSimpleFloatCurve>& Curves)
+	{
+		float Time = 0.f;
+		for (const auto& Curve : Curves)
+		{
+			if (Curve.Value.Values.Num() > 0)
+			{
+				Time = FMath::Max(Time, Curve.Value.Values.Last().Time);
+			}
+		}
+		return Time;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceStreamingMatchesBatchTest, "YnnkMetaFace.Streaming.MatchesBatch",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+/**
+* Feed a phrase to FMetaFaceStreamingBuilder in chunks of different size. Keys should be the same as keys built
+* for the whole phrase, and keys of stateless models should be output before the phrase is finished.
+*/
+bool FMetaFaceStreamingMatchesBatchTest::RunTest(const FString& Parameters)
+{
+	using namespace MetaFaceStreamingTests;
+
+	FYnnkMetaFaceEnhancerModule* ModuleMFE = MetaFaceTestHelpers::GetModuleWithModels(*this);
+	if (!ModuleMFE)
+	{
+		return false;
+	}
+	UNeuralProcessWrapper* NeuralProcessor = ModuleMFE->GetNeuralProcessor();
+	const bool bLipsyncStateless = NeuralProcessor->IsModelStateless(true);
+	const bool bFacialStateless = NeuralProcessor->IsModelStateless(false);
+
+	TArray<FPhonemeTextData> PhonemesData;
+	UMetaFaceBenchmarkCommandlet::MakeSyntheticPhrase(5.f, 5000, PhonemesData);
+	FMetaFaceGenerationSettings GenerationSettings;
+
+	// Whole phrase
+	TMap<FName, FSimpleFloatCurve> BatchLipsync, BatchFacial;
+	RawAnimDataMap RawData;
+	if (!TestTrue(TEXT("Lip-sync model evaluated"), ModuleMFE->ProcessPhonemesData(PhonemesData, true, RawData)))
+	{
+		return false;
+	}
+	UMFFunctionLibrary::RawDataToLipsync(PhonemesData, RawData, BatchLipsync, GenerationSettings);
+	if (!TestTrue(TEXT("Emotions model evaluated"), ModuleMFE->ProcessPhonemesData(PhonemesData, false, RawData)))
+	{
+		return false;
+	}
+	UMFFunctionLibrary::RawDataToFacialAnimation(PhonemesData, RawData, BatchFacial, GenerationSettings);
+
+	for (const int32 ChunkSize : { 1, 3, 16 })
+	{
+		FMetaFaceStreamingBuilder Builder(GenerationSettings, true, true);
+		TMap<FName, FSimpleFloatCurve> StreamedLipsync, StreamedFacial;
+		float LipsyncKeyTime = 0.f, FacialKeyTime = 0.f;
+		bool bFailed = false;
+
+		auto AppendChunk = [&](FMetaFaceStreamingChunk&& Chunk)
+		{
+			bFailed |= Chunk.bFailed;
+			for (const auto& Curve : Chunk.LipSync)
+			{
+				StreamedLipsync.FindOrAdd(Curve.Key).Values.Append(Curve.Value.Values);
+			}
+			for (const auto& Curve : Chunk.FacialAnimation)
+			{
+				StreamedFacial.FindOrAdd(Curve.Key).Values.Append(Curve.Value.Values);
+			}
+			if (!Chunk.bFinished)
+			{
+				LipsyncKeyTime = GetLastKeyTime(StreamedLipsync);
+				FacialKeyTime = GetLastKeyTime(StreamedFacial);
+			}
+		};
+
+		for (int32 Index = 0; Index < PhonemesData.Num(); Index += ChunkSize)
+		{
+			Builder.AppendPhonemes(TArray<FPhonemeTextData>(PhonemesData.GetData() + Index, FMath::Min(ChunkSize, PhonemesData.Num() - Index)));
+			Builder.ProcessPending(AppendChunk);
+		}
+		Builder.Finish();
+		Builder.ProcessPending(AppendChunk);
+
+		const FString Context = FString::Printf(TEXT("Chunks of %d phonemes"), ChunkSize);
+		if (!TestFalse(Context + TEXT(": streaming succeeded"), bFailed) || !TestTrue(Context + TEXT(": builder finished"), Builder.IsFinished()))
+		{
+			continue;
+		}
+
+		// Output of a stateful model for the same phrase may depend on previous requests, so only keys are compared
+		const float LipsyncDifference = CompareCurves(BatchLipsync, StreamedLipsync);
+		const float FacialDifference = CompareCurves(BatchFacial, StreamedFacial);
+		TestTrue(Context + TEXT(": lip-sync keys match"), LipsyncDifference >= 0.f);
+		TestTrue(Context + TEXT(": facial animation keys match"), FacialDifference >= 0.f);
+		if (bLipsyncStateless)
+		{
+			TestTrue(FString::Printf(TEXT("%s: lip-sync values match (difference %g)"), *Context, LipsyncDifference), LipsyncDifference <= KINDA_SMALL_NUMBER);
+			TestTrue(Context + TEXT(": lip-sync keys are output before the phrase is finished"), LipsyncKeyTime > 0.f);
+		}
+		if (bFacialStateless)
+		{
+			TestTrue(FString::Printf(TEXT("%s: facial animation values match (difference %g)"), *Context, FacialDifference), FacialDifference <= KINDA_SMALL_NUMBER);
+			TestTrue(Context + TEXT(": facial animation keys are output before the phrase is finished"), FacialKeyTime > 0.f);
+		}
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
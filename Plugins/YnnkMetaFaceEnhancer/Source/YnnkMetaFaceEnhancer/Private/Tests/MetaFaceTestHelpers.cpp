@@ -0,0 +1,27 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "MetaFaceTestHelpers.h"
+#include "Modules/ModuleManager.h"
+#include "YnnkMetaFaceEnhancer.h"
+#include "NeuralProcessWrapper.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+FYnnkMetaFaceEnhancerModule* MetaFaceTestHelpers::GetModuleWithModels(FAutomationTestBase& Test)
+{
+	auto ModuleMFE = FModuleManager::LoadModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	UNeuralProcessWrapper* NeuralProcessor = ModuleMFE ? ModuleMFE->GetNeuralProcessor() : nullptr;
+	if (IsValid(NeuralProcessor))
+	{
+		NeuralProcessor->WaitForModels();
+	}
+	if (!IsValid(NeuralProcessor) || !NeuralProcessor->IsValid() || !ModuleMFE->GetInferenceService())
+	{
+		Test.AddError(TEXT("Neural models aren't loaded"));
+		return nullptr;
+	}
+	return ModuleMFE;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
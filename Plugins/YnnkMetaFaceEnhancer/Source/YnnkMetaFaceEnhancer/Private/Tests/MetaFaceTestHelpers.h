@@ -0,0 +1,19 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class FYnnkMetaFaceEnhancerModule;
+
+namespace MetaFaceTestHelpers
+{
+	/** Module with loaded models and inference service, or nullptr (error is added to the test) */
+	FYnnkMetaFaceEnhancerModule* GetModuleWithModels(FAutomationTestBase& Test);
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,125 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "Misc/FileHelper.h"
+#include "UObject/Package.h"
+#include "NeuralProcessWrapper.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MetaFaceTorchParityTests
+{
+	/** Load rows of <model>.golden.csv: input and model output for every eval_compute call */
+	static bool LoadGoldenRows(const FString& FileName, int32 CurvesNum, TArray<float>& OutSymbols, TArray<float>& OutRows)
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *FileName))
+		{
+			return false;
+		}
+
+		OutSymbols.Reset(Lines.Num());
+		OutRows.Reset(Lines.Num() * CurvesNum);
+		TArray<FString> Values;
+		for (const FString& Line : Lines)
+		{
+			if (Line.IsEmpty())
+			{
+				continue;
+			}
+			Line.ParseIntoArray(Values, TEXT(","));
+			if (Values.Num() != CurvesNum + 1)
+			{
+				return false;
+			}
+			OutSymbols.Add(FCString::Atof(*Values[0]));
+			for (int32 n = 1; n < Values.Num(); n++)
+			{
+				OutRows.Add(FCString::Atof(*Values[n]));
+			}
+		}
+		return OutSymbols.Num() > 0;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMetaFaceTorchGoldenParityTest, "YnnkMetaFace.Inference.TorchGoldenParity",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+/**
+* TorchScript wrapper of the current platform (Windows DLL or Linux shared object) should give the same output
+* as the reference implementation of the models. Golden rows in Resources/Golden are made by make_golden_outputs.py
+* (plain Python evaluation of weights from .tmod, no libtorch) for a freshly loaded model and inputs in ascending order.
+* Models without golden rows or without torch wrapper library on this platform are skipped.
+*/
+bool FMetaFaceTorchGoldenParityTest::RunTest(const FString& Parameters)
+{
+	using namespace MetaFaceTorchParityTests;
+
+	// Golden rows are computed in double precision
+	constexpr float Tolerance = 1e-4f;
+
+	// Separate wrapper: models of the module may be replaced by lookup tables or have state of previous requests
+	UNeuralProcessWrapper* Wrapper = NewObject<UNeuralProcessWrapper>(GetTransientPackage());
+	Wrapper->InitializeTorchModels(true, true);
+
+	for (const bool bUseLipsyncModel : { true, false })
+	{
+		const TCHAR* ModelName = bUseLipsyncModel ? TEXT("Lip-sync") : TEXT("Emotions");
+		const FString ModelFile = Wrapper->GetModelFile(bUseLipsyncModel);
+		const FString GoldenFile = Wrapper->GetResourcesPath() / TEXT("Golden") / FPaths::GetBaseFilename(ModelFile) + TEXT(".golden.csv");
+		const int32 CurvesNum = Wrapper->GetCurvesNum(bUseLipsyncModel);
+
+		if (!(bUseLipsyncModel ? Wrapper->IsLipsyncModelReady() : Wrapper->IsEmotionsModelReady()))
+		{
+			AddInfo(FString::Printf(TEXT("%s model: TorchScript model %s isn't loaded on this platform, skipped"), ModelName, *ModelFile));
+			continue;
+		}
+
+		TArray<float> Symbols, GoldenRows;
+		if (!FPaths::FileExists(GoldenFile))
+		{
+			AddInfo(FString::Printf(TEXT("%s model: no golden rows %s, skipped"), ModelName, *GoldenFile));
+			continue;
+		}
+		if (!LoadGoldenRows(GoldenFile, CurvesNum, Symbols, GoldenRows))
+		{
+			AddError(FString::Printf(TEXT("Unable to read golden rows %s"), *GoldenFile));
+			continue;
+		}
+
+		// One call per input in the order of golden rows (model isn't verified as stateless, so sequence input isn't used)
+		TArray<float> Rows;
+		if (!Wrapper->EvaluateSymbols(bUseLipsyncModel, Symbols, Rows, TEXT("TorchGoldenParity")))
+		{
+			AddError(FString::Printf(TEXT("Unable to evaluate TorchScript model %s"), *ModelFile));
+			continue;
+		}
+
+		float MaxDifference = 0.f;
+		int32 MaxDifferenceRow = 0;
+		for (int32 Index = 0; Index < Rows.Num(); Index++)
+		{
+			// Output of EvaluateSymbols is clamped
+			const float Difference = FMath::Abs(Rows[Index] - FMath::Clamp(GoldenRows[Index], -1.f, 1.f));
+			if (Difference > MaxDifference)
+			{
+				MaxDifference = Difference;
+				MaxDifferenceRow = Index / CurvesNum;
+			}
+		}
+
+		AddInfo(FString::Printf(TEXT("%s model: max difference from golden rows %g (row %d)"), ModelName, MaxDifference, MaxDifferenceRow));
+		if (MaxDifference > Tolerance)
+		{
+			AddError(FString::Printf(TEXT("%s model output differs from golden rows by %g at row %d (input %g)"), ModelName, MaxDifference, MaxDifferenceRow, Symbols[MaxDifferenceRow]));
+		}
+	}
+
+	Wrapper->MarkAsGarbage();
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -18,6 +18,10 @@
 #include "Serialization/JsonSerializer.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "NeuralProcessWrapper.h"
+#include "MetaFaceInferenceService.h"
+#include "MetaFaceWorkerPool.h"
+#include "MetaFaceBuildQueue.h"
+#include "MetaFaceTickSubsystem.h"
 #include "HAL/CriticalSection.h"
 #include "Engine/World.h"
 #include "Async/Async.h"
@@ -36,7 +40,6 @@ DEFINE_LOG_CATEGORY(LogMetaFace);
 #define __is_anim_converted(animation) (animation.AnimationFlag && 1)
 #define __set_anim_converted(animation) animation.AnimationFlag = 1
 
-FCriticalSection UYnnkMetaFaceController::AsyncBuildMutex;
 
 namespace JsonHelpers
 {
@@ -109,6 +112,11 @@ UYnnkMetaFaceController::UYnnkMetaFaceController()
 	PrimaryComponentTick.bCanEverTick = true;
 	PrimaryComponentTick.bStartWithTickEnabled = false;
 
+	// Full animation; no fine shapes at half rate; lips, eyelids and eyes without look-at at quarter rate
+	AnimationLODs.Add(FMetaFaceAnimationLOD(0, 1, true, true, true));
+	AnimationLODs.Add(FMetaFaceAnimationLOD(2, 2, true, false, true));
+	AnimationLODs.Add(FMetaFaceAnimationLOD(4, 4, false, false, false));
+
 #if WITH_EDITOR
 	if (!IsValid(ArKitCurvesPoseAsset))
 	{
@@ -163,12 +171,23 @@ void UYnnkMetaFaceController::BeginPlay()
 	{
 		BodyMesh = HeadMesh;
 	}
+
+	// Created only if bTickControllersInSubsystem is enabled in project settings
+	if (UMetaFaceTickSubsystem* Subsystem = GetWorld()->GetSubsystem<UMetaFaceTickSubsystem>())
+	{
+		Subsystem->RegisterController(this);
+	}
 }
 
 void UYnnkMetaFaceController::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
+	if (UMetaFaceTickSubsystem* Subsystem = TickSubsystem.Get())
+	{
+		Subsystem->UnregisterController(this);
+	}
+
 	if (RemoteClient)
 	{
 		if (RemoteClient->IsConnected())
@@ -177,9 +196,14 @@ void UYnnkMetaFaceController::EndPlay(const EEndPlayReason::Type EndPlayReason)
 		}
 	}
 
-	if (IsValid(GetNeuralProcessor()))
+	CancelAnimationBuilds();
+	if (ModelsReadyHandle.IsValid())
 	{
-		GetNeuralProcessor()->InterruptAll();
+		if (auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer")))
+		{
+			ModuleMFE->OnModelsReady().Remove(ModelsReadyHandle);
+		}
+		ModelsReadyHandle.Reset();
 	}
 
 	if (IsValid(LipsyncController))
@@ -209,67 +233,86 @@ void UYnnkMetaFaceController::TickComponent(float DeltaTime, ELevelTick TickType
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	// Facial Animation
+	if (TickSubsystem.IsValid())
+	{
+		// Ticked by UMetaFaceTickSubsystem together with other controllers
+		return;
+	}
 
-	bool bPlayFacialAnim = IsValid(LipsyncController) && (CurrentLipsync.IsActive() || CurrentFaceAnim.IsActive());
-	if (bPlayFacialAnim)
+	TickGameThread(DeltaTime);
+	TickAnimation();
+	FinishTick();
+}
+
+EMetaFaceCurveFlags FMetaFaceAnimationLOD::GetDroppedCurves() const
+{
+	EMetaFaceCurveFlags DroppedCurves = EMetaFaceCurveFlags::None;
+	if (!bAnimateBrows)
 	{
-		PlayTime = LipsyncController->IsSpeaking()
-			? LipsyncController->PlayTime
-			: (PlayTime + DeltaTime);
+		DroppedCurves |= EMetaFaceCurveFlags::Brow;
+	}
+	if (!bAnimateDetails)
+	{
+		DroppedCurves |= EMetaFaceCurveFlags::Detail;
+	}
+	return DroppedCurves;
+}
 
-		if (CurrentLipsync.IsActive())
-		{
-			CurrentLipsync.ProcessFrame(PlayTime, LipsyncController);
-		}
-		if (CurrentFaceAnim.IsActive())
+void UYnnkMetaFaceController::SetAnimationLOD(int32 NewLOD)
+{
+	AnimationLOD = AnimationLODs.Num() > 0 ? FMath::Clamp(NewLOD, 0, AnimationLODs.Num() - 1) : 0;
+}
+
+void UYnnkMetaFaceController::UpdateAnimationLOD()
+{
+	if (!bAutoAnimationLOD || !HeadMesh || AnimationLODs.Num() == 0)
+	{
+		return;
+	}
+
+	if (!HeadMesh->WasRecentlyRendered(0.2f))
+	{
+		AnimationLOD = AnimationLODs.Num() - 1;
+		return;
+	}
+
+	const int32 MeshLOD = HeadMesh->GetPredictedLODLevel();
+	AnimationLOD = 0;
+	for (int32 LOD = 1; LOD < AnimationLODs.Num(); LOD++)
+	{
+		if (MeshLOD >= AnimationLODs[LOD].MinMeshLOD)
 		{
-			CurrentFaceAnim.ProcessFrame(PlayTime, LipsyncController);
+			AnimationLOD = LOD;
 		}
-		
-		// Combine animation with YnnkVoiceController with default parameters
-		if (bAutoBakeAnimation)
-		{
-			for (auto& Curve : CurrentBakedFaceFrame)
-			{
-				Curve.Value = 0.f;
+	}
+}
 
-				float SummAlpha = 0.f;
-				const FName& CurveName = Curve.Key;
+void UYnnkMetaFaceController::TickGameThread(float DeltaTime)
+{
+	// Animation LOD
 
-				if (LipsyncController->AnimationType == EYnnkAnimationType::AT_AnimationCurves)
-				{
-					if (float* Value = LipsyncController->ActiveCurveValues.Find(CurveName))
-					{
-						Curve.Value = *Value * BakedYnnkToMetaFaceRatio * BakedLipSyncIntensity;
-						SummAlpha = BakedYnnkToMetaFaceRatio;
-					}
-				}
-				
-				if (CurrentLipsync.IsActive())
-				{
-					if (float* Value = CurrentLipsync.AnimationFrame.Find(CurveName))
-					{
-						Curve.Value += *Value * (1.f - SummAlpha) * BakedLipSyncIntensity;
-					}
-				}
+	UpdateAnimationLOD();
+	const FMetaFaceAnimationLOD LODSettings = AnimationLODs.IsValidIndex(AnimationLOD) ? AnimationLODs[AnimationLOD] : FMetaFaceAnimationLOD();
 
-				if (CurrentFaceAnim.IsActive())
-				{
-					if (float* Value = CurrentFaceAnim.AnimationFrame.Find(CurveName))
-					{
-						Curve.Value += *Value * BakedFacialAnimationIntensity;
-					}
-				}
+	EyesAccumulatedTime += DeltaTime;
+	bTickEyes = ++FramesSinceEyesUpdate >= LODSettings.UpdateInterval;
+	if (bTickEyes)
+	{
+		FramesSinceEyesUpdate = 0;
+	}
 
-				if (BakedLipSyncIntensity != 1.f && LipSyncARCurvesSet.Contains(CurveName))
-				{
-					Curve.Value *= BakedLipSyncIntensity;
-				}
+	const EMetaFaceCurveFlags DroppedCurves = LODSettings.GetDroppedCurves();
+	CurrentLipsync.SetDroppedCurves(DroppedCurves);
+	CurrentFaceAnim.SetDroppedCurves(DroppedCurves);
 
-				Curve.Value = FMath::Clamp(Curve.Value, -1.f, 1.f);
-			}
-		}
+	// Facial Animation
+
+	bTickFacialAnimation = IsValid(LipsyncController) && (CurrentLipsync.IsActive() || CurrentFaceAnim.IsActive() || StreamingBuilder.IsValid());
+	if (bTickFacialAnimation)
+	{
+		PlayTime = LipsyncController->IsSpeaking()
+			? LipsyncController->PlayTime
+			: (PlayTime + DeltaTime);
 	}
 	else
 	{
@@ -280,25 +323,22 @@ void UYnnkMetaFaceController::TickComponent(float DeltaTime, ELevelTick TickType
 
 	if (HeadMesh && BodyMesh)
 	{
-		float CurrentTime = GetWorld()->GetTimeSeconds();
-
 		if (EyesControllerType == EEyesControlType::EC_LiveMovement)
 		{
+			float CurrentTime = GetWorld()->GetTimeSeconds();
 			if (CurrentTime > EyesNextUpdateTime)
 			{
 				EyesNextUpdateTime = CurrentTime + FMath::RandRange(0.4f, 3.5f);
 				EyeRotation_Target.X = FMath::FRandRange(-50.f, 50.f);
 				EyeRotation_Target.Y = FMath::FRandRange(-30.f, 30.f);
 			}
-
-			EyeRotation_Right = FMath::Vector2DInterpConstantTo(EyeRotation_Right, EyeRotation_Target, DeltaTime, EyeMovementSpeed);
-			EyeRotation_Left = FMath::Vector2DInterpConstantTo(EyeRotation_Left, EyeRotation_Target, DeltaTime, EyeMovementSpeed);
 		}
-		else if (EyesControllerType == EEyesControlType::EC_FocusAtTarget)
+		else if (EyesControllerType == EEyesControlType::EC_FocusAtTarget && bTickEyes && LODSettings.bEyesFocusAtTarget)
 		{
+			const float EyesDeltaTime = EyesAccumulatedTime;
 			if (EyesTargetAlpha < 1.f)
 			{
-				EyesTargetAlpha += DeltaTime * 4.f;
+				EyesTargetAlpha += EyesDeltaTime * 4.f;
 				if (EyesTargetAlpha > 1.f) EyesTargetAlpha = 1.f;
 			}
 
@@ -344,16 +384,16 @@ void UYnnkMetaFaceController::TickComponent(float DeltaTime, ELevelTick TickType
 
 			if (FMath::Abs(DeltaR.Yaw) > 50.f || FMath::Abs(DeltaL.Yaw) > 50.f)
 			{
-				EyeRotation_Right = FMath::Vector2DInterpConstantTo(EyeRotation_Right, FVector2D::ZeroVector, DeltaTime, EyeMovementSpeed * 1.5f);
-				EyeRotation_Left = FMath::Vector2DInterpConstantTo(EyeRotation_Left, FVector2D::ZeroVector, DeltaTime, EyeMovementSpeed * 1.5f);
+				EyeRotation_Right = FMath::Vector2DInterpConstantTo(EyeRotation_Right, FVector2D::ZeroVector, EyesDeltaTime, EyeMovementSpeed * 1.5f);
+				EyeRotation_Left = FMath::Vector2DInterpConstantTo(EyeRotation_Left, FVector2D::ZeroVector, EyesDeltaTime, EyeMovementSpeed * 1.5f);
 				EyesTargetAlpha = 0.f;
 			}
 			else
 			{
 				if (EyesTargetAlpha < 1.f)
 				{
-					EyeRotation_Right = FMath::Vector2DInterpConstantTo(EyeRotation_Right, FVector2D(DeltaR.Yaw, DeltaR.Pitch), DeltaTime, EyeMovementSpeed * (EyesTargetAlpha * 50.f + 1.f));
-					EyeRotation_Left = FMath::Vector2DInterpConstantTo(EyeRotation_Left, FVector2D(DeltaL.Yaw, DeltaL.Pitch), DeltaTime, EyeMovementSpeed * (EyesTargetAlpha * 50.f + 1.f));
+					EyeRotation_Right = FMath::Vector2DInterpConstantTo(EyeRotation_Right, FVector2D(DeltaR.Yaw, DeltaR.Pitch), EyesDeltaTime, EyeMovementSpeed * (EyesTargetAlpha * 50.f + 1.f));
+					EyeRotation_Left = FMath::Vector2DInterpConstantTo(EyeRotation_Left, FVector2D(DeltaL.Yaw, DeltaL.Pitch), EyesDeltaTime, EyeMovementSpeed * (EyesTargetAlpha * 50.f + 1.f));
 				}
 				else
 				{
@@ -361,7 +401,61 @@ void UYnnkMetaFaceController::TickComponent(float DeltaTime, ELevelTick TickType
 					EyeRotation_Left = FVector2D(DeltaL.Yaw, DeltaL.Pitch);
 				}
 			}
+		}
+	}
+}
 
+void UYnnkMetaFaceController::TickAnimation()
+{
+	// Facial Animation
+
+	if (bTickFacialAnimation)
+	{
+		// Sampling of clips with key cursor and the compiled mix cost about as much as interpolation of cached frames,
+		// so frames are evaluated at the current play time every tick regardless of animation LOD
+		const bool bEvaluateFrames = bPublishAnimationFrames || bAutoBakeAnimation;
+		if (CurrentLipsync.IsActive())
+		{
+			CurrentLipsync.ProcessFrame(PlayTime, LipsyncController, bEvaluateFrames);
+		}
+		if (CurrentFaceAnim.IsActive())
+		{
+			CurrentFaceAnim.ProcessFrame(PlayTime, LipsyncController, bEvaluateFrames);
+		}
+		
+		// Combine animation with YnnkVoiceController with default parameters
+		if (bAutoBakeAnimation)
+		{
+			const bool bUseYnnkCurves = LipsyncController->AnimationType == EYnnkAnimationType::AT_AnimationCurves;
+			auto EvaluateBakedFrame = [&]()
+			{
+				return BakedFramePlan.Evaluate(CurrentBakedFaceFrame, LipsyncController->ActiveCurveValues, bUseYnnkCurves, CurrentLipsync, CurrentFaceAnim,
+					BakedYnnkToMetaFaceRatio, BakedLipSyncIntensity, BakedFacialAnimationIntensity);
+			};
+			if (!EvaluateBakedFrame())
+			{
+				// Curves were changed since the plan was compiled
+				BakedFramePlan.Compile(CurrentBakedFaceFrame, LipsyncController->ActiveCurveValues, CurrentLipsync, CurrentFaceAnim);
+				EvaluateBakedFrame();
+			}
+		}
+	}
+
+	if (!bTickEyes)
+	{
+		return;
+	}
+	const float DeltaTime = EyesAccumulatedTime;
+	EyesAccumulatedTime = 0.f;
+
+	// Eyes Animation
+
+	if (HeadMesh && BodyMesh)
+	{
+		if (EyesControllerType == EEyesControlType::EC_LiveMovement)
+		{
+			EyeRotation_Right = FMath::Vector2DInterpConstantTo(EyeRotation_Right, EyeRotation_Target, DeltaTime, EyeMovementSpeed);
+			EyeRotation_Left = FMath::Vector2DInterpConstantTo(EyeRotation_Left, EyeRotation_Target, DeltaTime, EyeMovementSpeed);
 		}
 		else if (EyesControllerType == EEyesControlType::EC_Disabled)
 		{
@@ -376,20 +470,26 @@ void UYnnkMetaFaceController::TickComponent(float DeltaTime, ELevelTick TickType
 			{
 				EyeRotation_Left.X = EyeRotation_Left.Y = 0.f;
 			}
-			if (!bPlayFacialAnim
-				&& EyeRotation_Right.X == 0.f
-				&& EyeRotation_Right.Y == 0.f
-				&& EyeRotation_Left.X == 0.f
-				&& EyeRotation_Left.Y == 0.f)
-			{
-				SetComponentTickEnabled(false);
-			}
 		}
 
 		FillEyeAnimationCurves();
 	}
 }
 
+void UYnnkMetaFaceController::FinishTick()
+{
+	if (HeadMesh && BodyMesh
+		&& EyesControllerType == EEyesControlType::EC_Disabled
+		&& !bTickFacialAnimation
+		&& EyeRotation_Right.X == 0.f
+		&& EyeRotation_Right.Y == 0.f
+		&& EyeRotation_Left.X == 0.f
+		&& EyeRotation_Left.Y == 0.f)
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
 bool UYnnkMetaFaceController::BuildFacialAnimationData(UYnnkVoiceLipsyncData* LipsyncData, bool bCreateLipSync, bool bCreateFacialAnimation)
 {
 	if (!IsValid(LipsyncController))
@@ -428,18 +528,16 @@ bool UYnnkMetaFaceController::BuildFacialAnimationData(UYnnkVoiceLipsyncData* Li
 	}
 	else if (bAsyncAnimationBuilder)
 	{
-		if (bAsyncWorkerIsActive)
-		{
-			bExecutionInterrupted = true;
-			GetNeuralProcessor()->InterruptAll();
-		}
-
 		ProcessedLipsyncData = LipsyncData;
-
-		// May freeze game in theory, but single symbol is actually processed quickly enough
-		// @TODO: lock within async
-		AsyncBuildMutex.Lock();
-		AsyncBuildAnimation(LipsyncData);
+		AsyncBuildAnimation(LipsyncData, EMetaFaceBuildPriority::SpeakNow);
+		return true;
+	}
+	else if (ModuleMFE->IsLoadingModels())
+	{
+		// Don't block game thread until models are loaded
+		ProcessedLipsyncData = LipsyncData;
+		ModuleMFE->OnModelsReady().Remove(ModelsReadyHandle);
+		ModelsReadyHandle = ModuleMFE->OnModelsReady().AddUObject(this, &UYnnkMetaFaceController::OnNeuralModelsReady, TWeakObjectPtr<UYnnkVoiceLipsyncData>(LipsyncData), bCreateLipSync, bCreateFacialAnimation);
 		return true;
 	}
 	else // build locally without async builder
@@ -455,39 +553,16 @@ bool UYnnkMetaFaceController::BuildFacialAnimationData(UYnnkVoiceLipsyncData* Li
 			{
 				if (RawData.Num() > 0)
 				{
-					TMap<FName, FSimpleFloatCurve> AnimationData;
+					FMetaFaceClip AnimationData;
 					UMFFunctionLibrary::RawDataToLipsync(ProcessedLipsyncData, RawData, AnimationData, FMetaFaceGenerationSettings(this));
 
-					const FName FrownL = TEXT("MouthFrownLeft");
-					const FName FrownR = TEXT("MouthFrownRight");
-					const FName SmileL = TEXT("MouthSmileLeft");
-					const FName SmileR = TEXT("MouthSmileRight");
-
-					if (bBalanceSmileFrownCurves
-						&& AnimationData.Contains(FrownL) && AnimationData.Contains(SmileL)
-						&& AnimationData.Contains(FrownR) && AnimationData.Contains(SmileR))
-					{
-						for (int32 i = 0; i < AnimationData[FrownL].Values.Num(); i++)
-						{
-							if (AnimationData[FrownL].Values[i].Value < AnimationData[SmileL].Values[i].Value)
-							{
-								float Mean = (AnimationData[FrownL].Values[i].Value + AnimationData[SmileL].Values[i].Value) * 0.5f;
-								AnimationData[FrownL].Values[i].Value = AnimationData[SmileL].Values[i].Value = Mean;
-							}
-
-							if (AnimationData[FrownR].Values[i].Value < AnimationData[SmileR].Values[i].Value)
-							{
-								float Mean = (AnimationData[FrownR].Values[i].Value + AnimationData[SmileR].Values[i].Value) * 0.5f;
-								AnimationData[FrownR].Values[i].Value = AnimationData[SmileR].Values[i].Value = Mean;
-							}
-						}
-					}
+					BalanceSmileFrownCurves(AnimationData);
 
 					if (bLipSyncToSkeletonCurves)
 					{
 						UMFFunctionLibrary::ConvertFacialAnimCurves(AnimationData, ArKitCurvesPoseAsset);
 					}
-					LipsyncAnimation.Initialize(AnimationData, false);
+					LipsyncAnimation.Initialize(MoveTemp(AnimationData), false);
 				}
 			}
 		}
@@ -497,19 +572,19 @@ bool UYnnkMetaFaceController::BuildFacialAnimationData(UYnnkVoiceLipsyncData* Li
 			{
 				if (RawData.Num() > 0)
 				{
-					TMap<FName, FSimpleFloatCurve> AnimationData;
+					FMetaFaceClip AnimationData;
 					UMFFunctionLibrary::RawDataToFacialAnimation(ProcessedLipsyncData, RawData, AnimationData, FMetaFaceGenerationSettings(this));
 					if (bBalanceSmileFrownCurves)
 					{
-						AnimationData.Remove(TEXT("MouthSmileLeft"));
-						AnimationData.Remove(TEXT("MouthSmileRight"));
+						AnimationData.RemoveCurve(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::MouthSmileLeft));
+						AnimationData.RemoveCurve(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::MouthSmileRight));
 					}
 					if (bFacialAnimationToSkeletonCurves)
 					{
 						UMFFunctionLibrary::ConvertFacialAnimCurves(AnimationData, ArKitCurvesPoseAsset);
 					}
 
-					FacialAnimation.Initialize(AnimationData, true, FacialAnimationPauseDuration, FacialAnimationPauseDuration * 0.5f - 0.01f);
+					FacialAnimation.Initialize(MoveTemp(AnimationData), true, FacialAnimationPauseDuration, FacialAnimationPauseDuration * 0.5f - 0.01f);
 					FacialAnimation.Intensity = EmotionsIntensity;
 				}
 			}
@@ -520,23 +595,23 @@ bool UYnnkMetaFaceController::BuildFacialAnimationData(UYnnkVoiceLipsyncData* Li
 		NewItem.LipSync = LipsyncAnimation;
 		NewItem.FacialAnimation = FacialAnimation;
 
-		if (bLipSyncToSkeletonCurves && !__is_anim_converted(LipsyncAnimation))
+		if (bLipSyncToSkeletonCurves && LipsyncAnimation.GetClip().IsValid() && !__is_anim_converted(LipsyncAnimation))
 		{
-			auto AnimCopy = LipsyncAnimation.AnimationData;
+			FMetaFaceClip AnimCopy = *LipsyncAnimation.GetClip();
 			UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
-			NewItem.LipSync.AnimationData.Append(AnimCopy);
+			NewItem.LipSync.AddCurves(AnimCopy);
 			__set_anim_converted(LipsyncAnimation);
 		}
 
-		if (bFacialAnimationToSkeletonCurves && !__is_anim_converted(FacialAnimation))
+		if (bFacialAnimationToSkeletonCurves && FacialAnimation.GetClip().IsValid() && !__is_anim_converted(FacialAnimation))
 		{
-			auto AnimCopy = FacialAnimation.AnimationData;
+			FMetaFaceClip AnimCopy = *FacialAnimation.GetClip();
 			UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
-			NewItem.FacialAnimation.AnimationData.Append(AnimCopy);
+			NewItem.FacialAnimation.AddCurves(AnimCopy);
 			__set_anim_converted(FacialAnimation);
 		}
 
-		FaceAnimations.Add(ProcessedLipsyncData->GetFName(), NewItem);
+		FaceAnimations.Add(ProcessedLipsyncData->GetFName(), MoveTemp(NewItem));
 
 		if (bDelayedSpeak)
 		{
@@ -551,6 +626,22 @@ bool UYnnkMetaFaceController::BuildFacialAnimationData(UYnnkVoiceLipsyncData* Li
 	return false;
 }
 
+void UYnnkMetaFaceController::OnNeuralModelsReady(TWeakObjectPtr<UYnnkVoiceLipsyncData> LipsyncData, bool bCreateLipSync, bool bCreateFacialAnimation)
+{
+	auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	if (ModuleMFE)
+	{
+		ModuleMFE->OnModelsReady().Remove(ModelsReadyHandle);
+	}
+	ModelsReadyHandle.Reset();
+
+	// Phrase wasn't replaced by another request
+	if (LipsyncData.IsValid() && ProcessedLipsyncData == LipsyncData.Get())
+	{
+		BuildFacialAnimationData(LipsyncData.Get(), bCreateLipSync, bCreateFacialAnimation);
+	}
+}
+
 void UYnnkMetaFaceController::SpeakEx(UYnnkVoiceLipsyncData* VoiceLipsyncData, USoundWave* Sound, float SoundOffset)
 {
 	if (!LipsyncController)
@@ -576,6 +667,33 @@ void UYnnkMetaFaceController::SpeakEx(UYnnkVoiceLipsyncData* VoiceLipsyncData, U
 	}
 }
 
+bool UYnnkMetaFaceController::PrefetchFacialAnimation(UYnnkVoiceLipsyncData* LipsyncData)
+{
+	if (!LipsyncData || LipsyncData->PhonemesData.Num() == 0)
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("PrefetchFacialAnimation: invalid lip-sync data or no phonemes data"));
+		return false;
+	}
+	if (bUseRemoteBuilder)
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("PrefetchFacialAnimation isn't supported by remote animation builder"));
+		return false;
+	}
+
+	bool bContainsData
+		= (LipsyncData->ExtraAnimData1.Num() > 0 || !bApplyLipsyncToSpeak)
+		&& (LipsyncData->ExtraAnimData2.Num() > 0 || !bApplyFacialAnimationToSpeak);
+
+	// Nothing to build
+	if ((bUseExtraAnimationFromLipsyncDataAsset && bContainsData) || FaceAnimations.Contains(LipsyncData->GetFName()))
+	{
+		return true;
+	}
+
+	AsyncBuildAnimation(LipsyncData, EMetaFaceBuildPriority::Prefetch);
+	return true;
+}
+
 void UYnnkMetaFaceController::Speak(UYnnkVoiceLipsyncData* VoiceLipsyncData)
 {
 	if (VoiceLipsyncData)
@@ -588,6 +706,225 @@ void UYnnkMetaFaceController::Speak(UYnnkVoiceLipsyncData* VoiceLipsyncData)
 	}
 }
 
+bool UYnnkMetaFaceController::BeginStreamingAnimation(bool bCreateLipSync, bool bCreateFacialAnimation)
+{
+	if (!IsValid(LipsyncController))
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("BeginStreamingAnimation: can't find UYnnkLipsyncController component in %s"), *GetOwner()->GetName());
+		return false;
+	}
+	if (!IsValid(GetNeuralProcessor()))
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("BeginStreamingAnimation: neural processor isn't initialized"));
+		return false;
+	}
+	if (bUseRemoteBuilder)
+	{
+		UE_LOG(LogMetaFace, Log, TEXT("BeginStreamingAnimation: remote animation builder doesn't support streaming, local models are used"));
+	}
+
+	// Skeleton curves are converted in OnStreamingChunkReady
+	FMetaFaceGenerationSettings GenerationSettings(this);
+	GenerationSettings.bLipSyncToSkeletonCurves = GenerationSettings.bFacialAnimationToSkeletonCurves = false;
+	CancelStreamingAnimation();
+	PhraseId++;
+	StreamingBuilder = MakeShared<FMetaFaceStreamingBuilder, ESPMode::ThreadSafe>(GenerationSettings, bCreateLipSync, bCreateFacialAnimation);
+
+	CurrentLipsync.Initialize(FMetaFaceClip(), false);
+	CurrentLipsync.bStreaming = bCreateLipSync;
+	CurrentFaceAnim.Initialize(FMetaFaceClip(), false, FacialAnimationPauseDuration, FacialAnimationPauseDuration * 0.5f - 0.01f);
+	CurrentFaceAnim.Intensity = EmotionsIntensity;
+	CurrentFaceAnim.bStreaming = bCreateFacialAnimation;
+
+	if (bAutoBakeAnimation)
+	{
+		CurrentBakedFaceFrame.Empty();
+		BakedFramePlan.Reset();
+	}
+
+	PlayTime = 0.f;
+	SetComponentTickEnabled(true);
+
+	if (bLogDebug)
+	{
+		UE_LOG(LogMetaFace, Log, TEXT("BeginStreamingAnimation(%d, %d)"), (int32)bCreateLipSync, (int32)bCreateFacialAnimation);
+	}
+
+	return true;
+}
+
+bool UYnnkMetaFaceController::AppendStreamingPhonemes(const TArray<FPhonemeTextData>& Phonemes)
+{
+	if (!StreamingBuilder.IsValid())
+	{
+		UE_LOG(LogMetaFace, Warning, TEXT("AppendStreamingPhonemes: streaming animation isn't started"));
+		return false;
+	}
+
+	StreamingBuilder->AppendPhonemes(Phonemes);
+	ProcessStreamingPhonemes();
+	return true;
+}
+
+void UYnnkMetaFaceController::FinishStreamingAnimation()
+{
+	if (StreamingBuilder.IsValid())
+	{
+		StreamingBuilder->Finish();
+		ProcessStreamingPhonemes();
+	}
+}
+
+bool UYnnkMetaFaceController::IsStreamingAnimation() const
+{
+	return StreamingBuilder.IsValid();
+}
+
+void UYnnkMetaFaceController::CancelAnimationBuilds(bool bCancelPrefetch)
+{
+	if (auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer")))
+	{
+		FMetaFaceBuildQueue& BuildQueue = ModuleMFE->GetBuildQueue();
+		if (bCancelPrefetch)
+		{
+			for (const auto& Request : AsyncBuildRequests)
+			{
+				BuildQueue.Cancel(Request.Key);
+			}
+			AsyncBuildRequests.Empty();
+		}
+		else if (SpeakNowRequestId != INDEX_NONE)
+		{
+			BuildQueue.Cancel(SpeakNowRequestId);
+			AsyncBuildRequests.Remove(SpeakNowRequestId);
+		}
+	}
+	SpeakNowRequestId = INDEX_NONE;
+
+	CancelStreamingAnimation();
+}
+
+void UYnnkMetaFaceController::CancelStreamingAnimation()
+{
+	if (StreamingBuilder.IsValid())
+	{
+		StreamingBuilder->Cancel();
+		StreamingBuilder.Reset();
+		CurrentLipsync.bStreaming = CurrentFaceAnim.bStreaming = false;
+	}
+}
+
+void UYnnkMetaFaceController::ProcessStreamingPhonemes()
+{
+	TSharedPtr<FMetaFaceStreamingBuilder, ESPMode::ThreadSafe> Builder = StreamingBuilder;
+	const uint32 BuilderPhraseId = PhraseId;
+
+	if (!bAsyncAnimationBuilder)
+	{
+		Builder->ProcessPending([this, &Builder, BuilderPhraseId](FMetaFaceStreamingChunk&& Chunk)
+		{
+			OnStreamingChunkReady(Builder, BuilderPhraseId, MoveTemp(Chunk));
+		});
+		return;
+	}
+
+	// Each task processes all phonemes queued so far, so chunks are produced in order even if tasks start in different order
+	TWeakObjectPtr<UYnnkMetaFaceController> WeakThis(this);
+	auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	ModuleMFE->GetWorkerPool().Launch([WeakThis, Builder, BuilderPhraseId]()
+	{
+		Builder->ProcessPending([&WeakThis, &Builder, BuilderPhraseId](FMetaFaceStreamingChunk&& Chunk)
+		{
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, Builder, BuilderPhraseId, Chunk = MoveTemp(Chunk)]() mutable
+			{
+				if (UYnnkMetaFaceController* This = WeakThis.Get())
+				{
+					This->OnStreamingChunkReady(Builder, BuilderPhraseId, MoveTemp(Chunk));
+				}
+			});
+		});
+	});
+}
+
+void UYnnkMetaFaceController::OnStreamingChunkReady(const TSharedPtr<FMetaFaceStreamingBuilder, ESPMode::ThreadSafe>& Builder, uint32 BuilderPhraseId, FMetaFaceStreamingChunk&& Chunk)
+{
+	// Streaming was restarted or interrupted, or another phrase is playing
+	if (Builder != StreamingBuilder || BuilderPhraseId != PhraseId)
+	{
+		return;
+	}
+
+	if (Chunk.LipSync.Num() > 0)
+	{
+		FMetaFaceClip ChunkClip(Chunk.LipSync);
+		BalanceSmileFrownCurves(ChunkClip);
+		if (bLipSyncToSkeletonCurves)
+		{
+			// keep original curves, see OnAsyncBuilder_AnimationCreated
+			FMetaFaceClip AnimCopy = ChunkClip;
+			UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
+			ChunkClip.AddCurves(AnimCopy);
+		}
+		CurrentLipsync.AppendKeys(ChunkClip);
+	}
+	if (Chunk.FacialAnimation.Num() > 0)
+	{
+		FMetaFaceClip ChunkClip(Chunk.FacialAnimation);
+		if (bBalanceSmileFrownCurves)
+		{
+			ChunkClip.RemoveCurve(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::MouthSmileLeft));
+			ChunkClip.RemoveCurve(FMetaFaceCurveRegistry::GetName(EMetaFaceCurve::MouthSmileRight));
+		}
+		if (bFacialAnimationToSkeletonCurves)
+		{
+			FMetaFaceClip AnimCopy = ChunkClip;
+			UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
+			ChunkClip.AddCurves(AnimCopy);
+		}
+		CurrentFaceAnim.AppendKeys(ChunkClip);
+	}
+
+	// Usually curves are added with the first chunk, next chunks only append keys
+	if (bAutoBakeAnimation && LipsyncController
+		&& !BakedFramePlan.IsCompiledFor(CurrentBakedFaceFrame, LipsyncController->ActiveCurveValues, CurrentLipsync, CurrentFaceAnim))
+	{
+		for (const auto& Curve : CurrentLipsync.AnimationFrame)
+			CurrentBakedFaceFrame.FindOrAdd(Curve.Key);
+		for (const auto& Curve : CurrentFaceAnim.AnimationFrame)
+			CurrentBakedFaceFrame.FindOrAdd(Curve.Key);
+		BakedFramePlan.Compile(CurrentBakedFaceFrame, LipsyncController->ActiveCurveValues, CurrentLipsync, CurrentFaceAnim);
+	}
+
+	// Start playing with the first keys
+	if (CurrentLipsync.IsValid() && !CurrentLipsync.IsActive())
+	{
+		CurrentLipsync.Play();
+	}
+	if (CurrentFaceAnim.IsValid() && !CurrentFaceAnim.IsActive())
+	{
+		CurrentFaceAnim.Play();
+	}
+
+	if (Chunk.bFinished)
+	{
+		CurrentLipsync.bStreaming = CurrentFaceAnim.bStreaming = false;
+		StreamingBuilder.Reset();
+
+		if (bLogDebug)
+		{
+			UE_LOG(LogMetaFace, Log, TEXT("Streaming animation %s (%d phonemes)"), Chunk.bFailed ? TEXT("failed") : TEXT("finished"), Builder->GetPhonemesNum());
+		}
+	}
+}
+
+void UYnnkMetaFaceController::BalanceSmileFrownCurves(FMetaFaceClip& AnimationData) const
+{
+	if (bBalanceSmileFrownCurves)
+	{
+		UMFFunctionLibrary::BalanceSmileFrownCurves(AnimationData);
+	}
+}
+
 bool UYnnkMetaFaceController::InitializeRemoteAnimationBuilder(UYnnkRemoteClient*& RemoteConnectionClient, FString IPv4, int32 Port)
 {
 	if (IsValid(RemoteClient))
@@ -701,180 +1038,121 @@ UNeuralProcessWrapper* UYnnkMetaFaceController::GetNeuralProcessor() const
 	return ModuleMFE->GetNeuralProcessor();
 }
 
-void UYnnkMetaFaceController::AsyncBuildAnimation(UYnnkVoiceLipsyncData* LsData)
+void UYnnkMetaFaceController::AsyncBuildAnimation(UYnnkVoiceLipsyncData* LsData, EMetaFaceBuildPriority Priority)
 {
-	bAsyncWorkerIsActive = true;
-	bExecutionInterrupted = false;
+	const bool bSpeakNow = (Priority == EMetaFaceBuildPriority::SpeakNow);
 
 	if (bLogDebug)
 	{
-		UE_LOG(LogMetaFace, Log, TEXT("AsyncBuildAnimation(\"%s\")"), *LsData->Subtitles.ToString());
+		UE_LOG(LogMetaFace, Log, TEXT("AsyncBuildAnimation(\"%s\", %s)"), *LsData->Subtitles.ToString(), bSpeakNow ? TEXT("speak now") : TEXT("prefetch"));
 	}
 
-	Async(EAsyncExecution::Thread, [this, LsData]()
-	{
-		FString OutData;
-		bool bResult = false;
-		float TimeOffset = 0.f;
-		UNeuralProcessWrapper* NeuralProcessor = GetNeuralProcessor();
-
-		RawAnimDataMap GeneratedData;
-		// Note: Updated from EAsyncExecution::Thread
-		TMap<FName, FSimpleFloatCurve> OutLipsyncData;
-		// Note: Updated from EAsyncExecution::Thread
-		TMap<FName, FSimpleFloatCurve> OutFacialAnimationData;
+	auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer"));
+	FMetaFaceBuildQueue& BuildQueue = ModuleMFE->GetBuildQueue();
 
-		// Lip-sync
-		if (bApplyLipsyncToSpeak && !bExecutionInterrupted)
+	// Phrase could be already prefetched
+	int32 RequestId = INDEX_NONE;
+	for (const auto& Request : AsyncBuildRequests)
+	{
+		if (Request.Value.Get() == LsData)
 		{
-			if (NeuralProcessor->ProcessPhonemesData(LsData->PhonemesData, true, GeneratedData))
-			{
-				if (!bExecutionInterrupted)
-				{
-					bool bSavedLipSyncToSkeletonCurves = bLipSyncToSkeletonCurves;
-					bLipSyncToSkeletonCurves = false;
-					UMFFunctionLibrary::RawDataToLipsync(LsData, GeneratedData, OutLipsyncData, FMetaFaceGenerationSettings(this));
-					bLipSyncToSkeletonCurves = bSavedLipSyncToSkeletonCurves;
-
-					const FName FrownL = TEXT("MouthFrownLeft");
-					const FName FrownR = TEXT("MouthFrownRight");
-					const FName SmileL = TEXT("MouthSmileLeft");
-					const FName SmileR = TEXT("MouthSmileRight");
-
-					if (bBalanceSmileFrownCurves
-						&& OutLipsyncData.Contains(FrownL) && OutLipsyncData.Contains(SmileL)
-						&& OutLipsyncData.Contains(FrownR) && OutLipsyncData.Contains(SmileR))
-					{
-						for (int32 i = 0; i < OutLipsyncData[FrownL].Values.Num(); i++)
-						{
-							if (OutLipsyncData[FrownL].Values[i].Value < OutLipsyncData[SmileL].Values[i].Value)
-							{
-								float Mean = (OutLipsyncData[FrownL].Values[i].Value + OutLipsyncData[SmileL].Values[i].Value) * 0.5f;
-								OutLipsyncData[FrownL].Values[i].Value = OutLipsyncData[SmileL].Values[i].Value = Mean;
-							}
-
-							if (OutLipsyncData[FrownR].Values[i].Value < OutLipsyncData[SmileR].Values[i].Value)
-							{
-								float Mean = (OutLipsyncData[FrownR].Values[i].Value + OutLipsyncData[SmileR].Values[i].Value) * 0.5f;
-								OutLipsyncData[FrownR].Values[i].Value = OutLipsyncData[SmileR].Values[i].Value = Mean;
-							}
-						}
-					}
-					/*
-					if (bLipSyncToSkeletonCurves)
-					{
-						UMFFunctionLibrary::ConvertFacialAnimCurves(OutLipsyncData, ArKitCurvesPoseAsset);
-					}
-					*/
-				}
-				else
-				{
-					if (bLogDebug)
-					{
-						UE_LOG(LogMetaFace, Log, TEXT("AsyncBuildAnimation [Working Thread]: execution was interrupted (1)"), *LsData->Subtitles.ToString());
-					}
-				}
-			}
-			else
-			{
-				OutLipsyncData.Empty();
-				OutData = TEXT("ERROR: can't process data");
-			}
+			RequestId = Request.Key;
+			break;
 		}
+	}
 
-		// Facial Animation
-		if (bApplyFacialAnimationToSpeak && !bExecutionInterrupted)
+	if (bSpeakNow)
+	{
+		// Only cancel own previous speak-now request: prefetched phrases and other controllers keep building
+		if (SpeakNowRequestId != INDEX_NONE && SpeakNowRequestId != RequestId)
 		{
-			GeneratedData.Empty();
-			if (NeuralProcessor->ProcessPhonemesData2(LsData->PhonemesData, false, GeneratedData))
-			{
-				if (!bExecutionInterrupted)
-				{
-					bool bSavedFacialAnimationToSkeletonCurves = bFacialAnimationToSkeletonCurves;
-					bFacialAnimationToSkeletonCurves = false;
-					UMFFunctionLibrary::RawDataToFacialAnimation(LsData, GeneratedData, OutFacialAnimationData, FMetaFaceGenerationSettings(this));
-					bFacialAnimationToSkeletonCurves = bSavedFacialAnimationToSkeletonCurves;
-					if (bBalanceSmileFrownCurves)
-					{
-						OutFacialAnimationData.Remove(TEXT("MouthSmileLeft"));
-						OutFacialAnimationData.Remove(TEXT("MouthSmileRight"));
-					}
-					/*
-					if (bFacialAnimationToSkeletonCurves)
-					{
-						UMFFunctionLibrary::ConvertFacialAnimCurves(OutFacialAnimationData, ArKitCurvesPoseAsset);
-					}
-					*/
-				}
-				else
-				{
-					if (bLogDebug)
-					{
-						UE_LOG(LogMetaFace, Log, TEXT("AsyncBuildAnimation [Working Thread]: execution was interrupted (2)"), *LsData->Subtitles.ToString());
-					}
-				}
-			}
-			else
-			{
-				OutFacialAnimationData.Empty();
-				OutData = TEXT("ERROR: can't process data");
-			}
+			BuildQueue.Cancel(SpeakNowRequestId);
+			AsyncBuildRequests.Remove(SpeakNowRequestId);
 		}
+		SpeakNowRequestId = RequestId;
+	}
 
-		// send result
-		// 
-		// Main job done here
-		if (!bExecutionInterrupted && ProcessedLipsyncData == LsData)
+	if (RequestId != INDEX_NONE)
+	{
+		if (bSpeakNow)
 		{
-			AsyncTask(ENamedThreads::GameThread, [this, OutLipsyncData, OutFacialAnimationData]()
-			{
-				OnAsyncBuilder_AnimationCreated(OutLipsyncData, OutFacialAnimationData);
-			});
+			BuildQueue.SetPriority(RequestId, Priority);
 		}
-		else
+		return;
+	}
+
+	// Skeleton curves are converted in SaveAsyncBuildResult
+	FMetaFaceGenerationSettings GenerationSettings(this);
+	GenerationSettings.bLipSyncToSkeletonCurves = GenerationSettings.bFacialAnimationToSkeletonCurves = false;
+
+	// The same phrase was built recently (i.e. by another controller)
+	FMetaFaceBuildResult RecentResult;
+	if (BuildQueue.FindResult(LsData->PhonemesData, bApplyLipsyncToSpeak, bApplyFacialAnimationToSpeak, GenerationSettings, RecentResult))
+	{
+		SaveAsyncBuildResult(LsData, bSpeakNow, MoveTemp(RecentResult));
+		return;
+	}
+
+	TWeakObjectPtr<UYnnkMetaFaceController> WeakThis(this);
+	RequestId = BuildQueue.Submit(LsData->PhonemesData, bApplyLipsyncToSpeak, bApplyFacialAnimationToSpeak, GenerationSettings, Priority,
+		[WeakThis](int32 CompletedRequestId, bool bSuccess, FMetaFaceBuildResult&& Result)
+	{
+		if (UYnnkMetaFaceController* This = WeakThis.Get())
 		{
-			AsyncTask(ENamedThreads::GameThread, [this]()
-			{
-				OnAsyncBuilder_RequestInterrupted();
-			});
+			This->OnAsyncBuilder_AnimationCreated(CompletedRequestId, bSuccess, MoveTemp(Result));
 		}
 	});
-}
 
-void UYnnkMetaFaceController::OnAsyncBuilder_RequestInterrupted()
-{
-	AsyncBuildMutex.Unlock();
-	bAsyncWorkerIsActive = false;
-	bExecutionInterrupted = false;
-
-	if (bLogDebug)
+	AsyncBuildRequests.Add(RequestId, LsData);
+	if (bSpeakNow)
 	{
-		UE_LOG(LogMetaFace, Log, TEXT("OnAsyncBuilder_RequestInterrupted"));
+		SpeakNowRequestId = RequestId;
 	}
 }
 
-void UYnnkMetaFaceController::OnAsyncBuilder_AnimationCreated(const TMap<FName, FSimpleFloatCurve>& LipsyncData, const TMap<FName, FSimpleFloatCurve>& FacialAnimationData)
+void UYnnkMetaFaceController::OnAsyncBuilder_AnimationCreated(int32 RequestId, bool bSuccess, FMetaFaceBuildResult&& Result)
 {
-	AsyncBuildMutex.Unlock();
-	bAsyncWorkerIsActive = false;
-	if (bExecutionInterrupted)
+	TWeakObjectPtr<UYnnkVoiceLipsyncData> LsData;
+	if (!AsyncBuildRequests.RemoveAndCopyValue(RequestId, LsData))
 	{
-		bExecutionInterrupted = false;
 		return;
 	}
 
+	const bool bSpeakNow = (RequestId == SpeakNowRequestId);
+	if (bSpeakNow)
+	{
+		SpeakNowRequestId = INDEX_NONE;
+	}
+
 	if (bLogDebug)
 	{
-		UE_LOG(LogMetaFace, Log, TEXT("OnAsyncBuilder_AnimationCreated(%d, %d)"), LipsyncData.Num(), FacialAnimationData.Num());
+		UE_LOG(LogMetaFace, Log, TEXT("OnAsyncBuilder_AnimationCreated(%d, %d, %d)"), RequestId, Result.LipSync.AnimationFrame.Num(), Result.FacialAnimation.AnimationFrame.Num());
 	}
 
-	// Initialize animation structs from raw curves sets
-	FMHFacialAnimation LipsyncAnimation, FacialAnimation;
+	if (!bSuccess || !LsData.IsValid())
+	{
+		if (bSpeakNow)
+		{
+			ProcessedLipsyncData = nullptr;
+			bDelayedSpeak = false;
+		}
+		OnAnimationBuildingComplete.Broadcast(LsData.Get(), false);
+		if (bLogDebug)
+		{
+			UE_LOG(LogMetaFace, Log, TEXT("Can't continue speaking, because has no correct lip-sync asset or animation"));
+		}
+		return;
+	}
+
+	SaveAsyncBuildResult(LsData.Get(), bSpeakNow, MoveTemp(Result));
+}
 
+void UYnnkMetaFaceController::SaveAsyncBuildResult(UYnnkVoiceLipsyncData* LsData, bool bSpeakNow, FMetaFaceBuildResult&& Result)
+{
+	// Animations are initialized in worker thread (smile/frown curves are balanced too)
 	if (bApplyLipsyncToSpeak)
 	{
-		LipsyncAnimation.Initialize(LipsyncData, false);
-		if (!LipsyncAnimation.IsValid())
+		if (!Result.LipSync.IsValid())
 		{
 			if (bLogDebug)
 			{
@@ -885,8 +1163,7 @@ void UYnnkMetaFaceController::OnAsyncBuilder_AnimationCreated(const TMap<FName,
 	}
 	if (bApplyFacialAnimationToSpeak)
 	{
-		FacialAnimation.Initialize(FacialAnimationData, true, 1.f, 0.49f);
-		if (!FacialAnimation.IsValid())
+		if (!Result.FacialAnimation.IsValid())
 		{
 			if (bLogDebug)
 			{
@@ -897,69 +1174,62 @@ void UYnnkMetaFaceController::OnAsyncBuilder_AnimationCreated(const TMap<FName,
 	}
 
 	// Save result
-	if (IsValid(ProcessedLipsyncData))
-	{
-		FFacialAnimCollection NewItem;
-		NewItem.LipSync = LipsyncAnimation;
-		NewItem.FacialAnimation = FacialAnimation;
+	FFacialAnimCollection NewItem;
+	NewItem.LipSync = MoveTemp(Result.LipSync);
+	NewItem.FacialAnimation = MoveTemp(Result.FacialAnimation);
 
-		if (bLipSyncToSkeletonCurves && !__is_anim_converted(LipsyncAnimation))
+	if (bLipSyncToSkeletonCurves && NewItem.LipSync.GetClip().IsValid() && !__is_anim_converted(NewItem.LipSync))
+	{
+		if (bLogDebug)
 		{
-			if (bLogDebug)
-			{
-				UE_LOG(LogMetaFace, Log, TEXT("Converting lip-sync (AR curves) to skeletal animation using pose asset"));
-			}
-
-			auto AnimCopy = LipsyncAnimation.AnimationData;
-			UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
-			NewItem.LipSync.AnimationData.Append(AnimCopy);
-			__set_anim_converted(NewItem.LipSync);
+			UE_LOG(LogMetaFace, Log, TEXT("Converting lip-sync (AR curves) to skeletal animation using pose asset"));
 		}
 
-		if (bFacialAnimationToSkeletonCurves && !__is_anim_converted(FacialAnimation))
-		{
-			if (bLogDebug)
-			{
-				UE_LOG(LogMetaFace, Log, TEXT("Converting emotions animation (AR curves) to skeletal animation using pose asset"));
-			}
-
-			auto AnimCopy = FacialAnimation.AnimationData;
-			UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
-			NewItem.FacialAnimation.AnimationData.Append(AnimCopy);
-			__set_anim_converted(NewItem.FacialAnimation);
-		}
+		FMetaFaceClip AnimCopy = *NewItem.LipSync.GetClip();
+		UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
+		NewItem.LipSync.AddCurves(AnimCopy);
+		__set_anim_converted(NewItem.LipSync);
+	}
 
+	if (bFacialAnimationToSkeletonCurves && NewItem.FacialAnimation.GetClip().IsValid() && !__is_anim_converted(NewItem.FacialAnimation))
+	{
 		if (bLogDebug)
 		{
-			UE_LOG(LogMetaFace, Log, TEXT("Facial animation created (%d, %d)"), LipsyncAnimation.AnimationData.Num(), FacialAnimation.AnimationData.Num());
+			UE_LOG(LogMetaFace, Log, TEXT("Converting emotions animation (AR curves) to skeletal animation using pose asset"));
 		}
 
-		FaceAnimations.Add(ProcessedLipsyncData->GetFName(), NewItem);
-
-		if (bDelayedSpeak)
-		{
-			if (bLogDebug)
-			{
-				UE_LOG(LogMetaFace, Log, TEXT("Generated animation is saved in component cache. Continue speaking [%s] with MetaFace animation"), *ProcessedLipsyncData->Subtitles.ToString());
-			}
-			SpeakEx(ProcessedLipsyncData, DelayedSpeak_SoundWave, DelayedSpeak_TimeOffset);
-		}
-		else
-		{
-			OnAnimationBuildingComplete.Broadcast(ProcessedLipsyncData, true);
-		}
+		FMetaFaceClip AnimCopy = *NewItem.FacialAnimation.GetClip();
+		UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
+		NewItem.FacialAnimation.AddCurves(AnimCopy);
+		__set_anim_converted(NewItem.FacialAnimation);
+	}
 
-		ProcessedLipsyncData = nullptr;
+	if (bLogDebug)
+	{
+		UE_LOG(LogMetaFace, Log, TEXT("Facial animation created (%d, %d)"), NewItem.LipSync.AnimationFrame.Num(), NewItem.FacialAnimation.AnimationFrame.Num());
 	}
-	else
+
+	FaceAnimations.Add(LsData->GetFName(), MoveTemp(NewItem));
+
+	if (bSpeakNow && bDelayedSpeak)
 	{
-		OnAnimationBuildingComplete.Broadcast(ProcessedLipsyncData, false);
 		if (bLogDebug)
 		{
-			UE_LOG(LogMetaFace, Log, TEXT("Can't continue speaking, because has no correct lip-sync asset"));
+			UE_LOG(LogMetaFace, Log, TEXT("Generated animation is saved in component cache. Continue speaking [%s] with MetaFace animation"), *LsData->Subtitles.ToString());
 		}
+		bDelayedSpeak = false;
+		SpeakEx(LsData, DelayedSpeak_SoundWave, DelayedSpeak_TimeOffset);
+	}
+	else
+	{
+		OnAnimationBuildingComplete.Broadcast(LsData, true);
+	}
+
+	if (bSpeakNow)
+	{
+		ProcessedLipsyncData = nullptr;
+		bDelayedSpeak = false;
 	}
-	bDelayedSpeak = false;
 }
 
 void UYnnkMetaFaceController::OnRemoteClient_ResponseReceived(int32 RequestID, const FString& Command, const FString& JsonPacket)
@@ -999,9 +1269,9 @@ void UYnnkMetaFaceController::OnRemoteClient_ResponseReceived(int32 RequestID, c
 		JsonHelpers::LoadFromJsonToArray(TEXT("lipsync"), JsonObject, RawData);
 		if (RawData.Num() > 0)
 		{
-			TMap<FName, FSimpleFloatCurve> AnimationData;
+			FMetaFaceClip AnimationData;
 			UMFFunctionLibrary::RawDataToLipsync(ProcessedLipsyncData, RawData, AnimationData, FMetaFaceGenerationSettings(this));
-			LipsyncAnimation.Initialize(AnimationData, false);
+			LipsyncAnimation.Initialize(MoveTemp(AnimationData), false);
 		}
 	}
 	if (bFaceAnim)
@@ -1009,9 +1279,9 @@ void UYnnkMetaFaceController::OnRemoteClient_ResponseReceived(int32 RequestID, c
 		JsonHelpers::LoadFromJsonToArray(TEXT("facial"), JsonObject, RawData);
 		if (RawData.Num() > 0)
 		{
-			TMap<FName, FSimpleFloatCurve> AnimationData;
+			FMetaFaceClip AnimationData;
 			UMFFunctionLibrary::RawDataToFacialAnimation(ProcessedLipsyncData, RawData, AnimationData, FMetaFaceGenerationSettings(this));
-			FacialAnimation.Initialize(AnimationData, true, FacialAnimationPauseDuration, FacialAnimationPauseDuration * 0.5f - 0.01f);
+			FacialAnimation.Initialize(MoveTemp(AnimationData), true, FacialAnimationPauseDuration, FacialAnimationPauseDuration * 0.5f - 0.01f);
 			FacialAnimation.Intensity = EmotionsIntensity;
 		}
 	}
@@ -1020,7 +1290,7 @@ void UYnnkMetaFaceController::OnRemoteClient_ResponseReceived(int32 RequestID, c
 	FFacialAnimCollection NewItem;
 	NewItem.LipSync = LipsyncAnimation;
 	NewItem.FacialAnimation = FacialAnimation;
-	FaceAnimations.Add(ProcessedLipsyncData->GetFName(), NewItem);
+	FaceAnimations.Add(ProcessedLipsyncData->GetFName(), MoveTemp(NewItem));
 
 	if (bDelayedSpeak)
 	{
@@ -1045,25 +1315,27 @@ void UYnnkMetaFaceController::OnLipsyncController_StartSpeaking(UYnnkVoiceLipsyn
 	}
 	else if (bUseExtraAnimationFromLipsyncDataAsset)
 	{
-		auto LipsCopy = PhraseAsset->ExtraAnimData1;
+		FMetaFaceClip LipsCopy(PhraseAsset->ExtraAnimData1);
 		if (bLipSyncToSkeletonCurves)
 		{
 			// convert to target curves using pose asset
-			UMFFunctionLibrary::ConvertFacialAnimCurves(LipsCopy, ArKitCurvesPoseAsset);
+			FMetaFaceClip ConvertedLips = LipsCopy;
+			UMFFunctionLibrary::ConvertFacialAnimCurves(ConvertedLips, ArKitCurvesPoseAsset);
 			// but keep original curves, for example, to fix bones animation
-			LipsCopy.Append(PhraseAsset->ExtraAnimData1);
+			LipsCopy.AddCurves(ConvertedLips);
 		}
-		CurrentLipsync.Initialize(LipsCopy, false);
+		CurrentLipsync.Initialize(MoveTemp(LipsCopy), false);
 
-		auto AnimCopy = PhraseAsset->ExtraAnimData2;
+		FMetaFaceClip AnimCopy(PhraseAsset->ExtraAnimData2);
 		if (bFacialAnimationToSkeletonCurves)
 		{
 			// convert to target curves using pose asset
-			UMFFunctionLibrary::ConvertFacialAnimCurves(AnimCopy, ArKitCurvesPoseAsset);
+			FMetaFaceClip ConvertedAnim = AnimCopy;
+			UMFFunctionLibrary::ConvertFacialAnimCurves(ConvertedAnim, ArKitCurvesPoseAsset);
 			// keep original curves
-			AnimCopy.Append(PhraseAsset->ExtraAnimData2);
+			AnimCopy.AddCurves(ConvertedAnim);
 		}
-		CurrentFaceAnim.Initialize(AnimCopy, true, 1.f, 0.49f);
+		CurrentFaceAnim.Initialize(MoveTemp(AnimCopy), true, 1.f, 0.49f);
 
 		if (bLogDebug)
 		{
@@ -1075,13 +1347,12 @@ void UYnnkMetaFaceController::OnLipsyncController_StartSpeaking(UYnnkVoiceLipsyn
 		return;
 	}
 
+	// New phrase replaces streaming animation
+	CancelStreamingAnimation();
+	PhraseId++;
+
 	if (bAutoBakeAnimation)
 	{
-		if (LipSyncARCurvesSet.IsEmpty())
-		{
-			UMFFunctionLibrary::GetMetaFaceCurvesSet(LipSyncARCurvesSet, true);
-		}
-		
 		CurrentBakedFaceFrame.Empty();
 
 		for (const auto& Curve : PhraseAsset->RawCurves)
@@ -1089,14 +1360,15 @@ void UYnnkMetaFaceController::OnLipsyncController_StartSpeaking(UYnnkVoiceLipsyn
 
 		if (bApplyLipsyncToSpeak && CurrentLipsync.IsValid())
 		{
-			for (const auto& Curve : CurrentLipsync.AnimationData)
+			for (const auto& Curve : CurrentLipsync.AnimationFrame)
 				CurrentBakedFaceFrame.Add(Curve.Key);
 		}
 		if (bApplyFacialAnimationToSpeak && CurrentFaceAnim.IsValid())
 		{
-			for (const auto& Curve : CurrentFaceAnim.AnimationData)
+			for (const auto& Curve : CurrentFaceAnim.AnimationFrame)
 				CurrentBakedFaceFrame.Add(Curve.Key);
 		}
+		BakedFramePlan.Compile(CurrentBakedFaceFrame, LipsyncController->ActiveCurveValues, CurrentLipsync, CurrentFaceAnim);
 	}
 
 	// Play animation?
@@ -1108,8 +1380,7 @@ void UYnnkMetaFaceController::OnLipsyncController_StartSpeaking(UYnnkVoiceLipsyn
 bool UYnnkMetaFaceController::CheckAnimationCurvesSetIsArKit(const TMap<FName, FSimpleFloatCurve>& Animation, bool bLipSyncCurves) const
 {
 	// get arkit curves
-	TArray<FName> CompareSet;
-	UMFFunctionLibrary::GetMetaFaceCurvesSet(CompareSet, bLipSyncCurves);
+	const TArray<FName>& CompareSet = FMetaFaceCurveRegistry::GetCurveSet(bLipSyncCurves);
 
 	// has more curves already?
 	if (Animation.Num() + 3 > CompareSet.Num())
@@ -1135,6 +1406,9 @@ bool UYnnkMetaFaceController::CheckAnimationCurvesSetIsArKit(const TMap<FName, F
 
 void UYnnkMetaFaceController::OnLipsyncController_SpeakingInterrupted(UYnnkVoiceLipsyncData* PhraseAsset)
 {
+	// Prefetched replies are still valid
+	CancelAnimationBuilds(false);
+
 	if (CurrentLipsync.IsValid())
 	{
 		CurrentLipsync.Stop();
@@ -7,6 +7,11 @@
 #include "YnnkVoiceLipsyncData.h"
 #include "Interfaces/IPluginManager.h"
 #include "NeuralProcessWrapper.h"
+#include "MetaFaceInferenceService.h"
+#include "MetaFaceWorkerPool.h"
+#include "MetaFaceBuildQueue.h"
+#include "YnnkMetaFaceSettings.h"
+#include "Async/Async.h"
 #include "Engine/Engine.h"
 #include "Runtime/Launch/Resources/Version.h"
 
@@ -14,17 +19,34 @@
 
 void FYnnkMetaFaceEnhancerModule::StartupModule()
 {
+	const auto Settings = GetDefault<UYnnkMetaFaceSettings>();
+	WorkerPool = MakeUnique<FMetaFaceWorkerPool>();
+	WorkerPool->Create(Settings->WorkerThreadsNum, Settings->GetWorkerThreadsPriority(), (uint64)Settings->WorkerThreadsAffinityMask);
+	BuildQueue = MakeShared<FMetaFaceBuildQueue, ESPMode::ThreadSafe>(*this);
+
 	//NeuralProcessWrapper = nullptr;
 	NeuralProcessWrapper = NewObject<UNeuralProcessWrapper>();
 	if (IsValid(NeuralProcessWrapper))
 	{
 		NeuralProcessWrapper->AddToRoot();
-		NeuralProcessWrapper->Initialize();
+
+		InferenceService = MakeUnique<FMetaFaceInferenceService>(NeuralProcessWrapper);
+		LoadModels();
 	}
 }
 
 void FYnnkMetaFaceEnhancerModule::ShutdownModule()
 {
+	if (IsValid(NeuralProcessWrapper))
+	{
+		NeuralProcessWrapper->WaitForModels();
+	}
+	// Cancel build jobs, so running jobs return quickly. Jobs still queued in the pool are abandoned without execution.
+	BuildQueue->Reset();
+	WorkerPool->Destroy();
+	BuildQueue.Reset();
+	InferenceService.Reset();
+
 	if (IsValid(NeuralProcessWrapper))
 	{
 		if (NeuralProcessWrapper->IsRooted())
@@ -71,7 +93,8 @@ TObjectPtr<UNeuralProcessWrapper> FYnnkMetaFaceEnhancerModule::GetNeuralProcesso
 UNeuralProcessWrapper* FYnnkMetaFaceEnhancerModule::GetNeuralProcessor()
 #endif
 {
-	if (!IsValid(NeuralProcessWrapper) || !NeuralProcessWrapper->IsValid())
+	// Models are reloaded in game thread only, other threads get processor as is
+	if ((!IsValid(NeuralProcessWrapper) || (!NeuralProcessWrapper->IsValid() && !NeuralProcessWrapper->IsLoading())) && IsInGameThread())
 	{
 		//InitializeTorchModels(nullptr);
 		if (!IsValid(NeuralProcessWrapper))
@@ -81,13 +104,59 @@ UNeuralProcessWrapper* FYnnkMetaFaceEnhancerModule::GetNeuralProcessor()
 		if (IsValid(NeuralProcessWrapper))
 		{
 			NeuralProcessWrapper->AddToRoot();
-			NeuralProcessWrapper->Initialize();
+
+			if (InferenceService.IsValid())
+			{
+				InferenceService->SetProcessor(NeuralProcessWrapper);
+			}
+			else
+			{
+				InferenceService = MakeUnique<FMetaFaceInferenceService>(NeuralProcessWrapper);
+			}
+			LoadModels();
 		}
 	}
 
 	return NeuralProcessWrapper;
 }
 
+void FYnnkMetaFaceEnhancerModule::LoadModels()
+{
+	const auto Settings = GetDefault<UYnnkMetaFaceSettings>();
+
+	if (!Settings->bLoadModelsInBackground)
+	{
+		NeuralProcessWrapper->Initialize();
+		if (Settings->bWarmUpModels)
+		{
+			NeuralProcessWrapper->WarmUp();
+		}
+		return;
+	}
+
+	InferenceService->SetWaitingForModels(true);
+	FMetaFaceInferenceService* Service = InferenceService.Get();
+
+	// Module waits for loading in ShutdownModule, so service is valid in the loading thread
+	NeuralProcessWrapper->InitializeAsync(Settings->bWarmUpModels, [Service]()
+	{
+		Service->SetWaitingForModels(false);
+
+		AsyncTask(ENamedThreads::GameThread, []()
+		{
+			if (auto ModuleMFE = FModuleManager::GetModulePtr<FYnnkMetaFaceEnhancerModule>(TEXT("YnnkMetaFaceEnhancer")))
+			{
+				ModuleMFE->ModelsReadyEvent.Broadcast();
+			}
+		});
+	});
+}
+
+bool FYnnkMetaFaceEnhancerModule::IsLoadingModels() const
+{
+	return NeuralProcessWrapper && NeuralProcessWrapper->IsLoading();
+}
+
 bool FYnnkMetaFaceEnhancerModule::IsEmotionsModelReady() const
 {
 	return NeuralProcessWrapper && NeuralProcessWrapper->IsEmotionsModelReady();
@@ -100,9 +169,16 @@ bool FYnnkMetaFaceEnhancerModule::IsLipsyncModelReady() const
 
 bool FYnnkMetaFaceEnhancerModule::ProcessPhonemesData(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData)
 {
-	if (NeuralProcessWrapper && NeuralProcessWrapper->IsValid())
+	// Inference service holds requests until models are loaded
+	if (InferenceService.IsValid() && IsLoadingModels())
 	{
-		return NeuralProcessWrapper->ProcessPhonemesData(PhonemesData, bUseLipsyncModel, OutData);
+		return InferenceService->ProcessPhonemes(PhonemesData, bUseLipsyncModel, OutData);
+	}
+	else if (NeuralProcessWrapper && NeuralProcessWrapper->IsValid())
+	{
+		return InferenceService.IsValid()
+			? InferenceService->ProcessPhonemes(PhonemesData, bUseLipsyncModel, OutData)
+			: NeuralProcessWrapper->ProcessPhonemesData(PhonemesData, bUseLipsyncModel, OutData);
 	}
 	else
 	{
@@ -112,9 +188,15 @@ bool FYnnkMetaFaceEnhancerModule::ProcessPhonemesData(const TArray<FPhonemeTextD
 
 bool FYnnkMetaFaceEnhancerModule::ProcessPhonemesData2(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData)
 {
-	if (NeuralProcessWrapper && NeuralProcessWrapper->IsValid())
+	if (InferenceService.IsValid() && IsLoadingModels())
+	{
+		return InferenceService->ProcessPhonemes(PhonemesData, false, OutData);
+	}
+	else if (NeuralProcessWrapper && NeuralProcessWrapper->IsValid())
 	{
-		return NeuralProcessWrapper->ProcessPhonemesData2(PhonemesData, bUseLipsyncModel, OutData);
+		return InferenceService.IsValid()
+			? InferenceService->ProcessPhonemes(PhonemesData, false, OutData)
+			: NeuralProcessWrapper->ProcessPhonemesData2(PhonemesData, bUseLipsyncModel, OutData);
 	}
 	else
 	{
@@ -14,6 +14,16 @@ UYnnkMetaFaceSettings::UYnnkMetaFaceSettings()
 	, LipsyncNeuralIntensity(1.f)
 	, LipsyncSmoothness(0.3f)
 	, FacialAnimationSmoothness(1.f)
+	, bLoadModelsInBackground(true)
+	, bWarmUpModels(true)
+	, bUseLookupTables(true)
+	, NeuralModelReplicas(2)
+	, BatchingWindowMs(0.f)
+	, MaxBatchSize(16)
+	, WorkerThreadsNum(0)
+	, WorkerThreadsPriority(EMetaFaceThreadPriority::TP_BelowNormal)
+	, WorkerThreadsAffinityMask(0)
+	, bTickControllersInSubsystem(false)
 {
 	// Initialize poses for visemes
 	if (!LipsyncVisemesPreset.Num())
@@ -409,3 +419,38 @@ UYnnkMetaFaceSettings::UYnnkMetaFaceSettings()
 		LipsyncVisemesPreset.Add(EYnnkViseme::YV_OtherVowel, Curves);
 	}
 }
+
+EThreadPriority UYnnkMetaFaceSettings::GetWorkerThreadsPriority() const
+{
+	switch (WorkerThreadsPriority)
+	{
+		case EMetaFaceThreadPriority::TP_Lowest: return TPri_Lowest;
+		case EMetaFaceThreadPriority::TP_SlightlyBelowNormal: return TPri_SlightlyBelowNormal;
+		case EMetaFaceThreadPriority::TP_Normal: return TPri_Normal;
+		default: return TPri_BelowNormal;
+	}
+}
+
+FMetaFaceVisemeTablePtr UYnnkMetaFaceSettings::GetVisemeTable() const
+{
+	FScopeLock Lock(&VisemeTableSection);
+	if (!VisemeTable.IsValid())
+	{
+		VisemeTable = MakeShared<const FMetaFaceVisemeTable, ESPMode::ThreadSafe>(LipsyncVisemesPreset);
+	}
+	return VisemeTable;
+}
+
+#if WITH_EDITOR
+void UYnnkMetaFaceSettings::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UYnnkMetaFaceSettings, LipsyncVisemesPreset))
+	{
+		// Compiled again on next use
+		FScopeLock Lock(&VisemeTableSection);
+		VisemeTable.Reset();
+	}
+}
+#endif
@@ -0,0 +1,84 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Animation/AnimNodeBase.h"
+#include "MetaFaceTypes.h"
+#include "AnimNode_MetaFaceCurves.generated.h"
+
+class UYnnkMetaFaceController;
+
+/**
+ *	Applies lip-sync and facial animation of UYnnkMetaFaceController of the owning actor to curves of the pose.
+ *	Clips are sampled in animation thread, game thread only copies playback parameters.
+ */
+USTRUCT(BlueprintInternalUseOnly)
+struct YNNKMETAFACEENHANCER_API FAnimNode_MetaFaceCurves : public FAnimNode_Base
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, Category = Links)
+	FPoseLink Source;
+
+	/** Apply CurrentLipsync of controller */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (PinHiddenByDefault))
+	bool bApplyLipsync;
+
+	/** Apply CurrentFaceAnim of controller */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (PinHiddenByDefault))
+	bool bApplyFacialAnimation;
+
+	/** Blend weight of MetaFace curves over curves of source pose */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (PinShownByDefault))
+	float Alpha;
+
+	FAnimNode_MetaFaceCurves();
+
+	// FAnimNode_Base interface
+	virtual void Initialize_AnyThread(const FAnimationInitializeContext& Context) override;
+	virtual void CacheBones_AnyThread(const FAnimationCacheBonesContext& Context) override;
+	virtual void Update_AnyThread(const FAnimationUpdateContext& Context) override;
+	virtual void Evaluate_AnyThread(FPoseContext& Output) override;
+	virtual void GatherDebugData(FNodeDebugData& DebugData) override;
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
+	// End of FAnimNode_Base interface
+
+private:
+	/** Playback state of animation copied from controller in game thread */
+	struct FAnimationSnapshot
+	{
+		FMetaFaceClipPtr Clip;
+		FMetaFaceFrameParams Params;
+		// Curves dropped by animation LOD of controller
+		EMetaFaceCurveFlags DroppedCurves = EMetaFaceCurveFlags::None;
+		bool bPlaying = false;
+		// Animation is fading out after interruption: use frame values of controller
+		bool bFadingOut = false;
+		FMetaFaceClip::FValuesArray FadeOutValues;
+	};
+
+	/** Sampling state of animation in animation thread */
+	struct FAnimationSampler
+	{
+		FMetaFaceClipPtr Clip;
+		FMetaFaceClip::FValuesArray PauseMask;
+		EMetaFaceCurveFlags DroppedCurves = EMetaFaceCurveFlags::None;
+		FMetaFaceClip::FValuesArray CurveMask;
+		FMetaFaceClip::FValuesArray Values;
+		// Curves of clip in the order of FBlendedCurve elements
+		TArray<int32> SortedCurves;
+		int32 KeyCursor = 0;
+	};
+
+	TWeakObjectPtr<UYnnkMetaFaceController> Controller;
+	FAnimationSnapshot Snapshots[2];
+	FAnimationSampler Samplers[2];
+
+	void TakeSnapshot(const FMHFacialAnimation& Animation, FAnimationSnapshot& OutSnapshot) const;
+	/** Sample animation and add its curves to OutCurve */
+	static void SampleAnimation(const FAnimationSnapshot& Snapshot, FAnimationSampler& Sampler, FBlendedCurve& OutCurve);
+};
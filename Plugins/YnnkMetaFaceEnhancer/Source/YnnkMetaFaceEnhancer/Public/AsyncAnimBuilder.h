@@ -8,6 +8,7 @@
 #include "YnnkTypes.h"
 #include "HAL/CriticalSection.h"
 #include "MetaFaceTypes.h"
+#include "MetaFaceCancellationToken.h"
 #include "MetaFaceFunctionLibrary.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "AsyncAnimBuilder.generated.h"
@@ -54,11 +55,11 @@ public:
 	UNeuralProcessWrapper* NeuralProcessor;
 #endif
 
-	// Note: Updated from EAsyncExecution::Thread
+	// Note: Set in game thread when the job is completed
 	UPROPERTY()
 	TMap<FName, FSimpleFloatCurve> OutLipsyncData;
 
-	// Note: Updated from EAsyncExecution::Thread
+	// Note: Set in game thread when the job is completed
 	UPROPERTY()
 	TMap<FName, FSimpleFloatCurve> OutFacialAnimationData;
 
@@ -104,8 +105,8 @@ protected:
 	/** Is active? */
 	UPROPERTY()
 	bool bIsWorking;
-	UPROPERTY()
-	bool bExecutionInterrupted;
+	// Cancellation of the current request
+	FMetaFaceCancellationTokenPtr CancellationToken;
 
 	TFuture<void> WorkingThreadFA;
 	UPROPERTY()
@@ -129,6 +130,4 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Async Recognizer")
 	void Stop();
 
-	static FCriticalSection StartAsyncMutex;
-
 };
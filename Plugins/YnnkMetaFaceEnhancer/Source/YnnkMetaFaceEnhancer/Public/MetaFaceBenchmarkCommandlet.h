@@ -0,0 +1,41 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "YnnkVoiceLipsyncData.h"
+#include "MetaFaceBenchmarkCommandlet.generated.h"
+
+/**
+* Headless benchmark of animation generation stages:
+* model evaluation, RawDataToLipsync, RawDataToFacialAnimation (and its smoothing by FIR and IIR), ConvertFacialAnimCurves,
+* playback sampling at 60 fps (dense clip with and without key cursor, FMHFacialAnimation::ProcessFrame,
+* the same curves as TMap), mixing of baked frame by FMetaFaceBlendPlan
+* and the whole build of both models (sequential, parallel and streamed by FMetaFaceStreamingBuilder).
+* Phrases: warm-up phrase of PrepareYnnkMetaFaceModel and deterministic synthetic phrases 1..60 sec long.
+* Models are called through FYnnkMetaFaceEnhancerModule::ProcessPhonemesData, as animation builders do.
+* For each stage reports phrase latency percentiles, latency per phoneme and memory kept by the stage (process and
+* engine allocator stats) as JSON, memory of lip-sync animation as clip and as TMap, and throughput of 1..MaxConcurrency
+* parallel callers.
+*
+* UnrealEditor-Cmd <Project>.uproject -run=MetaFaceBenchmark -nullrhi -unattended [-Iterations=20] [-MaxDuration=60]
+*	[-MaxConcurrency=<cores>] [-PoseAsset=/Game/MetaHumans/Common/Common/Mocap/mh_arkit_mapping_pose] [-Output=<file.json>]
+*/
+UCLASS()
+class YNNKMETAFACEENHANCER_API UMetaFaceBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMetaFaceBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	/** Generate phrase of the specified duration. The same seed always gives the same phonemes. */
+	static void MakeSyntheticPhrase(float Duration, int32 Seed, TArray<FPhonemeTextData>& OutPhonemes);
+
+	/** Nearest-rank percentile (0..100) of sorted samples, 0 if there are no samples */
+	static double GetPercentile(const TArray<double>& SortedSamples, double Percentile);
+};
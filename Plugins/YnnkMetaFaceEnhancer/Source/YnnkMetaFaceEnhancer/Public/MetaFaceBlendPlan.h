@@ -0,0 +1,64 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MetaFaceTypes.h"
+
+/**
+* Mixing of Ynnk Voice Lip-Sync curves, MetaFace lip-sync and facial animation frames to a baked frame (bAutoBakeAnimation).
+* Plan is compiled once per phrase: for every output curve it keeps indices of source values, so a frame is mixed
+* without map lookups as Out = Clamp((Ynnk * WYnnk + Lipsync * WLipsync + Face * WFace) * Post, -1, 1) for 4 curves at once.
+*/
+struct YNNKMETAFACEENHANCER_API FMetaFaceBlendPlan
+{
+	FMetaFaceBlendPlan();
+
+	/** Build plan for the current curves of output frame and sources */
+	void Compile(const TMap<FName, float>& OutFrame, const TMap<FName, float>& YnnkCurves, const FMHFacialAnimation& Lipsync, const FMHFacialAnimation& FacialAnimation);
+
+	/**
+	* Mix sources to OutFrame. Returns false if curves of output frame or sources were changed after Compile:
+	* plan should be compiled again.
+	*/
+	bool Evaluate(TMap<FName, float>& OutFrame, const TMap<FName, float>& YnnkCurves, bool bUseYnnkCurves, const FMHFacialAnimation& Lipsync, const FMHFacialAnimation& FacialAnimation,
+		float YnnkRatio, float LipsyncIntensity, float FacialAnimationIntensity);
+
+	/** Was plan compiled for the current curves of output frame and sources? */
+	bool IsCompiledFor(const TMap<FName, float>& OutFrame, const TMap<FName, float>& YnnkCurves, const FMHFacialAnimation& Lipsync, const FMHFacialAnimation& FacialAnimation) const;
+
+	void Reset();
+
+private:
+	struct FYnnkSource
+	{
+		int32 Slot;
+		FName CurveName;
+		FSetElementId Id;
+	};
+
+	// Curves of output frame in the order of iteration
+	TArray<FName> SlotNames;
+	int32 YnnkCurvesNum;
+	const FMetaFaceClip* LipsyncClip;
+	int32 LipsyncCurvesNum;
+	const FMetaFaceClip* FacialAnimationClip;
+	int32 FacialAnimationCurvesNum;
+
+	// Source indices per slot (INDEX_NONE if source doesn't have the curve)
+	TArray<FYnnkSource> YnnkSources;
+	TArray<int32> LipsyncSources;
+	TArray<int32> FacialAnimationSources;
+
+	// 1 if slot has Ynnk curve
+	FMetaFaceClip::FValuesArray YnnkMask;
+	// 1 if slot is lip-sync curve of ARKit (affected by lip-sync intensity twice)
+	FMetaFaceClip::FValuesArray LipsyncCurvesMask;
+
+	// Gathered values of sources, padded to 4 slots
+	FMetaFaceClip::FValuesArray YnnkValues;
+	FMetaFaceClip::FValuesArray LipsyncValues;
+	FMetaFaceClip::FValuesArray FacialAnimationValues;
+	FMetaFaceClip::FValuesArray OutValues;
+};
@@ -0,0 +1,124 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MetaFaceTypes.h"
+#include "MetaFaceCancellationToken.h"
+#include "Containers/Queue.h"
+#include "YnnkVoiceLipsyncData.h"
+
+class FYnnkMetaFaceEnhancerModule;
+
+/** Priority class of animation build request */
+enum class EMetaFaceBuildPriority : uint8
+{
+	// Animation is required to start speaking
+	SpeakNow,
+	// Animation will be required later (queued replies)
+	Prefetch
+};
+
+/** Animations built for a single request in worker thread (skeleton curves aren't converted) */
+struct FMetaFaceBuildResult
+{
+	FMHFacialAnimation LipSync;
+	FMHFacialAnimation FacialAnimation;
+};
+
+/** Called in game thread. Callback owns the result and can move animations from it. */
+typedef TFunction<void(int32 /* RequestId */, bool /* bSuccess */, FMetaFaceBuildResult&& /* Result */)> FMetaFaceBuildCallback;
+
+/**
+* Process-wide queue of animation build jobs executed on the MetaFace worker pool.
+* Speak-now jobs are always started before prefetch jobs, and prefetch jobs never occupy all workers.
+* Requests with the same phonemes and generation settings share a single job (or a recently built result).
+* Completed animations are passed from workers to game thread by moving, without copying curves;
+* recent results share clips with animations passed to callbacks.
+* All methods should be called in game thread.
+*/
+class YNNKMETAFACEENHANCER_API FMetaFaceBuildQueue : public TSharedFromThis<FMetaFaceBuildQueue, ESPMode::ThreadSafe>
+{
+public:
+	FMetaFaceBuildQueue(FYnnkMetaFaceEnhancerModule& InOwner);
+
+	/** Get result of recently completed request with the same content. Animations share clips with the cached result. */
+	bool FindResult(const TArray<FPhonemeTextData>& PhonemesData, bool bLipsync, bool bFacialAnimation, const FMetaFaceGenerationSettings& Settings,
+		FMetaFaceBuildResult& OutResult);
+
+	/** Add request and get its ID. Callback is never executed before Submit returns. */
+	int32 Submit(const TArray<FPhonemeTextData>& PhonemesData, bool bLipsync, bool bFacialAnimation, const FMetaFaceGenerationSettings& Settings,
+		EMetaFaceBuildPriority Priority, FMetaFaceBuildCallback&& Callback);
+
+	/** Forget request. Job is cancelled if no other request waits for it. */
+	void Cancel(int32 RequestId);
+
+	/** Move request to another priority class (i.e. prefetched phrase is about to be spoken) */
+	void SetPriority(int32 RequestId, EMetaFaceBuildPriority Priority);
+
+	/** Is request queued or running? */
+	bool IsPending(int32 RequestId) const;
+
+	/** Cancel all jobs and clear recent results */
+	void Reset();
+
+	/** Number of recently built results kept to serve identical requests */
+	static constexpr int32 ResultsCacheSize = 8;
+
+private:
+	struct FJob
+	{
+		uint32 Hash = 0;
+		TArray<FPhonemeTextData> PhonemesData;
+		bool bLipsync = false;
+		bool bFacialAnimation = false;
+		FMetaFaceGenerationSettings Settings;
+		EMetaFaceBuildPriority Priority = EMetaFaceBuildPriority::Prefetch;
+		bool bRunning = false;
+		FMetaFaceCancellationTokenPtr Token;
+		TMap<int32, FMetaFaceBuildCallback> Waiters;
+
+		bool IsSameRequest(uint32 InHash, const TArray<FPhonemeTextData>& InPhonemesData, bool bInLipsync, bool bInFacialAnimation, const FMetaFaceGenerationSettings& InSettings) const;
+	};
+
+	typedef TSharedPtr<FJob, ESPMode::ThreadSafe> FJobPtr;
+
+	struct FCachedResult
+	{
+		FJobPtr Job;
+		FMetaFaceBuildResult Result;
+	};
+
+	struct FCompletedJob
+	{
+		FJobPtr Job;
+		bool bSuccess = false;
+		FMetaFaceBuildResult Result;
+	};
+
+	FYnnkMetaFaceEnhancerModule& Owner;
+	int32 LastRequestId;
+	int32 RunningNum;
+
+	// Queued and running jobs
+	TArray<FJobPtr> Jobs;
+	// Request ID -> job
+	TMap<int32, FJobPtr> Requests;
+	// Filled by workers, read in game thread
+	TQueue<FCompletedJob, EQueueMode::Mpsc> CompletedJobs;
+	// Recently completed jobs (the last one is the newest)
+	TArray<FCachedResult> RecentResults;
+
+	static uint32 GetRequestHash(const TArray<FPhonemeTextData>& PhonemesData, bool bLipsync, bool bFacialAnimation, const FMetaFaceGenerationSettings& Settings);
+
+	/** Max number of jobs executed at the same time */
+	int32 GetMaxRunningNum() const;
+
+	/** Start queued jobs while workers are available */
+	void StartJobs();
+	void RunJob(const FJobPtr& Job);
+	/** Deliver results published by workers */
+	void ProcessCompletedJobs();
+	void OnJobComplete(FCompletedJob& CompletedJob);
+};
@@ -0,0 +1,33 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+
+/**
+* Cancellation flag of a single animation build request. It's owned by the requester (controller, async builder)
+* and checked by inference and post-processing between steps, so cancelling one request doesn't affect others.
+* Time from Cancel() to release of the waiting caller is bounded by:
+* - one model call of UNeuralProcessWrapper::MaxSymbolsPerCall inputs (or one lookup table evaluation),
+* - UNeuralProcessWrapper::ReplicaCancellationPollMs while waiting for a free model replica,
+* - FMetaFaceInferenceService::CancellationPollMs while waiting for models, for batching window or for a batch.
+*/
+class FMetaFaceCancellationToken
+{
+public:
+	void Cancel() { bCancelled = true; }
+	bool IsCancelled() const { return bCancelled; }
+
+private:
+	FThreadSafeBool bCancelled;
+};
+
+typedef TSharedPtr<FMetaFaceCancellationToken, ESPMode::ThreadSafe> FMetaFaceCancellationTokenPtr;
+
+/** Is request cancelled? (null token is never cancelled) */
+FORCEINLINE bool IsRequestCancelled(const FMetaFaceCancellationToken* Token)
+{
+	return Token && Token->IsCancelled();
+}
@@ -0,0 +1,100 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YnnkTypes.h"
+#include "MetaFaceCurveRegistry.h"
+
+/**
+* Facial animation in dense format. All curves are keyed at the same times (phonemes and fade keys),
+* so clip stores a single time axis and [keys x curves] matrix of values: a row contains values of all curves at a key.
+* Rows are padded to 4 floats and memory is 64-byte aligned, so a row can be processed with SIMD.
+* Clip isn't modified after it's shared, so all FMHFacialAnimation objects playing the same phrase
+* (cache of controller, current playback, other avatars) reference a single copy.
+*/
+struct YNNKMETAFACEENHANCER_API FMetaFaceClip
+{
+	typedef TArray<float, TAlignedHeapAllocator<64>> FValuesArray;
+
+	FMetaFaceClip();
+	explicit FMetaFaceClip(const TArray<FName>& InCurveNames, int32 KeysNumToReserve = 0);
+	/** Convert from TMap representation (Blueprints, UYnnkVoiceLipsyncData assets) */
+	explicit FMetaFaceClip(const TMap<FName, FSimpleFloatCurve>& InCurves);
+
+	/** Remove all keys and set new list of curves */
+	void Reset(const TArray<FName>& InCurveNames, int32 KeysNumToReserve = 0);
+
+	/** Add key with zero values to the end. Time can't be less than time of the last key. Returns row of values. */
+	float* AddKey(float Time);
+
+	int32 GetCurvesNum() const { return CurveNames.Num(); }
+	int32 GetKeysNum() const { return Times.Num(); }
+	/** Number of floats in a row of values (>= GetCurvesNum()) */
+	int32 GetStride() const { return Stride; }
+	const TArray<FName>& GetCurveNames() const { return CurveNames; }
+	/** IDs of curves in FMetaFaceCurveRegistry, in the same order as names */
+	const TArray<int32>& GetCurveIds() const { return CurveIds; }
+	int32 FindCurve(FName CurveName) const { return CurveNames.IndexOfByKey(CurveName); }
+	int32 FindCurve(EMetaFaceCurve Curve) const { return CurveIds.IndexOfByKey((int32)Curve); }
+	const FValuesArray& GetTimes() const { return Times; }
+	float GetTime(int32 Key) const { return Times[Key]; }
+	const float* GetKey(int32 Key) const { return Values.GetData() + Key * Stride; }
+	float* GetKey(int32 Key) { return Values.GetData() + Key * Stride; }
+	float GetValue(int32 Key, int32 Curve) const { return Values[Key * Stride + Curve]; }
+	float& GetValue(int32 Key, int32 Curve) { return Values[Key * Stride + Curve]; }
+	/** Time of the last key */
+	float GetDuration() const { return Times.Num() > 0 ? Times.Last() : 0.f; }
+
+	/** Find interval containing Time: value at time is lerp(Key, Key + 1, Alpha). Alpha is 0 outside of the clip. */
+	void FindKeys(float Time, int32& OutKey, float& OutAlpha) const;
+	/**
+	* Same as FindKeys, but starts from key found for previous time. Playback time only grows,
+	* so cursor stays or moves forward by a key or two, and binary search is done only if time moves back.
+	* Cursor should be set to 0 before the first call.
+	*/
+	void FindKeys(float Time, int32& InOutCursor, float& OutAlpha) const;
+	/** Evaluate all curves. OutValues should have GetStride() elements. */
+	void Evaluate(float Time, float* OutValues) const;
+	/** Evaluate all curves using key cursor (see FindKeys). OutValues should have GetStride() elements and be 16-byte aligned. */
+	void Evaluate(float Time, int32& InOutCursor, float* OutValues) const;
+	/** Evaluate a single curve */
+	float EvaluateCurve(int32 Curve, float Time) const;
+	/** Time passed from the previous key and time left to the next key */
+	void GetIntervalsToKeys(float Time, float& OutFromPrevious, float& OutToNext) const;
+	/** Time passed from the previous key and time left to the next key for key cursor set by FindKeys or Evaluate */
+	void GetIntervalsToKeys(float Time, int32 Cursor, float& OutFromPrevious, float& OutToNext) const;
+
+	/** Add or replace curves. Other clip is resampled if it has different keys. */
+	void AddCurves(const FMetaFaceClip& Other);
+	/** Remove curve if it exists */
+	void RemoveCurve(FName CurveName);
+	/** Add keys of other clip to the end (streaming). Curves missing in one of clips keep their last/first value. */
+	void AppendKeys(const FMetaFaceClip& Other);
+
+	/** Convert from TMap representation. Curves keyed at different times are resampled to the union of their keys. */
+	void FromCurves(const TMap<FName, FSimpleFloatCurve>& InCurves);
+	/** Convert to TMap representation */
+	void ToCurves(TMap<FName, FSimpleFloatCurve>& OutCurves) const;
+
+	/** Memory used by clip data */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	TArray<FName> CurveNames;
+	TArray<int32> CurveIds;
+	int32 Stride;
+	FValuesArray Times;
+	FValuesArray Values;
+
+	/** Register curve names and cache their IDs */
+	void UpdateCurveIds();
+	/** Change list of curves keeping values of existing curves (new curves are zero) */
+	void SetCurveNames(const TArray<FName>& NewCurveNames);
+	bool HasSameKeys(const FMetaFaceClip& Other) const;
+	/** Lerp rows Key and Key + 1 */
+	void EvaluateKeys(int32 Key, float Alpha, float* OutValues) const;
+};
+
+typedef TSharedPtr<const FMetaFaceClip, ESPMode::ThreadSafe> FMetaFaceClipPtr;
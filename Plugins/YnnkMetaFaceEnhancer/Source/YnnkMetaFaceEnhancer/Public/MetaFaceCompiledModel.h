@@ -0,0 +1,104 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+* Identifies TorchScript model file a compiled model is made for. Content is compared instead of file time:
+* time isn't preserved by source control and packaging.
+*/
+struct YNNKMETAFACEENHANCER_API FMetaFaceModelSignature
+{
+	uint32 Size = 0;
+	uint32 Crc = 0;
+
+	/** Signature of file content, invalid if file can't be read */
+	static FMetaFaceModelSignature FromFile(const FString& FileName);
+
+	bool IsValid() const { return Size != 0; }
+	bool operator==(const FMetaFaceModelSignature& Other) const { return Size == Other.Size && Crc == Other.Crc; }
+	bool operator!=(const FMetaFaceModelSignature& Other) const { return !(*this == Other); }
+};
+
+/** Header of compiled model file (*.mfcm). Rows of float[CurvesNum] follow the header. */
+struct FMetaFaceCompiledModelHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	// Model input value for the first row
+	int32 InputMin;
+	// Number of rows
+	int32 InputsNum;
+	// Number of floats in row
+	int32 CurvesNum;
+	// TorchScript model file the rows are evaluated for (see FMetaFaceModelSignature)
+	uint32 SourceSize;
+	uint32 SourceCrc;
+	uint32 Reserved;
+
+	static constexpr uint32 FileMagic = 0x4D43464D; // MFCM
+	static constexpr uint32 FileVersion = 2;
+};
+static_assert(sizeof(FMetaFaceCompiledModelHeader) == 32, "Keep rows 32-bytes aligned in compiled model file");
+
+/**
+ * Dependency-free evaluator for lip-sync and emotions networks.
+ * The networks get a single discrete input (phoneme symbol), so the exporter evaluates TorchScript model
+ * once for every possible input and saves output rows. Evaluation is a row fetch with clamp
+ * done by kernels specialized for known curves count.
+ */
+class YNNKMETAFACEENHANCER_API FMetaFaceCompiledModel
+{
+public:
+	FMetaFaceCompiledModel();
+	~FMetaFaceCompiledModel();
+
+	/**
+	* Memory-map compiled model file (or load it to memory if mapping isn't supported)
+	* @param ExpectedSource	If valid, file is rejected unless it's made for TorchScript model with this signature
+	*/
+	bool LoadFromFile(const FString& FileName, int32 ExpectedCurvesNum, const FMetaFaceModelSignature& ExpectedSource = FMetaFaceModelSignature());
+
+	/** Write compiled model file. Rows contains InputsNum * CurvesNum values evaluated for TorchScript model Source. */
+	static bool SaveToFile(const FString& FileName, int32 InputMin, int32 InputsNum, int32 CurvesNum, const TArray<float>& Rows, const FMetaFaceModelSignature& Source);
+
+	/** Initialize model from rows evaluated at runtime (lookup table built for stateless TorchScript model) */
+	bool InitFromRows(int32 InputMin, int32 InputsNum, int32 CurvesNum, const TArray<float>& Rows);
+
+	/** Release file */
+	void Reset();
+
+	/** Is model loaded? */
+	bool IsValid() const { return Rows != nullptr; }
+
+	int32 GetCurvesNum() const { return CurvesNum; }
+
+	/**
+	* Evaluate model for a sequence of inputs
+	* @param Symbols			Model inputs (see UNeuralProcessWrapper::MakeModelInput)
+	* @param OutValues		Buffer of SymbolsNum * CurvesNum floats, values are clamped to [-1, 1]
+	*/
+	bool Evaluate(const float* Symbols, int32 SymbolsNum, float* OutValues) const;
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	// Used if platform can't map files
+	TArray<uint8> FileData;
+
+	const float* Rows;
+	int32 InputMin;
+	int32 InputsNum;
+	int32 CurvesNum;
+
+	bool InitFromMemory(const uint8* Data, int64 Size, int32 ExpectedCurvesNum, const FMetaFaceModelSignature& ExpectedSource);
+
+	/** Header + rows in file format */
+	static bool Serialize(int32 InputMin, int32 InputsNum, int32 CurvesNum, const TArray<float>& Rows, const FMetaFaceModelSignature& Source, TArray<uint8>& OutData);
+};
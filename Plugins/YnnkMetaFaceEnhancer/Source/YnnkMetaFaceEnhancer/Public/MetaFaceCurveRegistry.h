@@ -0,0 +1,109 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/EnumClassFlags.h"
+
+/** Categories of animation curves, evaluated once when curve is registered */
+enum class EMetaFaceCurveFlags : uint8
+{
+	None = 0,
+	// HeadRoll, HeadPitch, HeadYaw: aren't faded on pause
+	Head = 1 << 0,
+	// Brow curves: smoothed less
+	Brow = 1 << 1,
+	Eye = 1 << 2,
+	// Mouth, jaw and tongue
+	Mouth = 1 << 3,
+	Left = 1 << 4,
+	Right = 1 << 5,
+	// Not ARKit curve (i.e. CTRL_expressions_*)
+	Custom = 1 << 6,
+	// Cheeks, nose and fine mouth shapes: dropped first by animation LOD
+	Detail = 1 << 7
+};
+ENUM_CLASS_FLAGS(EMetaFaceCurveFlags)
+
+/** Built-in curves (ARKit and head rotation). Value of the enum is ID of the curve in registry. */
+enum class EMetaFaceCurve : uint8
+{
+	EyeBlinkLeft, EyeLookDownLeft, EyeLookInLeft, EyeLookOutLeft, EyeLookUpLeft, EyeSquintLeft, EyeWideLeft,
+	EyeBlinkRight, EyeLookDownRight, EyeLookInRight, EyeLookOutRight, EyeLookUpRight, EyeSquintRight, EyeWideRight,
+	JawForward, JawLeft, JawRight, JawOpen,
+	MouthClose, MouthFunnel, MouthPucker, MouthLeft, MouthRight, MouthSmileLeft, MouthSmileRight, MouthFrownLeft, MouthFrownRight,
+	MouthDimpleLeft, MouthDimpleRight, MouthStretchLeft, MouthStretchRight, MouthRollLower, MouthRollUpper, MouthShrugLower, MouthShrugUpper,
+	MouthPressLeft, MouthPressRight, MouthLowerDownLeft, MouthLowerDownRight, MouthUpperUpLeft, MouthUpperUpRight,
+	BrowDownLeft, BrowDownRight, BrowInnerUp, BrowOuterUpLeft, BrowOuterUpRight,
+	CheekPuff, CheekSquintLeft, CheekSquintRight, NoseSneerLeft, NoseSneerRight, TongueOut,
+	HeadYaw, HeadPitch, HeadRoll,
+
+	Num
+};
+
+/** Curves generated by neural models, in the order of model output */
+namespace MetaFaceCurveSets
+{
+	inline constexpr EMetaFaceCurve Lipsync[] =
+	{
+		EMetaFaceCurve::JawOpen, EMetaFaceCurve::MouthClose, EMetaFaceCurve::MouthFunnel, EMetaFaceCurve::MouthPucker, EMetaFaceCurve::MouthLeft, EMetaFaceCurve::MouthRight,
+		EMetaFaceCurve::MouthSmileLeft, EMetaFaceCurve::MouthSmileRight, EMetaFaceCurve::MouthFrownLeft, EMetaFaceCurve::MouthFrownRight, EMetaFaceCurve::MouthDimpleLeft,
+		EMetaFaceCurve::MouthDimpleRight, EMetaFaceCurve::MouthStretchLeft, EMetaFaceCurve::MouthStretchRight, EMetaFaceCurve::MouthRollLower, EMetaFaceCurve::MouthRollUpper,
+		EMetaFaceCurve::MouthShrugLower, EMetaFaceCurve::MouthShrugUpper, EMetaFaceCurve::MouthPressLeft, EMetaFaceCurve::MouthPressRight, EMetaFaceCurve::MouthLowerDownLeft,
+		EMetaFaceCurve::MouthLowerDownRight, EMetaFaceCurve::MouthUpperUpLeft, EMetaFaceCurve::MouthUpperUpRight
+	};
+	static_assert(UE_ARRAY_COUNT(Lipsync) == 24, "Lip-sync model has 24 output curves");
+
+	inline constexpr EMetaFaceCurve Emotions[] =
+	{
+		EMetaFaceCurve::BrowDownLeft, EMetaFaceCurve::BrowDownRight, EMetaFaceCurve::BrowInnerUp, EMetaFaceCurve::BrowOuterUpLeft, EMetaFaceCurve::BrowOuterUpRight,
+		EMetaFaceCurve::CheekPuff, EMetaFaceCurve::CheekSquintLeft, EMetaFaceCurve::CheekSquintRight, EMetaFaceCurve::NoseSneerLeft, EMetaFaceCurve::NoseSneerRight,
+		EMetaFaceCurve::HeadYaw, EMetaFaceCurve::HeadPitch, EMetaFaceCurve::HeadRoll, EMetaFaceCurve::EyeBlinkLeft, EMetaFaceCurve::EyeSquintLeft, EMetaFaceCurve::EyeWideLeft,
+		EMetaFaceCurve::EyeSquintRight, EMetaFaceCurve::EyeWideRight, EMetaFaceCurve::MouthSmileLeft, EMetaFaceCurve::MouthSmileRight
+	};
+	static_assert(UE_ARRAY_COUNT(Emotions) == 20, "Emotions model has 20 output curves");
+}
+
+/**
+* Process-wide registry of animation curve names. Every name gets a dense integer ID and category flags
+* computed once on registration, so hot code compares and indexes integers instead of hashing and parsing names.
+* Built-in curves are registered at startup with IDs equal to EMetaFaceCurve values; other names (i.e. CTRL_ curves
+* of MetaHuman skeleton) are added on first use. Thread safe.
+*/
+class YNNKMETAFACEENHANCER_API FMetaFaceCurveRegistry
+{
+public:
+	static FMetaFaceCurveRegistry& Get();
+
+	/** Get ID of curve, register it if needed */
+	int32 FindOrAdd(FName CurveName);
+	/** Get ID of registered curve or INDEX_NONE */
+	int32 Find(FName CurveName) const;
+
+	FName GetName(int32 CurveId) const;
+	EMetaFaceCurveFlags GetFlags(int32 CurveId) const;
+	/** Curve of the opposite side (EyeBlinkLeft -> EyeBlinkRight) or INDEX_NONE */
+	int32 GetMirroredCurve(int32 CurveId) const;
+
+	/** Name of built-in curve */
+	static FName GetName(EMetaFaceCurve Curve);
+	/** Names of curves of lip-sync or emotions model (cached, in the order of MetaFaceCurveSets) */
+	static const TArray<FName>& GetCurveSet(bool bLipsyncCurves);
+
+private:
+	struct FCurveInfo
+	{
+		FName Name;
+		EMetaFaceCurveFlags Flags;
+		int32 MirroredCurve;
+	};
+
+	mutable FRWLock Lock;
+	TMap<FName, int32> CurveIds;
+	TArray<FCurveInfo> Curves;
+
+	FMetaFaceCurveRegistry();
+	int32 AddCurve(FName CurveName);
+	static EMetaFaceCurveFlags MakeCurveFlags(const FString& CurveName);
+};
@@ -62,6 +62,10 @@ public:
 	UFUNCTION(BlueprintPure, meta = (DisplayName = "Get Curve Value"), Category = "Ynnk MetaFace")
 	static float FacialAnimation_CurveValueAtTime(UPARAM(Ref) FMHFacialAnimation& Animation, FName Curve, float PlayTime);
 
+	/** Get curves of Facial Animation object */
+	UFUNCTION(BlueprintPure, meta = (DisplayName = "Get Animation Data"), Category = "Ynnk MetaFace")
+	static TMap<FName, FSimpleFloatCurve> FacialAnimation_GetAnimationData(UPARAM(Ref) FMHFacialAnimation& Animation);
+
 	/** Get description of Facial Animation object (for debugging) */
 	UFUNCTION(BlueprintPure, meta = (DisplayName = "Get Animation Description"), Category = "Ynnk MetaFace")
 	static FString FacialAnimation_GetDescription(UPARAM(Ref) FMHFacialAnimation& Animation);
@@ -74,24 +78,58 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace")
 	static class UNeuralProcessWrapper* InitializeYnnkMetaFace(UObject* Parent);
 
-	/** Initialize YnnkMetaFace with first invisible request. */
+	/** Initialize YnnkMetaFace with first invisible request. Not needed if bWarmUpModels is enabled in settings. */
 	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace")
 	static void PrepareYnnkMetaFaceModel();
 
+	/** Phonemes of the test phrase used to warm up neural models */
+	static void GetWarmUpPhonemes(TArray<FPhonemeTextData>& OutPhonemes);
+
 	/** Generate head rotation from a specified frame of facial animation */
 	UFUNCTION(BlueprintPure, Category = "Ynnk MetaFace")
 	static FRotator MakeHeadRotatorFromAnimFrame(const TMap<FName, float>& AnimationFrame, float OffsetRoll, float OffsetPitch, float OffsetYaw);
 
 	/** Expand curves to skeleton but preserve head rotation */
+	static void ConvertFacialAnimCurves(FMetaFaceClip& InOutClip, class UPoseAsset* CurvesPoseAsset, FString Filter = TEXT("CTRL_"));
 	static void ConvertFacialAnimCurves(TMap<FName, FSimpleFloatCurve>& InOutAnimationCurves, class UPoseAsset* CurvesPoseAsset, FString Filter = TEXT("CTRL_"));
 
 	/** Convert raw animation data to animation curves */
+	static void RawDataToLipsync(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, FMetaFaceClip& OutClip,
+		const FMetaFaceGenerationSettings& MetaFaceSettings);
+	static void RawDataToLipsync(const TArray<FPhonemeTextData>& Phonemes, const RawAnimDataMap& InData, FMetaFaceClip& OutClip,
+		const FMetaFaceGenerationSettings& MetaFaceSettings);
 	static void RawDataToLipsync(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves,
 		const FMetaFaceGenerationSettings& MetaFaceSettings);
+	static void RawDataToLipsync(const TArray<FPhonemeTextData>& Phonemes, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves,
+		const FMetaFaceGenerationSettings& MetaFaceSettings);
 	/** Convert raw animation data to animation curves */
+	static void RawDataToFacialAnimation(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, FMetaFaceClip& OutClip,
+		const FMetaFaceGenerationSettings& MetaFaceSettings);
+	static void RawDataToFacialAnimation(const TArray<FPhonemeTextData>& Phonemes, const RawAnimDataMap& InData, FMetaFaceClip& OutClip,
+		const FMetaFaceGenerationSettings& MetaFaceSettings);
 	static void RawDataToFacialAnimation(const UYnnkVoiceLipsyncData* PhonemesSource, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves,
 		const FMetaFaceGenerationSettings& MetaFaceSettings);
+	static void RawDataToFacialAnimation(const TArray<FPhonemeTextData>& Phonemes, const RawAnimDataMap& InData, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves,
+		const FMetaFaceGenerationSettings& MetaFaceSettings);
+
+	/** Frown curves shouldn't be weaker than smile curves in lip-sync (CC3-Traditional assets) */
+	static void BalanceSmileFrownCurves(FMetaFaceClip& InOutClip);
 
+	/**
+	* Add unsmoothed lip-sync keys of a single phoneme to curves (step of RawDataToLipsync).
+	* Needs the next phoneme (if any). PlayTime is the end of the phrase used to fade out last phonemes.
+	* If model output for the phoneme is missing, the last key in OutAnimationCurves is kept (as RawDataToLipsync does),
+	* so the last key of the previous phoneme should be left in curves.
+	*/
+	static void MakeLipsyncKeys(const TArray<FPhonemeTextData>& Phonemes, int32 Index, float PlayTime, float& InOutPreviousPhonemeTime,
+		const RawAnimDataMap& InData, const FMetaFaceGenerationSettings& MetaFaceSettings, TMap<FName, FSimpleFloatCurve>& OutAnimationCurves);
+	/** Add unsmoothed facial animation keys of a single phoneme to curves (step of RawDataToFacialAnimation). Missing output keeps the last key as in MakeLipsyncKeys. */
+	static void MakeFacialAnimationKeys(const TArray<FPhonemeTextData>& Phonemes, int32 Index, float PlayTime, const RawAnimDataMap& InData,
+		TMap<FName, FSimpleFloatCurve>& OutAnimationCurves);
+	/** Emotions model doesn't output right eye blink, it's copied from the left one */
+	static bool NeedsMirroredRightBlink(const RawAnimDataMap& InData);
+
+	/** Copy of FMetaFaceCurveRegistry::GetCurveSet */
 	static void GetMetaFaceCurvesSet(TArray<FName>& CurvesSet, bool bLipSyncCurves);
 
 };
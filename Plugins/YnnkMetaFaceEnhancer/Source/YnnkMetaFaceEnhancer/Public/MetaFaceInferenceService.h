@@ -0,0 +1,131 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "MetaFaceTypes.h"
+#include "MetaFaceCancellationToken.h"
+#include "YnnkVoiceLipsyncData.h"
+
+class UNeuralProcessWrapper;
+class FEvent;
+
+/** Called when request is processed */
+typedef TFunction<void(bool /* bSuccess */, RawAnimDataMap&& /* Data */)> FMetaFaceInferenceCallback;
+
+/**
+* Entry point for model requests of all controllers and animation builders. Holds requests while models are loaded in background.
+* For TorchScript models verified for sequence input (see UNeuralProcessWrapper::IsSequenceInputEnabled),
+* requests received within a short time window are concatenated and evaluated together. A batch is evaluated by one
+* of its waiting callers, so batches of different callers run in parallel on model replicas.
+* Requests to lookup tables are batched without waiting window: requests queued while a batch is evaluated form the next one.
+* Other requests are evaluated by the calling thread.
+*/
+class YNNKMETAFACEENHANCER_API FMetaFaceInferenceService
+{
+public:
+	FMetaFaceInferenceService(UNeuralProcessWrapper* InProcessor);
+	~FMetaFaceInferenceService();
+
+	/** Update neural processor (if it was recreated by module) */
+	void SetProcessor(UNeuralProcessWrapper* InProcessor);
+
+	/**
+	* While models are loaded in background, requests wait instead of failing.
+	* Requests submitted with callback are processed in the calling thread when waiting is disabled.
+	*/
+	void SetWaitingForModels(bool bWaiting);
+
+	/**
+	* Process request. Callback is executed from the calling thread, or from the thread disabling waiting for models
+	* if request is received while models are loaded. Cancelled request fails without model evaluation.
+	*/
+	void Submit(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, FMetaFaceInferenceCallback&& Callback, const FMetaFaceCancellationTokenPtr& CancellationToken = nullptr);
+
+	/**
+	* Process request and wait for result (including loading of models).
+	* Returns false after the token is cancelled within the bound described in MetaFaceCancellationToken.h.
+	*/
+	bool ProcessPhonemes(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, RawAnimDataMap& OutData, const FMetaFaceCancellationTokenPtr& CancellationToken = nullptr);
+
+	/** Fail waiting requests, reject new ones and wait until all callers leave the service. Called by destructor. */
+	void Shutdown();
+
+	/** Number of batches and requests evaluated in batches (statistics) */
+	int32 GetBatchesNum() const { return BatchesNum.GetValue(); }
+	int32 GetBatchedRequestsNum() const { return BatchedRequestsNum.GetValue(); }
+
+	/** Interval to check cancellation (and free place of batch leader) while waiting */
+	static constexpr uint32 CancellationPollMs = 2;
+
+protected:
+	/** Request in batch queue, shared by its caller and the caller evaluating the batch */
+	struct FPendingRequest
+	{
+		TArray<float> Symbols;
+		int32 InterruptState = 0;
+		FMetaFaceCancellationTokenPtr CancellationToken;
+		FEvent* RequestDone;
+		bool bSuccess = false;
+		RawAnimDataMap Data;
+		// Model output of evaluated part of Symbols (batch is evaluated in chunks and can be handed over to another caller)
+		TArray<float> Values;
+		int32 EvaluatedNum = 0;
+
+		FPendingRequest();
+		~FPendingRequest();
+
+		/** Set result and release waiting caller */
+		void Complete(bool bInSuccess);
+	};
+	typedef TSharedRef<FPendingRequest, ESPMode::ThreadSafe> FPendingRequestRef;
+
+	struct FBatchQueue
+	{
+		TArray<FPendingRequestRef> Requests;
+		// Is one of callers collecting the next batch?
+		bool bHasLeader = false;
+		// Triggered when MaxBatchSize requests are queued
+		FEvent* BatchFullEvent = nullptr;
+	};
+
+	struct FDeferredRequest
+	{
+		TArray<FPhonemeTextData> PhonemesData;
+		bool bUseLipsyncModel;
+		FMetaFaceInferenceCallback Callback;
+		FMetaFaceCancellationTokenPtr CancellationToken;
+	};
+
+	UNeuralProcessWrapper* Processor;
+
+	// Protects all fields below
+	FCriticalSection QueueLock;
+	// Batch queues for emotions [0] and lip-sync [1] models
+	FBatchQueue Queues[2];
+	// Requests submitted with callback before models were loaded
+	TArray<FDeferredRequest> DeferredRequests;
+	bool bWaitingForModels;
+	bool bStopping;
+
+	// Manual-reset event, triggered while models aren't being loaded
+	FEvent* ModelsReadyEvent;
+	// Callers inside ProcessPhonemes
+	FThreadSafeCounter ActiveCallers;
+	// Statistics (see GetBatchesNum)
+	FThreadSafeCounter BatchesNum;
+	FThreadSafeCounter BatchedRequestsNum;
+
+	/** Is batching enabled in settings and useful for the model? */
+	static bool ShouldBatch(const UNeuralProcessWrapper* InProcessor, bool bUseLipsyncModel);
+
+	/**
+	* Wait for batching window, take up to MaxBatchSize queued requests and evaluate their concatenated inputs
+	* in chunks of UNeuralProcessWrapper::MaxSymbolsPerCall. Cancelled requests are dropped between chunks.
+	* If the leader's own request is cancelled, unfinished requests are returned to the queue for another caller.
+	*/
+	void ProcessBatch(bool bUseLipsyncModel, const FPendingRequestRef& Leader);
+};
@@ -0,0 +1,51 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MetaFaceClip.h"
+
+/**
+* Smoothing of generated curves. Kernels process rows of FMetaFaceClip (all curves of a key) 4 curves at once,
+* strength is set per curve (by category of FMetaFaceCurveRegistry) and can be scaled for keys marked CURVEFLAG_RICH.
+*/
+struct YNNKMETAFACEENHANCER_API FMetaFaceSmoothing
+{
+	/** Smoothing of all curves of clip with the same strength (0 - no smoothing, 1 - replace by average) */
+	FMetaFaceSmoothing(const FMetaFaceClip& Clip, float Strength);
+
+	/** Override strength of curves having any of Category flags */
+	void SetCategoryStrength(EMetaFaceCurveFlags Category, float Strength);
+	/** Strength of keys marked CURVEFLAG_RICH is multiplied by Scale */
+	void SetRichKeysScale(float Scale);
+	/** Curves having any of Category flags average 3 keys in FIR regardless of radius */
+	void SetNarrowCurves(EMetaFaceCurveFlags Category);
+
+	/**
+	* Moving average: Value = Lerp(Value, Average(Key - Radius .. Key + Radius), Strength) for keys [2, KeysNum - 2).
+	* Result is the same as PassesNum in-place sweeps over keys (smoothed previous keys are used for the next key),
+	* but passes are fused to a single sweep, so a few rows being smoothed stay in cache.
+	* Radius is 1 or 2. With bSmoothEnds the first and the last keys are lerped to average with their neighbour after every pass.
+	* KeyFlags (optional) are flags of [keys x curves] values.
+	*/
+	void ApplyFIR(FMetaFaceClip& Clip, int32 PassesNum, int32 Radius, bool bSmoothEnds, const uint8* KeyFlags = nullptr) const;
+
+	/**
+	* One-pole low-pass filter: Value = Lerp(Value, Filtered(Key - 1), Strength).
+	* With bZeroPhase the filter is also applied backward, so smoothed curves aren't delayed.
+	*/
+	void ApplyIIR(FMetaFaceClip& Clip, bool bZeroPhase, const uint8* KeyFlags = nullptr) const;
+
+private:
+	TArray<int32> CurveIds;
+	float RichScale;
+	// Per column of clip rows (padding columns are zero)
+	FMetaFaceClip::FValuesArray Strengths;
+	FMetaFaceClip::FValuesArray RichStrengths;
+	// 1 for curves using 3-keys average
+	FMetaFaceClip::FValuesArray NarrowMask;
+
+	/** Strength of [keys x stride] values (uses RichStrengths for flagged values) */
+	void MakeKeyStrengths(int32 KeysNum, const uint8* KeyFlags, FMetaFaceClip::FValuesArray& OutStrengths) const;
+};
@@ -0,0 +1,135 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Function.h"
+#include "MetaFaceTypes.h"
+#include "MetaFaceCancellationToken.h"
+#include "YnnkVoiceLipsyncData.h"
+
+/** Keys finalized by FMetaFaceStreamingBuilder since the previous chunk */
+struct FMetaFaceStreamingChunk
+{
+	TMap<FName, FSimpleFloatCurve> LipSync;
+	TMap<FName, FSimpleFloatCurve> FacialAnimation;
+	// Is it the last chunk of the phrase?
+	bool bFinished = false;
+	// Model evaluation failed or was interrupted, streaming is stopped
+	bool bFailed = false;
+};
+
+/**
+* Builds lip-sync and facial animation from phonemes received incrementally (from TTS or speech recognition).
+* Produces the same keys as UMFFunctionLibrary::RawDataToLipsync/RawDataToFacialAnimation for the whole phrase,
+* but outputs every key as soon as it can't be changed by phonemes which didn't arrive yet:
+* - keys of a phoneme need the next phoneme (lip-sync) and phonemes 0.2 sec later (fade out at the end of phrase);
+* - smoothing passes need 2 (lip-sync) or 8 (facial animation) next keys.
+* Phonemes are evaluated in chunks only by stateless models (see UNeuralProcessWrapper::IsModelStateless).
+* Output of other models depends on previous phonemes, so they are evaluated for the whole phrase after Finish().
+* Conversion to skeleton curves and balancing of smile/frown in facial animation isn't done here.
+*/
+class YNNKMETAFACEENHANCER_API FMetaFaceStreamingBuilder
+{
+public:
+	FMetaFaceStreamingBuilder(const FMetaFaceGenerationSettings& InSettings, bool bInCreateLipSync, bool bInCreateFacialAnimation);
+
+	/** Queue new phonemes of the phrase (thread-safe). Time of phonemes should increase. */
+	void AppendPhonemes(const TArray<FPhonemeTextData>& Phonemes);
+
+	/** No more phonemes will be added (thread-safe) */
+	void Finish();
+
+	/** Stop processing (thread-safe). Running ProcessPending returns after the current model call without output. */
+	void Cancel() { CancellationToken->Cancel(); }
+
+	/**
+	* Evaluate models for queued phonemes and output finalized keys. Calls from different threads are serialized
+	* and OnChunkReady is called under the same lock, so chunks are received in order.
+	* @return false if there was nothing to process
+	*/
+	bool ProcessPending(TFunctionRef<void(FMetaFaceStreamingChunk&&)> OnChunkReady);
+
+	/** Is the last chunk produced? */
+	bool IsFinished() const { return bOutputFinished; }
+
+	/** Number of phonemes received */
+	int32 GetPhonemesNum() const { return Phonemes.Num(); }
+
+protected:
+	/** Keys of a single curve with smoothing passes applied as soon as neighbour keys are known */
+	struct FStreamingCurve
+	{
+		// Unsmoothed keys
+		TArray<FSimpleFloatValue> Keys;
+		// Values after each smoothing pass (computed part)
+		TArray<TArray<float>> Passes;
+		// Keys sent to output
+		int32 EmittedNum = 0;
+
+		// Smoothing parameters: average of 2 * Radius + 1 keys lerped with alpha (RichAlpha for keys with CURVEFLAG_RICH)
+		int32 Radius = 1;
+		float Alpha = 0.f;
+		float RichAlpha = 0.f;
+		// Also smooth the first and the last keys (facial animation)
+		bool bSmoothEnds = false;
+
+		void Initialize(int32 PassesNum, int32 InRadius, float InAlpha, float InRichAlpha, bool bInSmoothEnds);
+
+		/** Compute smoothing passes for keys with known neighbours, copy new finalized keys to OutCurve */
+		void Advance(bool bFinished, FSimpleFloatCurve& OutCurve);
+
+	private:
+		float GetPassValue(int32 Pass, int32 Index) const { return Pass == 0 ? Keys[Index].Value : Passes[Pass - 1][Index]; }
+		int32 GetPassNum(int32 Pass) const { return Pass == 0 ? Keys.Num() : Passes[Pass - 1].Num(); }
+		bool ComputeKey(int32 Pass, bool bFinished);
+	};
+
+	/** Keys generation state for one model */
+	struct FModelStream
+	{
+		bool bEnabled = false;
+		// Is the model checked to be stateless? Otherwise the whole phrase is evaluated when it's finished.
+		bool bModeChecked = false;
+		bool bWholePhrase = false;
+		// Model output for received phonemes
+		RawAnimDataMap RawData;
+		// Next phoneme to convert to keys
+		int32 NextPhoneme = 0;
+		float PreviousPhonemeTime = 0.f;
+		TMap<FName, FStreamingCurve> Curves;
+		// Keys of a single phoneme (reused)
+		TMap<FName, FSimpleFloatCurve> PhonemeKeys;
+	};
+
+	FMetaFaceGenerationSettings Settings;
+	FMetaFaceCancellationTokenPtr CancellationToken;
+
+	FCriticalSection QueueLock;
+	TArray<FPhonemeTextData> QueuedPhonemes;
+	bool bFinishRequested;
+
+	FCriticalSection ProcessLock;
+	// All phonemes of the phrase received so far
+	TArray<FPhonemeTextData> Phonemes;
+	bool bOutputFinished;
+	FModelStream LipSync;
+	FModelStream FacialAnimation;
+
+	/** Evaluate model for phonemes starting from FirstNewPhoneme (or for the whole finished phrase) and update RawData */
+	bool UpdateModelOutput(FModelStream& Stream, int32 FirstNewPhoneme, bool bFinished, bool bUseLipsyncModel);
+
+	/** Evaluate model for phonemes and append output to RawData */
+	bool EvaluateModel(FModelStream& Stream, const TArray<FPhonemeTextData>& NewPhonemes, bool bUseLipsyncModel);
+
+	/** Set bWholePhrase once models are loaded */
+	static void CheckModelMode(FModelStream& Stream, bool bUseLipsyncModel);
+
+	/** Convert phonemes which won't change to keys and output finalized keys */
+	void AdvanceStream(FModelStream& Stream, bool bUseLipsyncModel, bool bFinished, TMap<FName, FSimpleFloatCurve>& OutKeys);
+
+	/** Create curves for model output */
+	void InitializeCurves(FModelStream& Stream, bool bUseLipsyncModel);
+};
@@ -0,0 +1,68 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MetaFaceTickSubsystem.generated.h"
+
+class UYnnkMetaFaceController;
+class UMetaFaceTickSubsystem;
+
+/** Tick function of UMetaFaceTickSubsystem, runs in the same tick group as controllers' component ticks */
+USTRUCT()
+struct FMetaFaceTickFunction : public FTickFunction
+{
+	GENERATED_USTRUCT_BODY()
+
+	UMetaFaceTickSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FMetaFaceTickFunction> : public TStructOpsTypeTraitsBase2<FMetaFaceTickFunction>
+{
+	enum { WithCopy = false };
+};
+
+/**
+* Ticks all active MetaFace controllers of game world (enabled by bTickControllersInSubsystem in project settings).
+* Reading of other objects (lip-sync controllers, meshes, eyes targets) and debug drawing are serial in game thread,
+* animation sampling, baked frame mixing and eyes curves of all controllers are updated in a single ParallelFor.
+*/
+UCLASS()
+class YNNKMETAFACEENHANCER_API UMetaFaceTickSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Controller stops using its own component tick */
+	void RegisterController(UYnnkMetaFaceController* Controller);
+	void UnregisterController(UYnnkMetaFaceController* Controller);
+
+	/** Tick all registered controllers with enabled component tick */
+	void TickControllers(float DeltaTime);
+
+	int32 GetControllersNum() const { return Controllers.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY(Transient)
+	TArray<UYnnkMetaFaceController*> Controllers;
+
+	FMetaFaceTickFunction TickFunction;
+
+	// Controllers ticked in the current frame and their delta time (with time dilation of owner)
+	TArray<UYnnkMetaFaceController*> TickedControllers;
+	TArray<float> TickedDeltaTimes;
+};
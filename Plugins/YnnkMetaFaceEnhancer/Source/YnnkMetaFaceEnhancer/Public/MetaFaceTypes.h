@@ -5,6 +5,7 @@
 
 #include "CoreMinimal.h"
 #include "YnnkTypes.h"
+#include "MetaFaceClip.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "MetaFaceTypes.generated.h"
 
@@ -37,6 +38,20 @@ class UYnnkLipsyncController;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogMetaFace, Log, All);
 
+/**
+* Priority of MetaFace worker threads
+*/
+UENUM(BlueprintType)
+enum class EMetaFaceThreadPriority : uint8
+{
+	TP_Lowest				UMETA(DisplayName = "Lowest"),
+	TP_BelowNormal			UMETA(DisplayName = "Below Normal"),
+	TP_SlightlyBelowNormal	UMETA(DisplayName = "Slightly Below Normal"),
+	TP_Normal				UMETA(DisplayName = "Normal"),
+
+	TP_Max					UMETA(Hidden)
+};
+
 /**
 * MetaHuman eyes controller program
 */
@@ -50,8 +65,16 @@ enum class EEyesControlType : uint8
 	EC_Max					UMETA(Hidden)
 };
 
+/** Parameters of a processed frame: value of curve is Clip(PlayTime) * Alpha * (Head curve ? 1 : PauseAlpha) */
+struct FMetaFaceFrameParams
+{
+	float PlayTime = 0.f;
+	float Alpha = 0.f;
+	float PauseAlpha = 1.f;
+};
+
 /**
-* Object containing facial animation for MetaHuman
+* Object containing facial animation for MetaHuman: shared immutable clip and state of playback
 */
 USTRUCT(BlueprintType, meta = (DisplayName = "MH Facial Animation"))
 struct YNNKMETAFACEENHANCER_API FMHFacialAnimation
@@ -66,10 +89,6 @@ struct YNNKMETAFACEENHANCER_API FMHFacialAnimation
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MH Facial Animation")
 	bool bInterrupting;
 
-	// Curves Data
-	UPROPERTY(BlueprintReadOnly, Category = "MH Facial Animation")
-	TMap<FName, FSimpleFloatCurve> AnimationData;
-	
 	// Current frame of Animation Data. Apply it in animation blueprint.
 	UPROPERTY(BlueprintReadOnly, Category = "MH Facial Animation")
 	TMap<FName, float> AnimationFrame;
@@ -97,6 +116,10 @@ struct YNNKMETAFACEENHANCER_API FMHFacialAnimation
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MH Facial Animation")
 	uint8 AnimationFlag;
 
+	// Are keys still being appended (streaming animation)? Animation doesn't finish at the last available key.
+	UPROPERTY(BlueprintReadOnly, Category = "MH Facial Animation")
+	bool bStreaming;
+
 	FMHFacialAnimation()
 		: bPlaying(false)
 		, bInterrupting(false)
@@ -106,23 +129,98 @@ struct YNNKMETAFACEENHANCER_API FMHFacialAnimation
 		, FadeTime(0.12f)
 		, AnimationDuration(0.f)
 		, AnimationFlag(0)
+		, bStreaming(false)
+		, KeyCursor(0)
+		, DroppedCurves(EMetaFaceCurveFlags::None)
+		, bFrameEvaluated(false)
 	{};
 
+	FMHFacialAnimation(const FMHFacialAnimation& OtherItem) = default;
+	FMHFacialAnimation(FMHFacialAnimation&& OtherItem) = default;
+
+	/** Convert curves to dense clip */
 	void Initialize(const TMap<FName, FSimpleFloatCurve>& InAnimationData, bool bInFadeOnPause, float InFadePauseDuration = 0.3f, float InFadeTime = 0.12f);
-	void ProcessFrame(float PlayTime, UYnnkLipsyncController* LipsyncController);
+	/** Take ownership of clip (animation built in worker thread) */
+	void Initialize(FMetaFaceClip&& InClip, bool bInFadeOnPause, float InFadePauseDuration = 0.3f, float InFadeTime = 0.12f);
+	/** Play existing clip without copying curves */
+	void Initialize(const FMetaFaceClipPtr& InClip, bool bInFadeOnPause, float InFadePauseDuration = 0.3f, float InFadeTime = 0.12f);
+	/** Add keys to the end of curves (streaming animation). Clip is copied first if it's shared with other objects. */
+	void AppendKeys(const FMetaFaceClip& InClip);
+	/** Add or replace whole curves (i.e. converted to skeleton curves). Clip is copied first if it's shared with other objects. */
+	void AddCurves(const FMetaFaceClip& InClip);
+	/** Convert curves of the clip to TMap representation (empty if not initialized) */
+	TMap<FName, FSimpleFloatCurve> GetAnimationData() const;
+	const FMetaFaceClipPtr& GetClip() const { return Clip; }
+	/** Current values of AnimationFrame in the order of clip curves (padded to clip stride) */
+	const FMetaFaceClip::FValuesArray& GetFrameValues() const { return FrameValues; }
+	/** Parameters of the last frame processed while playing */
+	const FMetaFaceFrameParams& GetFrameParams() const { return FrameParams; }
+	/** Set groups of curves which aren't animated (animation LOD). Dropped curves are kept in frame with zero values. */
+	void SetDroppedCurves(EMetaFaceCurveFlags InDroppedCurves);
+	EMetaFaceCurveFlags GetDroppedCurves() const { return DroppedCurves; }
+
+	/** Make mask of curves faded on pause (1) and not faded (0, head rotation) for clip */
+	static void MakePauseMask(const FMetaFaceClip& InClip, FMetaFaceClip::FValuesArray& OutPauseMask);
+	/** Make mask of curves kept (1) and dropped (0) by animation LOD. Empty if no curves are dropped. */
+	static void MakeCurveMask(const FMetaFaceClip& InClip, EMetaFaceCurveFlags DroppedCurves, FMetaFaceClip::FValuesArray& OutCurveMask);
+	/**
+	* Sample clip for frame parameters. OutValues, PauseMask and CurveMask (optional) should have clip stride size
+	* and be 16-byte aligned.
+	*/
+	static void EvaluateFrame(const FMetaFaceClip& InClip, const FMetaFaceFrameParams& Params, const float* PauseMask, int32& InOutKeyCursor, float* OutValues, const float* CurveMask = nullptr);
+	/**
+	* Update playback state for PlayTime. If bEvaluateFrame is false, clip isn't sampled and AnimationFrame isn't updated
+	* while playing (frame is sampled by FAnimNode_MetaFaceCurves using GetFrameParams).
+	*/
+	void ProcessFrame(float PlayTime, UYnnkLipsyncController* LipsyncController, bool bEvaluateFrame = true);
 	void Play();
 	void Stop();
-	bool IsValid() const { return AnimationData.Num() > 0 && AnimationFrame.Num() > 0; }
+	bool IsValid() const { return Clip.IsValid() && Clip->GetCurvesNum() > 0 && AnimationFrame.Num() > 0; }
 	bool IsActive() const { return bPlaying || bInterrupting; }
 	FString GetDescription() const;
 
 	FMHFacialAnimation& operator=(const FMHFacialAnimation& OtherItem)
 	{
-		this->Initialize(OtherItem.AnimationData, OtherItem.bFadeOnPause, OtherItem.Fade_PauseDuration, OtherItem.FadeTime);
+		this->Initialize(OtherItem.Clip, OtherItem.bFadeOnPause, OtherItem.Fade_PauseDuration, OtherItem.FadeTime);
+		this->Intensity = OtherItem.Intensity;
+		this->AnimationDuration = OtherItem.AnimationDuration;
+		return *this;
+	}
+
+	FMHFacialAnimation& operator=(FMHFacialAnimation&& OtherItem)
+	{
+		if (this == &OtherItem)
+		{
+			return *this;
+		}
+		this->Clip = MoveTemp(OtherItem.Clip);
+		this->InitializeFrame(OtherItem.bFadeOnPause, OtherItem.Fade_PauseDuration, OtherItem.FadeTime);
 		this->Intensity = OtherItem.Intensity;
 		this->AnimationDuration = OtherItem.AnimationDuration;
 		return *this;
 	}
+
+private:
+	FMetaFaceClipPtr Clip;
+	// Values of all curves at current time (row of clip)
+	FMetaFaceClip::FValuesArray FrameValues;
+	// Key of clip at last play time
+	int32 KeyCursor;
+	// 1 for curves faded on pause, 0 for others. Has the same size as row of clip.
+	FMetaFaceClip::FValuesArray PauseMask;
+	// Curves dropped by animation LOD and their mask (see MakeCurveMask)
+	EMetaFaceCurveFlags DroppedCurves;
+	FMetaFaceClip::FValuesArray CurveMask;
+	FMetaFaceFrameParams FrameParams;
+	// Are FrameValues and AnimationFrame up to date (false if frames were processed without evaluation)?
+	bool bFrameEvaluated;
+
+	/** Reset playback state and build frame for current clip */
+	void InitializeFrame(bool bInFadeOnPause, float InFadePauseDuration, float InFadeTime);
+	/** Get clip which can be modified (copy on write) */
+	FMetaFaceClip& GetMutableClip();
+	/** Add curves appended to clip to the frame */
+	void UpdateFrameCurves();
 };
 
 /** Animation curves preset */
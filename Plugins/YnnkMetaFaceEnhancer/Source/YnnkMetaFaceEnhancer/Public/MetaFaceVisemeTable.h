@@ -0,0 +1,38 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YnnkTypes.h"
+#include "MetaFaceTypes.h"
+
+/**
+* Viseme poses of UYnnkMetaFaceSettings::LipsyncVisemesPreset compiled to a dense [viseme x curve] matrix.
+* Columns are all curves used by poses (curve IDs of FMetaFaceCurveRegistry).
+*/
+struct YNNKMETAFACEENHANCER_API FMetaFaceVisemeTable
+{
+	static constexpr int32 VisemesNum = (int32)EYnnkViseme::YV_Max;
+
+	FMetaFaceVisemeTable() = default;
+	explicit FMetaFaceVisemeTable(const TMap<EYnnkViseme, FMetaFacePose>& VisemesPreset);
+
+	bool HasViseme(EYnnkViseme Viseme) const { return (int32)Viseme < VisemesNum && bHasViseme[(int32)Viseme]; }
+	int32 GetCurvesNum() const { return CurveIds.Num(); }
+
+	/**
+	* Gather poses for curves of a clip. OutValues and OutMask get (VisemesNum + 1) rows of Stride values,
+	* the last row is empty (YV_Max). Mask is 1 if pose of viseme has the curve.
+	*/
+	void MakeRows(const TArray<int32>& InCurveIds, int32 Stride, FMetaFaceClip::FValuesArray& OutValues, FMetaFaceClip::FValuesArray& OutMask) const;
+
+private:
+	TArray<int32> CurveIds;
+	// [VisemesNum x CurveIds.Num()]
+	TArray<float> Values;
+	TArray<bool> Mask;
+	bool bHasViseme[VisemesNum] = {};
+};
+
+typedef TSharedPtr<const FMetaFaceVisemeTable, ESPMode::ThreadSafe> FMetaFaceVisemeTablePtr;
@@ -0,0 +1,113 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "Misc/QueuedThreadPool.h"
+#include "HAL/Event.h"
+#include <atomic>
+
+/**
+* Part of a job which can run in parallel with the job itself (see FMetaFaceWorkerPool::LaunchSubtask).
+* If no worker has started the subtask before Join(), it's executed by the joining thread,
+* so jobs waiting for their subtasks can't occupy all workers of the pool.
+*/
+class YNNKMETAFACEENHANCER_API FMetaFaceSubtask
+{
+public:
+	FMetaFaceSubtask(TUniqueFunction<void()>&& InJob);
+	~FMetaFaceSubtask();
+
+	/** Execute job unless it's already taken by another thread */
+	bool TryRun();
+
+	/** Execute job in this thread if it isn't started yet, otherwise wait for completion */
+	void Join();
+
+private:
+	TUniqueFunction<void()> Job;
+	std::atomic<bool> bClaimed;
+	FEvent* DoneEvent;
+};
+
+typedef TSharedRef<FMetaFaceSubtask, ESPMode::ThreadSafe> FMetaFaceSubtaskRef;
+
+/**
+* Job queued by FMetaFaceWorkerPool::Launch. Unlike AsyncPool, a job abandoned by the pool (not started before the pool
+* is destroyed) isn't executed but still fulfils its promise with default value, so nobody waits for it forever.
+*/
+template<typename ResultType>
+class TMetaFaceQueuedWork : public IQueuedWork
+{
+public:
+	TMetaFaceQueuedWork(TUniqueFunction<ResultType()>&& InFunction, TPromise<ResultType>&& InPromise)
+		: Function(MoveTemp(InFunction))
+		, Promise(MoveTemp(InPromise))
+	{
+	}
+
+	virtual void DoThreadedWork() override
+	{
+		SetPromise(Promise, Function);
+		delete this;
+	}
+
+	virtual void Abandon() override
+	{
+		Function.Reset();
+		Promise.EmplaceValue();
+		delete this;
+	}
+
+private:
+	TUniqueFunction<ResultType()> Function;
+	TPromise<ResultType> Promise;
+};
+
+/**
+* Fixed-size thread pool for animation build jobs (model evaluation and conversion to curves).
+* Threads count, priority and affinity are defined in UYnnkMetaFaceSettings, so builds don't compete
+* with game and render threads and don't create a new OS thread per request.
+*/
+class YNNKMETAFACEENHANCER_API FMetaFaceWorkerPool
+{
+public:
+	FMetaFaceWorkerPool();
+	~FMetaFaceWorkerPool();
+
+	/** Create threads. ThreadsNum = 0 to select automatically, AffinityMask = 0 to use default mask of pool threads. */
+	bool Create(int32 ThreadsNum, EThreadPriority Priority, uint64 AffinityMask);
+
+	/**
+	* Wait for running jobs and destroy threads. Queued jobs which aren't started yet are abandoned:
+	* they aren't executed, their futures get default value. Cancel jobs before destroying the pool.
+	*/
+	void Destroy();
+
+	int32 GetThreadsNum() const { return ThreadsNum; }
+
+	/** Queue job. GThreadPool is used if the pool isn't created. */
+	template<typename CallableType>
+	auto Launch(CallableType&& Callable) -> TFuture<decltype(Forward<CallableType>(Callable)())>
+	{
+		using ResultType = decltype(Forward<CallableType>(Callable)());
+		TPromise<ResultType> Promise;
+		TFuture<ResultType> Future = Promise.GetFuture();
+		GetPool().AddQueuedWork(new TMetaFaceQueuedWork<ResultType>(TUniqueFunction<ResultType()>(Forward<CallableType>(Callable)), MoveTemp(Promise)));
+		return MoveTemp(Future);
+	}
+
+	/** Queue part of the current job, call Join() on the result before using output of the subtask */
+	FMetaFaceSubtaskRef LaunchSubtask(TUniqueFunction<void()>&& Job);
+
+	/** Number of threads created by default */
+	static int32 GetDefaultThreadsNum();
+
+private:
+	FQueuedThreadPool* Pool;
+	int32 ThreadsNum;
+
+	FQueuedThreadPool& GetPool() const { return Pool ? *Pool : *GThreadPool; }
+};
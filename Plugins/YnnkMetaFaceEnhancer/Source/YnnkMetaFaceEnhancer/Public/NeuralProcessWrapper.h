@@ -6,8 +6,13 @@
 #include "CoreMinimal.h"
 #include "SimpleTorchModule.h"
 #include "MetaFaceTypes.h"
+#include "MetaFaceCompiledModel.h"
+#include "MetaFaceCancellationToken.h"
 #include "YnnkVoiceLipsyncData.h"
 #include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/Event.h"
+#include "Async/Future.h"
 #include "NeuralProcessWrapper.generated.h"
 
 /**
@@ -20,10 +25,26 @@ class YNNKMETAFACEENHANCER_API UNeuralProcessWrapper : public UObject
 
 public:
 	UNeuralProcessWrapper();
+	virtual ~UNeuralProcessWrapper();
 
 	UFUNCTION()
 	void Initialize();
 
+	/**
+	* Load models (see Initialize) and warm them up in background thread. Should be called from game thread.
+	* Models aren't reported as ready until loading is complete. OnLoaded is called from the loading thread.
+	*/
+	void InitializeAsync(bool bWarmUp, TFunction<void()>&& OnLoaded);
+
+	/** Are models being loaded by InitializeAsync? */
+	bool IsLoading() const { return bLoading; }
+
+	/** Block calling thread until models loaded by InitializeAsync are ready */
+	void WaitForModels() const;
+
+	/** Evaluate test phrase with every model instance, so the first real request doesn't pay for the first call */
+	void WarmUp();
+
 	UFUNCTION()
 	bool IsValid() const;
 
@@ -36,8 +57,73 @@ public:
 	bool ProcessPhonemesData(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData);
 	bool ProcessPhonemesData2(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData);
 
+	/**
+	* Evaluate the phrase in sequence calls of up to MaxSymbolsPerCall phonemes: [N] symbols in, [N, curves] values out.
+	* Sequence input is only used if the model was verified at load time to be stateless and to give
+	* the same output for a sequence as for single phonemes. Otherwise phonemes are evaluated one by one.
+	* @param CancellationToken	Checked between model calls, request fails if it's cancelled
+	*/
+	bool ProcessPhonemesSequence(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData, const FMetaFaceCancellationToken* CancellationToken = nullptr);
+
+	/** Abort all running requests of all callers. To cancel a single request use FMetaFaceCancellationToken. */
 	void InterruptAll();
 
+	/** Load TorchScript models. Models replaced by lookup tables in Initialize() aren't loaded. */
+	void InitializeTorchModels(bool bLoadEmotionsModel, bool bLoadLipsyncModel);
+
+	/** TorchScript model file in plugin's Resources */
+	FString GetModelFile(bool bUseLipsyncModel) const;
+
+	/** Is model evaluated by lookup table (FMetaFaceCompiledModel) instead of TorchScript? */
+	bool IsUsingCompiledModel(bool bUseLipsyncModel) const;
+
+	/** Does model evaluate a phrase in a single call? (see ProcessPhonemesSequence) */
+	bool IsSequenceInputEnabled(bool bUseLipsyncModel) const { return bUseLipsyncModel ? bLipsyncSequenceInput : bEmotionsSequenceInput; }
+
+	/** Is model output for a phoneme verified to be independent of previous phonemes? (lookup table or verified sequence input) */
+	bool IsModelStateless(bool bUseLipsyncModel) const { return IsUsingCompiledModel(bUseLipsyncModel) || IsSequenceInputEnabled(bUseLipsyncModel); }
+
+	/** Range of values produced by MakeModelInput (digits and letters, with and without word start flag) */
+	static void GetModelInputRange(int32& OutInputMin, int32& OutInputMax);
+
+	/**
+	* Evaluate TorchScript model for every possible input to create compiled model.
+	* Fails if model output for the same input isn't repeatable (i. e. model has internal state).
+	*/
+	bool CompileTorchModel(bool bUseLipsyncModel, int32& OutInputMin, int32& OutInputsNum, TArray<float>& OutRows);
+
+	/**
+	* Evaluate model by lookup table made elsewhere instead of TorchScript (rows in the format of CompileTorchModel).
+	* Model is reported as ready after this call.
+	*/
+	bool InitializeLookupTable(bool bUseLipsyncModel, int32 InputMin, int32 InputsNum, const TArray<float>& Rows);
+
+	FString GetResourcesPath() const;
+
+	/** Convert phonemes to model input values (letter index * 2 + 1, +1 at word start) */
+	bool MakeModelInput(const TArray<FPhonemeTextData>& PhonemesData, TArray<float>& OutSymbols, const TCHAR* CallerName) const;
+
+	/**
+	* Evaluate model for a sequence of inputs. Sequence input is evaluated in calls of MaxSymbolsPerCall inputs,
+	* cancellation and InterruptAll() are checked after every model call.
+	* @param OutValues	[Symbols.Num(), curves] values clamped to [-1, 1]
+	*/
+	bool EvaluateSymbols(bool bUseLipsyncModel, const TArray<float>& Symbols, TArray<float>& OutValues, const TCHAR* CallerName, const FMetaFaceCancellationToken* CancellationToken = nullptr);
+
+	/** Convert [SymbolsNum, curves] values to curves map */
+	void ScatterValues(bool bUseLipsyncModel, const float* Values, int32 SymbolsNum, TMap<FName, TArray<float>>& OutData) const;
+
+	int32 GetCurvesNum(bool bUseLipsyncModel) const { return bUseLipsyncModel ? NN_LipsyncOutCurves.Num() : NN_EmotionsOutCurves.Num(); }
+
+	/** Max inputs of a single sequence call: the longest time a cancelled request keeps model replica */
+	static constexpr int32 MaxSymbolsPerCall = 64;
+
+	/** Interval to check cancellation while request waits for a free model replica */
+	static constexpr uint32 ReplicaCancellationPollMs = 1;
+
+	/** Changes when InterruptAll() is called */
+	int32 GetInterruptState() const { return InterruptCounter.GetValue(); }
+
 protected:
 
 	// Names of curves
@@ -46,31 +132,86 @@ protected:
 	UPROPERTY()
 	TArray<FName> NN_LipsyncOutCurves;
 
-	static FCriticalSection NeuralWrapMutex1;
-	static FCriticalSection NeuralWrapMutex2;
-
-	// Facial animation: in0out tensors and model
-	UPROPERTY()
-	FSimpleTorchTensor EmotionsInData;
-	UPROPERTY()
-	FSimpleTorchTensor EmotionsOutData;
+	// Facial animation model (requests use raw buffers, see EvaluateSymbols)
 	UPROPERTY()
 	USimpleTorchModule* EmotionsNeuralModel;
 	UPROPERTY()
 	bool bEmotionsModelReady;
 
-	// Lip-Sync: in0out tensors and model
-	UPROPERTY()
-	FSimpleTorchTensor LipsyncInData;
-	UPROPERTY()
-	FSimpleTorchTensor LipsyncOutData;
+	// Lip-Sync model
 	UPROPERTY()
 	USimpleTorchModule* LipsyncNeuralModel;
 	UPROPERTY()
 	bool bLipsyncModelReady;
 
-	bool bProcessingModel1 = false;
-	bool bProcessingModel2 = false;
+	// Lookup tables (used instead of TorchScript if loaded)
+	FMetaFaceCompiledModel EmotionsCompiledModel;
+	FMetaFaceCompiledModel LipsyncCompiledModel;
 
-	FString GetResourcesPath() const;
+	// Loaded TorchScript files
+	FString EmotionsModelFile;
+	FString LipsyncModelFile;
+
+	// Pools of TorchScript model instances to process requests in parallel. First replica is EmotionsNeuralModel/LipsyncNeuralModel.
+	UPROPERTY()
+	TArray<USimpleTorchModule*> EmotionsReplicas;
+	UPROPERTY()
+	TArray<USimpleTorchModule*> LipsyncReplicas;
+	// Lock per replica
+	TArray<TSharedPtr<FCriticalSection>> EmotionsReplicaLocks;
+	TArray<TSharedPtr<FCriticalSection>> LipsyncReplicaLocks;
+	FThreadSafeCounter ReplicaCounter;
+	// Triggered when replica is released (auto-reset)
+	FEvent* EmotionsReplicaReleased;
+	FEvent* LipsyncReplicaReleased;
+
+	// Set by InitializeAsync until models are loaded and warmed up
+	FThreadSafeBool bLoading;
+	TFuture<void> LoadingTask;
+
+	// Torch modules created in game thread for InitializeAsync (UObjects shouldn't be created in the loading thread)
+	UPROPERTY()
+	TArray<USimpleTorchModule*> PreallocatedTorchModules;
+	int32 PreallocatedModulesUsed = 0;
+
+	// Incremented by InterruptAll(): requests started before it are aborted. Per-request flags wouldn't work with parallel requests.
+	FThreadSafeCounter InterruptCounter;
+
+	// Is model stateless and [N] input in eval_compute equivalent to N single calls? Set only by Initialize(), requests don't change it.
+	bool bLipsyncSequenceInput = false;
+	bool bEmotionsSequenceInput = false;
+
+	/** Take preallocated torch module or create new one in game thread */
+	USimpleTorchModule* CreateTorchModule();
+
+	/** Load additional instances of TorchScript model (NeuralModelReplicas in settings) */
+	void CreateModelReplicas(bool bUseLipsyncModel);
+
+	/**
+	* Find and lock free model replica (or wait for one if all are busy). Returns index in replicas pool,
+	* or INDEX_NONE if request was cancelled while waiting.
+	*/
+	int32 AcquireModelReplica(bool bUseLipsyncModel, const FMetaFaceCancellationToken* CancellationToken);
+	void ReleaseModelReplica(bool bUseLipsyncModel, int32 ReplicaIndex);
+
+	/** Load lookup table exported to Resources or cached by BuildLookupTable, if it's made for the current TorchScript model file */
+	bool LoadLookupTable(bool bUseLipsyncModel);
+
+	/** Probe loaded TorchScript model for repeatability and replace it with lookup table (cached in Saved directory) */
+	bool BuildLookupTable(bool bUseLipsyncModel);
+
+	/** Load main TorchScript instance from file again to reset its internal state (replicas aren't changed) */
+	bool ReloadTorchModel(bool bUseLipsyncModel);
+
+	/** Check if TorchScript model is stateless and gives the same rows for [N] input as for single inputs (called once at load time) */
+	bool ProbeSequenceInput(bool bUseLipsyncModel);
+
+	/** Lookup table built for TorchScript model file */
+	static FString GetLookupTableCacheFile(const FString& ModelFile);
+
+	/** Clamp model output to [-1, 1] */
+	static void ClampValues(float* Values, int32 Num);
+
+	/** Shared implementation of ProcessPhonemesData/ProcessPhonemesData2 */
+	bool ProcessPhonemesInternal(const TArray<FPhonemeTextData>& PhonemesData, bool bUseLipsyncModel, TMap<FName, TArray<float>>& OutData, const TCHAR* CallerName, const FMetaFaceCancellationToken* CancellationToken = nullptr);
 };
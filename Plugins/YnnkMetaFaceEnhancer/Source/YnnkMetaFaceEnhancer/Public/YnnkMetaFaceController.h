@@ -9,6 +9,9 @@
 #include "MetaFaceTypes.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "HAL/CriticalSection.h"
+#include "MetaFaceStreamingBuilder.h"
+#include "MetaFaceBuildQueue.h"
+#include "MetaFaceBlendPlan.h"
 #include "YnnkMetaFaceController.generated.h"
 
 class UYnnkVoiceLipsyncData;
@@ -16,6 +19,7 @@ class UYnnkLipsyncController;
 class USkeletalMeshComponent;
 class UYnnkRemoteClient;
 class UNeuralProcessWrapper;
+class UMetaFaceTickSubsystem;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FAnimationBuildingResult, const UYnnkVoiceLipsyncData*, LipsyncData, bool, bResult);
 
@@ -71,6 +75,44 @@ struct FMFEyeControllerSetup
 	{}
 };
 
+/** Detail level of animation updated by controller (see UYnnkMetaFaceController::AnimationLODs) */
+USTRUCT(BlueprintType)
+struct FMetaFaceAnimationLOD
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Used if predicted LOD of head mesh is MinMeshLOD or greater (bAutoAnimationLOD)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MH Animation LOD")
+	int32 MinMeshLOD;
+
+	// Update eyes every N-th tick. Facial curves are sampled at the current play time every tick, so they stay smooth and in sync with audio.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MH Animation LOD", meta = (ClampMin = "1", UIMin = "1", UIMax = "8"))
+	int32 UpdateInterval;
+
+	// Animate brow curves
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MH Animation LOD")
+	bool bAnimateBrows;
+
+	// Animate cheeks, nose and fine mouth shapes (dimple, shrug, stretch). Lip press and roll are always animated: they close lips on P, B, M.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MH Animation LOD")
+	bool bAnimateDetails;
+
+	// Update eyes rotation for look-at target. If disabled, eyes keep the last rotation.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MH Animation LOD")
+	bool bEyesFocusAtTarget;
+
+	FMetaFaceAnimationLOD()
+		: MinMeshLOD(0), UpdateInterval(1), bAnimateBrows(true), bAnimateDetails(true), bEyesFocusAtTarget(true)
+	{}
+
+	FMetaFaceAnimationLOD(int32 InMinMeshLOD, int32 InUpdateInterval, bool bInAnimateBrows, bool bInAnimateDetails, bool bInEyesFocusAtTarget)
+		: MinMeshLOD(InMinMeshLOD), UpdateInterval(InUpdateInterval), bAnimateBrows(bInAnimateBrows), bAnimateDetails(bInAnimateDetails), bEyesFocusAtTarget(bInEyesFocusAtTarget)
+	{}
+
+	/** Groups of curves which aren't animated */
+	EMetaFaceCurveFlags GetDroppedCurves() const;
+};
+
 /**
 * This component controls MetaHuman facial animation and enhanced lip-sync
 */
@@ -203,6 +245,14 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bLipSyncToSkeletonCurves && bFacialAnimationToSkeletonCurves"), Category = "Play")
 	bool bAutoBakeAnimation = false;
 
+	/**
+	* Update CurrentLipsync.AnimationFrame and CurrentFaceAnim.AnimationFrame every tick.
+	* Disable if animation is applied by MetaFace Curves node of animation blueprint: it samples clips in animation thread.
+	* Frames are always updated if bAutoBakeAnimation is enabled.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Play")
+	bool bPublishAnimationFrames = true;
+
 	/** Ratio between YnnkLipsync and MetaFace LipSync in baked animation data. By default, 25% of YnnkLipsync and 75% of MetaFaceEnhancer */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bAutoBakeAnimation", DisplayName="Ynnk to MetaFace Bake Ratio", ClampMin = "0.0", ClampMax = "1.0", UIMin = "0.0", UIMax = "1.0"), Category = "Play")
 	float BakedYnnkToMetaFaceRatio = 0.25f;
@@ -226,6 +276,17 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Play")
 	float EyeMovementSpeed;
 
+	/**
+	* Select animation LOD every tick by predicted LOD of head mesh, use the last LOD if head isn't rendered.
+	* Disable to set LOD with SetAnimationLOD (i. e. from significance manager or animation budget allocator).
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD")
+	bool bAutoAnimationLOD = false;
+
+	/** Detail levels of animation, from the most detailed */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD")
+	TArray<FMetaFaceAnimationLOD> AnimationLODs;
+
 	/** Draw debug geometry */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Debug")
 	bool bDrawDebug;
@@ -299,6 +360,14 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Controller")
 	bool BuildFacialAnimationData(UYnnkVoiceLipsyncData* LipsyncData, bool bCreateLipSync, bool bCreateFacialAnimation);
 
+	/**
+	* Queue animation of the phrase which will be spoken later (i.e. next reply in dialogue).
+	* Prefetch requests don't delay animations required to speak now, and they aren't cancelled by new speak requests.
+	* OnAnimationBuildingComplete is called when animation is saved to cache.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Controller")
+	bool PrefetchFacialAnimation(UYnnkVoiceLipsyncData* LipsyncData);
+
 	/**
 	* Speak VoiceLipsyncData through UYnnkLipsyncController with forced generation of lip-sync and facial animation
 	*/
@@ -311,6 +380,26 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Controller")
 	void Speak(UYnnkVoiceLipsyncData* VoiceLipsyncData);
 
+	/**
+	* Start streaming animation: phonemes are added by AppendStreamingPhonemes as they arrive (from TTS or speech recognition)
+	* and finalized keys are appended to CurrentLipsync/CurrentFaceAnim, so speech can start before the whole phrase is processed.
+	* Phonemes time is counted from this call (or from the start of speaking by UYnnkLipsyncController).
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Controller")
+	bool BeginStreamingAnimation(bool bCreateLipSync = true, bool bCreateFacialAnimation = true);
+
+	/** Add phonemes to streaming animation */
+	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Controller")
+	bool AppendStreamingPhonemes(const TArray<FPhonemeTextData>& Phonemes);
+
+	/** No more phonemes in streaming animation: build the rest of keys */
+	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Controller")
+	void FinishStreamingAnimation();
+
+	/** Is streaming animation active? */
+	UFUNCTION(BlueprintPure, Category = "Ynnk MetaFace Controller")
+	bool IsStreamingAnimation() const;
+
 	/**
 	* Connect to server to build animation via network
 	*/
@@ -341,6 +430,16 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Controller")
 	void SetEyesTarget(FVector TargetLocation, USceneComponent* TargetComponent = nullptr);
 
+	/**
+	* Set detail level of animation (index in AnimationLODs). Overridden every tick if bAutoAnimationLOD is enabled.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Controller")
+	void SetAnimationLOD(int32 NewLOD);
+
+	/** Get current detail level of animation (index in AnimationLODs) */
+	UFUNCTION(BlueprintPure, Category = "Ynnk MetaFace Controller")
+	int32 GetAnimationLOD() const { return AnimationLOD; }
+
 	/**
 	* Is component initialized and ready to work?
 	*/
@@ -402,26 +501,51 @@ protected:
 	UPROPERTY()
 	float EyesTargetAlpha;
 
-	// Async lipsync generation
-	static FCriticalSection AsyncBuildMutex;
-	bool bAsyncWorkerIsActive = false;
-	bool bExecutionInterrupted = false;
+	// Async lipsync generation: requests in FMetaFaceBuildQueue (request ID -> phrase)
+	TMap<int32, TWeakObjectPtr<UYnnkVoiceLipsyncData>> AsyncBuildRequests;
+	// Request required to speak now, other requests are prefetched
+	int32 SpeakNowRequestId = INDEX_NONE;
 
 	UPROPERTY()
 	float FacialAnimationPauseDuration;
 
-	// ArKit curves used for lip-sync
-	// we keep ithen to apply intensity to baked animation
-	UPROPERTY()
-	TArray<FName> LipSyncARCurvesSet;
+	// Mixing of CurrentBakedFaceFrame (bAutoBakeAnimation), compiled when phrase starts or curves are changed
+	FMetaFaceBlendPlan BakedFramePlan;
 
-	void AsyncBuildAnimation(UYnnkVoiceLipsyncData* LsData);
+	void AsyncBuildAnimation(UYnnkVoiceLipsyncData* LsData, EMetaFaceBuildPriority Priority);
 
-	// Used to get a result from UAsyncAnimBuilder
-	UFUNCTION()
-	void OnAsyncBuilder_AnimationCreated(const TMap<FName, FSimpleFloatCurve>& LipsyncData, const TMap<FName, FSimpleFloatCurve>& FacialAnimationData);
-	UFUNCTION()
-	void OnAsyncBuilder_RequestInterrupted();
+	// Streaming animation (see BeginStreamingAnimation)
+	TSharedPtr<FMetaFaceStreamingBuilder, ESPMode::ThreadSafe> StreamingBuilder;
+
+	// Incremented when a new phrase replaces CurrentLipsync/CurrentFaceAnim, so late streaming chunks are dropped
+	uint32 PhraseId = 0;
+
+	/** Cancel async builds and streaming animation of this controller */
+	void CancelAnimationBuilds(bool bCancelPrefetch = true);
+
+	/** Cancel StreamingBuilder and stop waiting for streamed keys */
+	void CancelStreamingAnimation();
+
+	/** Process queued streaming phonemes (in async thread if bAsyncAnimationBuilder is set) */
+	void ProcessStreamingPhonemes();
+
+	/** Append keys built by StreamingBuilder for phrase BuilderPhraseId to current animations */
+	void OnStreamingChunkReady(const TSharedPtr<FMetaFaceStreamingBuilder, ESPMode::ThreadSafe>& Builder, uint32 BuilderPhraseId, FMetaFaceStreamingChunk&& Chunk);
+
+	// Local build requested while neural models are loaded in background
+	FDelegateHandle ModelsReadyHandle;
+
+	/** Build animation requested before neural models were loaded */
+	void OnNeuralModelsReady(TWeakObjectPtr<UYnnkVoiceLipsyncData> LipsyncData, bool bCreateLipSync, bool bCreateFacialAnimation);
+
+	/** Apply bBalanceSmileFrownCurves to lip-sync curves */
+	void BalanceSmileFrownCurves(FMetaFaceClip& AnimationData) const;
+
+	// Used to get a result from FMetaFaceBuildQueue
+	void OnAsyncBuilder_AnimationCreated(int32 RequestId, bool bSuccess, FMetaFaceBuildResult&& Result);
+
+	/** Move animation built asynchronously to cache and continue delayed speaking */
+	void SaveAsyncBuildResult(UYnnkVoiceLipsyncData* LsData, bool bSpeakNow, FMetaFaceBuildResult&& Result);
 
 	// Used to get a result from remote server
 	UFUNCTION()
@@ -438,6 +562,30 @@ protected:
 	UFUNCTION()
 	void FillEyeAnimationCurves();
 
+	friend class UMetaFaceTickSubsystem;
+
+	// Set if controller is ticked by UMetaFaceTickSubsystem instead of TickComponent
+	TWeakObjectPtr<UMetaFaceTickSubsystem> TickSubsystem;
+	// Facial animation is active in the current tick
+	bool bTickFacialAnimation = false;
+	// Current index in AnimationLODs
+	int32 AnimationLOD = 0;
+	// Eyes are updated in the current tick (see FMetaFaceAnimationLOD::UpdateInterval)
+	bool bTickEyes = true;
+	int32 FramesSinceEyesUpdate = 0;
+	// Time since the last update of eyes
+	float EyesAccumulatedTime = 0.f;
+
+	/** Select AnimationLOD by head mesh (bAutoAnimationLOD) */
+	void UpdateAnimationLOD();
+
+	/** Tick, part 1 (game thread): read lip-sync controller, meshes and eyes target, draw debug */
+	void TickGameThread(float DeltaTime);
+	/** Tick, part 2: update animation frames, baked frame and eyes curves. Only touches state of this controller, so can run in parallel with other controllers */
+	void TickAnimation();
+	/** Tick, part 3 (game thread): disable tick if nothing is animated */
+	void FinishTick();
+
 	bool CheckAnimationCurvesSetIsArKit(const TMap<FName, FSimpleFloatCurve>& Animation, bool bLipSyncCurves) const;
 
 	UNeuralProcessWrapper* GetNeuralProcessor() const;
@@ -11,6 +11,9 @@
 #include "Runtime/Launch/Resources/Version.h"
 
 class UNeuralProcessWrapper;
+class FMetaFaceInferenceService;
+class FMetaFaceWorkerPool;
+class FMetaFaceBuildQueue;
 
 /**
 * YnnkMetaFaceEnhancer module
@@ -33,6 +36,21 @@ public:
 	UNeuralProcessWrapper* GetNeuralProcessor();
 #endif
 
+	/** Get service to batch requests from different callers */
+	FMetaFaceInferenceService* GetInferenceService() const { return InferenceService.Get(); }
+
+	/** Get threads to build animations (always valid while module is loaded) */
+	FMetaFaceWorkerPool& GetWorkerPool() const { return *WorkerPool; }
+
+	/** Get queue of animation build requests shared by all controllers (game thread only) */
+	FMetaFaceBuildQueue& GetBuildQueue() const { return *BuildQueue; }
+
+	/** Are models being loaded in background? Requests to inference service are queued until loading is complete. */
+	bool IsLoadingModels() const;
+
+	/** Called in game thread when models loaded in background are ready (or failed to load) */
+	FSimpleMulticastDelegate& OnModelsReady() { return ModelsReadyEvent; }
+
 	/** Is model valid */
 	bool IsEmotionsModelReady() const;
 	/** Is model valid */
@@ -47,4 +65,15 @@ private:
 #else
 	UNeuralProcessWrapper* NeuralProcessWrapper;
 #endif
+
+	TUniquePtr<FMetaFaceInferenceService> InferenceService;
+
+	TUniquePtr<FMetaFaceWorkerPool> WorkerPool;
+
+	TSharedPtr<FMetaFaceBuildQueue, ESPMode::ThreadSafe> BuildQueue;
+
+	FSimpleMulticastDelegate ModelsReadyEvent;
+
+	/** Load models in background (or synchronously, depending on settings) */
+	void LoadModels();
 };
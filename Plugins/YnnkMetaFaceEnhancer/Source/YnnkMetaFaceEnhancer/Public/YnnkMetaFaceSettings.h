@@ -5,6 +5,8 @@
 
 #include "CoreMinimal.h"
 #include "MetaFaceTypes.h"
+#include "MetaFaceVisemeTable.h"
+#include "HAL/CriticalSection.h"
 #include "YnnkMetaFaceSettings.generated.h"
 
 /**
@@ -59,4 +61,79 @@ public:
 	*/		
 	UPROPERTY(GlobalConfig, EditAnywhere, Category = "General")
 	bool bBalanceSmileFrownCurves;
+
+	/**
+	* Load neural models in background thread at startup. Requests received before models are ready
+	* are queued and processed after loading.
+	*/
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance")
+	bool bLoadModelsInBackground;
+
+	/** Evaluate test phrase after models are loaded, so the first real request is processed at full speed */
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance")
+	bool bWarmUpModels;
+
+	/**
+	* Evaluate neural models by lookup tables (model output for every possible input) instead of TorchScript runtime.
+	* A table is taken from plugin's Resources (*.mfcm, see UMetaFaceEditorFunctionLibrary::ExportCompiledNeuralModels)
+	* or from Saved/YnnkMetaFace if it's made for the same TorchScript model file (size and CRC). Otherwise the model is probed at load time,
+	* and the table is built (and cached) only if model output doesn't depend on previous inputs.
+	*/
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance")
+	bool bUseLookupTables;
+
+	/**
+	* Number of TorchScript model instances used to process requests from different controllers in parallel.
+	* Not used if model is replaced by lookup table.
+	*/
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance", meta = (ClampMin = "1", ClampMax = "16", UIMin = "1", UIMax = "16"))
+	int32 NeuralModelReplicas;
+
+	/**
+	* Time to collect requests from different controllers into a single model call (milliseconds).
+	* Only used for TorchScript models verified at load time to be stateless and to accept sequence input, 0 disables their batching.
+	* Lookup tables (default) batch requests received at the same time without waiting, whatever the value is.
+	*/
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance", meta = (ClampMin = "0.0", ClampMax = "100.0", UIMin = "0.0", UIMax = "20.0"))
+	float BatchingWindowMs;
+
+	/** Maximum number of requests processed in a single model call */
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance", meta = (ClampMin = "1", ClampMax = "256", UIMin = "1", UIMax = "64"))
+	int32 MaxBatchSize;
+
+	/**
+	* Number of threads building animations (model evaluation and conversion to curves).
+	* 0 to use number of CPU cores minus 2 (up to 4). Applied at startup.
+	*/
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance", meta = (ClampMin = "0", ClampMax = "32", UIMin = "0", UIMax = "16"))
+	int32 WorkerThreadsNum;
+
+	/** Priority of threads building animations. Keep it below normal to not compete with game and render threads. */
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance")
+	EMetaFaceThreadPriority WorkerThreadsPriority;
+
+	/** CPU cores mask for threads building animations (0 to use default mask of pool threads). Applied at startup. */
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance")
+	int64 WorkerThreadsAffinityMask;
+
+	/**
+	* Tick all MetaFace controllers of game world by UMetaFaceTickSubsystem instead of their own component ticks.
+	* Facial animation sampling, baked frame mixing and eyes curves of all avatars are updated in parallel.
+	*/
+	UPROPERTY(GlobalConfig, EditAnywhere, Category = "Performance")
+	bool bTickControllersInSubsystem;
+
+	/** Convert WorkerThreadsPriority to engine type */
+	EThreadPriority GetWorkerThreadsPriority() const;
+
+	/** LipsyncVisemesPreset compiled to dense table (thread safe) */
+	FMetaFaceVisemeTablePtr GetVisemeTable() const;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	mutable FCriticalSection VisemeTableSection;
+	mutable FMetaFaceVisemeTablePtr VisemeTable;
 };
\ No newline at end of file
@@ -59,13 +59,22 @@ public class YnnkMetaFaceEnhancer : ModuleRules
 			}
 			);
 
-		if (Target.Platform == UnrealTargetPlatform.Win64)
+		if (Target.Platform == UnrealTargetPlatform.Win64 || Target.Platform == UnrealTargetPlatform.Linux)
 		{
 			// In editor build this would create nested directory in the plugin's directory, because $(BinaryOutputDir) = Plugins/SGVRIK/Binaries
 			if (!Target.bBuildEditor)
 			{
 				RuntimeDependencies.Add("$(BinaryOutputDir)/../../Plugins/YnnkMetaFaceEnhancer/Resources/ynnklipsync.tmod", Path.Combine(ResourcesPath, "ynnklipsync_editor.tmod"), StagedFileType.NonUFS);
 				RuntimeDependencies.Add("$(BinaryOutputDir)/../../Plugins/YnnkMetaFaceEnhancer/Resources/ynnkemotions_en.tmod", Path.Combine(ResourcesPath, "ynnkemotions_en_editor.tmod"), StagedFileType.NonUFS);
+
+				// Compiled models (see UMetaFaceEditorFunctionLibrary::ExportCompiledNeuralModels)
+				foreach (string CompiledModel in new string[] { "ynnklipsync.mfcm", "ynnkemotions_en.mfcm" })
+				{
+					if (File.Exists(Path.Combine(ResourcesPath, CompiledModel)))
+					{
+						RuntimeDependencies.Add("$(BinaryOutputDir)/../../Plugins/YnnkMetaFaceEnhancer/Resources/" + CompiledModel, Path.Combine(ResourcesPath, CompiledModel), StagedFileType.NonUFS);
+					}
+				}
 			}
 		}
 	}
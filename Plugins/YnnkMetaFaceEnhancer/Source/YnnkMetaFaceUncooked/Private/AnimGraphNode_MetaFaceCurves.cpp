@@ -0,0 +1,31 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#include "AnimGraphNode_MetaFaceCurves.h"
+
+/////////////////////////////////////////////////////
+// UAnimGraphNode_MetaFaceCurves
+
+#define LOCTEXT_NAMESPACE "AnimGraph_MetaFaceCurves"
+
+UAnimGraphNode_MetaFaceCurves::UAnimGraphNode_MetaFaceCurves(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+FText UAnimGraphNode_MetaFaceCurves::GetNodeTitle(ENodeTitleType::Type TitleType) const
+{
+	return LOCTEXT("MetaFaceCurvesNode", "MetaFace Curves");
+}
+
+FText UAnimGraphNode_MetaFaceCurves::GetTooltipText() const
+{
+	return LOCTEXT("AnimGraphNode_MetaFaceCurves_Tooltip", "Apply lip-sync and facial animation of Ynnk MetaFace Controller of the owning actor to curves of the pose. Animation is sampled in animation thread.");
+}
+
+FString UAnimGraphNode_MetaFaceCurves::GetNodeCategory() const
+{
+	return TEXT("Ynnk MetaFace");
+}
+
+#undef LOCTEXT_NAMESPACE
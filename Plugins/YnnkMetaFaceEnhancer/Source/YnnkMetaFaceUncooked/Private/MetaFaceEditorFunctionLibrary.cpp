@@ -13,6 +13,8 @@
 #include "Animation/PoseAsset.h"
 #include "YnnkMetaFaceEnhancer.h"
 #include "YnnkMetaFaceController.h"
+#include "NeuralProcessWrapper.h"
+#include "MetaFaceCompiledModel.h"
 #include "Misc/MessageDialog.h"
 
 #define Track_Facial ExtraAnimData2
@@ -277,6 +279,48 @@ bool UMetaFaceEditorFunctionLibrary::BakeFacialAnimation(
 	return true;
 }
 
+bool UMetaFaceEditorFunctionLibrary::ExportCompiledNeuralModels(bool bShowMessages)
+{
+	// Separate wrapper to make sure TorchScript models are loaded
+	UNeuralProcessWrapper* Wrapper = NewObject<UNeuralProcessWrapper>(GetTransientPackage());
+	Wrapper->InitializeTorchModels(true, true);
+
+	const FString ResourcesPath = Wrapper->GetResourcesPath();
+	bool bResult = true;
+
+	for (int32 ModelIndex = 0; ModelIndex < 2; ModelIndex++)
+	{
+		const bool bLipsyncModel = (ModelIndex == 0);
+		const FString FileName = ResourcesPath / (bLipsyncModel ? TEXT("ynnklipsync.mfcm") : TEXT("ynnkemotions_en.mfcm"));
+
+		TArray<FName> CurvesSet;
+		UMFFunctionLibrary::GetMetaFaceCurvesSet(CurvesSet, bLipsyncModel);
+
+		int32 InputMin, InputsNum;
+		TArray<float> Rows;
+		if (!Wrapper->CompileTorchModel(bLipsyncModel, InputMin, InputsNum, Rows)
+			|| !FMetaFaceCompiledModel::SaveToFile(FileName, InputMin, InputsNum, CurvesSet.Num(), Rows, FMetaFaceModelSignature::FromFile(Wrapper->GetModelFile(bLipsyncModel))))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Unable to export compiled model %s"), *FileName);
+			bResult = false;
+			continue;
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("Compiled model saved: %s (%d x %d)"), *FileName, InputsNum, CurvesSet.Num());
+	}
+
+	Wrapper->MarkAsGarbage();
+
+	if (bShowMessages)
+	{
+		FMessageDialog::Open(EAppMsgType::Type::Ok, FText::FromString(bResult
+			? TEXT("Compiled models saved to plugin Resources. They will be used after restart.")
+			: TEXT("Unable to export compiled models. See Output Log for details.")));
+	}
+
+	return bResult;
+}
+
 float UMetaFaceEditorFunctionLibrary::FindMaxValueInCurve(const FSimpleFloatCurve& Curve)
 {
 	float Max = 0.f, Min = 0.f;
@@ -0,0 +1,29 @@
+// (c) Yuri N. K. 2022. All rights reserved.
+// ykasczc@gmail.com
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "AnimGraphNode_Base.h"
+#include "AnimNode_MetaFaceCurves.h"
+#include "AnimGraphNode_MetaFaceCurves.generated.h"
+
+UCLASS(MinimalAPI, meta=(Keywords = "MetaFace, Lip-Sync, Facial Animation, Curves"))
+class UAnimGraphNode_MetaFaceCurves : public UAnimGraphNode_Base
+{
+	GENERATED_UCLASS_BODY()
+
+	UPROPERTY(EditAnywhere, Category=Settings)
+	FAnimNode_MetaFaceCurves Node;
+
+public:
+	// UEdGraphNode interface
+	virtual FText GetNodeTitle(ENodeTitleType::Type TitleType) const override;
+	virtual FText GetTooltipText() const override;
+	// End of UEdGraphNode interface
+
+	// UAnimGraphNode_Base interface
+	virtual FString GetNodeCategory() const override;
+	// End of UAnimGraphNode_Base interface
+};
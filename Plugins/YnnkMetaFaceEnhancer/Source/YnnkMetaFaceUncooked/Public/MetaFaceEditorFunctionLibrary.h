@@ -37,6 +37,13 @@ public:
 		bool bSaveArKitCurves,
 		FString Filter = TEXT(""));
 
+	/**
+	* Evaluate TorchScript models for all possible inputs and save results as compiled models (*.mfcm)
+	* to plugin's Resources directory. They are used at runtime as lookup tables instead of torch (see bUseLookupTables in settings).
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Ynnk MetaFace Editor")
+	static bool ExportCompiledNeuralModels(bool bShowMessages = true);
+
 	static void NormalizeAnimation(TMap<FName, FSimpleFloatCurve>& InOutAnimation);
 	static void NormalizeCurve(FSimpleFloatCurve& InOutAnimation);
 
@@ -33,6 +33,7 @@ namespace UnrealBuildTool.Rules
                     "YnnkVoiceLipsync",
                     "YnnkVoiceLipsyncUncooked",
                     "YnnkMetaFaceEnhancer",
+                    "SimplePyTorch",
                     "AnimationBlueprintLibrary",
                     "AnimationModifiers",
                     "ContentBrowser",